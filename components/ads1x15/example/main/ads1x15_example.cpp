@@ -4,6 +4,7 @@
 
 #include "ads1x15.hpp"
 #include "i2c.hpp"
+#include "interrupt.hpp"
 #include "logger.hpp"
 #include "task.hpp"
 
@@ -63,9 +64,64 @@ extern "C" void app_main(void) {
     ads_task->start();
     //! [ads1x15 example]
     logger.info("%time (s), x, y");
-    while (true) {
+    std::this_thread::sleep_for(5s);
+  }
+
+  // This example shows scanning the adc in the background, reading each
+  // conversion when the ALERT/RDY pin signals that it is ready
+  {
+    logger.info("Running i2c adc scan example!");
+    //! [ads1x15 scan example]
+    espp::I2c i2c({
+        .port = I2C_NUM_1,
+        .sda_io_num = (gpio_num_t)CONFIG_EXAMPLE_I2C_SDA_GPIO,
+        .scl_io_num = (gpio_num_t)CONFIG_EXAMPLE_I2C_SCL_GPIO,
+    });
+    espp::Ads1x15 ads(espp::Ads1x15::Ads1115Config{
+        .device_address = espp::Ads1x15::DEFAULT_ADDRESS,
+        .write = [&i2c](uint8_t addr, const uint8_t *data,
+                        size_t len) { return i2c.write(addr, data, len); },
+        .read = [&i2c](uint8_t addr, uint8_t *data,
+                       size_t len) { return i2c.read(addr, data, len); },
+        .sample_rate = espp::Ads1x15::Ads1115Rate::SPS860,
+    });
+    // the ALERT/RDY pin is open drain, and pulses low when a conversion is
+    // ready
+    espp::Interrupt alert({
+        .interrupts = {{
+            .gpio_num = CONFIG_EXAMPLE_ALERT_GPIO,
+            .callback = [&ads](const auto &event) { ads.notify_conversion_ready(); },
+            .active_level = espp::Interrupt::ActiveLevel::LOW,
+            .interrupt_type = espp::Interrupt::Type::FALLING_EDGE,
+            .pullup_enabled = true,
+        }},
+        .task_config =
+            {
+                .name = "ADS alert",
+                .stack_size_bytes = 4 * 1024,
+                .priority = 10,
+            },
+    });
+    std::error_code ec;
+    if (!ads.start_scan({.channels = {0, 1, 2, 3}, .buffer_size = 256, .use_alert_pin = true},
+                        ec)) {
+      logger.error("error starting the scan: {}", ec.message());
+    }
+    std::vector<espp::Ads1x15::Sample> samples;
+    samples.reserve(256);
+    for (int i = 0; i < 10; i++) {
       std::this_thread::sleep_for(100ms);
+      ads.read_samples(samples);
+      if (samples.empty()) {
+        continue;
+      }
+      const auto &last = samples.back();
+      logger.info("{} samples, last: channel {} = {:.3f} mV", samples.size(), last.channel,
+                  last.mv);
     }
+    logger.info("{} samples dropped", ads.get_num_dropped_samples());
+    ads.stop_scan();
+    //! [ads1x15 scan example]
   }
 
   logger.info("ADS1x15 example complete!");
@@ -1,17 +1,31 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <functional>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 #include "base_peripheral.hpp"
+#include "clock.hpp"
+#include "task.hpp"
 
 namespace espp {
 /**
  * @brief Class for reading values from the ADS1x15 family of ADC chips.
  *
+ * The ADC can also be scanned in the background (see start_scan()), which
+ * round-robins through a list of channels as fast as the data rate allows and
+ * stores the timestamped samples in a ring buffer. Conversions are read
+ * either after the nominal conversion time or, more precisely, when the
+ * ALERT/RDY pin signals that they are ready (see notify_conversion_ready()).
+ *
  * \section ads1x15_ex1 ADS1X15 Example
  * \snippet ads1x15_example.cpp ads1x15 example
+ * \section ads1x15_ex2 ADS1X15 ALERT/RDY Scan Example
+ * \snippet ads1x15_example.cpp ads1x15 scan example
  */
 class Ads1x15 : public BasePeripheral<> {
 public:
@@ -80,6 +94,29 @@ public:
     espp::Logger::Verbosity log_level{espp::Logger::Verbosity::WARN}; ///< Verbosity for the logger.
   };
 
+  /**
+   * @brief A timestamped sample taken by a scan.
+   */
+  struct Sample {
+    Clock::time_point timestamp; ///< When the conversion was read (see espp::Clock).
+    int channel;                 ///< Channel which was sampled.
+    int16_t raw;                 ///< Raw conversion result.
+    float mv;                    ///< Sampled voltage (in mV).
+  };
+
+  /**
+   * @brief Configuration for a scan, see start_scan().
+   */
+  struct ScanConfig {
+    std::vector<int> channels{0}; ///< Channels to sample, in order.
+    size_t buffer_size{64};       ///< Number of samples kept in the ring buffer.
+    bool use_alert_pin{false};    ///< If true, conversions are read when
+                                  ///< notify_conversion_ready() is called (e.g. from an
+                                  ///< espp::Interrupt on the ALERT/RDY pin), instead of after
+                                  ///< their nominal conversion time.
+    Task::BaseConfig task_config{.name = "Ads1x15 Scan"}; ///< Configuration for the scan task.
+  };
+
   /**
    * @brief Construct Ads1x15 specficially for ADS1015.
    * @param config Configuration structure.
@@ -119,11 +156,107 @@ public:
     return raw_to_mv(raw);
   }
 
+  /**
+   * @brief Stop the scan, if any.
+   */
+  ~Ads1x15() { stop_scan(); }
+
+  /**
+   * @brief Start scanning the channels in the background, storing the samples
+   *        in a ring buffer which can be read with read_samples().
+   * @details The threshold registers are written once for the scan, to put
+   *          the ALERT/RDY pin in conversion ready mode (if it is used).
+   *          Scanning a single channel uses continuous mode, so each sample
+   *          only needs the conversion register to be read. Scanning multiple
+   *          channels uses single-shot conversions, where after reading each
+   *          result a single write of the config register switches the mux
+   *          and starts the next conversion.
+   *
+   *          Without the ALERT/RDY pin, conversions are read after their
+   *          nominal conversion time (with some margin for single-shot
+   *          conversions). Since the ADC's oscillator is only accurate to
+   *          about 10%, continuous mode may then occasionally repeat or skip a
+   *          sample; use the ALERT/RDY pin for exact timing. sample_mv() can
+   *          not be used while scanning.
+   * @param config Configuration of the scan.
+   * @param ec Error code to set if there is an error.
+   * @return True if the scan was started.
+   */
+  bool start_scan(const ScanConfig &config, std::error_code &ec);
+
+  /**
+   * @brief Stop the scan, leaving the samples in the ring buffer.
+   */
+  void stop_scan();
+
+  /**
+   * @brief Whether the ADC is being scanned.
+   * @return True if a scan is running.
+   */
+  bool is_scanning() const { return scanning_; }
+
+  /**
+   * @brief Tell the scan that a conversion is ready. Call this on the active
+   *        edge of the ALERT/RDY pin, e.g. from an espp::Interrupt callback,
+   *        when scanning with ScanConfig::use_alert_pin.
+   */
+  void notify_conversion_ready() {
+    {
+      std::lock_guard<std::mutex> lock(scan_mutex_);
+      conversion_ready_ = true;
+    }
+    scan_cv_.notify_one();
+  }
+
+  /**
+   * @brief Move the samples taken since the last call out of the ring buffer.
+   * @param samples Vector to fill with the samples, oldest first. It is
+   *        cleared first, and does not allocate if its capacity is enough.
+   * @return The number of samples.
+   */
+  size_t read_samples(std::vector<Sample> &samples) {
+    std::lock_guard<std::mutex> lock(samples_mutex_);
+    samples.clear();
+    for (; num_read_ < num_written_; num_read_++) {
+      samples.push_back(samples_[num_read_ % samples_.size()]);
+    }
+    return samples.size();
+  }
+
+  /**
+   * @brief Get the number of samples which were overwritten in the ring
+   *        buffer before they were read.
+   * @return The number of dropped samples since the scan was started.
+   */
+  size_t get_num_dropped_samples() const {
+    std::lock_guard<std::mutex> lock(samples_mutex_);
+    return num_dropped_;
+  }
+
 protected:
   int16_t sample_raw(int channel, std::error_code &ec);
 
   bool conversion_complete(std::error_code &ec);
 
+  int16_t conversion_to_raw(uint16_t value) const {
+    value >>= bit_shift_;
+    if (bit_shift_ > 0) {
+      if (value > 0x07FF) {
+        // negative number - extend the sign to the 16th bit
+        value |= 0xF000;
+      }
+    }
+    return (int16_t)value;
+  }
+
+  std::chrono::duration<float> get_conversion_time() const;
+
+  bool scan_task_fn(std::mutex &m, std::condition_variable &cv);
+
+  void start_scan_conversion(std::error_code &ec);
+
+  void read_scan_conversion(std::error_code &ec);
+
   float raw_to_mv(int16_t raw) const {
     // see data sheet Table 3
     float fsRange;
@@ -166,5 +299,23 @@ protected:
     uint16_t rate_;
   };
   int bit_shift_;
+
+  std::atomic<bool> scanning_{false};
+  std::vector<int> scan_channels_;
+  size_t scan_index_{0};
+  bool use_alert_pin_{false};
+  uint16_t scan_config_{0};
+  Clock::time_point conversion_start_;
+  std::mutex scan_mutex_;
+  std::condition_variable scan_cv_;
+  bool conversion_ready_{false};
+  bool scan_stopping_{false};
+  std::unique_ptr<Task> scan_task_;
+
+  mutable std::mutex samples_mutex_;
+  std::vector<Sample> samples_;
+  size_t num_written_{0};
+  size_t num_read_{0};
+  size_t num_dropped_{0};
 };
 } // namespace espp
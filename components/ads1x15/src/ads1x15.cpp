@@ -51,6 +51,11 @@ static constexpr uint16_t REG_CONFIG_CQUE_NONE =
     (0x0003); ///< Disable the comparator and put ALERT/RDY in high state (default)
 
 int16_t Ads1x15::sample_raw(int channel, std::error_code &ec) {
+  if (scanning_) {
+    logger_.error("cannot sample channel {} while scanning", channel);
+    ec = std::make_error_code(std::errc::device_or_resource_busy);
+    return 0;
+  }
   // Start with default values
   uint16_t config = REG_CONFIG_MODE_SINGLE;
   // This is equivalent to the below (since the rest are 0x0000):
@@ -93,18 +98,12 @@ int16_t Ads1x15::sample_raw(int channel, std::error_code &ec) {
     return 0;
   }
   logger_.debug("reading conversion result for channel {}", channel);
-  uint16_t val = read_u16_from_register((uint8_t)Register::POINTER_CONVERT, ec) >> bit_shift_;
+  uint16_t val = read_u16_from_register((uint8_t)Register::POINTER_CONVERT, ec);
   if (ec) {
     logger_.error("error reading conversion result for channel {}", channel);
     return 0;
   }
-  if (bit_shift_ > 0) {
-    if (val > 0x07FF) {
-      // negative number - extend the sign to the 16th bit
-      val |= 0xF000;
-    }
-  }
-  return (int16_t)val;
+  return conversion_to_raw(val);
 }
 
 bool Ads1x15::conversion_complete(std::error_code &ec) {
@@ -115,3 +114,204 @@ bool Ads1x15::conversion_complete(std::error_code &ec) {
   }
   return (val & REG_CONFIG_OS_NOTBUSY) == REG_CONFIG_OS_NOTBUSY;
 }
+
+bool Ads1x15::start_scan(const ScanConfig &config, std::error_code &ec) {
+  stop_scan();
+  if (config.channels.empty()) {
+    logger_.error("no channels to scan");
+    ec = std::make_error_code(std::errc::invalid_argument);
+    return false;
+  }
+  for (auto channel : config.channels) {
+    if (channel < 0 || channel > 3) {
+      logger_.error("invalid channel {} to scan", channel);
+      ec = std::make_error_code(std::errc::invalid_argument);
+      return false;
+    }
+  }
+  if (config.use_alert_pin) {
+    // conversion ready mode: the ALERT/RDY pin asserts after each conversion
+    // when the MSB of HITHRESH is 1 and the MSB of LOWTHRESH is 0
+    write_u16_to_register((uint8_t)Register::POINTER_HITHRESH, 0x8000, ec);
+    if (ec) {
+      logger_.error("error configuring hi threshold for scan");
+      return false;
+    }
+    write_u16_to_register((uint8_t)Register::POINTER_LOWTHRESH, 0x0000, ec);
+    if (ec) {
+      logger_.error("error configuring low threshold for scan");
+      return false;
+    }
+  }
+  bool continuous = config.channels.size() == 1;
+  scan_channels_ = config.channels;
+  scan_index_ = 0;
+  use_alert_pin_ = config.use_alert_pin;
+  scan_config_ = (uint16_t)gain_ | rate_;
+  scan_config_ |= continuous ? REG_CONFIG_MODE_CONTIN : REG_CONFIG_MODE_SINGLE;
+  scan_config_ |= config.use_alert_pin ? REG_CONFIG_CQUE_1CONV : REG_CONFIG_CQUE_NONE;
+  {
+    std::lock_guard<std::mutex> lock(samples_mutex_);
+    samples_.resize(std::max<size_t>(config.buffer_size, 1));
+    num_written_ = 0;
+    num_read_ = 0;
+    num_dropped_ = 0;
+  }
+  logger_.info("scanning {} channels in {} mode", scan_channels_.size(),
+               continuous ? "continuous" : "single-shot");
+  start_scan_conversion(ec);
+  if (ec) {
+    logger_.error("error starting the first conversion of the scan");
+    return false;
+  }
+  {
+    // ignore ALERT/RDY pulses from before the scan
+    std::lock_guard<std::mutex> lock(scan_mutex_);
+    conversion_ready_ = false;
+    scan_stopping_ = false;
+  }
+  if (continuous) {
+    // leave the pointer at the conversion register, so that each sample is a
+    // single read
+    write_u8((uint8_t)Register::POINTER_CONVERT, ec);
+    if (ec) {
+      logger_.error("error setting the pointer to the conversion register");
+      return false;
+    }
+  }
+  scanning_ = true;
+  using namespace std::placeholders;
+  scan_task_ = Task::make_unique(Task::AdvancedConfig{
+      .callback = std::bind(&Ads1x15::scan_task_fn, this, _1, _2),
+      .task_config = config.task_config,
+      .log_level = espp::Logger::Verbosity::WARN,
+  });
+  scan_task_->start();
+  return true;
+}
+
+void Ads1x15::stop_scan() {
+  if (!scan_task_) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(scan_mutex_);
+    scan_stopping_ = true;
+  }
+  scan_cv_.notify_all();
+  scan_task_.reset();
+  scanning_ = false;
+  // stop continuous conversions
+  std::error_code ec;
+  write_u16_to_register((uint8_t)Register::POINTER_CONFIG, scan_config_ | REG_CONFIG_MODE_SINGLE,
+                        ec);
+  if (ec) {
+    logger_.error("error stopping the scan: {}", ec.message());
+  }
+}
+
+std::chrono::duration<float> Ads1x15::get_conversion_time() const {
+  // the data rates by value of the DR bits of the config register
+  static constexpr float ADS1015_RATES[] = {128, 250, 490, 920, 1600, 2400, 3300, 3300};
+  static constexpr float ADS1115_RATES[] = {8, 16, 32, 64, 128, 250, 475, 860};
+  size_t index = (rate_ >> 5) & 0x7;
+  return std::chrono::duration<float>(1.0f / (bit_shift_ > 0 ? ADS1015_RATES[index]
+                                                             : ADS1115_RATES[index]));
+}
+
+bool Ads1x15::scan_task_fn(std::mutex &m, std::condition_variable &cv) {
+  auto conversion_time = get_conversion_time();
+  bool continuous = scan_channels_.size() == 1;
+  {
+    std::unique_lock<std::mutex> lock(scan_mutex_);
+    if (use_alert_pin_) {
+      // don't stall on a missed ALERT/RDY edge: after a few conversion times,
+      // read the conversion anyway
+      auto deadline =
+          conversion_start_ + std::chrono::duration_cast<Clock::duration>(conversion_time * 4);
+      while (!conversion_ready_ && !scan_stopping_ &&
+             Clock::wait_until(scan_cv_, lock, deadline) == std::cv_status::no_timeout) {
+      }
+      if (!conversion_ready_ && !scan_stopping_) {
+        logger_.debug("no ALERT/RDY for the conversion, reading it anyway");
+      }
+    } else {
+      // single-shot conversions may take up to 10% longer than nominal
+      auto wait = continuous ? conversion_time : conversion_time * 1.15f;
+      auto deadline = conversion_start_ + std::chrono::duration_cast<Clock::duration>(wait);
+      while (!scan_stopping_ &&
+             Clock::wait_until(scan_cv_, lock, deadline) == std::cv_status::no_timeout) {
+      }
+    }
+    if (scan_stopping_) {
+      return true;
+    }
+    conversion_ready_ = false;
+  }
+  std::error_code ec;
+  read_scan_conversion(ec);
+  if (ec) {
+    logger_.error("error reading scan conversion: {}", ec.message());
+    // retry after another conversion time
+    conversion_start_ = Clock::now();
+    if (scan_channels_.size() > 1) {
+      ec.clear();
+      start_scan_conversion(ec);
+    }
+  }
+  return false;
+}
+
+void Ads1x15::start_scan_conversion(std::error_code &ec) {
+  write_u16_to_register((uint8_t)Register::POINTER_CONFIG,
+                        scan_config_ | MUX_BY_CHANNEL[scan_channels_[scan_index_]] |
+                            REG_CONFIG_OS_SINGLE,
+                        ec);
+  // the conversion starts once the write is complete
+  conversion_start_ = Clock::now();
+}
+
+void Ads1x15::read_scan_conversion(std::error_code &ec) {
+  int channel = scan_channels_[scan_index_];
+  bool continuous = scan_channels_.size() == 1;
+  uint16_t value = 0;
+  if (continuous) {
+    // the pointer is left at the conversion register
+    value = read_u16(ec);
+  } else {
+    // the result must be read before the next conversion is started, which
+    // would replace it
+    value = read_u16_from_register((uint8_t)Register::POINTER_CONVERT, ec);
+  }
+  if (ec) {
+    return;
+  }
+  int16_t raw = conversion_to_raw(value);
+  {
+    std::lock_guard<std::mutex> lock(samples_mutex_);
+    if (num_written_ - num_read_ == samples_.size()) {
+      // the ring buffer is full, overwrite the oldest sample
+      num_read_++;
+      num_dropped_++;
+    }
+    samples_[num_written_ % samples_.size()] = {
+        .timestamp = Clock::now(),
+        .channel = channel,
+        .raw = raw,
+        .mv = raw_to_mv(raw),
+    };
+    num_written_++;
+  }
+  if (continuous) {
+    // keep reading at the data rate, unless we have fallen behind
+    auto conversion_time = std::chrono::duration_cast<Clock::duration>(get_conversion_time());
+    auto now = Clock::now();
+    conversion_start_ += conversion_time;
+    if (conversion_start_ + conversion_time < now) {
+      conversion_start_ = now;
+    }
+  } else {
+    scan_index_ = (scan_index_ + 1) % scan_channels_.size();
+    start_scan_conversion(ec);
+  }
+}
@@ -190,8 +190,10 @@ extern "C" void app_main(void) {
       auto elapsed = std::chrono::duration<float>(now - start).count();
 
       std::error_code ec;
-      // get the analog input data
-      auto all_mv = ads.get_all_mv(ec);
+      // get the analog input data. This overload fills in the provided buffer
+      // instead of returning a (heap allocated) vector.
+      float mv_buffer[espp::Ads7138::NUM_CHANNELS];
+      auto all_mv = ads.get_all_mv(mv_buffer, ec);
       if (ec) {
         logger.error("error getting analog data: {}", ec.message());
         return false;
@@ -200,7 +202,8 @@ extern "C" void app_main(void) {
       auto y_mv = all_mv[1]; // the second channel is channel 3 (Y axis)
 
       // alternatively we could get the analog data in a map
-      auto mapped_mv = ads.get_all_mv_map(ec);
+      espp::Ads7138::ChannelMap<float> mapped_mv;
+      ads.get_all_mv_map(mapped_mv, ec);
       if (ec) {
         logger.error("error getting analog data: {}", ec.message());
         return false;
@@ -5,10 +5,12 @@
 #include <functional>
 #include <mutex>
 #include <numeric>
+#include <span>
 #include <thread>
 #include <unordered_map>
 
 #include "base_peripheral.hpp"
+#include "flat_map.hpp"
 
 namespace espp {
 /**
@@ -25,12 +27,14 @@ namespace espp {
  * @section ads7138_ex1 ADS7138 Example
  * @snippet ads7138_example.cpp ads7138 example
  */
-class Ads7138 : public BasePeripheral<> {
+class Ads7138 : public BasePeripheral<std::uint8_t, true, peripheral_lock::Configurable> {
 public:
   static constexpr uint8_t DEFAULT_ADDRESS =
       (0x10); ///< Default I2C address of the device (when both R1 and R2 are DNP) (see data sheet
               ///< Table 2, p. 16)
 
+  static constexpr size_t NUM_CHANNELS = 8; ///< Number of channels on the ADC
+
   /// @brief Possible oversampling ratios, see data sheet Table 15 (p. 34)
   enum class OversamplingRatio : uint8_t {
     NONE = 0,   ///< No oversampling
@@ -59,6 +63,9 @@ public:
     CH7 = 7, ///< Channel 7
   };
 
+  /// @brief Fixed-capacity (non-allocating) map from channel to value.
+  template <typename T> using ChannelMap = espp::FlatMap<Channel, T, NUM_CHANNELS>;
+
   /// @brief Possible modes for analog input conversion
   ///
   /// The ADS7128 device has the following sampling modes:
@@ -153,6 +160,10 @@ public:
     BasePeripheral::read_fn read;   ///< Function to read from the ADC
     bool auto_init = true;          ///< Automatically initialize the ADC on construction. If false,
                                     ///< initialize() must be called before any other functions.
+    peripheral_lock::Mode lock_mode =
+        peripheral_lock::Mode::MUTEX; ///< How register access is locked, see espp::peripheral_lock.
+    std::recursive_mutex *bus_mutex = nullptr; ///< Bus mutex for peripheral_lock::Mode::BUS, e.g.
+                                               ///< espp::I2c::get_mutex().
     espp::Logger::Verbosity log_level{espp::Logger::Verbosity::WARN}; ///< Verbosity for the logger.
   };
 
@@ -174,6 +185,7 @@ public:
       , digital_inputs_(config.digital_inputs)
       , digital_outputs_(config.digital_outputs)
       , oversampling_ratio_(config.oversampling_ratio) {
+    set_lock_mode(config.lock_mode, config.bus_mutex);
     // initialize the ADC
     if (config.auto_init) {
       std::error_code ec;
@@ -209,7 +221,7 @@ public:
    *       configured as an analog input.
    */
   float get_mv(Channel channel, std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    std::lock_guard lock(base_mutex_);
     if (mode_ == Mode::MANUAL) {
       // If auto conversion is not enabled, we need to trigger a conversion
       // and wait for it to complete.
@@ -246,17 +258,41 @@ public:
    *       ADC's buffer (blocking until conversion is complete).
    */
   std::vector<float> get_all_mv(std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    std::vector<float> values(analog_inputs_.size());
+    get_all_mv(values, ec);
+    if (ec)
+      return {};
+    return values;
+  }
+
+  /**
+   * @brief Communicate with the ADC to get the analog value for all channels
+   *        and store them in \p values, without allocating.
+   * @param values Buffer to store the voltages (in mV) in. Must have room for
+   *        (at least) the number of analog inputs configured in the
+   *        constructor.
+   * @param ec Error code to set if an error occurs.
+   * @return The part of \p values which was filled in, in the order of the
+   *         channels configured in the constructor. Empty on error.
+   * @note See get_all_mv(std::error_code &) for more information.
+   */
+  std::span<float> get_all_mv(std::span<float> values, std::error_code &ec) {
+    std::lock_guard lock(base_mutex_);
+    if (values.size() < analog_inputs_.size()) {
+      logger_.error("Buffer too small for {} analog inputs", analog_inputs_.size());
+      ec = std::make_error_code(std::errc::invalid_argument);
+      return {};
+    }
     // TODO: handle the non-autonomous case
-    auto raw_values = read_recent_all(ec);
+    uint16_t raw_buffer[NUM_CHANNELS];
+    auto raw_values = read_recent_all(raw_buffer, ec);
     if (ec)
       return {};
-    std::vector<float> values(analog_inputs_.size());
     // convert the raw values (uint16_t) to mv (float)
-    for (int i = 0; i < raw_values.size(); i++) {
+    for (size_t i = 0; i < raw_values.size(); i++) {
       values[i] = raw_to_mv(raw_values[i]);
     }
-    return values;
+    return values.first(raw_values.size());
   }
 
   /**
@@ -271,17 +307,33 @@ public:
    *       ADC's buffer (blocking until conversion is complete).
    */
   std::unordered_map<Channel, float> get_all_mv_map(std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(mutex_);
-    std::unordered_map<Channel, float> values;
-    // TODO: handle the non-autonomous case
-    auto raw_values = read_mapped_recent_all(ec);
+    ChannelMap<float> mapped_values;
+    get_all_mv_map(mapped_values, ec);
     if (ec)
       return {};
+    return {mapped_values.begin(), mapped_values.end()};
+  }
+
+  /**
+   * @brief Communicate with the ADC to get the analog value for all channels
+   *        and store them in \p values, without allocating.
+   * @param values Map to store the voltages (in mV) read from each channel
+   *        in. It is cleared first.
+   * @param ec Error code to set if an error occurs.
+   * @note See get_all_mv_map(std::error_code &) for more information.
+   */
+  void get_all_mv_map(ChannelMap<float> &values, std::error_code &ec) {
+    std::lock_guard lock(base_mutex_);
+    values.clear();
+    // TODO: handle the non-autonomous case
+    ChannelMap<uint16_t> raw_values;
+    read_mapped_recent_all(raw_values, ec);
+    if (ec)
+      return;
     // convert the raw values (uint16_t) to mv (float)
     for (auto &[channel, raw] : raw_values) {
       values[channel] = raw_to_mv(raw);
     }
-    return values;
   }
 
   /// @brief Configure the ALERT pin
@@ -289,7 +341,7 @@ public:
   /// @param alert_logic Alert logic for ALERT pin
   /// @param ec Error code to set if an error occurs.
   void configure_alert(OutputMode output_mode, AlertLogic alert_logic, std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    std::lock_guard lock(base_mutex_);
     // set the ALERT_PIN_CFG register
     if (output_mode == OutputMode::OPEN_DRAIN) {
       set_bits_(Register::ALERT_PIN_CFG, ALERT_DRIVE, ec);
@@ -320,7 +372,7 @@ public:
   /// @note The channel must have been configured as an analog input.
   void set_analog_alert(Channel channel, float high_threshold_mv, float low_threshold_mv,
                         AnalogEvent event, int event_count, std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    std::lock_guard lock(base_mutex_);
     // if it's a digital output channel, we can't set thresholds
     if (!is_analog_input(channel)) {
       logger_.error("Channel {} is configured as a digital output, cannot set alert", channel);
@@ -348,7 +400,7 @@ public:
   /// @param event Event type which will generate an alert
   /// @param ec Error code to set if an error occurs.
   void set_digital_alert(Channel channel, DigitalEvent event, std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    std::lock_guard lock(base_mutex_);
     // if it's not a digital input channel we can't set a digital alert
     if (!is_digital_input(channel)) {
       logger_.error("Channel {} is not configured as a digital input, cannot set alert", channel);
@@ -375,7 +427,7 @@ public:
   /// @note The event flags are cleared after reading.
   void get_event_data(uint8_t *event_flags, uint8_t *event_high_flags, uint8_t *event_low_flags,
                       std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    std::lock_guard lock(base_mutex_);
     // read the event data registers
     uint8_t read_val[3] = {0};
     read_val[0] = read_one_(Register::EVENT_FLAG, ec);
@@ -439,7 +491,7 @@ public:
   /// @param ec Error code to set if an error occurs.
   /// @note The channel must have been configured as a digital output.
   void set_digital_output_mode(Channel channel, OutputMode output_mode, std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    std::lock_guard lock(base_mutex_);
     if (!is_digital_output(channel)) {
       logger_.error("Channel {} is not configured as a digital output", channel);
       ec = std::make_error_code(std::errc::invalid_argument);
@@ -462,7 +514,7 @@ public:
    * @note The channel must have been configured as a digital output.
    */
   void set_digital_output_value(Channel channel, bool value, std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    std::lock_guard lock(base_mutex_);
     if (!is_digital_output(channel)) {
       logger_.error("Channel {} is not configured as a digital output", channel);
       ec = std::make_error_code(std::errc::invalid_argument);
@@ -483,7 +535,7 @@ public:
    * @note The channel must have been configured as a digital input.
    */
   bool get_digital_input_value(Channel channel, std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    std::lock_guard lock(base_mutex_);
     if (!is_digital_input(channel)) {
       logger_.error("Channel {} is not configured as a digital input", channel);
       ec = std::make_error_code(std::errc::invalid_argument);
@@ -514,7 +566,7 @@ public:
   /// @note If the write is successful, the function will wait for the reset
   ///       to complete before returning
   void reset(std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    std::lock_guard lock(base_mutex_);
     // reset the device
     write_one_(Register::GENERAL_CFG, SW_RST, ec);
     if (ec)
@@ -1031,14 +1083,14 @@ protected:
         static_cast<Register>(static_cast<uint8_t>(Register::RECENT_CH0_LSB) + channel * 2), ec);
   }
 
-  std::vector<uint16_t> read_recent_all(std::error_code &ec) {
+  std::span<uint16_t> read_recent_all(std::span<uint16_t, NUM_CHANNELS> values,
+                                      std::error_code &ec) {
     if (!statistics_enabled_) {
       logger_.error("Statistics are not enabled, cannot read recent value");
       ec = std::make_error_code(std::errc::protocol_error);
       return {};
     }
     logger_.info("Reading recent values for all channels");
-    std::vector<uint16_t> values(analog_inputs_.size());
     uint8_t raw_values[16];
     read_block_(Register::RECENT_CH0_LSB, raw_values, 16, ec);
     if (ec)
@@ -1053,21 +1105,21 @@ protected:
         values[analog_index++] = (msb << 8) | lsb;
       }
     }
-    return values;
+    return values.first(analog_index);
   }
 
-  std::unordered_map<Channel, uint16_t> read_mapped_recent_all(std::error_code &ec) {
+  void read_mapped_recent_all(ChannelMap<uint16_t> &values, std::error_code &ec) {
     if (!statistics_enabled_) {
       logger_.error("Statistics are not enabled, cannot read recent value");
       ec = std::make_error_code(std::errc::protocol_error);
-      return {};
+      return;
     }
     logger_.info("Reading recent mapped values for all channels");
-    std::unordered_map<Channel, uint16_t> values;
+    values.clear();
     uint8_t raw_values[16];
     read_block_(Register::RECENT_CH0_LSB, raw_values, 16, ec);
     if (ec)
-      return {};
+      return;
     // only pull out the ones that were configured as analog inputs
     for (int i = 0; i < 8; i++) {
       Channel ch = static_cast<Channel>(i);
@@ -1078,7 +1130,6 @@ protected:
         values[ch] = (msb << 8) | lsb;
       }
     }
-    return values;
   }
 
   uint16_t read_max(Channel ch, std::error_code &ec) {
@@ -1416,7 +1467,6 @@ protected:
   // used, so we don't use the subclass's read_* and write_* methods directly
 
   uint8_t read_one_(Register reg, std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
     uint8_t data = 0;
     uint8_t read_one_command[] = {OP_READ_ONE, (uint8_t)reg};
     write_then_read(read_one_command, sizeof(read_one_command), &data, 1, ec);
@@ -1439,25 +1489,21 @@ protected:
   }
 
   void read_block_(Register reg, uint8_t *data, uint8_t len, std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
     uint8_t read_block_command[] = {OP_READ_BLOCK, (uint8_t)reg};
     write_then_read(read_block_command, sizeof(read_block_command), data, len, ec);
   }
 
   void set_bits_(Register reg, uint8_t bit, std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
     uint8_t data[] = {OP_SET_BITS, (uint8_t)reg, bit};
     write_many(data, sizeof(data), ec);
   }
 
   void clear_bits_(Register reg, uint8_t bit, std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
     uint8_t data[] = {OP_CLR_BITS, (uint8_t)reg, bit};
     write_many(data, sizeof(data), ec);
   }
 
   void write_one_(Register reg, uint8_t value, std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
     uint8_t data[] = {OP_WRITE_ONE, (uint8_t)reg, value};
     write_many(data, sizeof(data), ec);
   }
@@ -1467,7 +1513,6 @@ protected:
   }
 
   void write_block_(Register reg, const uint8_t *data, uint8_t len, std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
     uint8_t total_len = len + 2;
     uint8_t data_with_header[total_len];
     data_with_header[0] = OP_WRITE_BLOCK;
@@ -1488,7 +1533,6 @@ protected:
   std::vector<Channel> digital_inputs_;
   std::vector<Channel> digital_outputs_;
   OversamplingRatio oversampling_ratio_;
-  std::recursive_mutex mutex_; ///< mutex for thread safety
 };
 } // namespace espp
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cassert>
 #include <chrono>
 #include <cstdint>
 #include <functional>
@@ -8,8 +9,100 @@
 #include <thread>
 
 #include "base_component.hpp"
+#include "inplace_function.hpp"
 
 namespace espp {
+/// Locking policies for BasePeripheral, selected with its LockPolicy template
+/// parameter.
+namespace peripheral_lock {
+/// No locking. Use this for peripherals which are only ever accessed from a
+/// single task (and whose bus functions are safe to call from that task), so
+/// that register accesses compile to lock-free code.
+struct None {
+  void lock() {}
+  bool try_lock() { return true; }
+  void unlock() {}
+};
+
+/// The peripheral has its own (recursive) mutex. This is the default, and is
+/// safe for peripherals which are shared between tasks. Note that the bus
+/// functions (e.g. espp::I2c::write) may take their own lock as well.
+using Mutex = std::recursive_mutex;
+
+/// The peripheral locks the mutex of the bus it is on (see
+/// BasePeripheral::set_bus_mutex), e.g. espp::I2c::get_mutex(). The bus lock
+/// is then the only lock: it is held across multi-transaction operations
+/// (such as set_bits_in_register) so they are atomic with respect to every
+/// other device on the bus, and the bus functions re-lock it recursively
+/// instead of taking a second mutex.
+/// @note Using the peripheral before a bus mutex is set is an error, which
+///       asserts. If asserts are disabled (NDEBUG), nothing is locked.
+class Bus {
+public:
+  void set_mutex(std::recursive_mutex *mutex) { mutex_ = mutex; }
+  void lock() {
+    assert(mutex_ && "peripheral_lock::Bus used before set_bus_mutex()");
+    if (mutex_)
+      mutex_->lock();
+  }
+  bool try_lock() {
+    assert(mutex_ && "peripheral_lock::Bus used before set_bus_mutex()");
+    return mutex_ ? mutex_->try_lock() : true;
+  }
+  void unlock() {
+    if (mutex_)
+      mutex_->unlock();
+  }
+
+protected:
+  std::recursive_mutex *mutex_{nullptr};
+};
+
+/// The lock used by a peripheral_lock::Configurable
+enum class Mode {
+  MUTEX, ///< The peripheral's own mutex, as with peripheral_lock::Mutex
+  NONE,  ///< No locking, as with peripheral_lock::None
+  BUS,   ///< The mutex of the bus, as with peripheral_lock::Bus
+};
+
+/// Selects one of the other policies at runtime (see
+/// BasePeripheral::set_lock_mode), for drivers which are not templated on
+/// the LockPolicy and instead have it in their Config. Each lock costs a
+/// (predictable) branch on the mode. Defaults to Mode::MUTEX.
+class Configurable {
+public:
+  void set_mode(Mode mode, std::recursive_mutex *bus_mutex) {
+    mode_ = mode;
+    bus_mutex_ = bus_mutex;
+  }
+  Mode get_mode() const { return mode_; }
+  void lock() {
+    if (mode_ == Mode::MUTEX)
+      mutex_.lock();
+    else if (mode_ == Mode::BUS)
+      bus_mutex_->lock();
+  }
+  bool try_lock() {
+    if (mode_ == Mode::MUTEX)
+      return mutex_.try_lock();
+    if (mode_ == Mode::BUS)
+      return bus_mutex_->try_lock();
+    return true;
+  }
+  void unlock() {
+    if (mode_ == Mode::MUTEX)
+      mutex_.unlock();
+    else if (mode_ == Mode::BUS)
+      bus_mutex_->unlock();
+  }
+
+protected:
+  Mode mode_{Mode::MUTEX};
+  std::recursive_mutex mutex_;
+  std::recursive_mutex *bus_mutex_{nullptr};
+};
+} // namespace peripheral_lock
+
 /// Base class for all peripherals
 /// This class provides a common interface for all peripherals
 ///
@@ -17,30 +110,45 @@ namespace espp {
 /// read data from the peripheral, and write then read data from the
 /// peripheral.
 ///
-/// The peripheral is protected by a mutex to ensure that only one
-/// operation can be performed at a time.
-template <std::integral RegisterAddressType = std::uint8_t, bool UseAddress = true>
+/// By default, the peripheral is protected by a mutex to ensure that only
+/// one operation can be performed at a time. The LockPolicy template
+/// parameter selects how the peripheral is locked (see
+/// espp::peripheral_lock): not at all for peripherals which are only used
+/// from one task, with its own mutex (the default), or with the mutex of the
+/// bus it shares with other peripherals. Drivers which use
+/// peripheral_lock::Configurable select one of these at runtime instead,
+/// from their Config.
+///
+/// The bus functions are stored in espp::InplaceFunction objects, so
+/// configuring the peripheral never allocates and calling them is a single
+/// indirect call. Anything up to a lambda capturing four pointers or a
+/// std::bind of a member function (e.g. std::bind(&espp::I2c::write, &i2c,
+/// _1, _2, _3)) fits, larger callables fail to compile. The capacity
+/// (espp::INPLACE_FUNCTION_DEFAULT_CAPACITY) can be raised with
+/// CONFIG_ESPP_INPLACE_FUNCTION_CAPACITY.
+template <std::integral RegisterAddressType = std::uint8_t, bool UseAddress = true,
+          typename LockPolicy = peripheral_lock::Mutex>
 class BasePeripheral : public BaseComponent {
 public:
   /// Function to probe the peripheral
   /// \param address The address to probe
   /// \return True if the peripheral is found at the given address
-  typedef std::function<bool(uint8_t)> probe_fn;
+  typedef InplaceFunction<bool(uint8_t)> probe_fn;
 
   // Functions for writing/reading data to/from the peripheral that take an address
   // as the first parameter
-  typedef std::function<bool(uint8_t, const uint8_t *, size_t)> write_to_address_fn;
-  typedef std::function<bool(uint8_t, uint8_t *, size_t)> read_from_address_fn;
-  typedef std::function<bool(uint8_t, RegisterAddressType, uint8_t *, size_t)>
+  typedef InplaceFunction<bool(uint8_t, const uint8_t *, size_t)> write_to_address_fn;
+  typedef InplaceFunction<bool(uint8_t, uint8_t *, size_t)> read_from_address_fn;
+  typedef InplaceFunction<bool(uint8_t, RegisterAddressType, uint8_t *, size_t)>
       read_register_from_address_fn;
-  typedef std::function<bool(uint8_t, const uint8_t *, size_t, uint8_t *, size_t)>
+  typedef InplaceFunction<bool(uint8_t, const uint8_t *, size_t, uint8_t *, size_t)>
       write_then_read_from_address_fn;
 
   // Functions for writing/reading data to/from the peripheral that do not take an address
-  typedef std::function<bool(const uint8_t *, size_t)> write_no_address_fn;
-  typedef std::function<bool(uint8_t *, size_t)> read_no_address_fn;
-  typedef std::function<bool(RegisterAddressType, uint8_t *, size_t)> read_register_no_address_fn;
-  typedef std::function<bool(const uint8_t *, size_t, uint8_t *, size_t)>
+  typedef InplaceFunction<bool(const uint8_t *, size_t)> write_no_address_fn;
+  typedef InplaceFunction<bool(uint8_t *, size_t)> read_no_address_fn;
+  typedef InplaceFunction<bool(RegisterAddressType, uint8_t *, size_t)> read_register_no_address_fn;
+  typedef InplaceFunction<bool(const uint8_t *, size_t, uint8_t *, size_t)>
       write_then_read_no_address_fn;
 
   // Simplify the function types based on whether the peripheral uses an address
@@ -77,7 +185,7 @@ public:
   ///      and set the error code to operation_not_supported
   /// \note This function is only available if UseAddress is true
   bool probe(std::error_code &ec) requires(UseAddress) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::lock_guard lock(base_mutex_);
     if (base_config_.probe) {
       return base_config_.probe(base_config_.address);
     } else {
@@ -86,12 +194,45 @@ public:
     return false;
   }
 
+  /// Set the mutex of the bus that the peripheral is on
+  /// \param mutex The bus mutex, which must also be locked (recursively) by
+  ///        the bus functions of every peripheral on the bus, e.g.
+  ///        espp::I2c::get_mutex()
+  /// \note This must be called before the peripheral is used from multiple
+  ///       tasks.
+  /// \note This function is only available if LockPolicy is
+  ///       peripheral_lock::Bus
+  void set_bus_mutex(std::recursive_mutex &mutex)
+      requires(std::is_same_v<LockPolicy, peripheral_lock::Bus>) {
+    base_mutex_.set_mutex(&mutex);
+  }
+
+  /// Select the lock of the peripheral
+  /// \param mode Which lock to use
+  /// \param bus_mutex The bus mutex, required for Mode::BUS, which must also
+  ///        be locked (recursively) by the bus functions of every peripheral
+  ///        on the bus, e.g. espp::I2c::get_mutex()
+  /// \note If \p mode is Mode::BUS and \p bus_mutex is null, an error is
+  ///       logged and the peripheral's own mutex is used.
+  /// \note This must be called before the peripheral is used from multiple
+  ///       tasks, e.g. from the driver's constructor.
+  /// \note This function is only available if LockPolicy is
+  ///       peripheral_lock::Configurable
+  void set_lock_mode(peripheral_lock::Mode mode, std::recursive_mutex *bus_mutex = nullptr)
+      requires(std::is_same_v<LockPolicy, peripheral_lock::Configurable>) {
+    if (mode == peripheral_lock::Mode::BUS && !bus_mutex) {
+      logger_.error("Bus lock mode requires a bus mutex, using the peripheral's own mutex");
+      mode = peripheral_lock::Mode::MUTEX;
+    }
+    base_mutex_.set_mode(mode, bus_mutex);
+  }
+
   /// Set the address of the peripheral
   /// \param address The address of the peripheral
   /// \note This function is thread safe
   /// \note This function is only available if UseAddress is true
   void set_address(uint8_t address) requires(UseAddress) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::lock_guard lock(base_mutex_);
     base_config_.address = address;
   }
 
@@ -103,7 +244,7 @@ public:
   ///      using the set_config function instead.
   /// \note This function is only available if UseAddress is true
   void set_probe(const probe_fn &probe) requires(UseAddress) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::lock_guard lock(base_mutex_);
     base_config_.probe = probe;
   }
 
@@ -114,7 +255,7 @@ public:
   ///       the constructor. If you need to change the write function, consider
   ///       using the set_config function instead.
   void set_write(const write_fn &write) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::lock_guard lock(base_mutex_);
     base_config_.write = write;
   }
 
@@ -125,7 +266,7 @@ public:
   ///      the constructor. If you need to change the read function, consider
   ///      using the set_config function instead.
   void set_read(const read_fn &read) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::lock_guard lock(base_mutex_);
     base_config_.read = read;
   }
 
@@ -136,7 +277,7 @@ public:
   ///      set in the constructor. If you need to change the read register
   ///      function, consider using the set_config function instead.
   void set_read_register(const read_register_fn &read_register) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::lock_guard lock(base_mutex_);
     base_config_.read_register = read_register;
   }
 
@@ -146,7 +287,7 @@ public:
   /// \note This should rarely be used, as the write then read function is
   ///      usually set in the constructor. If you need to change the write then
   void set_write_then_read(const write_then_read_fn &write_then_read) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::lock_guard lock(base_mutex_);
     base_config_.write_then_read = write_then_read;
   }
 
@@ -161,7 +302,7 @@ public:
   ///      a custom function and the write and read functions are separate
   ///      functions.
   void set_separate_write_then_read_delay(const std::chrono::milliseconds &delay) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::lock_guard lock(base_mutex_);
     base_config_.separate_write_then_read_delay = delay;
   }
 
@@ -173,7 +314,7 @@ public:
   ///       peripheral has been created - for instance if the peripheral could
   ///       be found on different communications buses.
   void set_config(const Config &config) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::lock_guard lock(base_mutex_);
     base_config_ = config;
   }
 
@@ -185,7 +326,7 @@ public:
   ///       peripheral has been created - for instance if the peripheral could
   ///       be found on different communications buses.
   void set_config(Config &&config) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::lock_guard lock(base_mutex_);
     base_config_ = std::move(config);
   }
 
@@ -212,7 +353,7 @@ protected:
   /// \param length The length of the data to write
   /// \param ec The error code to set if there is an error
   void write(const uint8_t *data, size_t length, std::error_code &ec) requires(UseAddress) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::lock_guard lock(base_mutex_);
     if (base_config_.write) {
       if (!base_config_.write(base_config_.address, data, length)) {
         ec = std::make_error_code(std::errc::io_error);
@@ -229,7 +370,7 @@ protected:
   /// \param length The length of the data to write
   /// \param ec The error code to set if there is an error
   void write(const uint8_t *data, size_t length, std::error_code &ec) requires(!UseAddress) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::lock_guard lock(base_mutex_);
     if (base_config_.write) {
       if (!base_config_.write(data, length)) {
         ec = std::make_error_code(std::errc::io_error);
@@ -246,7 +387,7 @@ protected:
   /// \param length The length of the buffer
   /// \param ec The error code to set if there is an error
   void read(uint8_t *data, size_t length, std::error_code &ec) requires(UseAddress) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::lock_guard lock(base_mutex_);
     if (base_config_.read) {
       if (!base_config_.read(base_config_.address, data, length)) {
         ec = std::make_error_code(std::errc::io_error);
@@ -263,7 +404,7 @@ protected:
   /// \param length The length of the buffer
   /// \param ec The error code to set if there is an error
   void read(uint8_t *data, size_t length, std::error_code &ec) requires(!UseAddress) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::lock_guard lock(base_mutex_);
     if (base_config_.read) {
       if (!base_config_.read(data, length)) {
         ec = std::make_error_code(std::errc::io_error);
@@ -282,7 +423,7 @@ protected:
   /// \param ec The error code to set if there is an error
   void read_register(RegisterAddressType reg_addr, uint8_t *data, size_t length,
                      std::error_code &ec) requires(UseAddress) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::lock_guard lock(base_mutex_);
     if (base_config_.read_register) {
       if (!base_config_.read_register(base_config_.address, reg_addr, data, length)) {
         ec = std::make_error_code(std::errc::io_error);
@@ -301,7 +442,7 @@ protected:
   /// \param ec The error code to set if there is an error
   void read_register(RegisterAddressType reg_addr, uint8_t *data, size_t length,
                      std::error_code &ec) requires(!UseAddress) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::lock_guard lock(base_mutex_);
     if (base_config_.read_register) {
       if (!base_config_.read_register(reg_addr, data, length)) {
         ec = std::make_error_code(std::errc::io_error);
@@ -321,7 +462,7 @@ protected:
   /// \param ec The error code to set if there is an error
   void write_then_read(const uint8_t *write_data, size_t write_length, uint8_t *read_data,
                        size_t read_length, std::error_code &ec) requires(UseAddress) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::lock_guard lock(base_mutex_);
     if (base_config_.write_then_read) {
       logger_.debug("write_then_read write: {}, read: {} bytes", write_length, read_length);
       if (!base_config_.write_then_read(base_config_.address, write_data, write_length, read_data,
@@ -353,7 +494,7 @@ protected:
   /// \param ec The error code to set if there is an error
   void write_then_read(const uint8_t *write_data, size_t write_length, uint8_t *read_data,
                        size_t read_length, std::error_code &ec) requires(!UseAddress) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::lock_guard lock(base_mutex_);
     if (base_config_.write_then_read) {
       logger_.debug("write_then_read write: {}, read: {} bytes", write_length, read_length);
       if (!base_config_.write_then_read(write_data, write_length, read_data, read_length)) {
@@ -495,7 +636,6 @@ protected:
   uint8_t read_u8_from_register(RegisterAddressType register_address, std::error_code &ec) {
     logger_.debug("read u8 from register 0x{:x}", register_address);
     uint8_t data = 0;
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
     if (base_config_.read_register) {
       read_register(register_address, &data, 1, ec);
     } else {
@@ -519,7 +659,6 @@ protected:
   uint16_t read_u16_from_register(RegisterAddressType register_address, std::error_code &ec) {
     logger_.debug("read u16 from register 0x{:x}", register_address);
     uint8_t data[2];
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
     if (base_config_.read_register) {
       read_register(register_address, data, 2, ec);
     } else {
@@ -545,7 +684,6 @@ protected:
                                std::error_code &ec) {
     logger_.debug("read_many_from_register {} bytes from register 0x{:x}", length,
                   register_address);
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
     if (base_config_.read_register) {
       read_register(register_address, data, length, ec);
     } else {
@@ -567,7 +705,7 @@ protected:
   void set_bits_in_register(RegisterAddressType register_address, uint8_t mask,
                             std::error_code &ec) {
     logger_.debug("set_bits_in_register 0x{:x} with mask 0x{:x}", register_address, mask);
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::lock_guard lock(base_mutex_);
     uint8_t data = read_u8_from_register(register_address, ec);
     if (ec) {
       return;
@@ -585,7 +723,7 @@ protected:
   void clear_bits_in_register(RegisterAddressType register_address, uint8_t mask,
                               std::error_code &ec) {
     logger_.debug("clear_bits_in_register 0x{:x} with mask 0x{:x}", register_address, mask);
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::lock_guard lock(base_mutex_);
     uint8_t data = read_u8_from_register(register_address, ec);
     if (ec) {
       return;
@@ -611,6 +749,6 @@ protected:
   }
 
   Config base_config_;              ///< The configuration for the peripheral
-  std::recursive_mutex base_mutex_; ///< The mutex to protect access to the peripheral
+  LockPolicy base_mutex_; ///< The lock to protect access to the peripheral
 };
 } // namespace espp
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace espp {
+/**
+ * @brief A key or button of an input peripheral changing state.
+ */
+struct InputEvent {
+  uint16_t code; ///< Code of the key or button, specific to the peripheral (e.g. the character
+                 ///< of a key, or the index of a button).
+  bool pressed;  ///< True if the key or button was pressed, false if it was released.
+  std::chrono::steady_clock::time_point timestamp; ///< When the event was read.
+};
+
+/**
+ * @brief Lock-free queue of the InputEvents of an input peripheral, from the
+ *        task polling the peripheral to the task handling the events.
+ *
+ * @details The queue is a ring buffer with a single producer (the polling
+ *          task) and a single consumer, which neither blocks nor allocates.
+ *          If the consumer falls behind and the queue is full, new events
+ *          are dropped and counted.
+ *
+ * @tparam Capacity Number of events the queue holds, a power of 2.
+ */
+template <size_t Capacity = 32> class InputEventQueue {
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                "Capacity must be a power of 2");
+
+public:
+  /**
+   * @brief Add an event to the queue. Only called by the producer.
+   * @param event The event.
+   * @return True if the event was added, false if the queue was full.
+   */
+  bool push(const InputEvent &event) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == Capacity) {
+      num_dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    events_[tail % Capacity] = event;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Remove the oldest event from the queue. Only called by the
+   *        consumer.
+   * @param event Set to the event, if there is one.
+   * @return True if an event was removed, false if the queue was empty.
+   */
+  bool pop(InputEvent &event) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    event = events_[head % Capacity];
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Get the number of events in the queue.
+   * @return The number of events.
+   */
+  size_t size() const {
+    return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+  }
+
+  /**
+   * @brief Whether the queue is empty.
+   * @return True if there are no events in the queue.
+   */
+  bool empty() const { return size() == 0; }
+
+  /**
+   * @brief Get the number of events which were dropped because the queue was
+   *        full.
+   * @return The number of dropped events.
+   */
+  size_t get_num_dropped() const { return num_dropped_.load(std::memory_order_relaxed); }
+
+protected:
+  std::array<InputEvent, Capacity> events_{};
+  std::atomic<size_t> head_{0};
+  std::atomic<size_t> tail_{0};
+  std::atomic<size_t> num_dropped_{0};
+};
+} // namespace espp
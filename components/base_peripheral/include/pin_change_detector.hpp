@@ -0,0 +1,165 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+#include "base_component.hpp"
+#include "task.hpp"
+
+namespace espp {
+/**
+ * @brief Debounces the pins of a GPIO expander, which are read when its
+ *        interrupt pin signals a change, and calls a callback with each
+ *        debounced change. The callback runs in a task which only wakes up
+ *        after the pins were read, so nothing is polled while the pins are
+ *        stable.
+ *
+ * @details The driver calls update() with the pins it read. A change is
+ *          reported once the pins have not changed for the debounce time, so
+ *          a bouncing contact is reported as a single change.
+ *
+ * @note This is used by the GPIO expander drivers (e.g. Mcp23x17 and
+ *       Kts1622) for their change detection mode, and does not access the
+ *       bus itself.
+ */
+class PinChangeDetector : public BaseComponent {
+public:
+  /**
+   * @brief A debounced change of the pins.
+   */
+  struct Event {
+    uint16_t pins;    ///< Debounced state of the pins.
+    uint16_t changed; ///< Pins whose debounced state changed (1 = changed).
+    std::chrono::steady_clock::time_point timestamp; ///< When the pins were first read in
+                                                     ///< their new state.
+  };
+
+  /**
+   * @brief Callback for the debounced changes of the pins.
+   */
+  typedef std::function<void(const Event &)> callback_fn;
+
+  /**
+   * @brief Configuration of the PinChangeDetector.
+   */
+  struct Config {
+    uint16_t mask{0xFFFF}; ///< Pins to report changes of (1 = report).
+    std::chrono::duration<float> debounce_time{
+        std::chrono::milliseconds(10)}; ///< How long the pins must be stable before a change
+                                        ///< is reported.
+    callback_fn callback{nullptr};      ///< Called with each debounced change.
+    Task::BaseConfig task_config{
+        .name = "PinChangeDetector",
+        .stack_size_bytes = 4 * 1024}; ///< Configuration of the task running the callback.
+    Logger::Verbosity log_level{Logger::Verbosity::WARN}; ///< Log verbosity.
+  };
+
+  /**
+   * @brief Construct the PinChangeDetector and start its task.
+   * @param config Configuration of the PinChangeDetector.
+   * @param pins The current state of the pins.
+   */
+  PinChangeDetector(const Config &config, uint16_t pins)
+      : BaseComponent("PinChangeDetector", config.log_level)
+      , mask_(config.mask)
+      , debounce_time_(
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(config.debounce_time))
+      , callback_(config.callback)
+      , pins_(pins)
+      , debounced_pins_(pins) {
+    using namespace std::placeholders;
+    task_ = Task::make_unique(Task::AdvancedConfig{
+        .callback = std::bind(&PinChangeDetector::task_fn, this, _1, _2),
+        .task_config = config.task_config,
+        .log_level = config.log_level,
+    });
+    task_->start();
+  }
+
+  /**
+   * @brief Stop the task.
+   */
+  ~PinChangeDetector() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    cv_.notify_all();
+    task_.reset();
+  }
+
+  /**
+   * @brief Update the state of the pins, as read from the device.
+   * @param pins The state of the pins.
+   */
+  void update(uint16_t pins) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (pins == pins_) {
+        return;
+      }
+      pins_ = pins;
+      last_change_ = std::chrono::steady_clock::now();
+      pending_ = true;
+    }
+    cv_.notify_all();
+  }
+
+  /**
+   * @brief Get the state of the pins, as last read from the device.
+   * @return The state of the pins (not debounced).
+   */
+  uint16_t get_pins() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pins_;
+  }
+
+  /**
+   * @brief Get the debounced state of the pins.
+   * @return The debounced state of the pins.
+   */
+  uint16_t get_debounced_pins() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return debounced_pins_;
+  }
+
+protected:
+  bool task_fn(std::mutex &m, std::condition_variable &cv) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return pending_ || stopping_; });
+    // wait until the pins have been stable for the debounce time; each
+    // update() while waiting restarts the wait
+    while (!stopping_ && std::chrono::steady_clock::now() < last_change_ + debounce_time_) {
+      cv_.wait_until(lock, last_change_ + debounce_time_);
+    }
+    if (stopping_) {
+      return true;
+    }
+    pending_ = false;
+    uint16_t changed = (pins_ ^ debounced_pins_) & mask_;
+    debounced_pins_ = pins_;
+    if (!changed || !callback_) {
+      return false;
+    }
+    Event event{.pins = debounced_pins_, .changed = changed, .timestamp = last_change_};
+    lock.unlock();
+    logger_.debug("Pins changed: {:#06x} ({:#06x})", event.pins, event.changed);
+    callback_(event);
+    return false;
+  }
+
+  uint16_t mask_;
+  std::chrono::steady_clock::duration debounce_time_;
+  callback_fn callback_;
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  uint16_t pins_;
+  uint16_t debounced_pins_;
+  std::chrono::steady_clock::time_point last_change_{};
+  bool pending_{false};
+  bool stopping_{false};
+  std::unique_ptr<Task> task_;
+};
+} // namespace espp
@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "base_component.hpp"
+#include "clock.hpp"
 #include "bldc_motor.hpp"
 #include "detent_config.hpp"
 #include "haptic_config.hpp"
@@ -277,7 +278,7 @@ protected:
   /// @param cv Condition variable to use for the task
   /// @return True if the task should be stopped, false otherwise
   bool motor_task(std::mutex &m, std::condition_variable &cv) {
-    auto start_time = std::chrono::steady_clock::now();
+    auto start_time = Clock::now();
     // if we are not moving, and we're close to the center (but not exactly at
     // the center), slowly move back to the center
 
@@ -412,7 +413,7 @@ protected:
     {
       using namespace std::chrono_literals;
       std::unique_lock<std::mutex> lk(m);
-      cv.wait_until(lk, start_time + 1ms);
+      Clock::wait_until(cv, lk, start_time + 1ms);
     }
 
     // don't want to stop the task
@@ -4,6 +4,7 @@
 
 #include "base_component.hpp"
 #include "fast_math.hpp"
+#include "inplace_function.hpp"
 #include "pid.hpp"
 
 #include "bldc_types.hpp"
@@ -72,7 +73,7 @@ public:
    * @param raw Most recent raw sample measured.
    * @return Filtered output from the input.
    */
-  typedef std::function<float(float raw)> filter_fn;
+  typedef InplaceFunction<float(float raw)> filter_fn;
 
   /**
    * @brief BLDC Motor / FOC configuration structure
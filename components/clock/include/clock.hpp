@@ -0,0 +1,321 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <thread>
+
+namespace espp {
+/// @brief Clock provides an injectable time source for espp components.
+/// @details By default, Clock is a thin wrapper around
+///          std::chrono::steady_clock and the standard condition variable /
+///          sleep functions. Components which are driven by time (Task,
+///          Timer, Pid, Logger, etc.) use Clock instead of reading
+///          std::chrono::steady_clock directly, so that the time source can
+///          be replaced.
+///
+///          When simulated time is enabled (see set_simulated()), now()
+///          returns a virtual time which only moves forward when every
+///          participating thread is blocked in one of the Clock wait / sleep
+///          functions. At that point the virtual time immediately jumps to
+///          the earliest pending deadline and the corresponding waiter(s) are
+///          woken. This allows time-driven code to run deterministically and
+///          much faster than real time, e.g. in host tests.
+///
+///          Every espp::Task is automatically a participant for as long as
+///          its thread is running. Other threads which wait on the Clock
+///          (such as the main thread of a test) should create a
+///          Clock::Participant for as long as they are doing work that the
+///          simulation should wait for.
+///
+/// @note Simulated time only advances while all participants are blocked in
+///       Clock waits. A participant blocked on anything else (e.g. a socket,
+///       or a condition variable wait which does not go through Clock::wait)
+///       will stall the simulation.
+/// @note Simulated time should be enabled / disabled before any Tasks are
+///       started.
+///
+/// Example usage in a host test:
+/// @code{.cpp}
+///   espp::Clock::set_simulated(true);
+///   espp::Clock::Participant participant; // main thread takes part in the simulation
+///   espp::Timer timer({.name = "Timer", .period = 100ms, .callback = ...});
+///   espp::Clock::sleep_for(10s); // returns as soon as the timer has run 100 times
+/// @endcode
+class Clock {
+public:
+  using duration = std::chrono::steady_clock::duration;     ///< Clock duration type.
+  using time_point = std::chrono::steady_clock::time_point; ///< Clock time point type.
+
+  /// @brief RAII helper which registers the current thread as a participant
+  ///        in the simulated time for the lifetime of the object.
+  /// @details While a participant is running (i.e. not blocked in a Clock
+  ///          wait / sleep), simulated time will not advance.
+  class Participant {
+  public:
+    /// @brief Register the current thread as a participant.
+    Participant() {
+      Clock::add_participant();
+      is_participant_ = true;
+    }
+
+    /// @brief Adopt a participant which was already added using
+    ///        Clock::add_participant() on behalf of the current thread.
+    /// @note This is used by Task, which adds the participant before the
+    ///       thread is created so that time cannot advance before the thread
+    ///       starts running.
+    struct adopt_t {};
+    explicit Participant(adopt_t) { is_participant_ = true; }
+
+    /// @brief Unregister the current thread as a participant.
+    ~Participant() { Clock::remove_participant(); }
+
+    Participant(const Participant &) = delete;
+    Participant &operator=(const Participant &) = delete;
+  };
+
+  /// @brief Get the current time.
+  /// @return The current (real or simulated) time.
+  static time_point now() {
+    if (simulated_) {
+      return time_point(duration(simulated_ticks_.load()));
+    }
+    return std::chrono::steady_clock::now();
+  }
+
+  /// @brief Enable or disable simulated time.
+  /// @details When enabled, the simulated time starts at the current real
+  ///          time, so that time points taken before and after enabling are
+  ///          still comparable.
+  /// @param simulated True to use simulated time, false to use real time.
+  static void set_simulated(bool simulated) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (simulated && !simulated_) {
+      simulated_ticks_ = std::chrono::steady_clock::now().time_since_epoch().count();
+    }
+    simulated_ = simulated;
+    if (!simulated) {
+      // release anyone waiting on simulated time
+      release_all();
+    }
+  }
+
+  /// @brief Is simulated time enabled?
+  /// @return True if simulated time is enabled, false otherwise.
+  static bool is_simulated() { return simulated_; }
+
+  /// @brief Manually advance the simulated time, waking any waiters whose
+  ///        deadline has passed.
+  /// @param delta The amount of time to advance.
+  /// @note Does nothing if simulated time is not enabled.
+  static void advance(duration delta) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!simulated_) {
+      return;
+    }
+    simulated_ticks_ += delta.count();
+    release_expired();
+  }
+
+  /// @brief Sleep until the provided time.
+  /// @param deadline The time to sleep until.
+  static void sleep_until(time_point deadline) {
+    if (!simulated_) {
+      std::this_thread::sleep_until(deadline);
+      return;
+    }
+    std::mutex m;
+    std::condition_variable cv;
+    std::unique_lock<std::mutex> lock(m);
+    while (simulated_wait_until(cv, lock, deadline) == std::cv_status::no_timeout) {
+      // nobody else can notify this cv, so keep waiting
+    }
+  }
+
+  /// @brief Sleep for the provided duration.
+  /// @param delta The duration to sleep for.
+  template <class Rep, class Period>
+  static void sleep_for(const std::chrono::duration<Rep, Period> &delta) {
+    sleep_until(now() + std::chrono::duration_cast<duration>(delta));
+  }
+
+  /// @brief Wait on the condition variable until notified or until the
+  ///        provided time.
+  /// @details Equivalent to std::condition_variable::wait_until, but uses the
+  ///          Clock time source.
+  /// @param cv The condition variable to wait on.
+  /// @param lock The (locked) lock associated with the condition variable.
+  /// @param deadline The time to wait until.
+  /// @return std::cv_status::timeout if the deadline was reached,
+  ///         std::cv_status::no_timeout otherwise.
+  static std::cv_status wait_until(std::condition_variable &cv, std::unique_lock<std::mutex> &lock,
+                                   time_point deadline) {
+    if (!simulated_) {
+      return cv.wait_until(lock, deadline);
+    }
+    return simulated_wait_until(cv, lock, deadline);
+  }
+
+  /// @brief Wait on the condition variable until notified.
+  /// @details Equivalent to std::condition_variable::wait, but in simulated
+  ///          time the calling participant is considered blocked while it
+  ///          waits, so that it does not stall the simulation.
+  /// @param cv The condition variable to wait on.
+  /// @param lock The (locked) lock associated with the condition variable.
+  static void wait(std::condition_variable &cv, std::unique_lock<std::mutex> &lock) {
+    if (!simulated_) {
+      cv.wait(lock);
+      return;
+    }
+    simulated_wait_until(cv, lock, time_point::max());
+  }
+
+  /// @brief Wait on the condition variable until notified or until the
+  ///        provided duration has elapsed.
+  /// @param cv The condition variable to wait on.
+  /// @param lock The (locked) lock associated with the condition variable.
+  /// @param delta The duration to wait for.
+  /// @return std::cv_status::timeout if the duration elapsed,
+  ///         std::cv_status::no_timeout otherwise.
+  template <class Rep, class Period>
+  static std::cv_status wait_for(std::condition_variable &cv, std::unique_lock<std::mutex> &lock,
+                                 const std::chrono::duration<Rep, Period> &delta) {
+    return wait_until(cv, lock, now() + std::chrono::duration_cast<duration>(delta));
+  }
+
+  /// @brief Add a participant to the simulated time.
+  /// @note Prefer using Clock::Participant. This can be called on behalf of
+  ///       a thread which has not started yet, which must then construct a
+  ///       Clock::Participant with Clock::Participant::adopt_t.
+  static void add_participant() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    num_running_++;
+  }
+
+  /// @brief Remove the current thread as a participant in the simulated time.
+  /// @note Prefer using Clock::Participant.
+  static void remove_participant() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_participant_ = false;
+    num_running_--;
+    maybe_advance();
+  }
+
+protected:
+  /// How long (real time) a simulated waiter waits on its condition variable
+  /// before re-checking the simulated time. This only bounds the latency of a
+  /// wakeup which raced with the waiter blocking.
+  static constexpr auto MISSED_WAKEUP_TIMEOUT = std::chrono::milliseconds(5);
+
+  struct Waiter {
+    std::condition_variable *cv;
+    time_point deadline;
+    bool participant;
+    std::atomic<bool> released{false};
+  };
+
+  static std::cv_status simulated_wait_until(std::condition_variable &cv,
+                                             std::unique_lock<std::mutex> &lock,
+                                             time_point deadline) {
+    Waiter waiter{.cv = &cv, .deadline = deadline, .participant = is_participant_};
+    {
+      std::lock_guard<std::mutex> clock_lock(mutex_);
+      if (now() >= deadline) {
+        return std::cv_status::timeout;
+      }
+      waiters_.push_back(&waiter);
+      if (waiter.participant) {
+        num_running_--;
+      }
+      maybe_advance();
+    }
+    std::cv_status status = std::cv_status::timeout;
+    // only the clock decides when the deadline has been reached, since other
+    // waiters with the same deadline may need to run first
+    while (simulated_ && !waiter.released) {
+      if (cv.wait_for(lock, MISSED_WAKEUP_TIMEOUT) == std::cv_status::no_timeout &&
+          !waiter.released) {
+        // notified (or spurious wakeup) before the deadline
+        status = std::cv_status::no_timeout;
+        break;
+      }
+    }
+    {
+      std::lock_guard<std::mutex> clock_lock(mutex_);
+      if (!waiter.released) {
+        waiters_.remove(&waiter);
+        if (waiter.participant) {
+          num_running_++;
+        }
+      }
+    }
+    return status;
+  }
+
+  /// Advance the simulated time to the earliest deadline if every participant
+  /// is blocked, and wake that waiter. Must be called with mutex_ held.
+  /// @note Only one waiter is woken at a time; waiters with the same deadline
+  ///       are woken in the order in which they started waiting, once the
+  ///       previously woken waiter blocks again. This keeps the simulation
+  ///       deterministic.
+  static void maybe_advance() {
+    if (!simulated_ || num_running_ > 0 || waiters_.empty()) {
+      return;
+    }
+    auto earliest = std::min_element(waiters_.begin(), waiters_.end(), [](auto *a, auto *b) {
+      return a->deadline < b->deadline;
+    });
+    if ((*earliest)->deadline == time_point::max()) {
+      // everyone is waiting to be notified, so there is no deadline to
+      // advance to
+      return;
+    }
+    auto deadline_ticks = (*earliest)->deadline.time_since_epoch().count();
+    if (deadline_ticks > simulated_ticks_) {
+      simulated_ticks_ = deadline_ticks;
+    }
+    release(*earliest);
+    waiters_.erase(earliest);
+  }
+
+  /// Wake all waiters whose deadline has passed. Must be called with mutex_
+  /// held.
+  static void release_expired() {
+    auto current = now();
+    for (auto it = waiters_.begin(); it != waiters_.end();) {
+      if ((*it)->deadline <= current) {
+        release(*it);
+        it = waiters_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  /// Wake all waiters. Must be called with mutex_ held.
+  static void release_all() {
+    for (auto *waiter : waiters_) {
+      release(waiter);
+    }
+    waiters_.clear();
+  }
+
+  static void release(Waiter *waiter) {
+    waiter->released = true;
+    if (waiter->participant) {
+      num_running_++;
+    }
+    waiter->cv->notify_all();
+  }
+
+  static inline std::atomic<bool> simulated_{false};
+  static inline std::atomic<duration::rep> simulated_ticks_{0};
+  static inline std::mutex mutex_;
+  static inline int num_running_{0};
+  static inline std::list<Waiter *> waiters_;
+  static inline thread_local bool is_participant_{false};
+};
+} // namespace espp
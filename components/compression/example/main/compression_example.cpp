@@ -0,0 +1,46 @@
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "compression.hpp"
+#include "format.hpp"
+
+extern "C" void app_main(void) {
+  {
+    fmt::print("Starting compression example\n");
+    //! [compression example]
+    // the compressed frame is appended to this vector, but it could just as
+    // well be sent over a socket (espp::make_socket_writer) or written to a
+    // file (espp::make_stream_writer)
+    std::vector<uint8_t> compressed;
+    espp::LzCompressor compressor({
+        .block_size = 4 * 1024,
+        .independent_blocks = true,
+        .write = espp::make_container_writer(compressed),
+    });
+    for (int i = 0; i < 1000; i++) {
+      compressor.write(fmt::format("[Motor/I]: speed = {} rpm, current = {:.2f} A\n", 1000 + i % 7,
+                                   0.5f + (i % 5) * 0.01f));
+    }
+    // finish the frame, flushing the last (partial) block
+    compressor.finish();
+    fmt::print("Compressed {} bytes into {} bytes\n", compressor.get_bytes_in(),
+               compressed.size());
+
+    std::vector<uint8_t> decompressed;
+    espp::LzDecompressor decompressor({.write = espp::make_container_writer(decompressed)});
+    std::error_code ec;
+    if (!decompressor.feed(compressed, ec) || !decompressor.is_complete()) {
+      fmt::print("Decompression failed: {}\n", ec.message());
+    } else {
+      fmt::print("Decompressed {} bytes\n", decompressed.size());
+    }
+    //! [compression example]
+  }
+
+  fmt::print("Compression example complete!\n");
+
+  while (true) {
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+  }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <system_error>
+#include <vector>
+
+#include "compression.hpp"
+#include "serialization.hpp"
+
+namespace espp {
+/**
+ * @brief Serialize data using the default options and compress it into the
+ *        container as a single frame.
+ * @param data Structure to be serialized.
+ * @param container Container class to append the compressed data to.
+ * @param block_size Maximum block size of the frame.
+ * @return Number of bytes that were appended to the container.
+ */
+template <class T, class Container>
+auto serialize_compressed(const T &data, Container &container, size_t block_size = 4 * 1024)
+    -> size_t {
+  std::vector<uint8_t> serialized;
+  serialize(data, serialized);
+  size_t size_before = container.size();
+  lz_compress(serialized, container, block_size);
+  return container.size() - size_before;
+}
+
+/**
+ * @brief Decompress a frame and deserialize it into a new object of type T
+ *        using the default serialization options.
+ * @param container The container of compressed, serialized data
+ *        representing an object of type T.
+ * @param ec The error code that was generated during decompression or
+ *        deserialization, if any.
+ * @return The object that was deserialized. Only valid if !ec.
+ */
+template <class T, class Container>
+auto deserialize_compressed(const Container &container, std::error_code &ec) -> T {
+  std::vector<uint8_t> serialized;
+  if (!lz_decompress(std::span<const uint8_t>(container.data(), container.size()), serialized,
+                     ec)) {
+    return T{};
+  }
+  return deserialize<T>(serialized, ec);
+}
+} // namespace espp
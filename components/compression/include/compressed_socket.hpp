@@ -0,0 +1,51 @@
+#pragma once
+
+#include <span>
+#include <system_error>
+
+#include "compression.hpp"
+#include "tcp_socket.hpp"
+
+namespace espp {
+/**
+ * @brief Make a write callback which transmits data over a connected
+ *        TcpSocket, e.g. to stream an LzCompressor's output to a peer.
+ * @param socket The connected socket. Must outlive the callback.
+ * @return The write callback.
+ */
+inline lz_write_fn make_socket_writer(TcpSocket &socket) {
+  return [&socket](std::span<const uint8_t> data) {
+    return socket.transmit(std::string_view((const char *)data.data(), data.size()));
+  };
+}
+
+/**
+ * @brief Receive compressed data from a connected TcpSocket and feed it to
+ *        a decompressor, until the peer closes the connection (or the
+ *        socket's receive timeout / cancellation token ends the receive).
+ * @param socket The connected socket.
+ * @param decompressor The decompressor, whose write callback receives the
+ *        decompressed data.
+ * @param buffer Buffer for the received (compressed) data.
+ * @param ec Set if the received data is malformed or incomplete.
+ * @return True if the received data formed complete frames, false
+ *         otherwise.
+ */
+inline bool receive_decompressed(TcpSocket &socket, LzDecompressor &decompressor,
+                                 std::span<uint8_t> buffer, std::error_code &ec) {
+  while (true) {
+    size_t received = socket.receive(buffer.data(), buffer.size());
+    if (received == 0) {
+      break;
+    }
+    if (!decompressor.feed(buffer.first(received), ec)) {
+      return false;
+    }
+  }
+  if (!decompressor.is_complete()) {
+    ec = std::make_error_code(std::errc::message_size);
+    return false;
+  }
+  return true;
+}
+} // namespace espp
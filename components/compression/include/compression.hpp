@@ -0,0 +1,499 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "lz_block.hpp"
+
+namespace espp {
+/**
+ * @brief Callback which receives the output of an LzCompressor or
+ *        LzDecompressor.
+ * @param data The next chunk of output. Only valid during the call.
+ * @return True on success, false to abort (e.g. the socket was closed).
+ */
+typedef std::function<bool(std::span<const uint8_t> data)> lz_write_fn;
+
+/**
+ * @brief Streaming compressor with a fast LZ77 (LZ4 block format) codec.
+ *
+ * @details Data written to the compressor is split into blocks of at most
+ *          block_size bytes, each of which is compressed and passed to the
+ *          write callback as soon as it is complete. The output is a frame:
+ *
+ *          | Field        | Size     | Contents                                     |
+ *          |--------------|----------|----------------------------------------------|
+ *          | magic        | 4        | 'E' 'L' 'Z' '1'                              |
+ *          | flags        | 1        | bit 0: independent blocks                    |
+ *          | block size   | 1        | log2 of the maximum block size (8 - 16)      |
+ *          | blocks       | 4 + n    | n (uint32 LE), bit 31 set if stored raw      |
+ *          | end mark     | 4        | 0 (uint32)                                   |
+ *
+ *          With independent blocks, each block can be decompressed on its
+ *          own (so a lost or corrupted block does not affect the next ones).
+ *          With linked blocks, matches may also reference the previous
+ *          block_size bytes of data, which improves the ratio for small
+ *          blocks. Blocks which do not compress are stored raw, so the output
+ *          is never more than 10 bytes + 4 bytes per block larger than the
+ *          input.
+ *
+ *          The working memory is fixed and allocated in the constructor:
+ *          16 KiB for the hash table plus 2 (independent) or 3 (linked)
+ *          block_size buffers.
+ *
+ * @note Not thread safe.
+ *
+ * \section compression_ex1 Example
+ * \snippet compression_example.cpp compression example
+ */
+class LzCompressor {
+public:
+  /// Magic number at the start of each frame.
+  static constexpr std::array<uint8_t, 4> MAGIC = {'E', 'L', 'Z', '1'};
+  /// Size of the frame header.
+  static constexpr size_t HEADER_SIZE = 6;
+  /// Size of each block header (and of the end mark).
+  static constexpr size_t BLOCK_HEADER_SIZE = 4;
+  /// Flag in the block header marking blocks which are stored uncompressed.
+  static constexpr uint32_t STORED_BLOCK_FLAG = 0x80000000;
+  /// Flag in the frame header marking frames with independent blocks.
+  static constexpr uint8_t INDEPENDENT_BLOCKS_FLAG = 0x01;
+  /// Smallest supported block size.
+  static constexpr size_t MIN_BLOCK_SIZE = 256;
+  /// Largest supported block size.
+  static constexpr size_t MAX_BLOCK_SIZE = 64 * 1024;
+
+  /**
+   * @brief Configuration for the compressor.
+   */
+  struct Config {
+    size_t block_size{16 * 1024}; ///< Maximum block size, rounded up to a power of two.
+    bool independent_blocks{true}; ///< Whether blocks can be decompressed on their own.
+    lz_write_fn write{nullptr};    ///< Callback which receives the compressed frame.
+  };
+
+  /**
+   * @brief Construct the compressor, allocating its working memory.
+   * @param config Configuration for the compressor.
+   */
+  explicit LzCompressor(const Config &config)
+      : block_size_(std::bit_ceil(std::clamp(config.block_size, MIN_BLOCK_SIZE, MAX_BLOCK_SIZE)))
+      , independent_blocks_(config.independent_blocks)
+      , write_(config.write)
+      , encoder_(std::make_unique<lz::BlockEncoder>())
+      , input_(independent_blocks_ ? block_size_ : 2 * block_size_)
+      , output_(BLOCK_HEADER_SIZE + block_size_) {}
+
+  /**
+   * @brief Compress data, passing complete blocks to the write callback.
+   * @param data Data to compress.
+   * @return True on success, false if the write callback failed.
+   */
+  bool write(std::span<const uint8_t> data) {
+    if (!header_written_ && !write_header()) {
+      return false;
+    }
+    size_t start = block_start();
+    while (!data.empty()) {
+      size_t count = std::min(data.size(), block_size_ - num_buffered_);
+      std::memcpy(input_.data() + start + num_buffered_, data.data(), count);
+      num_buffered_ += count;
+      data = data.subspan(count);
+      if (num_buffered_ == block_size_ && !compress_block()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * @brief Compress data, passing complete blocks to the write callback.
+   * @param data Data to compress.
+   * @return True on success, false if the write callback failed.
+   */
+  bool write(std::string_view data) {
+    return write(std::span<const uint8_t>((const uint8_t *)data.data(), data.size()));
+  }
+
+  /**
+   * @brief Compress and output any buffered data as a (short) block, e.g.
+   *        at the end of a message which the receiver needs right away.
+   * @return True on success, false if the write callback failed.
+   */
+  bool flush() {
+    if (!header_written_ && !write_header()) {
+      return false;
+    }
+    return num_buffered_ == 0 || compress_block();
+  }
+
+  /**
+   * @brief Flush, and end the frame. The next write starts a new frame.
+   * @return True on success, false if the write callback failed.
+   */
+  bool finish() {
+    if (!flush()) {
+      return false;
+    }
+    std::array<uint8_t, BLOCK_HEADER_SIZE> end_mark{};
+    header_written_ = false;
+    history_size_ = 0;
+    bytes_out_ += end_mark.size();
+    return write_(end_mark);
+  }
+
+  /**
+   * @brief Get the block size used by the compressor.
+   * @return The (maximum) block size in bytes.
+   */
+  size_t get_block_size() const { return block_size_; }
+
+  /**
+   * @brief Get the number of bytes written to the compressor.
+   * @return The number of uncompressed bytes.
+   */
+  size_t get_bytes_in() const { return bytes_in_; }
+
+  /**
+   * @brief Get the number of bytes output by the compressor.
+   * @return The number of compressed bytes, including frame overhead.
+   */
+  size_t get_bytes_out() const { return bytes_out_; }
+
+protected:
+  size_t block_start() const { return independent_blocks_ ? 0 : block_size_; }
+
+  bool write_header() {
+    std::array<uint8_t, HEADER_SIZE> header;
+    std::copy(MAGIC.begin(), MAGIC.end(), header.begin());
+    header[4] = independent_blocks_ ? INDEPENDENT_BLOCKS_FLAG : 0;
+    header[5] = uint8_t(std::countr_zero(block_size_));
+    header_written_ = true;
+    bytes_out_ += header.size();
+    return write_(header);
+  }
+
+  bool compress_block() {
+    size_t start = block_start();
+    size_t size = num_buffered_;
+    std::span<uint8_t> payload(output_.data() + BLOCK_HEADER_SIZE, size - 1);
+    size_t compressed_size =
+        encoder_->compress(input_.data(), start - history_size_, start, size, payload);
+    uint32_t block_header = uint32_t(compressed_size);
+    if (compressed_size == 0) {
+      std::memcpy(payload.data(), input_.data() + start, size);
+      compressed_size = size;
+      block_header = uint32_t(size) | STORED_BLOCK_FLAG;
+    }
+    for (size_t i = 0; i < BLOCK_HEADER_SIZE; i++) {
+      output_[i] = uint8_t(block_header >> (8 * i));
+    }
+    bytes_in_ += size;
+    bytes_out_ += BLOCK_HEADER_SIZE + compressed_size;
+    num_buffered_ = 0;
+    if (!independent_blocks_) {
+      // keep the last block_size bytes as the history of the next block
+      size_t new_history_size = std::min(block_size_, history_size_ + size);
+      std::memmove(input_.data() + start - new_history_size,
+                   input_.data() + start + size - new_history_size, new_history_size);
+      encoder_->rebase(uint32_t(size));
+      history_size_ = new_history_size;
+    }
+    return write_(std::span<const uint8_t>(output_.data(), BLOCK_HEADER_SIZE + compressed_size));
+  }
+
+  size_t block_size_;
+  bool independent_blocks_;
+  lz_write_fn write_;
+  std::unique_ptr<lz::BlockEncoder> encoder_;
+  std::vector<uint8_t> input_;
+  std::vector<uint8_t> output_;
+  size_t num_buffered_{0};
+  size_t history_size_{0};
+  bool header_written_{false};
+  size_t bytes_in_{0};
+  size_t bytes_out_{0};
+};
+
+/**
+ * @brief Streaming decompressor for frames created by the LzCompressor.
+ *
+ * @details Compressed data can be fed in arbitrary chunks (e.g. as it is
+ *          received from a socket); each decompressed block is passed to the
+ *          write callback as soon as it is complete. Multiple frames may be
+ *          concatenated. Malformed input is detected (it never causes out of
+ *          bounds accesses) and reported as an error.
+ *
+ *          The working memory is fixed and allocated in the constructor:
+ *          2 (independent blocks) or 3 (linked blocks) max_block_size
+ *          buffers.
+ *
+ * @note Not thread safe.
+ */
+class LzDecompressor {
+public:
+  /**
+   * @brief Configuration for the decompressor.
+   */
+  struct Config {
+    size_t max_block_size{LzCompressor::MAX_BLOCK_SIZE}; ///< Largest block size accepted.
+    bool allow_linked_blocks{true}; ///< Whether to accept frames with linked blocks.
+    lz_write_fn write{nullptr};     ///< Callback which receives the decompressed data.
+  };
+
+  /**
+   * @brief Construct the decompressor, allocating its working memory.
+   * @param config Configuration for the decompressor.
+   */
+  explicit LzDecompressor(const Config &config)
+      : max_block_size_(std::bit_ceil(std::clamp(
+            config.max_block_size, LzCompressor::MIN_BLOCK_SIZE, LzCompressor::MAX_BLOCK_SIZE)))
+      , write_(config.write)
+      , input_(max_block_size_)
+      , output_(config.allow_linked_blocks ? 2 * max_block_size_ : max_block_size_) {}
+
+  /**
+   * @brief Decompress the next chunk of compressed data.
+   * @param data Compressed data.
+   * @param ec Set if the data is not a valid frame, uses a block size larger
+   *        than max_block_size (or linked blocks if they are not allowed), or
+   *        the write callback failed.
+   * @return True on success, false on error. After an error, reset() must be
+   *         called before feeding the decompressor a new frame.
+   */
+  bool feed(std::span<const uint8_t> data, std::error_code &ec) {
+    if (error_) {
+      ec = error_;
+      return false;
+    }
+    while (!data.empty()) {
+      if (state_ == State::BLOCK_DATA && num_pending_ == 0 && data.size() >= block_length_) {
+        // fast path: the whole block is available, no need to copy it
+        if (!decode_block(data.first(block_length_))) {
+          ec = error_;
+          return false;
+        }
+        data = data.subspan(block_length_);
+        continue;
+      }
+      size_t needed = bytes_needed();
+      uint8_t *dst = state_ == State::BLOCK_DATA ? input_.data() : header_.data();
+      size_t count = std::min(data.size(), needed - num_pending_);
+      std::memcpy(dst + num_pending_, data.data(), count);
+      num_pending_ += count;
+      data = data.subspan(count);
+      if (num_pending_ < needed) {
+        break;
+      }
+      num_pending_ = 0;
+      if (!advance()) {
+        ec = error_;
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * @brief Decompress the next chunk of compressed data.
+   * @param data Compressed data.
+   * @param ec Set on error, see feed(std::span<const uint8_t>, std::error_code &).
+   * @return True on success, false on error.
+   */
+  bool feed(std::string_view data, std::error_code &ec) {
+    return feed(std::span<const uint8_t>((const uint8_t *)data.data(), data.size()), ec);
+  }
+
+  /**
+   * @brief Whether all data fed so far formed complete frames.
+   * @return True if the last frame was ended and no partial frame is
+   *         pending, false otherwise.
+   */
+  bool is_complete() const {
+    return state_ == State::FRAME_HEADER && num_pending_ == 0 && !error_;
+  }
+
+  /**
+   * @brief Discard any partial frame and clear the error.
+   */
+  void reset() {
+    state_ = State::FRAME_HEADER;
+    num_pending_ = 0;
+    history_size_ = 0;
+    error_.clear();
+  }
+
+  /**
+   * @brief Get the number of decompressed bytes output.
+   * @return The number of decompressed bytes.
+   */
+  size_t get_bytes_out() const { return bytes_out_; }
+
+protected:
+  enum class State { FRAME_HEADER, BLOCK_HEADER, BLOCK_DATA };
+
+  size_t bytes_needed() const {
+    switch (state_) {
+    case State::FRAME_HEADER:
+      return LzCompressor::HEADER_SIZE;
+    case State::BLOCK_HEADER:
+      return LzCompressor::BLOCK_HEADER_SIZE;
+    default:
+      return block_length_;
+    }
+  }
+
+  bool fail(std::errc error) {
+    error_ = std::make_error_code(error);
+    return false;
+  }
+
+  bool advance() {
+    switch (state_) {
+    case State::FRAME_HEADER: {
+      if (!std::equal(LzCompressor::MAGIC.begin(), LzCompressor::MAGIC.end(), header_.begin())) {
+        return fail(std::errc::bad_message);
+      }
+      independent_blocks_ = header_[4] & LzCompressor::INDEPENDENT_BLOCKS_FLAG;
+      uint8_t block_size_log = header_[5];
+      if (block_size_log > std::countr_zero(LzCompressor::MAX_BLOCK_SIZE) ||
+          (size_t(1) << block_size_log) > max_block_size_ ||
+          (!independent_blocks_ && output_.size() < 2 * max_block_size_)) {
+        return fail(std::errc::not_supported);
+      }
+      block_size_ = size_t(1) << block_size_log;
+      history_size_ = 0;
+      state_ = State::BLOCK_HEADER;
+      return true;
+    }
+    case State::BLOCK_HEADER: {
+      uint32_t block_header = 0;
+      for (size_t i = 0; i < LzCompressor::BLOCK_HEADER_SIZE; i++) {
+        block_header |= uint32_t(header_[i]) << (8 * i);
+      }
+      if (block_header == 0) {
+        // end mark
+        state_ = State::FRAME_HEADER;
+        return true;
+      }
+      stored_ = block_header & LzCompressor::STORED_BLOCK_FLAG;
+      block_length_ = block_header & ~LzCompressor::STORED_BLOCK_FLAG;
+      if (block_length_ > block_size_) {
+        return fail(std::errc::bad_message);
+      }
+      state_ = State::BLOCK_DATA;
+      return true;
+    }
+    default:
+      return decode_block(std::span<const uint8_t>(input_.data(), block_length_));
+    }
+  }
+
+  bool decode_block(std::span<const uint8_t> block) {
+    size_t start = independent_blocks_ ? 0 : max_block_size_;
+    size_t size = block.size();
+    if (stored_) {
+      std::memcpy(output_.data() + start, block.data(), size);
+    } else if (!lz::decompress_block(block, output_.data() + start - history_size_,
+                                     history_size_, block_size_, size)) {
+      return fail(std::errc::bad_message);
+    }
+    state_ = State::BLOCK_HEADER;
+    bytes_out_ += size;
+    if (write_ && !write_(std::span<const uint8_t>(output_.data() + start, size))) {
+      return fail(std::errc::io_error);
+    }
+    if (!independent_blocks_) {
+      size_t new_history_size = std::min(block_size_, history_size_ + size);
+      std::memmove(output_.data() + start - new_history_size,
+                   output_.data() + start + size - new_history_size, new_history_size);
+      history_size_ = new_history_size;
+    }
+    return true;
+  }
+
+  size_t max_block_size_;
+  lz_write_fn write_;
+  std::vector<uint8_t> input_;
+  std::vector<uint8_t> output_;
+  std::array<uint8_t, LzCompressor::HEADER_SIZE> header_{};
+  State state_{State::FRAME_HEADER};
+  size_t num_pending_{0};
+  size_t block_size_{0};
+  size_t block_length_{0};
+  size_t history_size_{0};
+  bool independent_blocks_{true};
+  bool stored_{false};
+  std::error_code error_;
+  size_t bytes_out_{0};
+};
+
+/**
+ * @brief Make a write callback which appends to a container.
+ * @param container Container (e.g. std::vector<uint8_t> or std::string) to
+ *        append the data to. Must outlive the callback.
+ * @return The write callback.
+ */
+template <class Container> lz_write_fn make_container_writer(Container &container) {
+  return [&container](std::span<const uint8_t> data) {
+    container.insert(container.end(), data.begin(), data.end());
+    return true;
+  };
+}
+
+/**
+ * @brief Make a write callback which writes to a stream (e.g. a file).
+ * @param stream Stream (e.g. std::ofstream) to write the data to. Must
+ *        outlive the callback.
+ * @return The write callback.
+ */
+inline lz_write_fn make_stream_writer(std::ostream &stream) {
+  return [&stream](std::span<const uint8_t> data) {
+    stream.write((const char *)data.data(), data.size());
+    return stream.good();
+  };
+}
+
+/**
+ * @brief Compress data into a single frame.
+ * @param data Data to compress.
+ * @param output Container the frame is appended to.
+ * @param block_size Maximum block size of the frame.
+ */
+template <class Container>
+void lz_compress(std::span<const uint8_t> data, Container &output, size_t block_size = 16 * 1024) {
+  LzCompressor compressor({.block_size = block_size, .write = make_container_writer(output)});
+  compressor.write(data);
+  compressor.finish();
+}
+
+/**
+ * @brief Decompress one or more complete frames.
+ * @param data Compressed data.
+ * @param output Container the decompressed data is appended to.
+ * @param ec Set if the data is malformed or incomplete.
+ * @return True on success, false on error.
+ */
+template <class Container>
+bool lz_decompress(std::span<const uint8_t> data, Container &output, std::error_code &ec) {
+  LzDecompressor decompressor({.write = make_container_writer(output)});
+  if (!decompressor.feed(data, ec)) {
+    return false;
+  }
+  if (!decompressor.is_complete()) {
+    ec = std::make_error_code(std::errc::message_size);
+    return false;
+  }
+  return true;
+}
+} // namespace espp
@@ -0,0 +1,258 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+namespace espp {
+namespace lz {
+/// Minimum length of a match.
+static constexpr size_t MIN_MATCH = 4;
+/// The last LAST_LITERALS bytes of a block are always literals.
+static constexpr size_t LAST_LITERALS = 5;
+/// A match must start at least MATCH_FIND_LIMIT bytes before the end.
+static constexpr size_t MATCH_FIND_LIMIT = 12;
+/// Maximum distance between a match and its reference.
+static constexpr size_t MAX_OFFSET = 65535;
+/// log2 of the number of entries in the encoder's hash table.
+static constexpr size_t HASH_LOG = 12;
+
+/**
+ * @brief Encoder for the LZ4 block format.
+ *
+ * @details Greedy LZ77 matching with a single-entry hash table of 4 byte
+ *          sequences (16 KiB), which is the only working memory the encoder
+ *          needs. The encoded blocks are compatible with the LZ4 block format,
+ *          so they can be decoded with the reference LZ4 implementation
+ *          (LZ4_decompress_safe / LZ4_decompress_safe_usingDict).
+ *
+ *          Matches may reference data before the block (a history / prefix),
+ *          which is how linked blocks are compressed: positions in the hash
+ *          table are relative to a base pointer, which must stay the same
+ *          while the history is in use (see rebase()).
+ */
+class BlockEncoder {
+public:
+  /**
+   * @brief Forget all positions in the hash table.
+   */
+  void reset() { table_.fill(0); }
+
+  /**
+   * @brief Shift all positions in the hash table down by \p delta bytes,
+   *        after the data referenced by the table was moved down by \p delta
+   *        bytes in memory.
+   * @param delta Number of bytes the data was moved by.
+   */
+  void rebase(uint32_t delta) {
+    for (auto &position : table_) {
+      position = position > delta ? position - delta : 0;
+    }
+  }
+
+  /**
+   * @brief Compress a block.
+   * @param base Base pointer which all positions in the hash table are
+   *        relative to.
+   * @param history_start Offset (from base) of the first byte which matches
+   *        may reference.
+   * @param start Offset (from base) of the first byte to compress.
+   * @param size Number of bytes to compress.
+   * @param output Buffer for the compressed block.
+   * @return Size of the compressed block, or 0 if it did not fit into
+   *         output (e.g. because the data is incompressible).
+   */
+  size_t compress(const uint8_t *base, size_t history_start, size_t start, size_t size,
+                  std::span<uint8_t> output) {
+    const uint8_t *low_limit = base + history_start;
+    const uint8_t *ip = base + start;
+    const uint8_t *anchor = ip;
+    const uint8_t *end = ip + size;
+    const uint8_t *match_limit = end - LAST_LITERALS;
+    const uint8_t *find_limit = end - MATCH_FIND_LIMIT;
+    uint8_t *op = output.data();
+    uint8_t *out_end = op + output.size();
+
+    if (size >= MATCH_FIND_LIMIT + 1) {
+      while (ip < find_limit) {
+        // find a match, skipping faster through incompressible data
+        const uint8_t *ref = nullptr;
+        size_t attempts = 1 << 6;
+        while (true) {
+          uint32_t sequence = read32(ip);
+          uint32_t &entry = table_[hash(sequence)];
+          ref = base + entry;
+          entry = uint32_t(ip - base);
+          if (ref >= low_limit && ref < ip && size_t(ip - ref) <= MAX_OFFSET &&
+              read32(ref) == sequence) {
+            break;
+          }
+          ip += attempts++ >> 6;
+          if (ip >= find_limit) {
+            ref = nullptr;
+            break;
+          }
+        }
+        if (!ref) {
+          break;
+        }
+        // extend the match backwards over the pending literals
+        while (ip > anchor && ref > low_limit && ip[-1] == ref[-1]) {
+          ip--;
+          ref--;
+        }
+        // and forwards
+        size_t match_length = MIN_MATCH;
+        while (ip + match_length < match_limit && ip[match_length] == ref[match_length]) {
+          match_length++;
+        }
+        if (!write_sequence(op, out_end, anchor, size_t(ip - anchor), size_t(ip - ref),
+                            match_length)) {
+          return 0;
+        }
+        // prime the table with a position inside the match
+        table_[hash(read32(ip + match_length - 2))] = uint32_t(ip + match_length - 2 - base);
+        ip += match_length;
+        anchor = ip;
+      }
+    }
+    // last literals
+    if (!write_sequence(op, out_end, anchor, size_t(end - anchor), 0, 0)) {
+      return 0;
+    }
+    return size_t(op - output.data());
+  }
+
+protected:
+  static uint32_t read32(const uint8_t *p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+  }
+
+  static uint32_t hash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HASH_LOG);
+  }
+
+  static bool write_length(uint8_t *&op, uint8_t *out_end, size_t length) {
+    for (; length >= 255; length -= 255) {
+      if (op >= out_end) {
+        return false;
+      }
+      *op++ = 255;
+    }
+    if (op >= out_end) {
+      return false;
+    }
+    *op++ = uint8_t(length);
+    return true;
+  }
+
+  // a match length of 0 means this is the last sequence, which has no match
+  static bool write_sequence(uint8_t *&op, uint8_t *out_end, const uint8_t *literals,
+                             size_t literal_length, size_t offset, size_t match_length) {
+    if (op >= out_end) {
+      return false;
+    }
+    uint8_t *token = op++;
+    *token = uint8_t(std::min<size_t>(literal_length, 15) << 4);
+    if (literal_length >= 15 && !write_length(op, out_end, literal_length - 15)) {
+      return false;
+    }
+    if (size_t(out_end - op) < literal_length) {
+      return false;
+    }
+    std::memcpy(op, literals, literal_length);
+    op += literal_length;
+    if (match_length == 0) {
+      return true;
+    }
+    if (out_end - op < 2) {
+      return false;
+    }
+    *op++ = uint8_t(offset);
+    *op++ = uint8_t(offset >> 8);
+    size_t length_code = match_length - MIN_MATCH;
+    *token |= uint8_t(std::min<size_t>(length_code, 15));
+    return length_code < 15 || write_length(op, out_end, length_code - 15);
+  }
+
+  std::array<uint32_t, size_t(1) << HASH_LOG> table_{};
+};
+
+/**
+ * @brief Decode a block in the LZ4 block format.
+ * @param input The compressed block.
+ * @param base Start of the history which matches may reference (the output
+ *        of previous linked blocks, directly before \p start).
+ * @param start Offset (from base) where the decompressed block is written.
+ * @param capacity Maximum size of the decompressed block.
+ * @param size Set to the size of the decompressed block.
+ * @return True on success, false if the block is malformed or does not fit
+ *         into \p capacity bytes. Never reads or writes out of bounds.
+ */
+inline bool decompress_block(std::span<const uint8_t> input, uint8_t *base, size_t start,
+                             size_t capacity, size_t &size) {
+  const uint8_t *ip = input.data();
+  const uint8_t *in_end = ip + input.size();
+  uint8_t *op = base + start;
+  uint8_t *out_end = op + capacity;
+  auto read_length = [&](size_t &length) {
+    uint8_t byte;
+    do {
+      if (ip >= in_end) {
+        return false;
+      }
+      byte = *ip++;
+      length += byte;
+    } while (byte == 255);
+    return true;
+  };
+  while (ip < in_end) {
+    uint8_t token = *ip++;
+    size_t literal_length = token >> 4;
+    if (literal_length == 15 && !read_length(literal_length)) {
+      return false;
+    }
+    if (size_t(in_end - ip) < literal_length || size_t(out_end - op) < literal_length) {
+      return false;
+    }
+    std::memcpy(op, ip, literal_length);
+    ip += literal_length;
+    op += literal_length;
+    if (ip == in_end) {
+      // the last sequence has no match
+      break;
+    }
+    if (in_end - ip < 2) {
+      return false;
+    }
+    size_t offset = size_t(ip[0]) | (size_t(ip[1]) << 8);
+    ip += 2;
+    size_t match_length = token & 15;
+    if (match_length == 15 && !read_length(match_length)) {
+      return false;
+    }
+    match_length += MIN_MATCH;
+    if (offset == 0 || offset > size_t(op - base) || size_t(out_end - op) < match_length) {
+      return false;
+    }
+    const uint8_t *ref = op - offset;
+    if (offset >= match_length) {
+      std::memcpy(op, ref, match_length);
+      op += match_length;
+    } else {
+      // overlapping copy (e.g. a run of repeated bytes)
+      for (size_t i = 0; i < match_length; i++) {
+        *op++ = ref[i];
+      }
+    }
+  }
+  size = size_t(op - (base + start));
+  return true;
+}
+} // namespace lz
+} // namespace espp
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <initializer_list>
+#include <tuple>
+#include <utility>
+
+#include "static_vector.hpp"
+
+namespace espp {
+/// @brief Sorted associative container with a fixed capacity.
+/// @details FlatMap stores up to Capacity key / value pairs, sorted by key,
+///          contiguously and inline (in a StaticVector), so it never
+///          allocates. Lookup is a binary search and iteration is a linear
+///          walk over an array, which for the small maps used in drivers
+///          (e.g. one entry per ADC channel) is considerably faster than
+///          std::unordered_map / std::map, and has no per-node overhead.
+///
+///          Inserting and erasing move the following elements, so this is
+///          not a good fit for large maps which change often.
+///
+///          Inserting a new key into a full map fails (try_emplace / insert
+///          return {end(), false}); operator[] with a new key on a full map
+///          throws std::length_error (or aborts if exceptions are disabled).
+///
+/// @tparam Key The type of the keys.
+/// @tparam T The type of the values.
+/// @tparam Capacity The maximum number of entries.
+/// @tparam Compare The comparison used to order the keys.
+///
+/// Example:
+/// @code{.cpp}
+///   espp::FlatMap<int, float, 8> map;
+///   map[3] = 1.0f;
+///   map.try_emplace(1, 2.0f);
+///   for (const auto &[key, value] : map) { ... } // iterates key 1, then key 3
+/// @endcode
+template <typename Key, typename T, size_t Capacity, typename Compare = std::less<Key>>
+class FlatMap {
+public:
+  using key_type = Key;
+  using mapped_type = T;
+  using value_type = std::pair<Key, T>;
+  using size_type = size_t;
+  using key_compare = Compare;
+  using iterator = typename StaticVector<value_type, Capacity>::iterator;
+  using const_iterator = typename StaticVector<value_type, Capacity>::const_iterator;
+
+  /// @brief Construct an empty map.
+  FlatMap() = default;
+
+  /// @brief Construct a map from an initializer list.
+  /// @details If a key appears more than once, the first value is kept.
+  /// @param init The key / value pairs.
+  FlatMap(std::initializer_list<value_type> init) {
+    for (const auto &value : init) {
+      if (!insert(value).second && !contains(value.first)) {
+        detail::throw_capacity_exceeded();
+      }
+    }
+  }
+
+  /// @brief Get the maximum number of entries.
+  /// @return Capacity
+  static constexpr size_t capacity() noexcept { return Capacity; }
+
+  /// @brief Get the number of entries.
+  /// @return The number of entries.
+  size_t size() const noexcept { return data_.size(); }
+
+  /// @brief Check whether the map has no entries.
+  /// @return True if the map is empty.
+  bool empty() const noexcept { return data_.empty(); }
+
+  /// @brief Check whether the map is at capacity.
+  /// @return True if no more keys can be added.
+  bool full() const noexcept { return data_.full(); }
+
+  iterator begin() noexcept { return data_.begin(); }
+  const_iterator begin() const noexcept { return data_.begin(); }
+  const_iterator cbegin() const noexcept { return data_.cbegin(); }
+  iterator end() noexcept { return data_.end(); }
+  const_iterator end() const noexcept { return data_.end(); }
+  const_iterator cend() const noexcept { return data_.cend(); }
+
+  /// @brief Find the entry for \p key.
+  /// @param key The key to look for.
+  /// @return Iterator to the entry, or end() if there is none.
+  iterator find(const Key &key) {
+    auto it = lower_bound(key);
+    return (it != end() && !compare_(key, it->first)) ? it : end();
+  }
+
+  /// @brief Find the entry for \p key.
+  /// @param key The key to look for.
+  /// @return Iterator to the entry, or end() if there is none.
+  const_iterator find(const Key &key) const {
+    auto it = lower_bound(key);
+    return (it != end() && !compare_(key, it->first)) ? it : end();
+  }
+
+  /// @brief Check whether the map has an entry for \p key.
+  /// @param key The key to look for.
+  /// @return True if there is an entry for \p key.
+  bool contains(const Key &key) const { return find(key) != end(); }
+
+  /// @brief Count the entries for \p key.
+  /// @param key The key to look for.
+  /// @return 1 if there is an entry for \p key, 0 otherwise.
+  size_t count(const Key &key) const { return contains(key) ? 1 : 0; }
+
+  /// @brief Find the first entry whose key is not less than \p key.
+  /// @param key The key to look for.
+  /// @return Iterator to the entry, or end() if there is none.
+  iterator lower_bound(const Key &key) {
+    return std::lower_bound(begin(), end(), key, [this](const value_type &value, const Key &key) {
+      return compare_(value.first, key);
+    });
+  }
+
+  /// @brief Find the first entry whose key is not less than \p key.
+  /// @param key The key to look for.
+  /// @return Iterator to the entry, or end() if there is none.
+  const_iterator lower_bound(const Key &key) const {
+    return std::lower_bound(begin(), end(), key, [this](const value_type &value, const Key &key) {
+      return compare_(value.first, key);
+    });
+  }
+
+  /// @brief Insert an entry for \p key, constructing its value from \p args,
+  ///        if there is no entry for \p key yet.
+  /// @param key The key of the entry.
+  /// @param args The arguments to construct the value with.
+  /// @return {iterator to the entry for \p key, true if it was inserted}, or
+  ///         {end(), false} if \p key is new but the map is full.
+  template <typename... Args> std::pair<iterator, bool> try_emplace(const Key &key, Args &&...args) {
+    auto it = lower_bound(key);
+    if (it != end() && !compare_(key, it->first)) {
+      return {it, false};
+    }
+    if (full()) {
+      return {end(), false};
+    }
+    it = data_.emplace(it, std::piecewise_construct, std::forward_as_tuple(key),
+                       std::forward_as_tuple(std::forward<Args>(args)...));
+    return {it, true};
+  }
+
+  /// @brief Insert \p value if there is no entry for its key yet.
+  /// @param value The key / value pair to insert.
+  /// @return {iterator to the entry for the key, true if it was inserted}, or
+  ///         {end(), false} if the key is new but the map is full.
+  std::pair<iterator, bool> insert(const value_type &value) {
+    return try_emplace(value.first, value.second);
+  }
+
+  /// @brief Insert \p value if there is no entry for its key yet.
+  /// @param value The key / value pair to insert.
+  /// @return {iterator to the entry for the key, true if it was inserted}, or
+  ///         {end(), false} if the key is new but the map is full.
+  std::pair<iterator, bool> insert(value_type &&value) {
+    return try_emplace(value.first, std::move(value.second));
+  }
+
+  /// @brief Set the value for \p key, inserting an entry if there is none.
+  /// @param key The key of the entry.
+  /// @param value The value to assign.
+  /// @return {iterator to the entry for \p key, true if it was inserted}, or
+  ///         {end(), false} if \p key is new but the map is full.
+  template <typename M> std::pair<iterator, bool> insert_or_assign(const Key &key, M &&value) {
+    auto result = try_emplace(key, std::forward<M>(value));
+    if (!result.second && result.first != end()) {
+      result.first->second = std::forward<M>(value);
+    }
+    return result;
+  }
+
+  /// @brief Get the value for \p key, inserting a value-initialized entry if
+  ///        there is none.
+  /// @param key The key of the entry.
+  /// @return Reference to the value for \p key.
+  /// @note Throws std::length_error (or aborts) if \p key is new and the map
+  ///       is full.
+  T &operator[](const Key &key) {
+    auto [it, inserted] = try_emplace(key);
+    if (it == end()) {
+      detail::throw_capacity_exceeded();
+    }
+    return it->second;
+  }
+
+  /// @brief Remove the entry at \p pos.
+  /// @param pos Iterator to the entry to remove.
+  /// @return Iterator following the removed entry.
+  iterator erase(const_iterator pos) { return data_.erase(pos); }
+
+  /// @brief Remove the entry for \p key, if there is one.
+  /// @param key The key of the entry to remove.
+  /// @return The number of entries removed (0 or 1).
+  size_t erase(const Key &key) {
+    auto it = find(key);
+    if (it == end()) {
+      return 0;
+    }
+    data_.erase(it);
+    return 1;
+  }
+
+  /// @brief Remove all entries.
+  void clear() noexcept { data_.clear(); }
+
+protected:
+  StaticVector<value_type, Capacity> data_;
+  [[no_unique_address]] Compare compare_;
+};
+} // namespace espp
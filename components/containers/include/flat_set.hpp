@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <initializer_list>
+#include <utility>
+
+#include "static_vector.hpp"
+
+namespace espp {
+/// @brief Sorted set with a fixed capacity.
+/// @details FlatSet stores up to Capacity unique keys, sorted, contiguously
+///          and inline (in a StaticVector), so it never allocates. See
+///          FlatMap for the trade-offs.
+///
+///          Inserting a new key into a full set fails (insert returns
+///          {end(), false}).
+///
+/// @tparam Key The type of the keys.
+/// @tparam Capacity The maximum number of keys.
+/// @tparam Compare The comparison used to order the keys.
+///
+/// Example:
+/// @code{.cpp}
+///   espp::FlatSet<int, 8> set{3, 1, 2};
+///   set.insert(5);
+///   if (set.contains(2)) { ... }
+/// @endcode
+template <typename Key, size_t Capacity, typename Compare = std::less<Key>> class FlatSet {
+public:
+  using key_type = Key;
+  using value_type = Key;
+  using size_type = size_t;
+  using key_compare = Compare;
+  // keys must not be modified in place, since that could break the ordering
+  using iterator = typename StaticVector<Key, Capacity>::const_iterator;
+  using const_iterator = typename StaticVector<Key, Capacity>::const_iterator;
+
+  /// @brief Construct an empty set.
+  FlatSet() = default;
+
+  /// @brief Construct a set from an initializer list. Duplicates are ignored.
+  /// @param init The keys.
+  FlatSet(std::initializer_list<Key> init) {
+    for (const auto &key : init) {
+      if (insert(key).first == end()) {
+        detail::throw_capacity_exceeded();
+      }
+    }
+  }
+
+  /// @brief Get the maximum number of keys.
+  /// @return Capacity
+  static constexpr size_t capacity() noexcept { return Capacity; }
+
+  /// @brief Get the number of keys.
+  /// @return The number of keys.
+  size_t size() const noexcept { return data_.size(); }
+
+  /// @brief Check whether the set has no keys.
+  /// @return True if the set is empty.
+  bool empty() const noexcept { return data_.empty(); }
+
+  /// @brief Check whether the set is at capacity.
+  /// @return True if no more keys can be added.
+  bool full() const noexcept { return data_.full(); }
+
+  const_iterator begin() const noexcept { return data_.begin(); }
+  const_iterator cbegin() const noexcept { return data_.cbegin(); }
+  const_iterator end() const noexcept { return data_.end(); }
+  const_iterator cend() const noexcept { return data_.cend(); }
+
+  /// @brief Find \p key.
+  /// @param key The key to look for.
+  /// @return Iterator to the key, or end() if it is not in the set.
+  const_iterator find(const Key &key) const {
+    auto it = lower_bound(key);
+    return (it != end() && !compare_(key, *it)) ? it : end();
+  }
+
+  /// @brief Check whether \p key is in the set.
+  /// @param key The key to look for.
+  /// @return True if \p key is in the set.
+  bool contains(const Key &key) const { return find(key) != end(); }
+
+  /// @brief Count the occurrences of \p key.
+  /// @param key The key to look for.
+  /// @return 1 if \p key is in the set, 0 otherwise.
+  size_t count(const Key &key) const { return contains(key) ? 1 : 0; }
+
+  /// @brief Find the first key which is not less than \p key.
+  /// @param key The key to look for.
+  /// @return Iterator to the key, or end() if there is none.
+  const_iterator lower_bound(const Key &key) const {
+    return std::lower_bound(begin(), end(), key, compare_);
+  }
+
+  /// @brief Insert \p key if it is not in the set yet.
+  /// @param key The key to insert.
+  /// @return {iterator to \p key, true if it was inserted}, or {end(), false}
+  ///         if \p key is new but the set is full.
+  std::pair<const_iterator, bool> insert(const Key &key) {
+    auto it = lower_bound(key);
+    if (it != end() && !compare_(key, *it)) {
+      return {it, false};
+    }
+    if (full()) {
+      return {end(), false};
+    }
+    return {data_.insert(it, key), true};
+  }
+
+  /// @brief Remove the key at \p pos.
+  /// @param pos Iterator to the key to remove.
+  /// @return Iterator following the removed key.
+  const_iterator erase(const_iterator pos) { return data_.erase(pos); }
+
+  /// @brief Remove \p key, if it is in the set.
+  /// @param key The key to remove.
+  /// @return The number of keys removed (0 or 1).
+  size_t erase(const Key &key) {
+    auto it = find(key);
+    if (it == end()) {
+      return 0;
+    }
+    data_.erase(it);
+    return 1;
+  }
+
+  /// @brief Remove all keys.
+  void clear() noexcept { data_.clear(); }
+
+protected:
+  StaticVector<Key, Capacity> data_;
+  [[no_unique_address]] Compare compare_;
+};
+} // namespace espp
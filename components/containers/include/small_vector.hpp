@@ -0,0 +1,362 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+namespace espp {
+/// @brief Vector which stores up to N elements inline before allocating.
+/// @details SmallVector has (a subset of) the interface of std::vector. The
+///          first N elements are stored inside the object, so a SmallVector
+///          which never holds more than N elements never allocates. Unlike
+///          StaticVector it can grow past N, at which point it moves its
+///          elements to the heap like a std::vector.
+///
+///          Use it for values which are usually small but have no hard upper
+///          bound, e.g. the list of subscribers to a topic.
+///
+/// @tparam T The type of the elements.
+/// @tparam N The number of elements stored inline.
+///
+/// Example:
+/// @code{.cpp}
+///   espp::SmallVector<std::string, 4> names{"a", "b"}; // no allocation
+///   names.push_back("c");                              // no allocation
+/// @endcode
+template <typename T, size_t N> class SmallVector {
+  static_assert(N > 0, "SmallVector must have a non-zero inline capacity");
+
+public:
+  using value_type = T;
+  using size_type = size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = T &;
+  using const_reference = const T &;
+  using pointer = T *;
+  using const_pointer = const T *;
+  using iterator = T *;
+  using const_iterator = const T *;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  /// The number of elements stored inline.
+  static constexpr size_t inline_capacity = N;
+
+  /// @brief Construct an empty vector.
+  SmallVector() noexcept
+      : data_(inline_data()) {}
+
+  /// @brief Construct a vector with \p count value-initialized elements.
+  /// @param count The number of elements.
+  explicit SmallVector(size_t count)
+      : SmallVector() {
+    resize(count);
+  }
+
+  /// @brief Construct a vector with \p count copies of \p value.
+  /// @param count The number of elements.
+  /// @param value The value to copy.
+  SmallVector(size_t count, const T &value)
+      : SmallVector() {
+    resize(count, value);
+  }
+
+  /// @brief Construct a vector from an initializer list.
+  /// @param init The elements.
+  SmallVector(std::initializer_list<T> init)
+      : SmallVector(init.begin(), init.end()) {}
+
+  /// @brief Construct a vector from a range of elements.
+  /// @param first Iterator to the first element.
+  /// @param last Iterator past the last element.
+  template <std::input_iterator InputIt>
+  SmallVector(InputIt first, InputIt last)
+      : SmallVector() {
+    assign(first, last);
+  }
+
+  /// @brief Copy constructor.
+  /// @param other The vector to copy.
+  SmallVector(const SmallVector &other)
+      : SmallVector(other.begin(), other.end()) {}
+
+  /// @brief Move constructor.
+  /// @details If \p other has allocated, its allocation is taken over,
+  ///          otherwise its elements are moved.
+  /// @param other The vector to move from. It is left empty.
+  SmallVector(SmallVector &&other) noexcept(std::is_nothrow_move_constructible_v<T>)
+      : SmallVector() {
+    take(std::move(other));
+  }
+
+  /// @brief Destroy the elements and free any allocation.
+  ~SmallVector() {
+    clear();
+    deallocate();
+  }
+
+  /// @brief Copy assignment.
+  /// @param other The vector to copy.
+  /// @return *this
+  SmallVector &operator=(const SmallVector &other) {
+    if (this != &other) {
+      assign(other.begin(), other.end());
+    }
+    return *this;
+  }
+
+  /// @brief Move assignment.
+  /// @param other The vector to move from. It is left empty.
+  /// @return *this
+  SmallVector &operator=(SmallVector &&other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+    if (this != &other) {
+      clear();
+      deallocate();
+      take(std::move(other));
+    }
+    return *this;
+  }
+
+  /// @brief Replace the contents with the elements of an initializer list.
+  /// @param init The elements.
+  /// @return *this
+  SmallVector &operator=(std::initializer_list<T> init) {
+    assign(init.begin(), init.end());
+    return *this;
+  }
+
+  /// @brief Replace the contents with a range of elements.
+  /// @param first Iterator to the first element.
+  /// @param last Iterator past the last element.
+  template <std::input_iterator InputIt> void assign(InputIt first, InputIt last) {
+    clear();
+    if constexpr (std::forward_iterator<InputIt>) {
+      reserve(std::distance(first, last));
+    }
+    for (; first != last; ++first) {
+      emplace_back(*first);
+    }
+  }
+
+  /// @brief Get the number of elements which can be held without allocating.
+  /// @return The capacity.
+  size_t capacity() const noexcept { return capacity_; }
+
+  /// @brief Get the number of elements.
+  /// @return The number of elements.
+  size_t size() const noexcept { return size_; }
+
+  /// @brief Check whether the vector has no elements.
+  /// @return True if the vector is empty.
+  bool empty() const noexcept { return size_ == 0; }
+
+  /// @brief Check whether the elements are stored inline.
+  /// @return True if the vector has not allocated.
+  bool is_inline() const noexcept { return data_ == inline_data(); }
+
+  /// @brief Get a pointer to the elements.
+  /// @return Pointer to the first element.
+  T *data() noexcept { return data_; }
+
+  /// @brief Get a pointer to the elements.
+  /// @return Pointer to the first element.
+  const T *data() const noexcept { return data_; }
+
+  iterator begin() noexcept { return data_; }
+  const_iterator begin() const noexcept { return data_; }
+  const_iterator cbegin() const noexcept { return data_; }
+  iterator end() noexcept { return data_ + size_; }
+  const_iterator end() const noexcept { return data_ + size_; }
+  const_iterator cend() const noexcept { return data_ + size_; }
+  reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+  const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator(end()); }
+  reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+  const_reverse_iterator rend() const noexcept { return const_reverse_iterator(begin()); }
+
+  T &operator[](size_t index) noexcept { return data_[index]; }
+  const T &operator[](size_t index) const noexcept { return data_[index]; }
+  T &front() noexcept { return data_[0]; }
+  const T &front() const noexcept { return data_[0]; }
+  T &back() noexcept { return data_[size_ - 1]; }
+  const T &back() const noexcept { return data_[size_ - 1]; }
+
+  /// @brief Make sure the vector can hold \p count elements without
+  ///        reallocating.
+  /// @param count The number of elements.
+  void reserve(size_t count) {
+    if (count > capacity_) {
+      grow(count);
+    }
+  }
+
+  /// @brief Construct an element at the end of the vector.
+  /// @param args The arguments to construct the element with.
+  /// @return Reference to the new element.
+  template <typename... Args> T &emplace_back(Args &&...args) {
+    if (size_ == capacity_) {
+      // construct the new element before moving the old ones, in case args
+      // refer to an element of this vector
+      size_t new_capacity = capacity_ * 2;
+      T *new_data = std::allocator<T>().allocate(new_capacity);
+      ::new (static_cast<void *>(new_data + size_)) T(std::forward<Args>(args)...);
+      std::uninitialized_move(begin(), end(), new_data);
+      std::destroy(begin(), end());
+      deallocate();
+      data_ = new_data;
+      capacity_ = new_capacity;
+    } else {
+      ::new (static_cast<void *>(end())) T(std::forward<Args>(args)...);
+    }
+    return data_[size_++];
+  }
+
+  /// @brief Add an element to the end of the vector.
+  /// @param value The value to add.
+  void push_back(const T &value) { emplace_back(value); }
+
+  /// @brief Add an element to the end of the vector.
+  /// @param value The value to add.
+  void push_back(T &&value) { emplace_back(std::move(value)); }
+
+  /// @brief Remove the last element.
+  void pop_back() noexcept {
+    size_--;
+    std::destroy_at(end());
+  }
+
+  /// @brief Remove all elements. Any allocation is kept.
+  void clear() noexcept {
+    std::destroy(begin(), end());
+    size_ = 0;
+  }
+
+  /// @brief Change the number of elements, value-initializing new elements.
+  /// @param count The new number of elements.
+  void resize(size_t count) {
+    reserve(count);
+    while (size_ > count) {
+      pop_back();
+    }
+    while (size_ < count) {
+      emplace_back();
+    }
+  }
+
+  /// @brief Change the number of elements, copying \p value into new elements.
+  /// @param count The new number of elements.
+  /// @param value The value to copy.
+  void resize(size_t count, const T &value) {
+    reserve(count);
+    while (size_ > count) {
+      pop_back();
+    }
+    while (size_ < count) {
+      emplace_back(value);
+    }
+  }
+
+  /// @brief Construct an element before \p pos.
+  /// @param pos Iterator before which the element is constructed.
+  /// @param args The arguments to construct the element with.
+  /// @return Iterator to the new element.
+  template <typename... Args> iterator emplace(const_iterator pos, Args &&...args) {
+    auto index = pos - begin();
+    emplace_back(std::forward<Args>(args)...);
+    std::rotate(begin() + index, end() - 1, end());
+    return begin() + index;
+  }
+
+  /// @brief Insert \p value before \p pos.
+  /// @param pos Iterator before which the value is inserted.
+  /// @param value The value to insert.
+  /// @return Iterator to the inserted element.
+  iterator insert(const_iterator pos, const T &value) { return emplace(pos, value); }
+
+  /// @brief Insert \p value before \p pos.
+  /// @param pos Iterator before which the value is inserted.
+  /// @param value The value to insert.
+  /// @return Iterator to the inserted element.
+  iterator insert(const_iterator pos, T &&value) { return emplace(pos, std::move(value)); }
+
+  /// @brief Remove the element at \p pos.
+  /// @param pos Iterator to the element to remove.
+  /// @return Iterator following the removed element.
+  iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+
+  /// @brief Remove the elements in [first, last).
+  /// @param first Iterator to the first element to remove.
+  /// @param last Iterator past the last element to remove.
+  /// @return Iterator following the removed elements.
+  iterator erase(const_iterator first, const_iterator last) {
+    auto index = first - begin();
+    auto count = last - first;
+    if (count > 0) {
+      auto new_end = std::move(begin() + index + count, end(), begin() + index);
+      std::destroy(new_end, end());
+      size_ -= count;
+    }
+    return begin() + index;
+  }
+
+  /// @brief View the elements as a span.
+  operator std::span<T>() noexcept { return {data_, size_}; }
+
+  /// @brief View the elements as a span.
+  operator std::span<const T>() const noexcept { return {data_, size_}; }
+
+  /// @brief Compare the elements of two vectors.
+  friend bool operator==(const SmallVector &lhs, const SmallVector &rhs) {
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+  }
+
+protected:
+  T *inline_data() noexcept { return std::launder(reinterpret_cast<T *>(storage_)); }
+  const T *inline_data() const noexcept {
+    return std::launder(reinterpret_cast<const T *>(storage_));
+  }
+
+  void grow(size_t new_capacity) {
+    T *new_data = std::allocator<T>().allocate(new_capacity);
+    std::uninitialized_move(begin(), end(), new_data);
+    std::destroy(begin(), end());
+    deallocate();
+    data_ = new_data;
+    capacity_ = new_capacity;
+  }
+
+  void deallocate() noexcept {
+    if (!is_inline()) {
+      std::allocator<T>().deallocate(data_, capacity_);
+      data_ = inline_data();
+      capacity_ = N;
+    }
+  }
+
+  // NOTE: expects this vector to be empty and inline
+  void take(SmallVector &&other) {
+    if (other.is_inline()) {
+      std::uninitialized_move(other.begin(), other.end(), begin());
+      size_ = other.size_;
+      other.clear();
+    } else {
+      data_ = other.data_;
+      size_ = other.size_;
+      capacity_ = other.capacity_;
+      other.data_ = other.inline_data();
+      other.size_ = 0;
+      other.capacity_ = N;
+    }
+  }
+
+  T *data_;
+  size_t size_{0};
+  size_t capacity_{N};
+  alignas(T) std::byte storage_[N * sizeof(T)];
+};
+} // namespace espp
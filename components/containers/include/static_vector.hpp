@@ -0,0 +1,340 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace espp {
+namespace detail {
+/// Called when a fixed-capacity container would exceed its capacity. Throws
+/// std::length_error (or aborts if exceptions are disabled).
+[[noreturn]] inline void throw_capacity_exceeded() {
+#if defined(__cpp_exceptions)
+  throw std::length_error("espp container capacity exceeded");
+#else
+  std::abort();
+#endif
+}
+} // namespace detail
+
+/// @brief Vector with a fixed capacity whose elements are stored inline.
+/// @details StaticVector has (a subset of) the interface of std::vector, but
+///          never allocates: its storage for Capacity elements is part of the
+///          object. It is intended for values which have a small, known upper
+///          bound on their size (e.g. one entry per channel of an ADC), and
+///          which are created in hot paths where the allocation for a
+///          std::vector would dominate the cost.
+///
+///          Growing the vector beyond its capacity with push_back /
+///          emplace_back / insert / resize throws std::length_error (or
+///          aborts if exceptions are disabled). Use try_push_back /
+///          try_emplace_back if the vector may be full.
+///
+/// @tparam T The type of the elements.
+/// @tparam Capacity The maximum number of elements.
+///
+/// Example:
+/// @code{.cpp}
+///   espp::StaticVector<float, 8> values;
+///   values.push_back(1.0f);
+///   std::span<float> view = values; // converts to a span
+/// @endcode
+template <typename T, size_t Capacity> class StaticVector {
+  static_assert(Capacity > 0, "StaticVector must have a non-zero capacity");
+
+public:
+  using value_type = T;
+  using size_type = size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = T &;
+  using const_reference = const T &;
+  using pointer = T *;
+  using const_pointer = const T *;
+  using iterator = T *;
+  using const_iterator = const T *;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  /// @brief Construct an empty vector.
+  StaticVector() noexcept = default;
+
+  /// @brief Construct a vector with \p count value-initialized elements.
+  /// @param count The number of elements.
+  explicit StaticVector(size_t count) { resize(count); }
+
+  /// @brief Construct a vector with \p count copies of \p value.
+  /// @param count The number of elements.
+  /// @param value The value to copy.
+  StaticVector(size_t count, const T &value) { resize(count, value); }
+
+  /// @brief Construct a vector from an initializer list.
+  /// @param init The elements.
+  StaticVector(std::initializer_list<T> init)
+      : StaticVector(init.begin(), init.end()) {}
+
+  /// @brief Construct a vector from a range of elements.
+  /// @param first Iterator to the first element.
+  /// @param last Iterator past the last element.
+  template <std::input_iterator InputIt> StaticVector(InputIt first, InputIt last) {
+    for (; first != last; ++first) {
+      emplace_back(*first);
+    }
+  }
+
+  /// @brief Copy constructor.
+  /// @param other The vector to copy.
+  StaticVector(const StaticVector &other)
+      : StaticVector(other.begin(), other.end()) {}
+
+  /// @brief Move constructor. Moves the elements of \p other.
+  /// @param other The vector to move from. It keeps its (moved from) elements.
+  StaticVector(StaticVector &&other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+    std::uninitialized_move(other.begin(), other.end(), begin());
+    size_ = other.size_;
+  }
+
+  /// @brief Destroy the elements.
+  ~StaticVector() { clear(); }
+
+  /// @brief Copy assignment.
+  /// @param other The vector to copy.
+  /// @return *this
+  StaticVector &operator=(const StaticVector &other) {
+    if (this != &other) {
+      assign(other.begin(), other.end());
+    }
+    return *this;
+  }
+
+  /// @brief Move assignment.
+  /// @param other The vector to move from. It keeps its (moved from) elements.
+  /// @return *this
+  StaticVector &operator=(StaticVector &&other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+    if (this != &other) {
+      clear();
+      std::uninitialized_move(other.begin(), other.end(), begin());
+      size_ = other.size_;
+    }
+    return *this;
+  }
+
+  /// @brief Replace the contents with the elements of an initializer list.
+  /// @param init The elements.
+  /// @return *this
+  StaticVector &operator=(std::initializer_list<T> init) {
+    assign(init.begin(), init.end());
+    return *this;
+  }
+
+  /// @brief Replace the contents with a range of elements.
+  /// @param first Iterator to the first element.
+  /// @param last Iterator past the last element.
+  template <std::input_iterator InputIt> void assign(InputIt first, InputIt last) {
+    clear();
+    for (; first != last; ++first) {
+      emplace_back(*first);
+    }
+  }
+
+  /// @brief Get the maximum number of elements.
+  /// @return Capacity
+  static constexpr size_t capacity() noexcept { return Capacity; }
+
+  /// @brief Get the maximum number of elements.
+  /// @return Capacity
+  static constexpr size_t max_size() noexcept { return Capacity; }
+
+  /// @brief Get the number of elements.
+  /// @return The number of elements.
+  size_t size() const noexcept { return size_; }
+
+  /// @brief Check whether the vector has no elements.
+  /// @return True if the vector is empty.
+  bool empty() const noexcept { return size_ == 0; }
+
+  /// @brief Check whether the vector is at capacity.
+  /// @return True if no more elements can be added.
+  bool full() const noexcept { return size_ == Capacity; }
+
+  /// @brief Get a pointer to the elements.
+  /// @return Pointer to the first element.
+  T *data() noexcept { return std::launder(reinterpret_cast<T *>(storage_)); }
+
+  /// @brief Get a pointer to the elements.
+  /// @return Pointer to the first element.
+  const T *data() const noexcept { return std::launder(reinterpret_cast<const T *>(storage_)); }
+
+  iterator begin() noexcept { return data(); }
+  const_iterator begin() const noexcept { return data(); }
+  const_iterator cbegin() const noexcept { return data(); }
+  iterator end() noexcept { return data() + size_; }
+  const_iterator end() const noexcept { return data() + size_; }
+  const_iterator cend() const noexcept { return data() + size_; }
+  reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+  const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator(end()); }
+  reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+  const_reverse_iterator rend() const noexcept { return const_reverse_iterator(begin()); }
+
+  T &operator[](size_t index) noexcept { return data()[index]; }
+  const T &operator[](size_t index) const noexcept { return data()[index]; }
+  T &front() noexcept { return data()[0]; }
+  const T &front() const noexcept { return data()[0]; }
+  T &back() noexcept { return data()[size_ - 1]; }
+  const T &back() const noexcept { return data()[size_ - 1]; }
+
+  /// @brief Construct an element at the end of the vector.
+  /// @param args The arguments to construct the element with.
+  /// @return Reference to the new element.
+  /// @note Throws std::length_error (or aborts) if the vector is full.
+  template <typename... Args> T &emplace_back(Args &&...args) {
+    if (full()) {
+      detail::throw_capacity_exceeded();
+    }
+    return *try_emplace_back(std::forward<Args>(args)...);
+  }
+
+  /// @brief Construct an element at the end of the vector, if there is room.
+  /// @param args The arguments to construct the element with.
+  /// @return Pointer to the new element, or nullptr if the vector is full.
+  template <typename... Args> T *try_emplace_back(Args &&...args) {
+    if (full()) {
+      return nullptr;
+    }
+    T *element = ::new (static_cast<void *>(end())) T(std::forward<Args>(args)...);
+    size_++;
+    return element;
+  }
+
+  /// @brief Add an element to the end of the vector.
+  /// @param value The value to add.
+  /// @note Throws std::length_error (or aborts) if the vector is full.
+  void push_back(const T &value) { emplace_back(value); }
+
+  /// @brief Add an element to the end of the vector.
+  /// @param value The value to add.
+  /// @note Throws std::length_error (or aborts) if the vector is full.
+  void push_back(T &&value) { emplace_back(std::move(value)); }
+
+  /// @brief Add an element to the end of the vector, if there is room.
+  /// @param value The value to add.
+  /// @return True if the element was added, false if the vector is full.
+  bool try_push_back(const T &value) { return try_emplace_back(value) != nullptr; }
+
+  /// @brief Add an element to the end of the vector, if there is room.
+  /// @param value The value to add.
+  /// @return True if the element was added, false if the vector is full.
+  bool try_push_back(T &&value) { return try_emplace_back(std::move(value)) != nullptr; }
+
+  /// @brief Remove the last element.
+  void pop_back() noexcept {
+    size_--;
+    std::destroy_at(end());
+  }
+
+  /// @brief Remove all elements.
+  void clear() noexcept {
+    std::destroy(begin(), end());
+    size_ = 0;
+  }
+
+  /// @brief Change the number of elements, value-initializing new elements.
+  /// @param count The new number of elements.
+  /// @note Throws std::length_error (or aborts) if \p count > Capacity.
+  void resize(size_t count) {
+    if (count > Capacity) {
+      detail::throw_capacity_exceeded();
+    }
+    while (size_ > count) {
+      pop_back();
+    }
+    while (size_ < count) {
+      try_emplace_back();
+    }
+  }
+
+  /// @brief Change the number of elements, copying \p value into new elements.
+  /// @param count The new number of elements.
+  /// @param value The value to copy.
+  /// @note Throws std::length_error (or aborts) if \p count > Capacity.
+  void resize(size_t count, const T &value) {
+    if (count > Capacity) {
+      detail::throw_capacity_exceeded();
+    }
+    while (size_ > count) {
+      pop_back();
+    }
+    while (size_ < count) {
+      try_emplace_back(value);
+    }
+  }
+
+  /// @brief Construct an element before \p pos.
+  /// @param pos Iterator before which the element is constructed.
+  /// @param args The arguments to construct the element with.
+  /// @return Iterator to the new element.
+  /// @note Throws std::length_error (or aborts) if the vector is full.
+  template <typename... Args> iterator emplace(const_iterator pos, Args &&...args) {
+    auto index = pos - begin();
+    emplace_back(std::forward<Args>(args)...);
+    std::rotate(begin() + index, end() - 1, end());
+    return begin() + index;
+  }
+
+  /// @brief Insert \p value before \p pos.
+  /// @param pos Iterator before which the value is inserted.
+  /// @param value The value to insert.
+  /// @return Iterator to the inserted element.
+  /// @note Throws std::length_error (or aborts) if the vector is full.
+  iterator insert(const_iterator pos, const T &value) { return emplace(pos, value); }
+
+  /// @brief Insert \p value before \p pos.
+  /// @param pos Iterator before which the value is inserted.
+  /// @param value The value to insert.
+  /// @return Iterator to the inserted element.
+  /// @note Throws std::length_error (or aborts) if the vector is full.
+  iterator insert(const_iterator pos, T &&value) { return emplace(pos, std::move(value)); }
+
+  /// @brief Remove the element at \p pos.
+  /// @param pos Iterator to the element to remove.
+  /// @return Iterator following the removed element.
+  iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+
+  /// @brief Remove the elements in [first, last).
+  /// @param first Iterator to the first element to remove.
+  /// @param last Iterator past the last element to remove.
+  /// @return Iterator following the removed elements.
+  iterator erase(const_iterator first, const_iterator last) {
+    auto index = first - begin();
+    auto count = last - first;
+    if (count > 0) {
+      auto new_end = std::move(begin() + index + count, end(), begin() + index);
+      std::destroy(new_end, end());
+      size_ -= count;
+    }
+    return begin() + index;
+  }
+
+  /// @brief View the elements as a span.
+  operator std::span<T>() noexcept { return {data(), size_}; }
+
+  /// @brief View the elements as a span.
+  operator std::span<const T>() const noexcept { return {data(), size_}; }
+
+  /// @brief Compare the elements of two vectors.
+  friend bool operator==(const StaticVector &lhs, const StaticVector &rhs) {
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+  }
+
+protected:
+  alignas(T) std::byte storage_[Capacity * sizeof(T)];
+  size_t size_{0};
+};
+} // namespace espp
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <algorithm>
+#include <bitset>
 #include <mutex>
 #include <numeric>
 
@@ -139,7 +140,7 @@ public:
   explicit Controller(const DigitalConfig &config)
       : BaseComponent("Digital Controller", config.log_level) {
     gpio_.assign((int)Button::LAST_UNUSED, -1);
-    input_state_.assign((int)Button::LAST_UNUSED, false);
+    input_state_.reset();
     gpio_[(int)Button::A] = config.gpio_a;
     gpio_[(int)Button::B] = config.gpio_b;
     gpio_[(int)Button::X] = config.gpio_x;
@@ -160,7 +161,7 @@ public:
       : BaseComponent("Analog Joystick Controller", config.log_level)
       , joystick_(std::make_unique<espp::Joystick>(config.joystick_config)) {
     gpio_.assign((int)Button::LAST_UNUSED, -1);
-    input_state_.assign((int)Button::LAST_UNUSED, false);
+    input_state_.reset();
     gpio_[(int)Button::A] = config.gpio_a;
     gpio_[(int)Button::B] = config.gpio_b;
     gpio_[(int)Button::X] = config.gpio_x;
@@ -177,7 +178,7 @@ public:
   explicit Controller(const DualConfig &config)
       : BaseComponent("Dual Digital Controller", config.log_level) {
     gpio_.assign((int)Button::LAST_UNUSED, -1);
-    input_state_.assign((int)Button::LAST_UNUSED, false);
+    input_state_.reset();
     gpio_[(int)Button::A] = config.gpio_a;
     gpio_[(int)Button::B] = config.gpio_b;
     gpio_[(int)Button::X] = config.gpio_x;
@@ -319,7 +320,7 @@ protected:
 
   std::mutex state_mutex_;
   std::vector<int> gpio_;
-  std::vector<bool> input_state_;
+  std::bitset<(int)Button::LAST_UNUSED> input_state_;
   dedic_gpio_bundle_handle_t gpio_bundle_{NULL};
   std::unique_ptr<espp::Joystick> joystick_;
 };
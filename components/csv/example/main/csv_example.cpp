@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "csv.hpp" // includes csv2/reader.hpp and csv2/writer.hpp
+#include "csv_writer.hpp"
 #include "format.hpp"
 
 using namespace std::chrono_literals;
@@ -74,6 +75,28 @@ extern "C" void app_main(void) {
     //! [csv writer example]
   }
 
+  {
+    fmt::print("Starting csv typed writer example!\n");
+    //! [csv typed writer example]
+    std::string output;
+    {
+      espp::TypedCsvWriter<uint32_t, float, float, std::string_view> writer(
+          {"time_ms", "voltage", "current", "state"},
+          {.write =
+               [&output](std::string_view data) {
+                 output += data;
+                 return true;
+               },
+           .float_precision = 3});
+      for (uint32_t i = 0; i < 5; i++) {
+        writer.write_row(i * 10, 3.3f + i * 0.01f, 0.25f * i, i < 3 ? "charging" : "full, idle");
+      }
+      // the writer flushes when it is destroyed (or when flush() is called)
+    }
+    fmt::print("Wrote:\n'{}'\n", output);
+    //! [csv typed writer example]
+  }
+
   fmt::print("CSV example complete!\n");
 
   while (true) {
@@ -0,0 +1,381 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "base_component.hpp"
+#include "task.hpp"
+
+namespace espp {
+/**
+ * @brief Callback which receives the output of a CsvWriter.
+ * @param data The next block of CSV text. Only valid during the call.
+ * @return True on success, false on error (e.g. the disk is full or the
+ *         socket was closed).
+ */
+typedef std::function<bool(std::string_view data)> csv_write_fn;
+
+/**
+ * @brief Typed CSV writer for high rate (telemetry) logging.
+ *
+ * @details Formats each value of a row directly into a large, reusable
+ *          buffer - integers and floating point values with std::to_chars,
+ *          strings copied as-is and quoted only if they contain the
+ *          delimiter, a quote or a line break - and passes the buffer to the
+ *          write callback (a file, a socket, ...) only when it is full or
+ *          flush() is called. Nothing is allocated after construction, and
+ *          no std::string or std::ostream is involved per value.
+ *
+ *          With background_flush enabled, the writer double buffers: full
+ *          buffers are handed to a flush task, so the (potentially slow)
+ *          write callback runs concurrently with formatting the next rows and
+ *          the caller only blocks if the flush task falls a full buffer
+ *          behind.
+ *
+ *          Floating point values are written with the shortest
+ *          representation which round-trips, or with a fixed number of
+ *          decimals if float_precision is set.
+ *
+ * @note Not thread safe: rows must be written from a single task (or under
+ *       a lock).
+ *
+ * \section csv_writer_ex1 CSV Writer Example
+ * \snippet csv_example.cpp csv typed writer example
+ */
+class CsvWriter : public BaseComponent {
+public:
+  /**
+   * @brief Configuration for the CsvWriter.
+   */
+  struct Config {
+    csv_write_fn write;                 ///< Callback which receives the CSV text.
+    size_t buffer_size{16 * 1024};      ///< Size of the buffer(s), must be >= 128 bytes.
+    char delimiter{','};                ///< Delimiter between the values of a row.
+    int float_precision{-1};            ///< Decimals for floating point, -1 = shortest.
+    bool background_flush{false};       ///< Flush full buffers from a separate task.
+    Task::BaseConfig task_config{.name = "CsvWriter"}; ///< Flush task configuration.
+    Logger::Verbosity log_level{Logger::Verbosity::WARN}; ///< Log verbosity.
+  };
+
+  /**
+   * @brief Construct the writer, allocating its buffer(s) and starting the
+   *        flush task if background_flush is enabled.
+   * @param config Configuration for the writer.
+   */
+  explicit CsvWriter(const Config &config)
+      : BaseComponent("CsvWriter", config.log_level)
+      , write_(config.write)
+      , delimiter_(config.delimiter)
+      , float_precision_(config.float_precision)
+      , special_characters_{config.delimiter, '"', '\n', '\r'}
+      , buffer_(std::max<size_t>(config.buffer_size, MIN_BUFFER_SIZE)) {
+    if (config.background_flush) {
+      pending_.resize(buffer_.size());
+      using namespace std::placeholders;
+      flush_task_ = Task::make_unique(Task::AdvancedConfig{
+          .callback = std::bind(&CsvWriter::flush_task_fn, this, _1, _2),
+          .task_config = config.task_config,
+          .log_level = config.log_level,
+      });
+      flush_task_->start();
+    }
+  }
+
+  /**
+   * @brief Flush any buffered data and stop the flush task.
+   */
+  ~CsvWriter() {
+    flush();
+    if (flush_task_) {
+      {
+        std::lock_guard<std::mutex> lk(flush_mutex_);
+        stopping_ = true;
+      }
+      flush_cv_.notify_all();
+      flush_task_->stop();
+    }
+  }
+
+  /**
+   * @brief Write a row of values, followed by a newline.
+   * @param values The values of the row: integers, floating point values,
+   *        bools, enums, chars or strings (anything convertible to
+   *        std::string_view).
+   * @return True on success, false if the write callback failed (now or
+   *         for a previous block).
+   */
+  template <class... Ts> bool write_row(const Ts &...values) {
+    (write_field(values), ...);
+    return end_row();
+  }
+
+  /**
+   * @brief Write a single value of the current row, e.g. to write rows with
+   *        a variable number of values. Finish the row with end_row().
+   * @param value The value to write.
+   */
+  template <class T> void write_field(const T &value) {
+    if (row_started_) {
+      put(delimiter_);
+    }
+    row_started_ = true;
+    write_value(value);
+  }
+
+  /**
+   * @brief Finish the current row.
+   * @return True on success, false if the write callback failed (now or
+   *         for a previous block).
+   */
+  bool end_row() {
+    put('\n');
+    row_started_ = false;
+    num_rows_++;
+    return !failed_;
+  }
+
+  /**
+   * @brief Pass all buffered data to the write callback, and (with
+   *        background_flush) wait for the flush task to write it.
+   * @return True on success, false if the write callback failed.
+   */
+  bool flush() {
+    submit_buffer();
+    if (flush_task_) {
+      std::unique_lock<std::mutex> lk(flush_mutex_);
+      flush_cv_.wait(lk, [this] { return pending_size_ == 0; });
+    }
+    return !failed_;
+  }
+
+  /**
+   * @brief Get the number of rows written.
+   * @return The number of rows written (including buffered rows).
+   */
+  size_t get_num_rows() const { return num_rows_; }
+
+  /**
+   * @brief Get the number of bytes passed to the write callback.
+   * @return The number of bytes flushed so far.
+   */
+  size_t get_bytes_flushed() const { return bytes_flushed_; }
+
+protected:
+  static constexpr size_t MIN_BUFFER_SIZE = 128;
+  // large enough for any integer and any floating point value in general or
+  // shortest form
+  static constexpr size_t MAX_NUMBER_SIZE = 64;
+
+  template <class T> void write_value(const T &value) {
+    if constexpr (std::is_same_v<T, bool>) {
+      write_string(value ? std::string_view("true") : std::string_view("false"));
+    } else if constexpr (std::is_same_v<T, char>) {
+      write_string(std::string_view(&value, 1));
+    } else if constexpr (std::is_enum_v<T>) {
+      write_value(std::underlying_type_t<T>(value));
+    } else if constexpr (std::is_arithmetic_v<T>) {
+      write_number(value);
+    } else {
+      static_assert(std::is_convertible_v<const T &, std::string_view>,
+                    "CSV values must be arithmetic, enums or convertible to std::string_view");
+      write_string(std::string_view(value));
+    }
+  }
+
+  template <class T> void write_number(T value) {
+    reserve(MAX_NUMBER_SIZE);
+    char *first = buffer_.data() + size_;
+    char *last = buffer_.data() + buffer_.size();
+    std::to_chars_result result;
+    if constexpr (std::is_floating_point_v<T>) {
+      if (float_precision_ < 0) {
+        result = std::to_chars(first, last, value);
+      } else {
+        result = std::to_chars(first, last, value, std::chars_format::fixed, float_precision_);
+        if (result.ec != std::errc()) {
+          // very large values do not fit in fixed notation
+          result = std::to_chars(first, last, value, std::chars_format::general);
+        }
+      }
+    } else {
+      result = std::to_chars(first, last, value);
+    }
+    size_ = result.ptr - buffer_.data();
+  }
+
+  void write_string(std::string_view value) {
+    std::string_view special(special_characters_.data(), special_characters_.size());
+    if (value.find_first_of(special) == std::string_view::npos) {
+      append(value);
+      return;
+    }
+    // quote, doubling any quotes in the value
+    put('"');
+    size_t start = 0;
+    for (size_t quote = value.find('"'); quote != std::string_view::npos;
+         quote = value.find('"', start)) {
+      append(value.substr(start, quote + 1 - start));
+      put('"');
+      start = quote + 1;
+    }
+    append(value.substr(start));
+    put('"');
+  }
+
+  void put(char c) {
+    reserve(1);
+    buffer_[size_++] = c;
+  }
+
+  void append(std::string_view data) {
+    while (!data.empty()) {
+      reserve(1);
+      size_t n = std::min(data.size(), buffer_.size() - size_);
+      std::copy_n(data.data(), n, buffer_.data() + size_);
+      size_ += n;
+      data.remove_prefix(n);
+    }
+  }
+
+  void reserve(size_t n) {
+    if (buffer_.size() - size_ < n) {
+      submit_buffer();
+    }
+  }
+
+  void submit_buffer() {
+    if (size_ == 0) {
+      return;
+    }
+    bytes_flushed_ += size_;
+    if (!flush_task_) {
+      if (!write_ || !write_(std::string_view(buffer_.data(), size_))) {
+        failed_ = true;
+      }
+      size_ = 0;
+      return;
+    }
+    {
+      std::unique_lock<std::mutex> lk(flush_mutex_);
+      // only blocks if the flush task is still writing the previous buffer
+      flush_cv_.wait(lk, [this] { return pending_size_ == 0; });
+      std::swap(buffer_, pending_);
+      pending_size_ = size_;
+    }
+    size_ = 0;
+    flush_cv_.notify_all();
+  }
+
+  bool flush_task_fn(std::mutex &m, std::condition_variable &cv) {
+    {
+      std::unique_lock<std::mutex> lk(flush_mutex_);
+      flush_cv_.wait(lk, [this] { return pending_size_ > 0 || stopping_; });
+      if (pending_size_ == 0) {
+        // stopping, and everything has been written
+        return true;
+      }
+    }
+    // the writer does not touch the pending buffer until pending_size_ is 0
+    if (!write_ || !write_(std::string_view(pending_.data(), pending_size_))) {
+      logger_.error("Failed to write {} bytes", pending_size_);
+      failed_ = true;
+    }
+    {
+      std::lock_guard<std::mutex> lk(flush_mutex_);
+      pending_size_ = 0;
+    }
+    flush_cv_.notify_all();
+    return false;
+  }
+
+  csv_write_fn write_;
+  char delimiter_;
+  int float_precision_;
+  std::array<char, 4> special_characters_;
+  std::vector<char> buffer_;
+  size_t size_{0};
+  bool row_started_{false};
+  size_t num_rows_{0};
+  size_t bytes_flushed_{0};
+  std::atomic<bool> failed_{false};
+
+  // background flush
+  std::unique_ptr<Task> flush_task_;
+  std::mutex flush_mutex_;
+  std::condition_variable flush_cv_;
+  std::vector<char> pending_;
+  size_t pending_size_{0};
+  bool stopping_{false};
+};
+
+/**
+ * @brief CsvWriter with a fixed schema: a header row with the column names
+ *        and rows which must contain one value of the given type per column.
+ * @tparam Columns The types of the columns.
+ *
+ * \section typed_csv_writer_ex1 Typed CSV Writer Example
+ * \snippet csv_example.cpp csv typed writer example
+ */
+template <class... Columns> class TypedCsvWriter : public CsvWriter {
+public:
+  /// Number of columns.
+  static constexpr size_t NUM_COLUMNS = sizeof...(Columns);
+
+  /**
+   * @brief Construct the writer and write the header row.
+   * @param header The names of the columns.
+   * @param config Configuration for the writer.
+   */
+  TypedCsvWriter(const std::array<std::string_view, NUM_COLUMNS> &header, const Config &config)
+      : CsvWriter(config) {
+    for (const auto &name : header) {
+      write_field(name);
+    }
+    end_row();
+    num_rows_ = 0;
+  }
+
+  /**
+   * @brief Write a row.
+   * @param values One value per column.
+   * @return True on success, false if the write callback failed (now or
+   *         for a previous block).
+   */
+  bool write_row(const Columns &...values) { return CsvWriter::write_row(values...); }
+};
+
+/**
+ * @brief Make a write callback which writes to a C file (e.g. on SPIFFS /
+ *        LittleFS / SD card).
+ * @param file File opened for writing. Must outlive the callback.
+ * @return The write callback.
+ */
+inline csv_write_fn make_csv_file_writer(FILE *file) {
+  return [file](std::string_view data) {
+    return fwrite(data.data(), 1, data.size(), file) == data.size();
+  };
+}
+
+/**
+ * @brief Make a write callback which writes to a stream.
+ * @param stream Stream (e.g. std::ofstream) to write the data to. Must
+ *        outlive the callback.
+ * @return The write callback.
+ */
+inline csv_write_fn make_csv_stream_writer(std::ostream &stream) {
+  return [&stream](std::string_view data) {
+    stream.write(data.data(), data.size());
+    return stream.good();
+  };
+}
+} // namespace espp
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "display.hpp"
+#include "inplace_function.hpp"
 #include "driver/gpio.h"
 #include "esp_lcd_panel_commands.h"
 
@@ -12,7 +13,7 @@ namespace display_drivers {
  * @param length Number of bytes to write.
  * @param user_data User data associated with this transfer, used for flags.
  */
-typedef std::function<void(const uint8_t *data, size_t length, uint32_t user_data)> write_fn;
+typedef InplaceFunction<void(const uint8_t *data, size_t length, uint32_t user_data)> write_fn;
 
 /**
  * @brief Send color data to the display, with optional flags.
@@ -24,8 +25,8 @@ typedef std::function<void(const uint8_t *data, size_t length, uint32_t user_dat
  *                   (x_end-x_start)*(y_end-y_start)*2 bytes.
  * @param flags Optional flags to send with the transaction.
  */
-typedef std::function<void(int sx, int sy, int ex, int ey, const uint8_t *color_data,
-                           uint32_t flags)>
+typedef InplaceFunction<void(int sx, int sy, int ex, int ey, const uint8_t *color_data,
+                             uint32_t flags)>
     send_lines_fn;
 
 /**
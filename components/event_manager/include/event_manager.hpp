@@ -1,13 +1,16 @@
 #pragma once
 
 #include <deque>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
 #include "base_component.hpp"
 #include "event_map.hpp"
+#include "latest_value.hpp"
 #include "task.hpp"
 
 namespace espp {
@@ -19,6 +22,25 @@ namespace espp {
  *        topic's subscribers, executing all the callbacks in sequence and
  *        then going to sleep again until new data is published.
  *
+ * @details Subscribers which are slow, or which must not be delayed by slow
+ *          subscribers, can instead be added with a SubscriberConfig. Such a
+ *          subscriber runs its callback on its own task, reading the
+ *          messages of the topic from a ring shared by all of the topic's
+ *          subscribers of this kind, through its own cursor. Each subscriber
+ *          gets the messages in the order they were published, at its own
+ *          pace; a subscriber which falls more than the ring size behind
+ *          skips the oldest messages (the publisher never blocks), which is
+ *          counted in its SubscriberStats along with its lag.
+ *
+ * @details Topics which carry state, where subscribers only need the latest
+ *          value, can be made latest-value topics with
+ *          add_latest_value_topic(). Publishing on such a topic stores the
+ *          value in a LatestValue, which can be polled without locking (see
+ *          get_latest_value()), and the updates which the topic's task has
+ *          not delivered yet are coalesced, so a burst of publishes results
+ *          in a single callback with the latest value instead of a backlog of
+ *          stale values.
+ *
  * @note In c++ objects, it's recommended to call the
  *       add_publisher/add_subscriber functions in the class constructor and
  *       then to call the remove_publisher/remove_subscriber functions in the
@@ -43,6 +65,28 @@ public:
    */
   typedef std::function<void(const std::vector<uint8_t> &)> event_callback_fn;
 
+  /**
+   * @brief Configuration for a subscriber which runs its callback on its own
+   *        task, reading from the topic's ring of messages.
+   */
+  struct SubscriberConfig {
+    Task::BaseConfig task_config{}; /**< Configuration of the subscriber's task. If its name
+                                         is empty, the task is named after the topic and
+                                         component. */
+    size_t ring_size{16}; /**< Number of messages kept for the topic. Only used by the first
+                               subscriber of this kind on the topic. */
+  };
+
+  /**
+   * @brief Delivery statistics of a subscriber added with a SubscriberConfig.
+   */
+  struct SubscriberStats {
+    size_t num_delivered{0};  /**< Messages passed to the callback. */
+    size_t num_overflowed{0}; /**< Messages overwritten before the subscriber read them. */
+    size_t lag{0};            /**< Messages published but not delivered yet. */
+    size_t max_lag{0};        /**< Largest lag seen when reading a message. */
+  };
+
   /**
    * @brief Get the singleton instance of the EventManager.
    * @return A reference to the EventManager singleton.
@@ -98,13 +142,64 @@ public:
   bool add_subscriber(const std::string &topic, const std::string &component,
                       const event_callback_fn &callback, const Task::BaseConfig &task_config);
 
+  /**
+   * @brief Register a subscriber for \p component on \p topic, which runs
+   *        \p callback on its own task, independently of the topic's other
+   *        subscribers.
+   * @param topic Topic name for the data being subscribed to.
+   * @param component Name of the component publishing data.
+   * @param callback The event_callback_fn to be called when receicing data on
+   *        \p topic.
+   * @param config The configuration of the subscriber's task and of the
+   *        topic's ring of messages.
+   * @note The ring_size is only used if no subscriber of this kind is
+   *       registered for that topic yet.
+   * @return True if the subscriber was added, false if it was already
+   *         registered for that component.
+   */
+  bool add_subscriber(const std::string &topic, const std::string &component,
+                      const event_callback_fn &callback, const SubscriberConfig &config);
+
+  /**
+   * @brief Make \p topic a latest-value topic.
+   * @details Data published on \p topic is stored as the topic's latest
+   *          value, even if there are no subscribers, and subscribers added
+   *          without a SubscriberConfig are called once with the latest value
+   *          for any number of publishes which happened while the topic's
+   *          task was busy.
+   * @param topic Topic name.
+   * @param max_size The maximum size in bytes of the data published on
+   *        \p topic. Larger data is not published.
+   * @return True if the topic was made a latest-value topic, false if it
+   *         already was one.
+   */
+  bool add_latest_value_topic(const std::string &topic, size_t max_size);
+
+  /**
+   * @brief Get the latest value of \p topic, for polling it without
+   *        subscribing.
+   * @param topic Topic name.
+   * @return The LatestValue holding the topic's value, or nullptr if \p topic
+   *         is not a latest-value topic. It stays valid (but is no longer
+   *         updated) after the topic is removed.
+   */
+  std::shared_ptr<const LatestValue> get_latest_value(const std::string &topic);
+
+  /**
+   * @brief Make \p topic a normal (queued) topic again.
+   * @param topic Topic name.
+   * @return True if the topic was a latest-value topic, false otherwise.
+   */
+  bool remove_latest_value_topic(const std::string &topic);
+
   /**
    * @brief Publish \p data on \p topic.
    * @param topic Topic to publish data on.
    * @param data Data to publish, within a vector container.
    * @return True if \p data was successfully published to \p topic, false
    *         otherwise. Publish will not occur (and will return false) if
-   *         there are no subscribers for this topic.
+   *         there are no subscribers for this topic, unless it is a
+   *         latest-value topic.
    */
   bool publish(const std::string &topic, const std::vector<uint8_t> &data);
 
@@ -126,6 +221,17 @@ public:
    */
   bool remove_subscriber(const std::string &topic, const std::string &component);
 
+  /**
+   * @brief Get the delivery statistics of \p component's subscriber on
+   *        \p topic.
+   * @param topic The topic that \p component is subscribing to.
+   * @param component The component for which the subscriber was registered.
+   * @return The statistics, or std::nullopt if \p component is not
+   *         registered for \p topic with a SubscriberConfig.
+   */
+  std::optional<SubscriberStats> get_subscriber_stats(const std::string &topic,
+                                                      const std::string &component);
+
 protected:
   EventManager()
       : BaseComponent("Event Manager") {}
@@ -134,10 +240,37 @@ protected:
     std::mutex m;
     std::condition_variable cv;
     std::deque<std::vector<uint8_t>> deq;
+    bool stopping{false};
+  };
+
+  struct RingSubscriber;
+
+  // messages of a topic, shared by the subscribers added with a
+  // SubscriberConfig. Message n is in slots[n % slots.size()].
+  struct TopicRing {
+    std::mutex m;
+    std::condition_variable cv;
+    std::vector<std::shared_ptr<const std::vector<uint8_t>>> slots;
+    size_t head{0}; // number of messages published
+    std::vector<std::unique_ptr<RingSubscriber>> subscribers;
+  };
+
+  struct RingSubscriber {
+    std::string component;
+    event_callback_fn callback;
+    size_t cursor{0}; // next message to deliver
+    bool stopping{false};
+    SubscriberStats stats;
+    std::unique_ptr<Task> task;
   };
 
   bool subscriber_task_fn(const std::string &topic, std::mutex &m, std::condition_variable &cv);
 
+  bool ring_subscriber_task_fn(TopicRing *ring, RingSubscriber *subscriber, std::mutex &m,
+                               std::condition_variable &cv);
+
+  bool remove_ring_subscriber(const std::string &topic, const std::string &component);
+
   std::recursive_mutex events_mutex_;
   detail::EventMap events_;
 
@@ -150,5 +283,24 @@ protected:
 
   std::recursive_mutex data_mutex_;
   std::unordered_map<std::string, SubscriberData> subscriber_data_;
+
+  std::recursive_mutex latest_values_mutex_;
+  std::unordered_map<std::string, std::shared_ptr<LatestValue>> latest_values_;
+
+  std::recursive_mutex rings_mutex_;
+  std::unordered_map<std::string, std::unique_ptr<TopicRing>> topic_rings_;
 };
 } // namespace espp
+
+// for printing of EventManager::SubscriberStats using libfmt
+template <> struct fmt::formatter<espp::EventManager::SubscriberStats> {
+  constexpr auto parse(format_parse_context &ctx) { return ctx.begin(); }
+
+  template <typename FormatContext>
+  auto format(const espp::EventManager::SubscriberStats &stats, FormatContext &ctx) {
+    return fmt::format_to(ctx.out(),
+                          "SubscriberStats{{num_delivered: {}, num_overflowed: {}, lag: {}, "
+                          "max_lag: {}}}",
+                          stats.num_delivered, stats.num_overflowed, stats.lag, stats.max_lag);
+  }
+};
@@ -6,13 +6,19 @@
 #include <unordered_map>
 #include <vector>
 
+#include "small_vector.hpp"
+
 namespace espp {
 namespace detail {
 struct EventMap {
+  // most topics only have a few publishers / subscribers, so store them
+  // inline to avoid a separate allocation for each topic's list
+  static constexpr size_t INLINE_COMPONENTS = 4;
+  using ComponentList = SmallVector<std::string, INLINE_COMPONENTS>;
   // topic -> [component1, component2, ...] mapping for publishing components
-  std::unordered_map<std::string, std::vector<std::string>> publishers;
+  std::unordered_map<std::string, ComponentList> publishers;
   // topic -> [component1, component2, ...] mapping for subscribing components
-  std::unordered_map<std::string, std::vector<std::string>> subscribers;
+  std::unordered_map<std::string, ComponentList> subscribers;
 };
 
 /**
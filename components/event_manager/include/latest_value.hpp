@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace espp {
+/**
+ * @brief Holds the latest value of some state (e.g. battery level, motor
+ *        angle, connection status) for readers which only need the latest
+ *        value, not every update. Implemented as a seqlock: writers never
+ *        wait for readers, and readers never take a lock - they copy the
+ *        value and retry only if a write happened meanwhile.
+ *
+ * @details The value is stored in a fixed size buffer allocated on
+ *          construction, so neither writing nor reading allocates (as long
+ *          as the reader reuses its vector). Each write increments the
+ *          version, so readers can cheaply poll for changes with
+ *          get_version() or read_if_newer(). Writers are serialized by a
+ *          mutex, which readers do not use.
+ *
+ * @note Used by the EventManager for latest-value topics, see
+ *       EventManager::add_latest_value_topic().
+ */
+class LatestValue {
+public:
+  /**
+   * @brief Construct a LatestValue which can hold up to \p max_size bytes.
+   * @param max_size The maximum size of the value in bytes.
+   */
+  explicit LatestValue(size_t max_size)
+      : max_size_(max_size)
+      , num_words_((max_size + sizeof(uint32_t) - 1) / sizeof(uint32_t))
+      , words_(std::make_unique<std::atomic<uint32_t>[]>(num_words_)) {}
+
+  /**
+   * @brief Get the maximum size of the value.
+   * @return The maximum size of the value in bytes.
+   */
+  size_t get_max_size() const { return max_size_; }
+
+  /**
+   * @brief Replace the value with \p data.
+   * @param data The new value.
+   * @return True if the value was written, false if \p data is larger than
+   *         the maximum size.
+   */
+  bool write(std::span<const uint8_t> data) {
+    if (data.size() > max_size_) {
+      return false;
+    }
+    std::lock_guard<std::mutex> lk(write_mutex_);
+    // an odd sequence tells readers that a write is in progress
+    uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    size_.store(data.size(), std::memory_order_relaxed);
+    for (size_t i = 0; i * sizeof(uint32_t) < data.size(); i++) {
+      uint32_t word = 0;
+      size_t offset = i * sizeof(uint32_t);
+      std::memcpy(&word, data.data() + offset, std::min(sizeof(word), data.size() - offset));
+      words_[i].store(word, std::memory_order_relaxed);
+    }
+    sequence_.store(sequence + 2, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Copy the value into \p data.
+   * @param data The vector to copy the value into. It is resized to the size
+   *        of the value, which does not allocate if its capacity is enough.
+   * @return The version of the value, 0 if it has not been written yet.
+   */
+  uint32_t read(std::vector<uint8_t> &data) const {
+    for (size_t attempt = 0;; attempt++) {
+      uint32_t sequence = sequence_.load(std::memory_order_acquire);
+      if (sequence & 1) {
+        // a write is in progress; let the writer finish if it was preempted
+        if (attempt > SPINS_BEFORE_YIELD) {
+          std::this_thread::yield();
+        }
+        continue;
+      }
+      size_t size = size_.load(std::memory_order_relaxed);
+      data.resize(size);
+      for (size_t i = 0; i * sizeof(uint32_t) < size; i++) {
+        uint32_t word = words_[i].load(std::memory_order_relaxed);
+        size_t offset = i * sizeof(uint32_t);
+        std::memcpy(data.data() + offset, &word, std::min(sizeof(word), size - offset));
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (sequence_.load(std::memory_order_relaxed) == sequence) {
+        return sequence / 2;
+      }
+    }
+  }
+
+  /**
+   * @brief Copy the value into \p data if it changed since \p version.
+   * @param data The vector to copy the value into.
+   * @param version The version of the value the caller has, updated to the
+   *        version of the value copied into \p data.
+   * @return True if the value changed and was copied, false otherwise.
+   */
+  bool read_if_newer(std::vector<uint8_t> &data, uint32_t &version) const {
+    if (get_version() == version) {
+      return false;
+    }
+    version = read(data);
+    return true;
+  }
+
+  /**
+   * @brief Get the version of the value, which is incremented by each write.
+   * @return The version of the value, 0 if it has not been written yet.
+   */
+  uint32_t get_version() const { return sequence_.load(std::memory_order_acquire) / 2; }
+
+protected:
+  static constexpr size_t SPINS_BEFORE_YIELD = 16;
+
+  size_t max_size_;
+  size_t num_words_;
+  std::unique_ptr<std::atomic<uint32_t>[]> words_;
+  std::atomic<size_t> size_{0};
+  std::atomic<uint32_t> sequence_{0};
+  std::mutex write_mutex_;
+};
+} // namespace espp
@@ -79,8 +79,116 @@ bool EventManager::add_subscriber(const std::string &topic, const std::string &c
   return true;
 }
 
+bool EventManager::add_subscriber(const std::string &topic, const std::string &component,
+                                  const event_callback_fn &callback,
+                                  const SubscriberConfig &config) {
+  logger_.info("Adding ring subscriber '{}' to topic '{}'", component, topic);
+  {
+    std::lock_guard<std::recursive_mutex> lk(events_mutex_);
+    // add to `events_`
+    // NOTE: this will default construct this if it does not exist
+    auto &topic_subscribers = events_.subscribers[topic];
+    auto [exists, index] = detail::get_index_in_container(component, topic_subscribers);
+    if (exists) {
+      // component is already registered as a subscriber, so return false
+      return false;
+    }
+    topic_subscribers.push_back(component);
+  }
+  std::lock_guard<std::recursive_mutex> lk(rings_mutex_);
+  auto &ring = topic_rings_[topic];
+  if (!ring) {
+    logger_.debug("Creating ring of {} messages for topic '{}'", config.ring_size, topic);
+    ring = std::make_unique<TopicRing>();
+    ring->slots.resize(std::max<size_t>(config.ring_size, 1));
+  }
+  auto subscriber = std::make_unique<RingSubscriber>();
+  subscriber->component = component;
+  subscriber->callback = callback;
+  auto task_config = config.task_config;
+  if (task_config.name.empty()) {
+    task_config.name = topic + " " + component + " subscriber";
+  }
+  using namespace std::placeholders;
+  subscriber->task = Task::make_unique(
+      {.callback = std::bind(&EventManager::ring_subscriber_task_fn, this, ring.get(),
+                             subscriber.get(), _1, _2),
+       .task_config = task_config});
+  auto task = subscriber->task.get();
+  {
+    std::lock_guard<std::mutex> ring_lk(ring->m);
+    // only deliver the messages published from now on
+    subscriber->cursor = ring->head;
+    ring->subscribers.push_back(std::move(subscriber));
+  }
+  task->start();
+  return true;
+}
+
+bool EventManager::add_latest_value_topic(const std::string &topic, size_t max_size) {
+  logger_.info("Adding latest-value topic '{}'", topic);
+  std::lock_guard<std::recursive_mutex> lk(latest_values_mutex_);
+  if (latest_values_.contains(topic)) {
+    return false;
+  }
+  latest_values_[topic] = std::make_shared<LatestValue>(max_size);
+  return true;
+}
+
+std::shared_ptr<const LatestValue> EventManager::get_latest_value(const std::string &topic) {
+  std::lock_guard<std::recursive_mutex> lk(latest_values_mutex_);
+  auto it = latest_values_.find(topic);
+  if (it == latest_values_.end()) {
+    return nullptr;
+  }
+  return it->second;
+}
+
+bool EventManager::remove_latest_value_topic(const std::string &topic) {
+  logger_.info("Removing latest-value topic '{}'", topic);
+  std::lock_guard<std::recursive_mutex> lk(latest_values_mutex_);
+  return latest_values_.erase(topic) > 0;
+}
+
 bool EventManager::publish(const std::string &topic, const std::vector<uint8_t> &data) {
   logger_.info("Publishing on topic '{}'", topic);
+  bool published = false;
+  // store the data as the latest value of latest-value topics
+  std::shared_ptr<LatestValue> latest_value;
+  {
+    std::lock_guard<std::recursive_mutex> lk(latest_values_mutex_);
+    auto it = latest_values_.find(topic);
+    if (it != latest_values_.end()) {
+      latest_value = it->second;
+    }
+  }
+  if (latest_value) {
+    if (!latest_value->write(data)) {
+      logger_.error("Cannot publish {} bytes on latest-value topic '{}', the maximum is {}",
+                    data.size(), topic, latest_value->get_max_size());
+      return false;
+    }
+    published = true;
+  }
+  // copy the data into the topic's ring (if any), shared by the ring
+  // subscribers which are woken up to deliver it from their own tasks
+  {
+    std::lock_guard<std::recursive_mutex> lk(rings_mutex_);
+    auto it = topic_rings_.find(topic);
+    if (it != topic_rings_.end()) {
+      auto &ring = *it->second;
+      auto message = std::make_shared<const std::vector<uint8_t>>(data);
+      {
+        std::lock_guard<std::mutex> ring_lk(ring.m);
+        // the overwritten message is released after unlocking, unless a
+        // subscriber is still using it
+        std::swap(message, ring.slots[ring.head % ring.slots.size()]);
+        ring.head++;
+      }
+      ring.cv.notify_all();
+      published = true;
+    }
+  }
   // find topic in `subscriber_data_`, push_back into the queue there and notify
   // the cv.
   // get the data queue
@@ -89,15 +197,20 @@ bool EventManager::publish(const std::string &topic, const std::vector<uint8_t>
     std::lock_guard<std::recursive_mutex> lk(data_mutex_);
     // find sub_data in `subscriber_data_`
     if (!subscriber_data_.contains(topic)) {
-      return false;
+      return published;
     }
     sub_data = &subscriber_data_[topic];
   }
   {
     // lock the data queue
     std::unique_lock<std::mutex> lk(sub_data->m);
-    // push the data into the queue
-    sub_data->deq.push_back(data);
+    if (latest_value && !sub_data->deq.empty()) {
+      // coalesce with the update which has not been delivered yet
+      sub_data->deq.back() = data;
+    } else {
+      // push the data into the queue
+      sub_data->deq.push_back(data);
+    }
   }
   // notify the task that there is new data in the queue
   sub_data->cv.notify_all();
@@ -149,7 +262,10 @@ bool EventManager::remove_subscriber(const std::string &topic, const std::string
     }
     // we found it, so remove it from the list
     topic_subscribers.erase(elem);
-    was_last_subscriber = topic_subscribers.size() == 0;
+  }
+  // remove from `topic_rings_` if it was a ring subscriber
+  if (remove_ring_subscriber(topic, component)) {
+    return true;
   }
   // remove from `subscriber_callbacks_`
   {
@@ -163,6 +279,8 @@ bool EventManager::remove_subscriber(const std::string &topic, const std::string
     if (elem != std::end(callbacks)) {
       callbacks.erase(elem);
     }
+    // ring subscribers do not use the topic's task
+    was_last_subscriber = callbacks.empty();
     if (was_last_subscriber) {
       // remove the key from the map
       subscriber_callbacks_.erase(topic);
@@ -174,7 +292,12 @@ bool EventManager::remove_subscriber(const std::string &topic, const std::string
     // notify the data (so the subscriber task function can stop waiting on the data cv)
     {
       std::lock_guard<std::recursive_mutex> lk(data_mutex_);
-      subscriber_data_[topic].cv.notify_all();
+      auto &sub_data = subscriber_data_[topic];
+      {
+        std::lock_guard<std::mutex> data_lk(sub_data.m);
+        sub_data.stopping = true;
+      }
+      sub_data.cv.notify_all();
     }
     {
       std::lock_guard<std::recursive_mutex> lk(tasks_mutex_);
@@ -192,6 +315,90 @@ bool EventManager::remove_subscriber(const std::string &topic, const std::string
   return true;
 }
 
+bool EventManager::remove_ring_subscriber(const std::string &topic,
+                                          const std::string &component) {
+  std::unique_ptr<TopicRing> ring_to_delete;
+  std::unique_ptr<RingSubscriber> subscriber;
+  {
+    std::lock_guard<std::recursive_mutex> lk(rings_mutex_);
+    auto it = topic_rings_.find(topic);
+    if (it == topic_rings_.end()) {
+      return false;
+    }
+    auto &ring = *it->second;
+    {
+      std::lock_guard<std::mutex> ring_lk(ring.m);
+      auto elem = std::find_if(ring.subscribers.begin(), ring.subscribers.end(),
+                               [&component](auto &s) { return s->component == component; });
+      if (elem == ring.subscribers.end()) {
+        return false;
+      }
+      subscriber = std::move(*elem);
+      ring.subscribers.erase(elem);
+      subscriber->stopping = true;
+    }
+    ring.cv.notify_all();
+    if (ring.subscribers.empty()) {
+      logger_.info("It was the last ring subscriber for '{}', removing the ring", topic);
+      ring_to_delete = std::move(it->second);
+      topic_rings_.erase(it);
+    }
+  }
+  // stop the task without holding the lock, since its callback may be
+  // publishing; the ring is deleted afterwards
+  subscriber->task->stop();
+  return true;
+}
+
+std::optional<EventManager::SubscriberStats>
+EventManager::get_subscriber_stats(const std::string &topic, const std::string &component) {
+  std::lock_guard<std::recursive_mutex> lk(rings_mutex_);
+  auto it = topic_rings_.find(topic);
+  if (it == topic_rings_.end()) {
+    return std::nullopt;
+  }
+  auto &ring = *it->second;
+  std::lock_guard<std::mutex> ring_lk(ring.m);
+  for (const auto &subscriber : ring.subscribers) {
+    if (subscriber->component == component) {
+      auto stats = subscriber->stats;
+      stats.lag = ring.head - subscriber->cursor;
+      return stats;
+    }
+  }
+  return std::nullopt;
+}
+
+bool EventManager::ring_subscriber_task_fn(TopicRing *ring, RingSubscriber *subscriber,
+                                           std::mutex &m, std::condition_variable &cv) {
+  std::shared_ptr<const std::vector<uint8_t>> data;
+  {
+    std::unique_lock<std::mutex> lk(ring->m);
+    ring->cv.wait(lk, [&] { return subscriber->stopping || subscriber->cursor != ring->head; });
+    if (subscriber->stopping) {
+      return true;
+    }
+    auto &stats = subscriber->stats;
+    size_t lag = ring->head - subscriber->cursor;
+    if (lag > ring->slots.size()) {
+      // the oldest messages have been overwritten, skip to the oldest one
+      // which is still in the ring
+      stats.num_overflowed += lag - ring->slots.size();
+      subscriber->cursor = ring->head - ring->slots.size();
+      lag = ring->slots.size();
+    }
+    stats.max_lag = std::max(stats.max_lag, lag);
+    stats.num_delivered++;
+    data = ring->slots[subscriber->cursor % ring->slots.size()];
+    subscriber->cursor++;
+  }
+  // the shared_ptr keeps the message valid even if it is overwritten while
+  // the callback runs
+  subscriber->callback(*data);
+  // we don't want to stop the task...
+  return false;
+}
+
 bool EventManager::subscriber_task_fn(const std::string &topic, std::mutex &m,
                                       std::condition_variable &cv) {
   // get the data queue
@@ -210,14 +417,18 @@ bool EventManager::subscriber_task_fn(const std::string &topic, std::mutex &m,
   {
     // wait on sub_data's mutex/cv
     std::unique_lock<std::mutex> lk(sub_data->m);
-    sub_data->cv.wait(lk);
-    if (sub_data->deq.empty()) {
-      // stop the task, we were notified, but there was no data available.
+    // data may have been published before we started waiting
+    sub_data->cv.wait(lk, [&] { return sub_data->stopping || !sub_data->deq.empty(); });
+    if (sub_data->stopping) {
+      // stop the task, the last subscriber was removed
       return true;
     }
   }
   // we were woken up - that means there must be >= 1 element in the queue,
-  // so let's loop until we get all the data
+  // so let's loop until we get all the data. The callbacks are copied out for
+  // each event (reusing this vector's storage), since a subscriber may be
+  // removed - destroying its callback - while the callbacks are running.
+  std::vector<std::pair<std::string, event_callback_fn>> callbacks;
   while (true) {
     logger_.debug("Getting data for topic '{}'", topic);
     std::vector<uint8_t> data;
@@ -227,27 +438,27 @@ bool EventManager::subscriber_task_fn(const std::string &topic, std::mutex &m,
         // we've gotten all the data, so break out of the loop
         break;
       }
-      // set data to sub_data's deque front
-      data = sub_data->deq.front();
+      // take the data from sub_data's deque front
+      data = std::move(sub_data->deq.front());
       // and pop the front data off
       sub_data->deq.pop_front();
     }
     // get all the callbacks
     logger_.debug("Finding callbacks for topic '{}'", topic);
-    std::vector<std::pair<std::string, event_callback_fn>> *callbacks;
     {
       std::lock_guard<std::recursive_mutex> lk(callbacks_mutex_);
-      if (!subscriber_callbacks_.contains(topic)) {
+      auto it = subscriber_callbacks_.find(topic);
+      if (it == subscriber_callbacks_.end()) {
         // stop the task, we don't have any callbacks anymore.
         return true;
       }
       // copy here so that we don't hold this lock the whole time we're calling
       // callbacks
-      callbacks = &subscriber_callbacks_[topic];
+      callbacks.assign(it->second.begin(), it->second.end());
     }
     // call all the callbacks
-    logger_.debug("Calling {} callbacks for topic '{}'", callbacks->size(), topic);
-    for (auto [comp, callback] : *callbacks) {
+    logger_.debug("Calling {} callbacks for topic '{}'", callbacks.size(), topic);
+    for (auto &[comp, callback] : callbacks) {
       logger_.debug("Callback for '{}'", comp);
       callback(data);
     }
@@ -0,0 +1,92 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "async_file.hpp"
+#include "file_io.hpp"
+#include "file_system.hpp"
+#include "logger.hpp"
+
+using namespace std::chrono_literals;
+
+extern "C" void app_main(void) {
+  static espp::Logger logger({.tag = "file io example", .level = espp::Logger::Verbosity::INFO});
+  logger.info("Running file I/O example!");
+
+  auto root_path = espp::FileSystem::get().get_root_path();
+
+  {
+    //! [file io service example]
+    espp::FileIoService service({
+        .task_config = {.name = "file io", .stack_size_bytes = 4 * 1024, .priority = 5},
+    });
+    auto path = root_path / "service.bin";
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    std::vector<uint8_t> data(1024, 0x5a);
+    // the write and the sync run in the service's task, the future lets us
+    // wait for (or poll) the result
+    auto written = service.write(fd, 0, data);
+    auto synced = service.sync(fd);
+    logger.info("Queued a write and a sync, {} requests pending", service.get_num_pending());
+    auto write_result = written.get();
+    auto sync_result = synced.get();
+    logger.info("Wrote {} bytes ({}), synced ({})", write_result.bytes, write_result.ec.message(),
+                sync_result.ec.message());
+    // or get a callback (from the service's task) when the request completes
+    std::vector<uint8_t> buffer(1024);
+    std::atomic<bool> done{false};
+    service.read(fd, 0, buffer, [&](const espp::FileIoResult &result) {
+      logger.info("Read {} bytes ({})", result.bytes, result.ec.message());
+      done = true;
+    });
+    while (!done) {
+      std::this_thread::sleep_for(1ms);
+    }
+    close(fd);
+    //! [file io service example]
+  }
+
+  {
+    //! [async file example]
+    espp::FileIoService service({});
+    auto path = root_path / "log.bin";
+    std::error_code ec;
+    // write-behind: the writer copies the data into a block, and the service
+    // writes full blocks while we produce the next ones
+    espp::AsyncFileWriter writer(service, {.block_size = 4096, .num_blocks = 2});
+    if (!writer.open(path, ec)) {
+      logger.error("Failed to open {}: {}", path.string(), ec.message());
+      return;
+    }
+    std::vector<uint8_t> record(100);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < 1000; i++) {
+      std::fill(record.begin(), record.end(), uint8_t(i));
+      writer.write(record, ec);
+    }
+    // durability point: ready once everything written so far is on the flash
+    auto synced = writer.sync();
+    logger.info("Sync: {}", synced.get().ec.message());
+    writer.close(ec);
+    auto end = std::chrono::high_resolution_clock::now();
+    logger.info("Wrote {} bytes in {:.1f} ms", writer.get_size(),
+                std::chrono::duration<float, std::milli>(end - start).count());
+
+    // read-ahead: the service reads the next block while we process this one
+    espp::AsyncFileReader reader(service, {.block_size = 4096, .num_blocks = 2});
+    reader.open(path, 0, ec);
+    size_t total = 0;
+    for (auto block = reader.read_next(ec); !block.empty(); block = reader.read_next(ec)) {
+      total += block.size();
+    }
+    logger.info("Read {} bytes ({})", total, ec.message());
+    //! [async file example]
+  }
+
+  logger.info("File I/O example complete!");
+
+  while (true) {
+    std::this_thread::sleep_for(1s);
+  }
+}
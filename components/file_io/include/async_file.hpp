@@ -0,0 +1,336 @@
+#pragma once
+
+#include <filesystem>
+#include <future>
+#include <vector>
+
+#include "file_io.hpp"
+
+namespace espp {
+/**
+ * @brief Sequential file reader with read-ahead.
+ *
+ * @details Keeps num_blocks reads of block_size bytes queued on a
+ *          FileIoService, so that while the caller processes one block (e.g.
+ *          sends it over a socket), the next ones are already being read.
+ *          Memory use is num_blocks * block_size, allocated when the reader
+ *          is constructed.
+ *
+ * \section async_file_reader_ex1 Example
+ * \snippet file_io_example.cpp async file example
+ */
+class AsyncFileReader {
+public:
+  /**
+   * @brief Configuration for the AsyncFileReader.
+   */
+  struct Config {
+    size_t block_size{4096}; ///< Size of each read.
+    size_t num_blocks{2};    ///< Number of blocks read ahead (>= 2 to overlap).
+  };
+
+  /**
+   * @brief Construct the reader.
+   * @param service Service executing the reads, must outlive the reader.
+   * @param config Configuration for the reader.
+   */
+  AsyncFileReader(FileIoService &service, const Config &config)
+      : service_(service)
+      , block_size_(config.block_size)
+      , blocks_(std::max<size_t>(config.num_blocks, 1)) {
+    for (auto &block : blocks_) {
+      block.data.resize(block_size_);
+    }
+  }
+
+  /**
+   * @brief Wait for outstanding reads and close the file.
+   */
+  ~AsyncFileReader() { close(); }
+
+  AsyncFileReader(const AsyncFileReader &) = delete;
+  AsyncFileReader &operator=(const AsyncFileReader &) = delete;
+
+  /**
+   * @brief Open a file and start reading it.
+   * @param path Path of the file.
+   * @param offset Offset to start reading at.
+   * @param ec Set if the file could not be opened.
+   * @return True on success, false on error.
+   */
+  bool open(const std::filesystem::path &path, size_t offset, std::error_code &ec) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      ec = std::error_code(errno, std::generic_category());
+      return false;
+    }
+    open(fd, offset);
+    return true;
+  }
+
+  /**
+   * @brief Start reading an open file.
+   * @param fd File descriptor (opened for reading), which the reader takes
+   *        ownership of and closes.
+   * @param offset Offset to start reading at.
+   */
+  void open(int fd, size_t offset) {
+    close();
+    fd_ = fd;
+    next_offset_ = offset;
+    for (size_t i = 0; i < blocks_.size(); i++) {
+      start_read(blocks_[i]);
+    }
+    current_ = 0;
+    returned_ = false;
+    at_end_ = false;
+  }
+
+  /**
+   * @brief Get the next block of the file.
+   * @details Waits until the next block has been read. The block stays valid
+   *          until the next call.
+   * @param ec Set if the read failed.
+   * @return The next block, empty at the end of the file or on error.
+   */
+  std::span<const uint8_t> read_next(std::error_code &ec) {
+    if (fd_ < 0 || at_end_) {
+      return {};
+    }
+    if (returned_) {
+      // the caller is done with the previous block, reuse it to read ahead
+      start_read(blocks_[current_]);
+      current_ = (current_ + 1) % blocks_.size();
+    }
+    auto result = blocks_[current_].result.get();
+    returned_ = true;
+    if (result.ec) {
+      ec = result.ec;
+      at_end_ = true;
+      return {};
+    }
+    if (result.bytes < block_size_) {
+      // the blocks after this one are past the end of the file
+      at_end_ = true;
+    }
+    return std::span<const uint8_t>(blocks_[current_].data.data(), result.bytes);
+  }
+
+  /**
+   * @brief Wait for outstanding reads and close the file.
+   */
+  void close() {
+    if (fd_ < 0) {
+      return;
+    }
+    for (auto &block : blocks_) {
+      if (block.result.valid()) {
+        block.result.wait();
+      }
+    }
+    ::close(fd_);
+    fd_ = -1;
+  }
+
+protected:
+  struct Block {
+    std::vector<uint8_t> data;
+    std::future<FileIoResult> result;
+  };
+
+  void start_read(Block &block) {
+    block.result = service_.read(fd_, next_offset_, block.data);
+    next_offset_ += block_size_;
+  }
+
+  FileIoService &service_;
+  size_t block_size_;
+  std::vector<Block> blocks_;
+  int fd_{-1};
+  size_t next_offset_{0};
+  size_t current_{0};
+  bool returned_{false};
+  bool at_end_{false};
+};
+
+/**
+ * @brief Sequential file writer with write-behind.
+ *
+ * @details Copies the data it is given into block_size buffers and queues
+ *          each full buffer on a FileIoService, so the caller (e.g. a task
+ *          receiving the data from a socket) only waits for the file system
+ *          if all num_blocks buffers are still being written. sync() is an
+ *          explicit durability point: its result is ready once everything
+ *          written before it is on the storage.
+ *
+ * \section async_file_writer_ex1 Example
+ * \snippet file_io_example.cpp async file example
+ */
+class AsyncFileWriter {
+public:
+  /**
+   * @brief Configuration for the AsyncFileWriter.
+   */
+  struct Config {
+    size_t block_size{4096}; ///< Size of each write.
+    size_t num_blocks{2};    ///< Number of blocks being written behind (>= 2 to overlap).
+  };
+
+  /**
+   * @brief Construct the writer.
+   * @param service Service executing the writes, must outlive the writer.
+   * @param config Configuration for the writer.
+   */
+  AsyncFileWriter(FileIoService &service, const Config &config)
+      : service_(service)
+      , block_size_(config.block_size)
+      , blocks_(std::max<size_t>(config.num_blocks, 1)) {
+    for (auto &block : blocks_) {
+      block.data.reserve(block_size_);
+    }
+  }
+
+  /**
+   * @brief Write any buffered data and close the file.
+   */
+  ~AsyncFileWriter() {
+    std::error_code ec;
+    close(ec);
+  }
+
+  AsyncFileWriter(const AsyncFileWriter &) = delete;
+  AsyncFileWriter &operator=(const AsyncFileWriter &) = delete;
+
+  /**
+   * @brief Create (or truncate) a file for writing.
+   * @param path Path of the file.
+   * @param ec Set if the file could not be opened.
+   * @return True on success, false on error.
+   */
+  bool open(const std::filesystem::path &path, std::error_code &ec) {
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+      ec = std::error_code(errno, std::generic_category());
+      return false;
+    }
+    open(fd);
+    return true;
+  }
+
+  /**
+   * @brief Start writing an open file, from its beginning.
+   * @param fd File descriptor (opened for writing), which the writer takes
+   *        ownership of and closes.
+   */
+  void open(int fd) {
+    std::error_code ec;
+    close(ec);
+    fd_ = fd;
+    offset_ = 0;
+    current_ = 0;
+    error_.clear();
+  }
+
+  /**
+   * @brief Write data to the file.
+   * @param data The data to write.
+   * @param ec Set if this or a previous write failed.
+   * @return True on success, false on error.
+   */
+  bool write(std::span<const uint8_t> data, std::error_code &ec) {
+    while (!data.empty() && !error_) {
+      // the current block is never being written (see submit_current())
+      auto &block = blocks_[current_];
+      size_t n = std::min(data.size(), block_size_ - block.data.size());
+      block.data.insert(block.data.end(), data.begin(), data.begin() + n);
+      data = data.subspan(n);
+      if (block.data.size() == block_size_) {
+        submit_current();
+      }
+    }
+    ec = error_;
+    return !error_;
+  }
+
+  /**
+   * @brief Write any buffered data and flush the file to the storage.
+   * @return Future for the result of the sync, ready once all data written
+   *         so far is on the storage.
+   */
+  std::future<FileIoResult> sync() {
+    submit_current();
+    return service_.sync(fd_);
+  }
+
+  /**
+   * @brief Write any buffered data, wait for all writes and close the file.
+   * @param ec Set if any write failed.
+   * @return True on success, false on error.
+   */
+  bool close(std::error_code &ec) {
+    if (fd_ < 0) {
+      return true;
+    }
+    submit_current();
+    // wait for all writes and drop the written data, so that a reopened
+    // writer starts with empty blocks
+    for (auto &block : blocks_) {
+      if (block.result.valid()) {
+        check(block.result.get());
+      }
+      block.result = {};
+      block.data.clear();
+    }
+    current_ = 0;
+    if (::close(fd_) != 0 && !error_) {
+      error_ = std::error_code(errno, std::generic_category());
+    }
+    fd_ = -1;
+    ec = error_;
+    return !error_;
+  }
+
+  /**
+   * @brief Get the number of bytes written (including buffered data).
+   * @return The number of bytes written.
+   */
+  size_t get_size() const { return offset_ + blocks_[current_].data.size(); }
+
+protected:
+  struct Block {
+    std::vector<uint8_t> data;
+    std::future<FileIoResult> result;
+  };
+
+  void submit_current() {
+    auto &block = blocks_[current_];
+    if (block.data.empty()) {
+      return;
+    }
+    block.result = service_.write(fd_, offset_, block.data);
+    offset_ += block.data.size();
+    // move on to the next block, waiting for its previous write if all
+    // blocks are being written
+    current_ = (current_ + 1) % blocks_.size();
+    auto &next = blocks_[current_];
+    if (next.result.valid()) {
+      check(next.result.get());
+    }
+    next.data.clear();
+  }
+
+  void check(const FileIoResult &result) {
+    if (result.ec && !error_) {
+      error_ = result.ec;
+    }
+  }
+
+  FileIoService &service_;
+  size_t block_size_;
+  std::vector<Block> blocks_;
+  int fd_{-1};
+  size_t offset_{0};
+  size_t current_{0};
+  std::error_code error_;
+};
+} // namespace espp
@@ -0,0 +1,428 @@
+#pragma once
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#if !defined(ESP_PLATFORM) && __has_include(<aio.h>)
+#include <aio.h>
+#define ESPP_FILE_IO_HAS_POSIX_AIO 1
+#endif
+
+#include "base_component.hpp"
+#include "task.hpp"
+
+namespace espp {
+/**
+ * @brief Result of a FileIoService request.
+ */
+struct FileIoResult {
+  size_t bytes{0};    ///< Number of bytes read / written (less than requested at end of file).
+  std::error_code ec; ///< Error, if the request failed.
+};
+
+/**
+ * @brief Callback called (from the FileIoService's task) when a request
+ *        completes.
+ * @param result The result of the request.
+ */
+typedef std::function<void(const FileIoResult &result)> file_io_callback_fn;
+
+/**
+ * @brief Asynchronous file I/O service.
+ *
+ * @details Executes positional reads, writes and syncs of file descriptors
+ *          (opened with open(), e.g. on the FileSystem's LittleFS mount) in
+ *          a dedicated task, so that the tasks which submit them can keep
+ *          working (e.g. sending the previous block over a socket) while the
+ *          file system waits on the flash. Each request completes either a
+ *          std::future or calls a callback from the service's task.
+ *
+ *          Requests are started in the order they were submitted. A sync()
+ *          is a barrier: it starts only after all previously submitted
+ *          requests have completed, and later requests start only after it
+ *          completed, so it is a durability point for everything written
+ *          before it.
+ *
+ *          With the WORKER backend, the task executes one request at a time
+ *          with pread() / pwrite() / fsync(). On Linux, the POSIX_AIO backend
+ *          instead keeps up to max_in_flight requests in flight using
+ *          aio_read() / aio_write(), so independent reads and writes overlap
+ *          inside the kernel as well.
+ *
+ *          Buffers passed to read() / write() must stay valid until the
+ *          request completes. The AsyncFileReader and AsyncFileWriter manage
+ *          the buffers for sequential read-ahead and write-behind.
+ *
+ *          When destroyed, the service completes all requests which were
+ *          already submitted.
+ *
+ * \section file_io_ex1 File I/O Service Example
+ * \snippet file_io_example.cpp file io service example
+ */
+class FileIoService : public BaseComponent {
+public:
+  /**
+   * @brief How the requests are executed.
+   */
+  enum class Backend {
+    WORKER,    ///< One request at a time with blocking pread() / pwrite() in the service's task.
+    POSIX_AIO, ///< Up to max_in_flight concurrent POSIX AIO requests (Linux only).
+  };
+
+  /**
+   * @brief Configuration for the FileIoService.
+   */
+  struct Config {
+    Backend backend{Backend::WORKER}; ///< Backend executing the requests.
+    size_t max_in_flight{4};          ///< Maximum concurrent requests (POSIX_AIO backend).
+    /// Configuration of the service's task.
+    Task::BaseConfig task_config{.name = "FileIoService", .stack_size_bytes = 4 * 1024};
+    Logger::Verbosity log_level{Logger::Verbosity::WARN}; ///< Log verbosity.
+  };
+
+  /**
+   * @brief Construct the service and start its task.
+   * @param config Configuration for the service.
+   */
+  explicit FileIoService(const Config &config)
+      : BaseComponent("FileIoService", config.log_level)
+      , backend_(config.backend)
+      , max_in_flight_(std::max<size_t>(config.max_in_flight, 1)) {
+#if !defined(ESPP_FILE_IO_HAS_POSIX_AIO)
+    if (backend_ == Backend::POSIX_AIO) {
+      logger_.warn("POSIX AIO is not available, using the WORKER backend");
+      backend_ = Backend::WORKER;
+    }
+#endif
+    using namespace std::placeholders;
+    task_ = Task::make_unique(Task::AdvancedConfig{
+        .callback = std::bind(&FileIoService::task_fn, this, _1, _2),
+        .task_config = config.task_config,
+        .log_level = config.log_level,
+    });
+    task_->start();
+  }
+
+  /**
+   * @brief Complete all submitted requests and stop the service's task.
+   */
+  ~FileIoService() {
+    {
+      std::lock_guard<std::mutex> lk(queue_mutex_);
+      stopping_ = true;
+    }
+    queue_cv_.notify_all();
+    task_->stop();
+  }
+
+  /**
+   * @brief Get the backend executing the requests.
+   * @return The backend (WORKER if POSIX_AIO was requested but is not
+   *         available).
+   */
+  Backend get_backend() const { return backend_; }
+
+  /**
+   * @brief Read up to buffer.size() bytes at \p offset of \p fd.
+   * @param fd The file descriptor.
+   * @param offset Offset in the file.
+   * @param buffer Buffer to read into, must stay valid until completion.
+   * @param callback Called with the result.
+   */
+  void read(int fd, size_t offset, std::span<uint8_t> buffer, const file_io_callback_fn &callback) {
+    submit({Operation::READ, fd, offset, buffer.data(), buffer.size(), callback});
+  }
+
+  /**
+   * @brief Read up to buffer.size() bytes at \p offset of \p fd.
+   * @param fd The file descriptor.
+   * @param offset Offset in the file.
+   * @param buffer Buffer to read into, must stay valid until completion.
+   * @return Future for the result.
+   */
+  std::future<FileIoResult> read(int fd, size_t offset, std::span<uint8_t> buffer) {
+    return submit_with_future({Operation::READ, fd, offset, buffer.data(), buffer.size()});
+  }
+
+  /**
+   * @brief Write \p data at \p offset of \p fd.
+   * @param fd The file descriptor.
+   * @param offset Offset in the file.
+   * @param data Data to write, must stay valid until completion.
+   * @param callback Called with the result.
+   */
+  void write(int fd, size_t offset, std::span<const uint8_t> data,
+             const file_io_callback_fn &callback) {
+    submit({Operation::WRITE, fd, offset, const_cast<uint8_t *>(data.data()), data.size(),
+            callback});
+  }
+
+  /**
+   * @brief Write \p data at \p offset of \p fd.
+   * @param fd The file descriptor.
+   * @param offset Offset in the file.
+   * @param data Data to write, must stay valid until completion.
+   * @return Future for the result.
+   */
+  std::future<FileIoResult> write(int fd, size_t offset, std::span<const uint8_t> data) {
+    return submit_with_future(
+        {Operation::WRITE, fd, offset, const_cast<uint8_t *>(data.data()), data.size()});
+  }
+
+  /**
+   * @brief Flush all data previously written to \p fd to the storage.
+   * @param fd The file descriptor.
+   * @param callback Called with the result.
+   */
+  void sync(int fd, const file_io_callback_fn &callback) {
+    submit({Operation::SYNC, fd, 0, nullptr, 0, callback});
+  }
+
+  /**
+   * @brief Flush all data previously written to \p fd to the storage.
+   * @param fd The file descriptor.
+   * @return Future for the result.
+   */
+  std::future<FileIoResult> sync(int fd) {
+    return submit_with_future({Operation::SYNC, fd, 0, nullptr, 0});
+  }
+
+  /**
+   * @brief Get the number of requests which have not completed yet.
+   * @return The number of queued and in-flight requests.
+   */
+  size_t get_num_pending() const {
+    std::lock_guard<std::mutex> lk(queue_mutex_);
+    return queue_.size() + num_in_flight_;
+  }
+
+protected:
+  enum class Operation { READ, WRITE, SYNC };
+
+  struct Request {
+    Operation operation{Operation::READ};
+    int fd{-1};
+    size_t offset{0};
+    uint8_t *data{nullptr};
+    size_t size{0};
+    file_io_callback_fn callback{nullptr};
+    size_t done{0};
+#if defined(ESPP_FILE_IO_HAS_POSIX_AIO)
+    struct aiocb cb {};
+#endif
+  };
+
+  std::future<FileIoResult> submit_with_future(Request &&request) {
+    auto promise = std::make_shared<std::promise<FileIoResult>>();
+    auto future = promise->get_future();
+    request.callback = [promise](const FileIoResult &result) { promise->set_value(result); };
+    submit(std::move(request));
+    return future;
+  }
+
+  void submit(Request &&request) {
+    {
+      std::lock_guard<std::mutex> lk(queue_mutex_);
+      queue_.push_back(std::make_unique<Request>(std::move(request)));
+    }
+    queue_cv_.notify_all();
+  }
+
+  std::unique_ptr<Request> pop_request() {
+    auto request = std::move(queue_.front());
+    queue_.pop_front();
+    return request;
+  }
+
+  static void complete(Request &request, std::error_code ec = {}) {
+    if (request.callback) {
+      request.callback({.bytes = request.done, .ec = ec});
+    }
+  }
+
+  static std::error_code last_error() { return std::error_code(errno, std::generic_category()); }
+
+  // executes the request with blocking calls
+  static void execute(Request &request) {
+    if (request.operation == Operation::SYNC) {
+      complete(request, fsync(request.fd) == 0 ? std::error_code{} : last_error());
+      return;
+    }
+    while (request.done < request.size) {
+      ssize_t result;
+      if (request.operation == Operation::READ) {
+        result = pread(request.fd, request.data + request.done, request.size - request.done,
+                       request.offset + request.done);
+      } else {
+        result = pwrite(request.fd, request.data + request.done, request.size - request.done,
+                        request.offset + request.done);
+      }
+      if (result < 0 && errno == EINTR) {
+        continue;
+      }
+      if (result < 0) {
+        complete(request, last_error());
+        return;
+      }
+      if (result == 0) {
+        // end of file
+        break;
+      }
+      request.done += result;
+    }
+    complete(request);
+  }
+
+  bool task_fn(std::mutex &m, std::condition_variable &cv) {
+#if defined(ESPP_FILE_IO_HAS_POSIX_AIO)
+    if (backend_ == Backend::POSIX_AIO) {
+      return aio_task_fn();
+    }
+#endif
+    std::unique_ptr<Request> request;
+    {
+      std::unique_lock<std::mutex> lk(queue_mutex_);
+      queue_cv_.wait(lk, [this] { return !queue_.empty() || stopping_; });
+      if (queue_.empty()) {
+        // stopping, and all requests have completed
+        return true;
+      }
+      request = pop_request();
+      num_in_flight_ = 1;
+    }
+    execute(*request);
+    std::lock_guard<std::mutex> lk(queue_mutex_);
+    num_in_flight_ = 0;
+    return false;
+  }
+
+#if defined(ESPP_FILE_IO_HAS_POSIX_AIO)
+  bool start_aio(Request &request) {
+    auto &cb = request.cb;
+    cb = {};
+    cb.aio_fildes = request.fd;
+    cb.aio_offset = request.offset + request.done;
+    cb.aio_buf = request.data + request.done;
+    cb.aio_nbytes = request.size - request.done;
+    cb.aio_sigevent.sigev_notify = SIGEV_NONE;
+    int result = request.operation == Operation::READ ? aio_read(&cb) : aio_write(&cb);
+    if (result != 0) {
+      complete(request, last_error());
+      return false;
+    }
+    return true;
+  }
+
+  bool aio_task_fn() {
+    using namespace std::chrono_literals;
+    {
+      std::unique_lock<std::mutex> lk(queue_mutex_);
+      if (in_flight_.empty()) {
+        queue_cv_.wait(lk, [this] { return !queue_.empty() || stopping_; });
+        if (queue_.empty()) {
+          return true;
+        }
+      }
+    }
+    // start as many requests as possible, stopping at a sync (barrier)
+    while (true) {
+      std::unique_ptr<Request> request;
+      {
+        std::lock_guard<std::mutex> lk(queue_mutex_);
+        if (queue_.empty() || in_flight_.size() >= max_in_flight_) {
+          break;
+        }
+        if (queue_.front()->operation == Operation::SYNC) {
+          if (!in_flight_.empty()) {
+            break;
+          }
+          request = pop_request();
+          num_in_flight_ = 1;
+        } else {
+          request = pop_request();
+          num_in_flight_ = in_flight_.size() + 1;
+        }
+      }
+      if (request->operation == Operation::SYNC) {
+        execute(*request);
+        std::lock_guard<std::mutex> lk(queue_mutex_);
+        num_in_flight_ = 0;
+        continue;
+      }
+      if (request->size == 0 || !start_aio(*request)) {
+        if (request->size == 0) {
+          complete(*request);
+        }
+        std::lock_guard<std::mutex> lk(queue_mutex_);
+        num_in_flight_ = in_flight_.size();
+        continue;
+      }
+      in_flight_.push_back(std::move(request));
+    }
+    if (in_flight_.empty()) {
+      return false;
+    }
+    // wait for at least one to complete; with a timeout so that new requests
+    // are started promptly
+    aio_list_.clear();
+    for (auto &request : in_flight_) {
+      aio_list_.push_back(&request->cb);
+    }
+    struct timespec timeout = {.tv_sec = 0, .tv_nsec = 1'000'000};
+    aio_suspend(aio_list_.data(), aio_list_.size(), &timeout);
+    // complete the finished requests, in order, restarting partial transfers
+    for (auto it = in_flight_.begin(); it != in_flight_.end();) {
+      auto &request = **it;
+      int error = aio_error(&request.cb);
+      if (error == EINPROGRESS) {
+        ++it;
+        continue;
+      }
+      ssize_t result = aio_return(&request.cb);
+      if (error != 0) {
+        complete(request, std::error_code(error, std::generic_category()));
+      } else if (result > 0 && request.done + result < request.size) {
+        request.done += result;
+        if (start_aio(request)) {
+          ++it;
+          continue;
+        }
+        // start_aio() completed the request with the error
+      } else {
+        request.done += result;
+        complete(request);
+      }
+      it = in_flight_.erase(it);
+    }
+    std::lock_guard<std::mutex> lk(queue_mutex_);
+    num_in_flight_ = in_flight_.size();
+    return false;
+  }
+
+  std::deque<std::unique_ptr<Request>> in_flight_;
+  std::vector<const struct aiocb *> aio_list_;
+#endif
+
+  Backend backend_;
+  size_t max_in_flight_;
+  mutable std::mutex queue_mutex_;
+  std::condition_variable queue_cv_;
+  std::deque<std::unique_ptr<Request>> queue_;
+  size_t num_in_flight_{0};
+  bool stopping_{false};
+  std::unique_ptr<Task> task_;
+};
+} // namespace espp
@@ -0,0 +1,413 @@
+#pragma once
+
+#if !__has_include("lfs.h") && !defined(_DOXYGEN_)
+#error "littlefs_simulator.hpp needs the LittleFS sources (lfs.h) from the esp_littlefs submodule"
+#endif
+
+#include <memory>
+#include <span>
+#include <string>
+#include <system_error>
+
+#include "lfs.h"
+
+#include "base_component.hpp"
+#include "nor_flash_simulator.hpp"
+
+namespace espp {
+/**
+ * @brief LittleFS on a simulated NOR flash, to run the file access patterns
+ *        of the FileSystem on a host and measure their cost.
+ *
+ * @details Mounts the same LittleFS the FileSystem uses on the device (from
+ *          the esp_littlefs component) on a NorFlashSimulator, with the same
+ *          defaults as esp_littlefs (128 byte reads / programs, 512 byte
+ *          caches, 4 KiB blocks). The flash counts every read, program and
+ *          erase and estimates their duration, so comparing its stats before
+ *          and after an operation gives the write amplification (bytes
+ *          programmed / bytes written), the erases and the (simulated) time of
+ *          that operation. Since the geometry and cache sizes are part of the
+ *          Config, it can be used to tune them before changing the partition
+ *          or the menuconfig of the device. Power cuts scheduled on the flash
+ *          test that the data survives them.
+ *
+ *          The files are accessed through the File handles of this class
+ *          rather than POSIX / std::filesystem, since there is no VFS on the
+ *          host. On the host, lib/CMakeLists.txt builds LittleFS from the
+ *          esp_littlefs submodule if ESPP_LITTLEFS is ON (default OFF).
+ *
+ * \section littlefs_simulator_ex1 Example
+ * @code{.cpp}
+ *   espp::LittleFsSimulator fs({.flash = {.block_count = 256}});
+ *   std::error_code ec;
+ *   fs.format(ec);
+ *   fs.mount(ec);
+ *   auto before = fs.get_flash().get_stats();
+ *   auto file = fs.open("log.bin", LFS_O_WRONLY | LFS_O_CREAT | LFS_O_APPEND, ec);
+ *   file.write(record, ec);
+ *   file.sync(ec);
+ *   auto cost = fs.get_flash().get_stats() - before;
+ *   float write_amplification = float(cost.bytes_programmed) / record.size();
+ * @endcode
+ */
+class LittleFsSimulator : public BaseComponent {
+public:
+  /**
+   * @brief Configuration for the LittleFsSimulator.
+   */
+  struct Config {
+    NorFlashSimulator::Config flash{}; ///< Geometry and timing of the flash.
+    size_t read_size{128};             ///< Minimum size of a read.
+    size_t prog_size{128};             ///< Minimum size of a program.
+    size_t cache_size{512};            ///< Size of the read / program / file caches.
+    size_t lookahead_size{128};        ///< Size of the block allocator lookahead buffer.
+    int32_t block_cycles{512};         ///< Erase cycles before moving metadata (wear leveling).
+    Logger::Verbosity log_level{Logger::Verbosity::WARN}; ///< Log verbosity.
+  };
+
+  /**
+   * @brief An open file.
+   * @details Closed when destroyed. Must not outlive the LittleFsSimulator
+   *          or be used after it was unmounted.
+   */
+  class File {
+  public:
+    File() = default;
+    ~File() {
+      std::error_code ec;
+      close(ec);
+    }
+    File(File &&other) noexcept
+        : lfs_(other.lfs_)
+        , file_(std::move(other.file_)) {}
+    File &operator=(File &&other) noexcept {
+      if (this != &other) {
+        std::error_code ec;
+        close(ec);
+        lfs_ = other.lfs_;
+        file_ = std::move(other.file_);
+      }
+      return *this;
+    }
+
+    /**
+     * @brief Check whether the file is open.
+     * @return True if the file is open.
+     */
+    bool is_open() const { return file_ != nullptr; }
+
+    /**
+     * @brief Write data at the current position.
+     * @param data The data to write.
+     * @param ec Set on error.
+     * @return True on success, false on error.
+     */
+    bool write(std::span<const uint8_t> data, std::error_code &ec) {
+      if (!check_open(ec)) {
+        return false;
+      }
+      auto result = lfs_file_write(lfs_, file_.get(), data.data(), data.size());
+      return check(result, ec);
+    }
+
+    /**
+     * @brief Read data from the current position.
+     * @param data Buffer to read into.
+     * @param ec Set on error.
+     * @return Number of bytes read, less than requested at the end of the file.
+     */
+    size_t read(std::span<uint8_t> data, std::error_code &ec) {
+      if (!check_open(ec)) {
+        return 0;
+      }
+      auto result = lfs_file_read(lfs_, file_.get(), data.data(), data.size());
+      return check(result, ec) ? result : 0;
+    }
+
+    /**
+     * @brief Set the current position.
+     * @param offset Offset from the beginning of the file.
+     * @param ec Set on error.
+     * @return True on success, false on error.
+     */
+    bool seek(size_t offset, std::error_code &ec) {
+      if (!check_open(ec)) {
+        return false;
+      }
+      return check(lfs_file_seek(lfs_, file_.get(), offset, LFS_SEEK_SET), ec);
+    }
+
+    /**
+     * @brief Get the size of the file.
+     * @param ec Set on error.
+     * @return The size of the file in bytes.
+     */
+    size_t size(std::error_code &ec) {
+      if (!check_open(ec)) {
+        return 0;
+      }
+      auto result = lfs_file_size(lfs_, file_.get());
+      return check(result, ec) ? result : 0;
+    }
+
+    /**
+     * @brief Commit the written data to the flash (like fsync()).
+     * @param ec Set on error.
+     * @return True on success, false on error.
+     */
+    bool sync(std::error_code &ec) {
+      if (!check_open(ec)) {
+        return false;
+      }
+      return check(lfs_file_sync(lfs_, file_.get()), ec);
+    }
+
+    /**
+     * @brief Commit the written data and close the file.
+     * @param ec Set on error.
+     * @return True on success, false on error.
+     */
+    bool close(std::error_code &ec) {
+      if (!file_) {
+        return true;
+      }
+      auto result = lfs_file_close(lfs_, file_.get());
+      file_.reset();
+      return check(result, ec);
+    }
+
+  protected:
+    friend class LittleFsSimulator;
+
+    File(lfs_t *lfs, std::unique_ptr<lfs_file_t> file)
+        : lfs_(lfs)
+        , file_(std::move(file)) {}
+
+    bool check_open(std::error_code &ec) {
+      if (!file_) {
+        ec = std::make_error_code(std::errc::bad_file_descriptor);
+        return false;
+      }
+      return true;
+    }
+
+    lfs_t *lfs_{nullptr};
+    std::unique_ptr<lfs_file_t> file_;
+  };
+
+  /**
+   * @brief Construct the simulator with an erased flash (format() it before
+   *        mounting).
+   * @param config Configuration for the simulator.
+   */
+  explicit LittleFsSimulator(const Config &config)
+      : BaseComponent("LittleFsSimulator", config.log_level)
+      , flash_(config.flash) {
+    lfs_config_.context = &flash_;
+    lfs_config_.read = &LittleFsSimulator::read;
+    lfs_config_.prog = &LittleFsSimulator::prog;
+    lfs_config_.erase = &LittleFsSimulator::erase;
+    lfs_config_.sync = &LittleFsSimulator::sync;
+    lfs_config_.read_size = config.read_size;
+    lfs_config_.prog_size = config.prog_size;
+    lfs_config_.block_size = flash_.get_block_size();
+    lfs_config_.block_count = flash_.get_block_count();
+    lfs_config_.block_cycles = config.block_cycles;
+    lfs_config_.cache_size = config.cache_size;
+    lfs_config_.lookahead_size = config.lookahead_size;
+  }
+
+  /**
+   * @brief Unmount the file system (if mounted).
+   */
+  ~LittleFsSimulator() {
+    std::error_code ec;
+    unmount(ec);
+  }
+
+  LittleFsSimulator(const LittleFsSimulator &) = delete;
+  LittleFsSimulator &operator=(const LittleFsSimulator &) = delete;
+
+  /**
+   * @brief Format the flash. The file system must not be mounted.
+   * @param ec Set on error.
+   * @return True on success, false on error.
+   */
+  bool format(std::error_code &ec) { return check(lfs_format(&lfs_, &lfs_config_), ec); }
+
+  /**
+   * @brief Mount the file system, e.g. again after a power cut.
+   * @param ec Set on error (e.g. the flash is not formatted).
+   * @return True on success, false on error.
+   */
+  bool mount(std::error_code &ec) {
+    if (mounted_) {
+      return true;
+    }
+    if (!check(lfs_mount(&lfs_, &lfs_config_), ec)) {
+      return false;
+    }
+    mounted_ = true;
+    return true;
+  }
+
+  /**
+   * @brief Unmount the file system. All files must have been closed.
+   * @details After a power cut, this only releases the memory of the
+   *          mounted file system, like a reset of the device would.
+   * @param ec Set on error.
+   * @return True on success, false on error.
+   */
+  bool unmount(std::error_code &ec) {
+    if (!mounted_) {
+      return true;
+    }
+    mounted_ = false;
+    return check(lfs_unmount(&lfs_), ec);
+  }
+
+  /**
+   * @brief Check whether the file system is mounted.
+   * @return True if mounted.
+   */
+  bool is_mounted() const { return mounted_; }
+
+  /**
+   * @brief Open a file.
+   * @param path Path of the file.
+   * @param flags LittleFS open flags, e.g. LFS_O_WRONLY | LFS_O_CREAT.
+   * @param ec Set on error.
+   * @return The file, which is not open on error.
+   */
+  File open(const std::string &path, int flags, std::error_code &ec) {
+    if (!check_mounted(ec)) {
+      return {};
+    }
+    auto file = std::make_unique<lfs_file_t>();
+    if (!check(lfs_file_open(&lfs_, file.get(), path.c_str(), flags), ec)) {
+      return {};
+    }
+    return File(&lfs_, std::move(file));
+  }
+
+  /**
+   * @brief Remove a file or an empty directory.
+   * @param path Path to remove.
+   * @param ec Set on error.
+   * @return True on success, false on error.
+   */
+  bool remove(const std::string &path, std::error_code &ec) {
+    return check_mounted(ec) && check(lfs_remove(&lfs_, path.c_str()), ec);
+  }
+
+  /**
+   * @brief Atomically rename a file or directory, replacing any existing
+   *        file at the new path.
+   * @param from Current path.
+   * @param to New path.
+   * @param ec Set on error.
+   * @return True on success, false on error.
+   */
+  bool rename(const std::string &from, const std::string &to, std::error_code &ec) {
+    return check_mounted(ec) && check(lfs_rename(&lfs_, from.c_str(), to.c_str()), ec);
+  }
+
+  /**
+   * @brief Create a directory.
+   * @param path Path of the directory.
+   * @param ec Set on error.
+   * @return True on success, false on error.
+   */
+  bool mkdir(const std::string &path, std::error_code &ec) {
+    return check_mounted(ec) && check(lfs_mkdir(&lfs_, path.c_str()), ec);
+  }
+
+  /**
+   * @brief Check whether a file or directory exists.
+   * @param path Path to check.
+   * @return True if it exists.
+   */
+  bool exists(const std::string &path) {
+    struct lfs_info info;
+    return mounted_ && lfs_stat(&lfs_, path.c_str(), &info) >= 0;
+  }
+
+  /**
+   * @brief Get the total space of the file system.
+   * @return The total space in bytes.
+   */
+  size_t get_total_space() const { return flash_.get_block_size() * flash_.get_block_count(); }
+
+  /**
+   * @brief Get the used space of the file system.
+   * @return The used space in bytes (whole blocks), 0 if not mounted.
+   */
+  size_t get_used_space() {
+    if (!mounted_) {
+      return 0;
+    }
+    auto blocks = lfs_fs_size(&lfs_);
+    return blocks < 0 ? 0 : blocks * flash_.get_block_size();
+  }
+
+  /**
+   * @brief Get the free space of the file system.
+   * @return The free space in bytes.
+   */
+  size_t get_free_space() { return get_total_space() - get_used_space(); }
+
+  /**
+   * @brief Get the simulated flash, e.g. for its stats or to schedule a
+   *        power cut.
+   * @return The flash.
+   */
+  NorFlashSimulator &get_flash() { return flash_; }
+
+protected:
+  static bool check(int result, std::error_code &ec) {
+    if (result < 0) {
+      // LittleFS errors are negative errno values
+      ec = std::error_code(-result, std::generic_category());
+      return false;
+    }
+    return true;
+  }
+
+  bool check_mounted(std::error_code &ec) {
+    if (!mounted_) {
+      ec = std::make_error_code(std::errc::no_such_device);
+      return false;
+    }
+    return true;
+  }
+
+  static NorFlashSimulator &get_flash(const struct lfs_config *c) {
+    return *static_cast<NorFlashSimulator *>(c->context);
+  }
+
+  static int read(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, void *buffer,
+                  lfs_size_t size) {
+    std::span<uint8_t> data(static_cast<uint8_t *>(buffer), size);
+    return get_flash(c).read(block, off, data) ? LFS_ERR_OK : LFS_ERR_IO;
+  }
+
+  static int prog(const struct lfs_config *c, lfs_block_t block, lfs_off_t off,
+                  const void *buffer, lfs_size_t size) {
+    std::span<const uint8_t> data(static_cast<const uint8_t *>(buffer), size);
+    return get_flash(c).program(block, off, data) ? LFS_ERR_OK : LFS_ERR_IO;
+  }
+
+  static int erase(const struct lfs_config *c, lfs_block_t block) {
+    return get_flash(c).erase(block) ? LFS_ERR_OK : LFS_ERR_IO;
+  }
+
+  static int sync(const struct lfs_config *c) {
+    return get_flash(c).is_powered() ? LFS_ERR_OK : LFS_ERR_IO;
+  }
+
+  NorFlashSimulator flash_;
+  struct lfs_config lfs_config_ {};
+  lfs_t lfs_{};
+  bool mounted_{false};
+};
+} // namespace espp
@@ -0,0 +1,333 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "base_component.hpp"
+
+namespace espp {
+/**
+ * @brief Simulated NOR flash, e.g. to run LittleFS on a host (see
+ *        LittleFsSimulator) and measure how a file access pattern wears and
+ *        loads the flash.
+ *
+ * @details Models the flash as block_count erase blocks of block_size bytes
+ *          with NOR semantics: erasing sets a block to 0xFF, and programming
+ *          can only clear bits (the data is ANDed with the contents, and
+ *          programs which would need to set bits are counted as bad
+ *          programs).
+ *
+ *          Every read, program and erase is counted (operations, bytes and
+ *          erases per block) and its duration is estimated with the
+ *          configured Timing, whose defaults are typical for the SPI NOR
+ *          flash on ESP32 modules. The estimate accumulates in the stats, and
+ *          can optionally also be slept, to run in (simulated) real time.
+ *
+ *          A power cut can be scheduled after a number of programs / erases:
+ *          that operation is torn (only a random part of the data is
+ *          programmed, or only a random part of the block is erased), and
+ *          all further operations fail until power_on() is called.
+ *
+ * \section nor_flash_simulator_ex1 Example
+ * @code{.cpp}
+ *   espp::NorFlashSimulator flash({.block_size = 4096, .block_count = 256});
+ *   flash.erase(0);
+ *   flash.program(0, 0, data);
+ *   auto before = flash.get_stats();
+ *   // ... run the access pattern ...
+ *   auto stats = flash.get_stats() - before;
+ *   fmt::print("{}\n", stats);
+ * @endcode
+ */
+class NorFlashSimulator : public BaseComponent {
+public:
+  /**
+   * @brief Durations of the flash operations.
+   */
+  struct Timing {
+    std::chrono::nanoseconds read_setup{1000};          ///< Fixed cost of each read.
+    std::chrono::nanoseconds read_per_byte{50};          ///< Per byte read (~20 MB/s QIO).
+    std::chrono::microseconds program_per_page{700};     ///< Per (partial) page programmed.
+    std::chrono::microseconds erase_per_block{45'000};   ///< Per block (sector) erased.
+  };
+
+  /**
+   * @brief Configuration for the NorFlashSimulator.
+   */
+  struct Config {
+    size_t block_size{4096};  ///< Size of an erase block (sector) in bytes.
+    size_t block_count{256};  ///< Number of erase blocks.
+    size_t page_size{256};    ///< Size of a program page in bytes.
+    Timing timing{};          ///< Durations of the operations.
+    bool sleep{false};        ///< Sleep for the duration of each operation.
+    uint32_t seed{1};         ///< Seed for the torn operations of power cuts.
+    Logger::Verbosity log_level{Logger::Verbosity::WARN}; ///< Log verbosity.
+  };
+
+  /**
+   * @brief Counters of the flash operations.
+   */
+  struct Stats {
+    size_t reads{0};                           ///< Number of reads.
+    size_t programs{0};                        ///< Number of programs.
+    size_t erases{0};                          ///< Number of block erases.
+    size_t bytes_read{0};                      ///< Bytes read.
+    size_t bytes_programmed{0};                ///< Bytes programmed.
+    std::chrono::microseconds busy_time{0};    ///< Estimated time spent in the operations.
+
+    /**
+     * @brief Difference of two snapshots, e.g. the cost of an operation.
+     * @param other The earlier snapshot.
+     * @return The counts since \p other.
+     */
+    Stats operator-(const Stats &other) const {
+      return {
+          .reads = reads - other.reads,
+          .programs = programs - other.programs,
+          .erases = erases - other.erases,
+          .bytes_read = bytes_read - other.bytes_read,
+          .bytes_programmed = bytes_programmed - other.bytes_programmed,
+          .busy_time = busy_time - other.busy_time,
+      };
+    }
+  };
+
+  /**
+   * @brief Construct the flash, fully erased.
+   * @param config Configuration for the flash.
+   */
+  explicit NorFlashSimulator(const Config &config)
+      : BaseComponent("NorFlashSimulator", config.log_level)
+      , block_size_(config.block_size)
+      , block_count_(config.block_count)
+      , page_size_(config.page_size)
+      , timing_(config.timing)
+      , sleep_(config.sleep)
+      , data_(config.block_size * config.block_count, 0xFF)
+      , erase_counts_(config.block_count, 0)
+      , gen_(config.seed) {}
+
+  /**
+   * @brief Read data.
+   * @param block The block to read from.
+   * @param offset Offset in the block.
+   * @param data Buffer to read into, must not cross the end of the block.
+   * @return True on success, false if out of range or the power is off.
+   */
+  bool read(size_t block, size_t offset, std::span<uint8_t> data) {
+    if (!check(block, offset, data.size())) {
+      return false;
+    }
+    std::copy_n(data_.begin() + address(block, offset), data.size(), data.begin());
+    stats_.reads++;
+    stats_.bytes_read += data.size();
+    busy(timing_.read_setup + timing_.read_per_byte * data.size());
+    return true;
+  }
+
+  /**
+   * @brief Program data (clear bits).
+   * @param block The block to program.
+   * @param offset Offset in the block.
+   * @param data Data to program, must not cross the end of the block.
+   * @return True on success, false if out of range, the power is off or the
+   *         power was cut during the program.
+   */
+  bool program(size_t block, size_t offset, std::span<const uint8_t> data) {
+    if (!check(block, offset, data.size())) {
+      return false;
+    }
+    size_t size = data.size();
+    bool torn = power_cut_now();
+    if (torn) {
+      size = std::uniform_int_distribution<size_t>(0, data.size())(gen_);
+    }
+    uint8_t *flash = data_.data() + address(block, offset);
+    for (size_t i = 0; i < size; i++) {
+      if ((flash[i] & data[i]) != data[i]) {
+        num_bad_programs_++;
+      }
+      flash[i] &= data[i];
+    }
+    size_t first_page = offset / page_size_;
+    size_t last_page = (offset + std::max<size_t>(data.size(), 1) - 1) / page_size_;
+    stats_.programs++;
+    stats_.bytes_programmed += size;
+    busy(timing_.program_per_page * (last_page - first_page + 1));
+    if (torn) {
+      logger_.info("Power cut while programming block {} offset {}", block, offset);
+    }
+    return !torn;
+  }
+
+  /**
+   * @brief Erase a block (set it to 0xFF).
+   * @param block The block to erase.
+   * @return True on success, false if out of range, the power is off or the
+   *         power was cut during the erase.
+   */
+  bool erase(size_t block) {
+    if (!check(block, 0, 0)) {
+      return false;
+    }
+    size_t size = block_size_;
+    bool torn = power_cut_now();
+    if (torn) {
+      size = std::uniform_int_distribution<size_t>(0, block_size_)(gen_);
+    }
+    std::fill_n(data_.begin() + address(block, 0), size, 0xFF);
+    erase_counts_[block]++;
+    stats_.erases++;
+    busy(timing_.erase_per_block);
+    if (torn) {
+      logger_.info("Power cut while erasing block {}", block);
+    }
+    return !torn;
+  }
+
+  /**
+   * @brief Cut the power during a future program or erase.
+   * @param num_operations Number of programs / erases which complete before
+   *        the power is cut during the next one.
+   */
+  void schedule_power_cut(size_t num_operations) { operations_until_power_cut_ = num_operations; }
+
+  /**
+   * @brief Cancel a scheduled power cut.
+   */
+  void cancel_power_cut() { operations_until_power_cut_.reset(); }
+
+  /**
+   * @brief Restore the power after a power cut.
+   */
+  void power_on() { powered_ = true; }
+
+  /**
+   * @brief Check whether the flash is powered.
+   * @return False after a power cut, until power_on() is called.
+   */
+  bool is_powered() const { return powered_; }
+
+  /**
+   * @brief Get the operation counters.
+   * @return The counters since construction or the last reset_stats().
+   */
+  const Stats &get_stats() const { return stats_; }
+
+  /**
+   * @brief Reset the operation counters (not the erase counts per block).
+   */
+  void reset_stats() { stats_ = {}; }
+
+  /**
+   * @brief Get the number of times a block was erased.
+   * @param block The block.
+   * @return The number of erases of \p block.
+   */
+  size_t get_erase_count(size_t block) const { return erase_counts_.at(block); }
+
+  /**
+   * @brief Get the highest number of erases of any block (the wear).
+   * @return The maximum erase count.
+   */
+  size_t get_max_erase_count() const {
+    return *std::max_element(erase_counts_.begin(), erase_counts_.end());
+  }
+
+  /**
+   * @brief Get the number of programs which tried to set bits (i.e. did not
+   *        erase first), which real NOR flash cannot do.
+   * @return The number of bad programs.
+   */
+  size_t get_num_bad_programs() const { return num_bad_programs_; }
+
+  /// @brief Get the size of an erase block.
+  /// @return The block size in bytes.
+  size_t get_block_size() const { return block_size_; }
+
+  /// @brief Get the number of erase blocks.
+  /// @return The number of blocks.
+  size_t get_block_count() const { return block_count_; }
+
+  /// @brief Get the size of a program page.
+  /// @return The page size in bytes.
+  size_t get_page_size() const { return page_size_; }
+
+  /**
+   * @brief Get the contents of the flash, e.g. to save or inspect an image.
+   * @return The contents of the flash.
+   */
+  std::span<const uint8_t> get_data() const { return data_; }
+
+protected:
+  size_t address(size_t block, size_t offset) const { return block * block_size_ + offset; }
+
+  bool check(size_t block, size_t offset, size_t size) {
+    if (!powered_) {
+      logger_.debug("Flash is not powered");
+      return false;
+    }
+    if (block >= block_count_ || offset + size > block_size_) {
+      logger_.error("Access out of range: block {}, offset {}, size {}", block, offset, size);
+      return false;
+    }
+    return true;
+  }
+
+  bool power_cut_now() {
+    if (!operations_until_power_cut_) {
+      return false;
+    }
+    if (*operations_until_power_cut_ > 0) {
+      (*operations_until_power_cut_)--;
+      return false;
+    }
+    operations_until_power_cut_.reset();
+    powered_ = false;
+    return true;
+  }
+
+  void busy(std::chrono::nanoseconds duration) {
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(duration + fraction_);
+    fraction_ = duration + fraction_ - us;
+    stats_.busy_time += us;
+    if (sleep_) {
+      std::this_thread::sleep_for(duration);
+    }
+  }
+
+  size_t block_size_;
+  size_t block_count_;
+  size_t page_size_;
+  Timing timing_;
+  bool sleep_;
+  std::vector<uint8_t> data_;
+  std::vector<size_t> erase_counts_;
+  Stats stats_;
+  std::chrono::nanoseconds fraction_{0};
+  size_t num_bad_programs_{0};
+  bool powered_{true};
+  std::optional<size_t> operations_until_power_cut_;
+  std::mt19937 gen_;
+};
+} // namespace espp
+
+// for allowing easy serialization/printing of the
+// espp::NorFlashSimulator::Stats
+template <> struct fmt::formatter<espp::NorFlashSimulator::Stats> {
+  template <typename ParseContext> constexpr auto parse(ParseContext &ctx) { return ctx.begin(); }
+
+  template <typename FormatContext>
+  auto format(espp::NorFlashSimulator::Stats const &stats, FormatContext &ctx) {
+    return fmt::format_to(ctx.out(),
+                          "{{reads: {} ({} B), programs: {} ({} B), erases: {}, busy: {:.3f} s}}",
+                          stats.reads, stats.bytes_read, stats.programs, stats.bytes_programmed,
+                          stats.erases, stats.busy_time.count() / 1e6f);
+  }
+};
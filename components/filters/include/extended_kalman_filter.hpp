@@ -0,0 +1,161 @@
+#pragma once
+
+#include <type_traits>
+#include <utility>
+
+#include "kalman_filter.hpp"
+
+namespace espp {
+/**
+ * @brief Extended Kalman filter (EKF) with compile-time dimensions.
+ *
+ * @details Estimates the state x of the non-linear system
+ *
+ * @f[
+ *   x_{k} = f(x_{k-1}) + w_{k}, \quad w_{k} \sim N(0, Q)
+ * @f]
+ * @f[
+ *   z_{k} = h(x_{k}) + v_{k}, \quad v_{k} \sim N(0, R)
+ * @f]
+ *
+ *          by linearizing f and h around the current estimate. The models
+ *          and their Jacobians are passed to predict() / update() as
+ *          callables (e.g. lambdas), so they are inlined into the filter and
+ *          can capture whatever inputs they need (time step, control input,
+ *          sensor calibration, ...). Different sensors can be fused by
+ *          calling update() with different measurement models.
+ *
+ *          Like the KalmanFilter, the measurement update is computed in
+ *          Joseph form and the filter never allocates.
+ *
+ * @tparam N Number of states.
+ * @tparam M Number of measurements (for the Measurement / R types; update()
+ *         also accepts other measurement sizes).
+ * @tparam T Scalar type (float or double).
+ *
+ * \section extended_kalman_filter_ex1 Example
+ * @code{.cpp}
+ *   // estimate [angle, rate] from a gyro, using an accelerometer-derived
+ *   // angle which is only valid near level
+ *   espp::ExtendedKalmanFilter<2, 1> ekf({.Q = ..., .R = {{0.01f}}});
+ *   ekf.predict([&](const auto &x) { return espp::Vector<2>{{x[0] + x[1] * dt, x[1]}}; },
+ *               [&](const auto &x) { return espp::Matrix<2, 2>{{1.0f, dt, 0.0f, 1.0f}}; });
+ *   ekf.update(z, [](const auto &x) { return espp::Vector<1>{{std::sin(x[0])}}; },
+ *              [](const auto &x) { return espp::Matrix<1, 2>{{std::cos(x[0]), 0.0f}}; });
+ * @endcode
+ */
+template <size_t N, size_t M, typename T = float> class ExtendedKalmanFilter {
+public:
+  using State = Vector<N, T>;                    ///< State vector (x)
+  using Measurement = Vector<M, T>;              ///< Measurement vector (z)
+  using StateMatrix = Matrix<N, N, T>;           ///< N x N matrix (Jacobian of f, Q, P)
+  using MeasurementMatrix = Matrix<M, N, T>;     ///< Jacobian of h
+  using MeasurementCovariance = Matrix<M, M, T>; ///< Measurement noise (R)
+
+  /**
+   * @brief Configuration for the extended Kalman filter.
+   */
+  struct Config {
+    StateMatrix Q = {};                                          ///< Process noise covariance.
+    MeasurementCovariance R = MeasurementCovariance::identity(); ///< Measurement noise covariance.
+    State x = {};                                                ///< Initial state estimate.
+    StateMatrix P = StateMatrix::identity();                     ///< Initial state covariance.
+  };
+
+  /**
+   * @brief Construct the extended Kalman filter.
+   * @param config Configuration for the filter.
+   */
+  explicit ExtendedKalmanFilter(const Config &config)
+      : Q_(config.Q)
+      , R_(config.R)
+      , x_(config.x)
+      , P_(config.P) {}
+
+  /**
+   * @brief Predict the next state.
+   * @param f State transition function, State f(const State &x).
+   * @param jacobian Jacobian of f, StateMatrix jacobian(const State &x). It
+   *        is evaluated at the current (prior) estimate.
+   */
+  template <typename TransitionFn, typename JacobianFn>
+  void predict(TransitionFn &&f, JacobianFn &&jacobian) {
+    StateMatrix F = jacobian(std::as_const(x_));
+    x_ = f(std::as_const(x_));
+    P_ = multiply_transpose(F * P_, F) + Q_;
+    P_.symmetrize();
+  }
+
+  /**
+   * @brief Correct the state estimate with measurement \p z, using the
+   *        configured measurement noise.
+   * @param z Measurement.
+   * @param h Measurement function, Measurement h(const State &x).
+   * @param jacobian Jacobian of h, MeasurementMatrix jacobian(const State &x).
+   * @return True on success, false if the innovation covariance was not
+   *         positive definite (the estimate is left unchanged).
+   */
+  template <typename MeasurementFn, typename JacobianFn>
+  bool update(const Measurement &z, MeasurementFn &&h, JacobianFn &&jacobian) {
+    return update(z, std::forward<MeasurementFn>(h), std::forward<JacobianFn>(jacobian), R_);
+  }
+
+  /**
+   * @brief Correct the state estimate with a measurement from an arbitrary
+   *        sensor, e.g. to fuse sensors with different measurement sizes.
+   * @param z Measurement (K x 1).
+   * @param h Measurement function, Vector<K> h(const State &x).
+   * @param jacobian Jacobian of h, Matrix<K, N> jacobian(const State &x).
+   * @param R Measurement noise covariance (K x K).
+   * @return True on success, false if the innovation covariance was not
+   *         positive definite (the estimate is left unchanged).
+   */
+  template <size_t K, typename MeasurementFn, typename JacobianFn>
+  bool update(const Vector<K, T> &z, MeasurementFn &&h, JacobianFn &&jacobian,
+              const Matrix<K, K, T> &R) {
+    Matrix<K, N, T> H = jacobian(std::as_const(x_));
+    Vector<K, T> innovation = z - h(std::as_const(x_));
+    return detail::joseph_update(x_, P_, innovation, H, R);
+  }
+
+  /**
+   * @brief Get the current state estimate.
+   * @return The state estimate.
+   */
+  const State &get_state() const { return x_; }
+
+  /**
+   * @brief Get the covariance of the current state estimate.
+   * @return The state covariance.
+   */
+  const StateMatrix &get_covariance() const { return P_; }
+
+  /**
+   * @brief Reset the state estimate and its covariance.
+   * @param x The new state estimate.
+   * @param P The new state covariance.
+   */
+  void set_state(const State &x, const StateMatrix &P) {
+    x_ = x;
+    P_ = P;
+  }
+
+  /**
+   * @brief Set the process noise covariance.
+   * @param Q Process noise covariance.
+   */
+  void set_process_noise(const StateMatrix &Q) { Q_ = Q; }
+
+  /**
+   * @brief Set the measurement noise covariance.
+   * @param R Measurement noise covariance.
+   */
+  void set_measurement_noise(const MeasurementCovariance &R) { R_ = R; }
+
+protected:
+  StateMatrix Q_;
+  MeasurementCovariance R_;
+  State x_;
+  StateMatrix P_;
+};
+} // namespace espp
@@ -0,0 +1,193 @@
+#pragma once
+
+#include "matrix.hpp"
+
+namespace espp {
+namespace detail {
+/**
+ * @brief Kalman measurement update with a Joseph-form covariance update,
+ *        shared by the KalmanFilter and ExtendedKalmanFilter.
+ * @param x State estimate, updated in place.
+ * @param P State covariance, updated in place.
+ * @param innovation Measurement residual (z - h(x)).
+ * @param H Measurement model (or its Jacobian at x).
+ * @param R Measurement noise covariance.
+ * @return True on success, false if the innovation covariance is not
+ *         positive definite (in which case x and P are unchanged).
+ */
+template <size_t N, size_t M, typename T>
+bool joseph_update(Vector<N, T> &x, Matrix<N, N, T> &P, const Vector<M, T> &innovation,
+                   const Matrix<M, N, T> &H, const Matrix<M, M, T> &R) {
+  // innovation covariance S = H P H^T + R
+  Matrix<N, M, T> PHt = multiply_transpose(P, H);
+  Matrix<M, M, T> S = H * PHt + R;
+  Matrix<M, M, T> S_sqrt;
+  if (!cholesky(S, S_sqrt)) {
+    return false;
+  }
+  // gain K = P H^T S^-1, computed as K^T = S^-1 (P H^T)^T with two triangular
+  // solves instead of an explicit inverse
+  Matrix<N, M, T> K =
+      solve_lower_transpose(S_sqrt, solve_lower(S_sqrt, PHt.transpose())).transpose();
+  x += K * innovation;
+  // Joseph form, P = (I - K H) P (I - K H)^T + K R K^T, which (unlike
+  // P = (I - K H) P) keeps P symmetric positive definite in the face of
+  // round-off and sub-optimal gains
+  Matrix<N, N, T> A = Matrix<N, N, T>::identity() - K * H;
+  P = multiply_transpose(A * P, A) + multiply_transpose(K * R, K);
+  P.symmetrize();
+  return true;
+}
+} // namespace detail
+
+/**
+ * @brief Linear Kalman filter with compile-time dimensions.
+ *
+ * @details Estimates the state x of the linear system
+ *
+ * @f[
+ *   x_{k} = F x_{k-1} + B u_{k} + w_{k}, \quad w_{k} \sim N(0, Q)
+ * @f]
+ * @f[
+ *   z_{k} = H x_{k} + v_{k}, \quad v_{k} \sim N(0, R)
+ * @f]
+ *
+ *          All matrices are fixed-size espp::Matrix objects, so the filter
+ *          never allocates and every kernel is specialized for the model's
+ *          dimensions. The covariance is updated in Joseph form and kept
+ *          symmetric. If float precision is not sufficient for your model
+ *          (e.g. very small or very large variances), either use T = double
+ *          or the SquareRootKalmanFilter.
+ *
+ * @tparam N Number of states.
+ * @tparam M Number of measurements.
+ * @tparam U Number of control inputs (may be 0).
+ * @tparam T Scalar type (float or double).
+ *
+ * \section kalman_filter_ex1 Example
+ * @code{.cpp}
+ *   // constant velocity model, measuring position
+ *   espp::KalmanFilter<2, 1> kf({
+ *       .F = {{1.0f, dt, 0.0f, 1.0f}},
+ *       .H = {{1.0f, 0.0f}},
+ *       .Q = espp::Matrix<2, 2>::diagonal({1e-4f, 1e-2f}),
+ *       .R = {{0.1f}},
+ *   });
+ *   kf.predict();
+ *   kf.update({{measured_position}});
+ *   float velocity = kf.get_state()[1];
+ * @endcode
+ */
+template <size_t N, size_t M, size_t U = 0, typename T = float> class KalmanFilter {
+public:
+  using State = Vector<N, T>;                    ///< State vector (x)
+  using Measurement = Vector<M, T>;              ///< Measurement vector (z)
+  using Control = Vector<U, T>;                  ///< Control vector (u)
+  using StateMatrix = Matrix<N, N, T>;           ///< N x N matrix (F, Q, P)
+  using ControlMatrix = Matrix<N, U, T>;         ///< Control model (B)
+  using MeasurementMatrix = Matrix<M, N, T>;     ///< Measurement model (H)
+  using MeasurementCovariance = Matrix<M, M, T>; ///< Measurement noise (R)
+
+  /**
+   * @brief Configuration for the Kalman filter.
+   */
+  struct Config {
+    StateMatrix F = StateMatrix::identity();                     ///< State transition model.
+    ControlMatrix B = {};                                        ///< Control input model.
+    MeasurementMatrix H = {};                                    ///< Measurement model.
+    StateMatrix Q = {};                                          ///< Process noise covariance.
+    MeasurementCovariance R = MeasurementCovariance::identity(); ///< Measurement noise covariance.
+    State x = {};                                                ///< Initial state estimate.
+    StateMatrix P = StateMatrix::identity();                     ///< Initial state covariance.
+  };
+
+  /**
+   * @brief Construct the Kalman filter.
+   * @param config Configuration for the filter.
+   */
+  explicit KalmanFilter(const Config &config)
+      : F_(config.F)
+      , B_(config.B)
+      , H_(config.H)
+      , Q_(config.Q)
+      , R_(config.R)
+      , x_(config.x)
+      , P_(config.P) {}
+
+  /**
+   * @brief Predict the next state, without a control input.
+   */
+  void predict() {
+    x_ = F_ * x_;
+    P_ = multiply_transpose(F_ * P_, F_) + Q_;
+    P_.symmetrize();
+  }
+
+  /**
+   * @brief Predict the next state, given control input \p u.
+   * @param u Control input.
+   */
+  void predict(const Control &u) requires(U > 0) {
+    x_ = F_ * x_ + B_ * u;
+    P_ = multiply_transpose(F_ * P_, F_) + Q_;
+    P_.symmetrize();
+  }
+
+  /**
+   * @brief Correct the state estimate with measurement \p z.
+   * @param z Measurement.
+   * @return True on success, false if the innovation covariance was not
+   *         positive definite (the estimate is left unchanged).
+   */
+  bool update(const Measurement &z) { return detail::joseph_update(x_, P_, z - H_ * x_, H_, R_); }
+
+  /**
+   * @brief Get the current state estimate.
+   * @return The state estimate.
+   */
+  const State &get_state() const { return x_; }
+
+  /**
+   * @brief Get the covariance of the current state estimate.
+   * @return The state covariance.
+   */
+  const StateMatrix &get_covariance() const { return P_; }
+
+  /**
+   * @brief Reset the state estimate and its covariance.
+   * @param x The new state estimate.
+   * @param P The new state covariance.
+   */
+  void set_state(const State &x, const StateMatrix &P) {
+    x_ = x;
+    P_ = P;
+  }
+
+  /**
+   * @brief Set the state transition model, e.g. if the time step changed.
+   * @param F State transition model.
+   */
+  void set_transition_model(const StateMatrix &F) { F_ = F; }
+
+  /**
+   * @brief Set the process noise covariance.
+   * @param Q Process noise covariance.
+   */
+  void set_process_noise(const StateMatrix &Q) { Q_ = Q; }
+
+  /**
+   * @brief Set the measurement noise covariance.
+   * @param R Measurement noise covariance.
+   */
+  void set_measurement_noise(const MeasurementCovariance &R) { R_ = R; }
+
+protected:
+  StateMatrix F_;
+  ControlMatrix B_;
+  MeasurementMatrix H_;
+  StateMatrix Q_;
+  MeasurementCovariance R_;
+  State x_;
+  StateMatrix P_;
+};
+} // namespace espp
@@ -0,0 +1,383 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+#include "format.hpp"
+
+namespace espp {
+/**
+ * @brief Small, fixed-size, row-major matrix for the state estimators
+ *        (KalmanFilter, ExtendedKalmanFilter, UnscentedKalmanFilter, ...).
+ *
+ * @details The dimensions are template parameters, so all storage is inline
+ *          (no heap allocation) and every loop has a compile-time trip count,
+ *          which lets the compiler fully unroll and vectorize the kernels for
+ *          the small (<= ~12x12) matrices used in sensor fusion.
+ *
+ *          It is an aggregate, so it can be initialized directly in row-major
+ *          order:
+ *
+ * @code{.cpp}
+ *   espp::Matrix<2, 2> F{{1.0f, dt,
+ *                         0.0f, 1.0f}};
+ *   auto P = F * P * F.transpose() + Q;
+ * @endcode
+ *
+ * @tparam Rows Number of rows.
+ * @tparam Cols Number of columns.
+ * @tparam T Element type (float or double).
+ */
+template <size_t Rows, size_t Cols, typename T = float> struct Matrix {
+  static constexpr size_t rows = Rows; /**< Number of rows. */
+  static constexpr size_t cols = Cols; /**< Number of columns. */
+
+  std::array<T, Rows * Cols> data = {}; /**< Elements, in row-major order. */
+
+  /**
+   * @brief Matrix with all elements set to zero.
+   * @return Zero matrix.
+   */
+  static constexpr Matrix zeros() { return {}; }
+
+  /**
+   * @brief Matrix with ones on the diagonal and zeros elsewhere.
+   * @return Identity matrix.
+   */
+  static constexpr Matrix identity() {
+    Matrix m;
+    for (size_t i = 0; i < (Rows < Cols ? Rows : Cols); i++) {
+      m(i, i) = T(1);
+    }
+    return m;
+  }
+
+  /**
+   * @brief Square matrix with \p values on the diagonal.
+   * @param values The diagonal elements.
+   * @return Diagonal matrix.
+   */
+  static constexpr Matrix diagonal(const std::array<T, Rows> &values) requires(Rows == Cols) {
+    Matrix m;
+    for (size_t i = 0; i < Rows; i++) {
+      m(i, i) = values[i];
+    }
+    return m;
+  }
+
+  constexpr T &operator()(size_t row, size_t col) { return data[row * Cols + col]; }
+  constexpr const T &operator()(size_t row, size_t col) const { return data[row * Cols + col]; }
+
+  /**
+   * @brief Element access for (column) vectors.
+   * @param index Index of the element.
+   * @return Reference to the element.
+   */
+  constexpr T &operator[](size_t index) { return data[index]; }
+  constexpr const T &operator[](size_t index) const { return data[index]; }
+
+  /**
+   * @brief Get the transpose of the matrix.
+   * @return Transposed matrix.
+   */
+  constexpr Matrix<Cols, Rows, T> transpose() const {
+    Matrix<Cols, Rows, T> result;
+    for (size_t r = 0; r < Rows; r++) {
+      for (size_t c = 0; c < Cols; c++) {
+        result(c, r) = (*this)(r, c);
+      }
+    }
+    return result;
+  }
+
+  /**
+   * @brief Make the matrix exactly symmetric, by averaging it with its
+   *        transpose. Used to remove round-off asymmetry from covariances.
+   */
+  constexpr void symmetrize() requires(Rows == Cols) {
+    for (size_t r = 0; r < Rows; r++) {
+      for (size_t c = r + 1; c < Cols; c++) {
+        T value = ((*this)(r, c) + (*this)(c, r)) / T(2);
+        (*this)(r, c) = value;
+        (*this)(c, r) = value;
+      }
+    }
+  }
+
+  constexpr Matrix &operator+=(const Matrix &other) {
+    for (size_t i = 0; i < Rows * Cols; i++) {
+      data[i] += other.data[i];
+    }
+    return *this;
+  }
+
+  constexpr Matrix &operator-=(const Matrix &other) {
+    for (size_t i = 0; i < Rows * Cols; i++) {
+      data[i] -= other.data[i];
+    }
+    return *this;
+  }
+
+  constexpr Matrix &operator*=(T scale) {
+    for (size_t i = 0; i < Rows * Cols; i++) {
+      data[i] *= scale;
+    }
+    return *this;
+  }
+
+  friend constexpr Matrix operator+(Matrix lhs, const Matrix &rhs) { return lhs += rhs; }
+  friend constexpr Matrix operator-(Matrix lhs, const Matrix &rhs) { return lhs -= rhs; }
+  friend constexpr Matrix operator*(Matrix lhs, T scale) { return lhs *= scale; }
+  friend constexpr Matrix operator*(T scale, Matrix rhs) { return rhs *= scale; }
+  friend constexpr bool operator==(const Matrix &lhs, const Matrix &rhs) = default;
+};
+
+/// Column vector, i.e. an N x 1 Matrix.
+template <size_t N, typename T = float> using Vector = Matrix<N, 1, T>;
+
+/**
+ * @brief Matrix product.
+ * @param lhs Left hand side (R x K).
+ * @param rhs Right hand side (K x C).
+ * @return lhs * rhs (R x C).
+ */
+template <size_t R, size_t K, size_t C, typename T>
+constexpr Matrix<R, C, T> operator*(const Matrix<R, K, T> &lhs, const Matrix<K, C, T> &rhs) {
+  Matrix<R, C, T> result;
+  for (size_t r = 0; r < R; r++) {
+    for (size_t k = 0; k < K; k++) {
+      const T a = lhs(r, k);
+      for (size_t c = 0; c < C; c++) {
+        result(r, c) += a * rhs(k, c);
+      }
+    }
+  }
+  return result;
+}
+
+/**
+ * @brief Product of a matrix with the transpose of another, without forming
+ *        the transpose.
+ * @param lhs Left hand side (R x K).
+ * @param rhs Right hand side (C x K).
+ * @return lhs * rhs^T (R x C).
+ */
+template <size_t R, size_t K, size_t C, typename T>
+constexpr Matrix<R, C, T> multiply_transpose(const Matrix<R, K, T> &lhs,
+                                             const Matrix<C, K, T> &rhs) {
+  Matrix<R, C, T> result;
+  for (size_t r = 0; r < R; r++) {
+    for (size_t c = 0; c < C; c++) {
+      T sum = 0;
+      for (size_t k = 0; k < K; k++) {
+        sum += lhs(r, k) * rhs(c, k);
+      }
+      result(r, c) = sum;
+    }
+  }
+  return result;
+}
+
+/**
+ * @brief Cholesky decomposition of a symmetric positive definite matrix.
+ * @param a Symmetric positive definite matrix (only the lower triangle is
+ *        used).
+ * @param lower Lower triangular matrix L such that a = L * L^T.
+ * @return True on success, false if \p a is not (numerically) positive
+ *         definite.
+ */
+template <size_t N, typename T>
+constexpr bool cholesky(const Matrix<N, N, T> &a, Matrix<N, N, T> &lower) {
+  lower = {};
+  // row by row (Cholesky-Banachiewicz), so the inner loop only reads the
+  // elements of rows i and j which were already computed
+  for (size_t i = 0; i < N; i++) {
+    for (size_t j = 0; j <= i; j++) {
+      T sum = a(i, j);
+      for (size_t k = 0; k < j; k++) {
+        sum -= lower(i, k) * lower(j, k);
+      }
+      if (i != j) {
+        lower(i, j) = sum / lower(j, j);
+      } else if (sum > T(0)) {
+        lower(i, i) = std::sqrt(sum);
+      } else {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Cholesky decomposition of a symmetric positive semi-definite matrix.
+ * @details Like cholesky(), but (numerically) zero pivots are allowed and
+ *          produce a zero column in \p lower. Useful for factoring process
+ *          noise covariances, which are often rank deficient.
+ * @param a Symmetric positive semi-definite matrix (only the lower triangle
+ *        is used).
+ * @param lower Lower triangular matrix L such that a = L * L^T.
+ * @return True on success, false if \p a has a (significantly) negative
+ *         pivot.
+ */
+template <size_t N, typename T>
+constexpr bool cholesky_semidefinite(const Matrix<N, N, T> &a, Matrix<N, N, T> &lower) {
+  lower = {};
+  T max_diagonal = 0;
+  for (size_t i = 0; i < N; i++) {
+    max_diagonal = std::max(max_diagonal, std::abs(a(i, i)));
+  }
+  const T tolerance = max_diagonal * T(N) * std::numeric_limits<T>::epsilon();
+  for (size_t j = 0; j < N; j++) {
+    T sum = a(j, j);
+    for (size_t k = 0; k < j; k++) {
+      sum -= lower(j, k) * lower(j, k);
+    }
+    if (sum < -tolerance) {
+      return false;
+    }
+    if (sum <= tolerance) {
+      // zero pivot, leave the column as zero
+      continue;
+    }
+    T diag = std::sqrt(sum);
+    lower(j, j) = diag;
+    T inv_diag = T(1) / diag;
+    for (size_t i = j + 1; i < N; i++) {
+      T value = a(i, j);
+      for (size_t k = 0; k < j; k++) {
+        value -= lower(i, k) * lower(j, k);
+      }
+      lower(i, j) = value * inv_diag;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Solve L * X = B for X, where L is lower triangular (forward
+ *        substitution).
+ * @param lower Lower triangular matrix with a non-zero diagonal (N x N).
+ * @param b Right hand side (N x C).
+ * @return X (N x C).
+ */
+template <size_t N, size_t C, typename T>
+constexpr Matrix<N, C, T> solve_lower(const Matrix<N, N, T> &lower, const Matrix<N, C, T> &b) {
+  Matrix<N, C, T> x;
+  for (size_t c = 0; c < C; c++) {
+    for (size_t i = 0; i < N; i++) {
+      T value = b(i, c);
+      for (size_t k = 0; k < i; k++) {
+        value -= lower(i, k) * x(k, c);
+      }
+      x(i, c) = value / lower(i, i);
+    }
+  }
+  return x;
+}
+
+/**
+ * @brief Solve L^T * X = B for X, where L is lower triangular (backward
+ *        substitution).
+ * @param lower Lower triangular matrix with a non-zero diagonal (N x N).
+ * @param b Right hand side (N x C).
+ * @return X (N x C).
+ */
+template <size_t N, size_t C, typename T>
+constexpr Matrix<N, C, T> solve_lower_transpose(const Matrix<N, N, T> &lower,
+                                                const Matrix<N, C, T> &b) {
+  Matrix<N, C, T> x;
+  for (size_t c = 0; c < C; c++) {
+    for (size_t i = N; i-- > 0;) {
+      T value = b(i, c);
+      for (size_t k = i + 1; k < N; k++) {
+        value -= lower(k, i) * x(k, c);
+      }
+      x(i, c) = value / lower(i, i);
+    }
+  }
+  return x;
+}
+
+/**
+ * @brief Lower-triangularize a wide matrix with Householder reflections (LQ
+ *        decomposition), i.e. find lower triangular L such that
+ *        L * L^T = A * A^T.
+ * @details This is the core operation of square-root filters: it combines
+ *          several square-root (Cholesky) factors into one without ever
+ *          forming the (worse conditioned) covariance itself.
+ * @param a Matrix to triangularize (N x K, K >= N). It is overwritten.
+ * @return L (N x N). Its diagonal may contain negative values.
+ */
+template <size_t N, size_t K, typename T>
+constexpr Matrix<N, N, T> lower_triangularize(Matrix<N, K, T> &a) {
+  static_assert(K >= N, "Matrix must have at least as many columns as rows");
+  for (size_t i = 0; i < N; i++) {
+    // build the Householder vector which zeroes row i to the right of the
+    // diagonal
+    T norm = 0;
+    for (size_t k = i; k < K; k++) {
+      norm += a(i, k) * a(i, k);
+    }
+    norm = std::sqrt(norm);
+    if (norm == T(0)) {
+      continue;
+    }
+    T alpha = a(i, i) > T(0) ? -norm : norm;
+    std::array<T, K> v = {};
+    v[i] = a(i, i) - alpha;
+    for (size_t k = i + 1; k < K; k++) {
+      v[k] = a(i, k);
+    }
+    T v_norm_sq = 0;
+    for (size_t k = i; k < K; k++) {
+      v_norm_sq += v[k] * v[k];
+    }
+    if (v_norm_sq == T(0)) {
+      continue;
+    }
+    T scale = T(2) / v_norm_sq;
+    // apply the reflection to rows i..N-1 (from the right)
+    for (size_t r = i; r < N; r++) {
+      T dot = 0;
+      for (size_t k = i; k < K; k++) {
+        dot += a(r, k) * v[k];
+      }
+      dot *= scale;
+      for (size_t k = i; k < K; k++) {
+        a(r, k) -= dot * v[k];
+      }
+    }
+  }
+  Matrix<N, N, T> lower;
+  for (size_t r = 0; r < N; r++) {
+    for (size_t c = 0; c <= r; c++) {
+      lower(r, c) = a(r, c);
+    }
+  }
+  return lower;
+}
+} // namespace espp
+
+// for allowing easy serialization/printing of the
+// espp::Matrix
+template <size_t Rows, size_t Cols, typename T>
+struct fmt::formatter<espp::Matrix<Rows, Cols, T>> {
+  template <typename ParseContext> constexpr auto parse(ParseContext &ctx) { return ctx.begin(); }
+
+  template <typename FormatContext>
+  auto format(espp::Matrix<Rows, Cols, T> const &m, FormatContext &ctx) {
+    auto out = fmt::format_to(ctx.out(), "[");
+    for (size_t r = 0; r < Rows; r++) {
+      out = fmt::format_to(out, "{}[", r == 0 ? "" : ", ");
+      for (size_t c = 0; c < Cols; c++) {
+        out = fmt::format_to(out, "{}{}", c == 0 ? "" : ", ", m(r, c));
+      }
+      out = fmt::format_to(out, "]");
+    }
+    return fmt::format_to(out, "]");
+  }
+};
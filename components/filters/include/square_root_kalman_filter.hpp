@@ -0,0 +1,191 @@
+#pragma once
+
+#include "kalman_filter.hpp"
+
+namespace espp {
+/**
+ * @brief Square-root (array form) linear Kalman filter with compile-time
+ *        dimensions.
+ *
+ * @details Estimates the same model as the KalmanFilter, but instead of the
+ *          state covariance P it propagates a lower triangular square root S
+ *          of it (P = S * S^T). Both the prediction and the measurement
+ *          update are computed by triangularizing a pre-array of square-root
+ *          factors with Householder reflections (see lower_triangularize()),
+ *          so the covariance can never lose symmetry or positive
+ *          definiteness, and the effective numerical precision is roughly
+ *          doubled. This makes it a good choice for float on
+ *          microcontrollers when the variances span many orders of
+ *          magnitude, at roughly 1.5-2x the cost of the KalmanFilter.
+ *
+ * @tparam N Number of states.
+ * @tparam M Number of measurements.
+ * @tparam U Number of control inputs (may be 0).
+ * @tparam T Scalar type (float or double).
+ */
+template <size_t N, size_t M, size_t U = 0, typename T = float> class SquareRootKalmanFilter {
+public:
+  using State = Vector<N, T>;                    ///< State vector (x)
+  using Measurement = Vector<M, T>;              ///< Measurement vector (z)
+  using Control = Vector<U, T>;                  ///< Control vector (u)
+  using StateMatrix = Matrix<N, N, T>;           ///< N x N matrix (F, Q, P)
+  using ControlMatrix = Matrix<N, U, T>;         ///< Control model (B)
+  using MeasurementMatrix = Matrix<M, N, T>;     ///< Measurement model (H)
+  using MeasurementCovariance = Matrix<M, M, T>; ///< Measurement noise (R)
+
+  /// Configuration for the filter, the same as for the KalmanFilter. Q must
+  /// be positive semi-definite and R and P must be positive definite.
+  using Config = typename KalmanFilter<N, M, U, T>::Config;
+
+  /**
+   * @brief Construct the square-root Kalman filter.
+   * @param config Configuration for the filter.
+   */
+  explicit SquareRootKalmanFilter(const Config &config)
+      : F_(config.F)
+      , B_(config.B)
+      , H_(config.H)
+      , x_(config.x) {
+    set_process_noise(config.Q);
+    set_measurement_noise(config.R);
+    cholesky(config.P, S_);
+  }
+
+  /**
+   * @brief Predict the next state, without a control input.
+   */
+  void predict() {
+    x_ = F_ * x_;
+    predict_covariance();
+  }
+
+  /**
+   * @brief Predict the next state, given control input \p u.
+   * @param u Control input.
+   */
+  void predict(const Control &u) requires(U > 0) {
+    x_ = F_ * x_ + B_ * u;
+    predict_covariance();
+  }
+
+  /**
+   * @brief Correct the state estimate with measurement \p z.
+   * @param z Measurement.
+   * @return True on success, false if the innovation covariance was
+   *         singular (the estimate is left unchanged).
+   */
+  bool update(const Measurement &z) {
+    // pre-array [sqrt(R)  H S]   post-array [sqrt(Re)  0 ]
+    //           [0          S] -> (LQ)    ->  [K'       S+]
+    // where Re = H P H^T + R and K = K' sqrt(Re)^-1
+    Matrix<M + N, M + N, T> pre;
+    Matrix<M, N, T> HS = H_ * S_;
+    for (size_t r = 0; r < M; r++) {
+      for (size_t c = 0; c < M; c++) {
+        pre(r, c) = R_sqrt_(r, c);
+      }
+      for (size_t c = 0; c < N; c++) {
+        pre(r, M + c) = HS(r, c);
+      }
+    }
+    for (size_t r = 0; r < N; r++) {
+      for (size_t c = 0; c < N; c++) {
+        pre(M + r, M + c) = S_(r, c);
+      }
+    }
+    auto post = lower_triangularize(pre);
+    Matrix<M, M, T> Re_sqrt;
+    for (size_t r = 0; r < M; r++) {
+      for (size_t c = 0; c <= r; c++) {
+        Re_sqrt(r, c) = post(r, c);
+      }
+      if (Re_sqrt(r, r) == T(0)) {
+        return false;
+      }
+    }
+    Matrix<N, M, T> K_scaled;
+    for (size_t r = 0; r < N; r++) {
+      for (size_t c = 0; c < M; c++) {
+        K_scaled(r, c) = post(M + r, c);
+      }
+      for (size_t c = 0; c < N; c++) {
+        S_(r, c) = post(M + r, M + c);
+      }
+    }
+    x_ += K_scaled * solve_lower(Re_sqrt, Measurement(z - H_ * x_));
+    return true;
+  }
+
+  /**
+   * @brief Get the current state estimate.
+   * @return The state estimate.
+   */
+  const State &get_state() const { return x_; }
+
+  /**
+   * @brief Get the covariance of the current state estimate.
+   * @return The state covariance (S * S^T).
+   */
+  StateMatrix get_covariance() const { return multiply_transpose(S_, S_); }
+
+  /**
+   * @brief Get the square root of the covariance of the current state
+   *        estimate.
+   * @return Lower triangular S, such that the covariance is S * S^T.
+   */
+  const StateMatrix &get_covariance_sqrt() const { return S_; }
+
+  /**
+   * @brief Reset the state estimate and its covariance.
+   * @param x The new state estimate.
+   * @param P The new state covariance (must be positive definite).
+   * @return True on success, false if \p P is not positive definite.
+   */
+  bool set_state(const State &x, const StateMatrix &P) {
+    x_ = x;
+    return cholesky(P, S_);
+  }
+
+  /**
+   * @brief Set the state transition model, e.g. if the time step changed.
+   * @param F State transition model.
+   */
+  void set_transition_model(const StateMatrix &F) { F_ = F; }
+
+  /**
+   * @brief Set the process noise covariance.
+   * @param Q Process noise covariance (must be positive semi-definite).
+   * @return True on success, false if \p Q is not positive semi-definite.
+   */
+  bool set_process_noise(const StateMatrix &Q) { return cholesky_semidefinite(Q, Q_sqrt_); }
+
+  /**
+   * @brief Set the measurement noise covariance.
+   * @param R Measurement noise covariance (must be positive definite).
+   * @return True on success, false if \p R is not positive definite.
+   */
+  bool set_measurement_noise(const MeasurementCovariance &R) { return cholesky(R, R_sqrt_); }
+
+protected:
+  void predict_covariance() {
+    // S+ S+^T = [F S  sqrt(Q)] [F S  sqrt(Q)]^T = F P F^T + Q
+    Matrix<N, 2 * N, T> pre;
+    StateMatrix FS = F_ * S_;
+    for (size_t r = 0; r < N; r++) {
+      for (size_t c = 0; c < N; c++) {
+        pre(r, c) = FS(r, c);
+        pre(r, N + c) = Q_sqrt_(r, c);
+      }
+    }
+    S_ = lower_triangularize(pre);
+  }
+
+  StateMatrix F_;
+  ControlMatrix B_;
+  MeasurementMatrix H_;
+  StateMatrix Q_sqrt_;
+  MeasurementCovariance R_sqrt_;
+  State x_;
+  StateMatrix S_;
+};
+} // namespace espp
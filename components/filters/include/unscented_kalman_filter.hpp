@@ -0,0 +1,202 @@
+#pragma once
+
+#include <array>
+#include <type_traits>
+
+#include "matrix.hpp"
+
+namespace espp {
+/**
+ * @brief Unscented Kalman filter (UKF) with compile-time dimensions.
+ *
+ * @details Estimates the state of the same kind of non-linear system as the
+ *          ExtendedKalmanFilter, but instead of linearizing the models it
+ *          propagates 2N+1 (scaled) sigma points through them, which captures
+ *          the mean and covariance to second order and does not need any
+ *          Jacobians. Each step costs roughly 2N+1 evaluations of the models
+ *          plus a Cholesky decomposition.
+ *
+ *          The sigma points are stored in the filter, so it never allocates.
+ *
+ * @note With float, keep alpha close to 1: small values of alpha (e.g. the
+ *       1e-3 often seen in the literature) produce very large sigma point
+ *       weights which cancel catastrophically in single precision.
+ *
+ * @tparam N Number of states.
+ * @tparam M Number of measurements.
+ * @tparam T Scalar type (float or double).
+ *
+ * \section unscented_kalman_filter_ex1 Example
+ * @code{.cpp}
+ *   espp::UnscentedKalmanFilter<2, 1> ukf({.Q = ..., .R = {{0.01f}}});
+ *   ukf.predict([&](const auto &x) { return espp::Vector<2>{{x[0] + x[1] * dt, x[1]}}; });
+ *   ukf.update(z, [](const auto &x) { return espp::Vector<1>{{std::sin(x[0])}}; });
+ * @endcode
+ */
+template <size_t N, size_t M, typename T = float> class UnscentedKalmanFilter {
+public:
+  using State = Vector<N, T>;                    ///< State vector (x)
+  using Measurement = Vector<M, T>;              ///< Measurement vector (z)
+  using StateMatrix = Matrix<N, N, T>;           ///< N x N matrix (Q, P)
+  using MeasurementCovariance = Matrix<M, M, T>; ///< Measurement noise (R)
+
+  static constexpr size_t NUM_SIGMA_POINTS = 2 * N + 1; ///< Number of sigma points
+
+  /**
+   * @brief Configuration for the unscented Kalman filter.
+   */
+  struct Config {
+    StateMatrix Q = {};                                          ///< Process noise covariance.
+    MeasurementCovariance R = MeasurementCovariance::identity(); ///< Measurement noise covariance.
+    State x = {};                                                ///< Initial state estimate.
+    StateMatrix P = StateMatrix::identity();                     ///< Initial state covariance.
+    T alpha = T(1); ///< Spread of the sigma points around the mean, (0, 1].
+    T beta = T(2);  ///< Prior knowledge of the distribution (2 is optimal for Gaussians).
+    T kappa = T(0); ///< Secondary scaling parameter, usually 0.
+  };
+
+  /**
+   * @brief Construct the unscented Kalman filter.
+   * @param config Configuration for the filter.
+   */
+  explicit UnscentedKalmanFilter(const Config &config)
+      : Q_(config.Q)
+      , R_(config.R)
+      , x_(config.x)
+      , P_(config.P) {
+    T lambda = config.alpha * config.alpha * (T(N) + config.kappa) - T(N);
+    gamma_ = std::sqrt(T(N) + lambda);
+    weights_mean_[0] = lambda / (T(N) + lambda);
+    weights_covariance_[0] = weights_mean_[0] + (T(1) - config.alpha * config.alpha + config.beta);
+    for (size_t i = 1; i < NUM_SIGMA_POINTS; i++) {
+      weights_mean_[i] = T(1) / (T(2) * (T(N) + lambda));
+      weights_covariance_[i] = weights_mean_[i];
+    }
+  }
+
+  /**
+   * @brief Predict the next state.
+   * @param f State transition function, State f(const State &x).
+   * @return True on success, false if the covariance was not positive
+   *         definite (the estimate is left unchanged).
+   */
+  template <typename TransitionFn> bool predict(TransitionFn &&f) {
+    if (!generate_sigma_points()) {
+      return false;
+    }
+    for (auto &point : sigma_points_) {
+      point = f(std::as_const(point));
+    }
+    x_ = {};
+    for (size_t i = 0; i < NUM_SIGMA_POINTS; i++) {
+      x_ += weights_mean_[i] * sigma_points_[i];
+    }
+    P_ = Q_;
+    for (size_t i = 0; i < NUM_SIGMA_POINTS; i++) {
+      State dx = sigma_points_[i] - x_;
+      P_ += weights_covariance_[i] * multiply_transpose(dx, dx);
+    }
+    P_.symmetrize();
+    return true;
+  }
+
+  /**
+   * @brief Correct the state estimate with measurement \p z.
+   * @param z Measurement.
+   * @param h Measurement function, Measurement h(const State &x).
+   * @return True on success, false if a covariance was not positive
+   *         definite (the estimate is left unchanged).
+   */
+  template <typename MeasurementFn> bool update(const Measurement &z, MeasurementFn &&h) {
+    if (!generate_sigma_points()) {
+      return false;
+    }
+    std::array<Measurement, NUM_SIGMA_POINTS> z_points;
+    Measurement z_mean = {};
+    for (size_t i = 0; i < NUM_SIGMA_POINTS; i++) {
+      z_points[i] = h(std::as_const(sigma_points_[i]));
+      z_mean += weights_mean_[i] * z_points[i];
+    }
+    MeasurementCovariance S = R_;
+    Matrix<N, M, T> Pxz = {};
+    for (size_t i = 0; i < NUM_SIGMA_POINTS; i++) {
+      Measurement dz = z_points[i] - z_mean;
+      State dx = sigma_points_[i] - x_;
+      S += weights_covariance_[i] * multiply_transpose(dz, dz);
+      Pxz += weights_covariance_[i] * multiply_transpose(dx, dz);
+    }
+    MeasurementCovariance S_sqrt;
+    if (!cholesky(S, S_sqrt)) {
+      return false;
+    }
+    // K = Pxz S^-1 (via K^T = S^-1 Pxz^T), P -= K S K^T = (K sqrt(S)) (K sqrt(S))^T
+    Matrix<N, M, T> K =
+        solve_lower_transpose(S_sqrt, solve_lower(S_sqrt, Pxz.transpose())).transpose();
+    x_ += K * Measurement(z - z_mean);
+    Matrix<N, M, T> KS_sqrt = K * S_sqrt;
+    P_ -= multiply_transpose(KS_sqrt, KS_sqrt);
+    P_.symmetrize();
+    return true;
+  }
+
+  /**
+   * @brief Get the current state estimate.
+   * @return The state estimate.
+   */
+  const State &get_state() const { return x_; }
+
+  /**
+   * @brief Get the covariance of the current state estimate.
+   * @return The state covariance.
+   */
+  const StateMatrix &get_covariance() const { return P_; }
+
+  /**
+   * @brief Reset the state estimate and its covariance.
+   * @param x The new state estimate.
+   * @param P The new state covariance.
+   */
+  void set_state(const State &x, const StateMatrix &P) {
+    x_ = x;
+    P_ = P;
+  }
+
+  /**
+   * @brief Set the process noise covariance.
+   * @param Q Process noise covariance.
+   */
+  void set_process_noise(const StateMatrix &Q) { Q_ = Q; }
+
+  /**
+   * @brief Set the measurement noise covariance.
+   * @param R Measurement noise covariance.
+   */
+  void set_measurement_noise(const MeasurementCovariance &R) { R_ = R; }
+
+protected:
+  bool generate_sigma_points() {
+    StateMatrix L;
+    if (!cholesky(P_, L)) {
+      return false;
+    }
+    sigma_points_[0] = x_;
+    for (size_t i = 0; i < N; i++) {
+      for (size_t r = 0; r < N; r++) {
+        T offset = gamma_ * L(r, i);
+        sigma_points_[1 + i][r] = x_[r] + offset;
+        sigma_points_[1 + N + i][r] = x_[r] - offset;
+      }
+    }
+    return true;
+  }
+
+  StateMatrix Q_;
+  MeasurementCovariance R_;
+  State x_;
+  StateMatrix P_;
+  T gamma_;
+  std::array<T, NUM_SIGMA_POINTS> weights_mean_;
+  std::array<T, NUM_SIGMA_POINTS> weights_covariance_;
+  std::array<State, NUM_SIGMA_POINTS> sigma_points_;
+};
+} // namespace espp
@@ -19,7 +19,9 @@
 #include <random>
 #endif
 
+#include "async_file.hpp"
 #include "base_component.hpp"
+#include "compressed_socket.hpp"
 #include "task.hpp"
 #include "tcp_socket.hpp"
 
@@ -43,16 +45,28 @@ namespace espp {
 /// class is used by the FtpServer class to handle the client's requests.
 class FtpClientSession : public BaseComponent {
 public:
+  /// \brief Create a session for a client which connected to the server.
+  /// \param id The id of the client.
+  /// \param local_address The IP address of the server, used in PASV.
+  /// \param socket The control connection of the client.
+  /// \param root_path The root directory of the server.
+  /// \param file_io The FileIoService which runs the file I/O of the
+  ///        transfers. It must outlive the session.
   explicit FtpClientSession(int id, std::string_view local_address,
                             std::unique_ptr<TcpSocket> socket,
-                            const std::filesystem::path &root_path)
+                            const std::filesystem::path &root_path, FileIoService &file_io)
       : BaseComponent("FtpClientSession " + std::to_string(id))
       , id_(id)
       , local_ip_address_(local_address)
       , current_directory_(root_path)
+      , file_io_(file_io)
       , socket_(std::move(socket))
       , passive_socket_({.log_level = Logger::Verbosity::WARN}) {
     logger_.debug("Client session {} created", id_);
+    // all of our sockets share the token, so that stopping the session
+    // interrupts whichever one the task is blocked on
+    socket_->set_cancellation_token(cancellation_token_);
+    passive_socket_.set_cancellation_token(cancellation_token_);
     send_welcome_message();
     using namespace std::placeholders;
     task_ = std::make_unique<Task>(Task::Config{
@@ -66,6 +80,7 @@ public:
 
   ~FtpClientSession() {
     logger_.debug("Client session {} destroyed", id_);
+    cancellation_token_->cancel();
     task_->stop();
   }
 
@@ -131,6 +146,10 @@ protected:
     static constexpr int max_request_size = 1024;
     std::vector<uint8_t> request_data;
     if (!socket_->receive(request_data, max_request_size)) {
+      if (socket_->is_cancelled()) {
+        logger_.debug("Session cancelled, stopping the task");
+        return true;
+      }
       // didn't receive anything, the client may have not sent anything yet
       // or may have disconnected. If it disconnected, the socket will be
       // closed and is_connected() will return false, so we'll handle that
@@ -249,8 +268,15 @@ protected:
       }
     }
     // send the data
-    detail::TcpTransmitConfig config{};
-    bool success = data_socket_->transmit(data, config);
+    bool success;
+    if (compressed_mode_) {
+      LzCompressor compressor({.block_size = COMPRESSION_BLOCK_SIZE,
+                               .write = make_socket_writer(*data_socket_)});
+      success = compressor.write(data) && compressor.finish();
+    } else {
+      detail::TcpTransmitConfig config{};
+      success = data_socket_->transmit(data, config);
+    }
     // close the data socket
     data_socket_->close();
     data_socket_.reset();
@@ -289,36 +315,54 @@ protected:
         return false;
       }
     }
-    // open the file
-    std::ofstream file(file_path, std::ios::binary);
-    if (!file.is_open()) {
-      logger_.error("Failed to open file");
+    // open the file; the file I/O service writes it behind the socket
+    // receives
+    AsyncFileWriter file(file_io_, {.block_size = FILE_BLOCK_SIZE, .num_blocks = 2});
+    std::error_code ec;
+    if (!file.open(file_path, ec)) {
+      logger_.error("Failed to open file: {}", ec.message());
       return false;
     }
 
     auto start = std::chrono::high_resolution_clock::now();
     size_t total_size = 0;
-    // receive the data
-    while (true) {
-      std::vector<uint8_t> buffer(1024);
-      std::size_t received = data_socket_->receive(buffer.data(), buffer.size());
-      if (received == 0) {
-        break;
+    bool success = true;
+    std::vector<uint8_t> buffer(FILE_BLOCK_SIZE);
+    if (compressed_mode_) {
+      // decompress the data straight into the file
+      LzDecompressor decompressor({.max_block_size = MAX_COMPRESSION_BLOCK_SIZE,
+                                   .write = [&file, &ec](std::span<const uint8_t> data) {
+                                     return file.write(data, ec);
+                                   }});
+      success = receive_decompressed(*data_socket_, decompressor, buffer, ec);
+      if (!success) {
+        logger_.error("Failed to decompress file: {}", ec.message());
+      }
+      total_size = decompressor.get_bytes_out();
+    } else {
+      // receive the data
+      while (success) {
+        std::size_t received = data_socket_->receive(buffer.data(), buffer.size());
+        if (received == 0) {
+          break;
+        }
+        total_size += received;
+        // write it to the file
+        logger_.debug("Writing {} bytes", received);
+        success = file.write(std::span(buffer).first(received), ec);
       }
-      total_size += received;
-      // write it to the filen
-      logger_.debug("Writing {} bytes", received);
-      file.write(reinterpret_cast<char *>(buffer.data()), received);
+    }
+    if (!file.close(ec) || !success) {
+      logger_.error("Failed to write file: {}", ec.message());
+      success = false;
     }
     auto end = std::chrono::high_resolution_clock::now();
     float elapsed = std::chrono::duration<float>(end - start).count();
     logger_.info("Received {} bytes in {:.2f} seconds ({:.2f} bytes/s)", total_size, elapsed,
                  total_size / elapsed);
-    file.close();
-    file.flush();
     data_socket_->close();
     data_socket_.reset();
-    return true;
+    return success;
   }
 
   /// \brief Send a file to the client.
@@ -355,34 +399,45 @@ protected:
     }
 
     detail::TcpTransmitConfig config{};
-    // open the file
-    std::ifstream file(file_path, std::ios::in | std::ios::binary);
-    if (!file.is_open()) {
-      logger_.error("Failed to open file");
+    // open the file; the file I/O service reads the next blocks while the
+    // current one is being sent
+    AsyncFileReader file(file_io_, {.block_size = FILE_BLOCK_SIZE, .num_blocks = 2});
+    std::error_code ec;
+    if (!file.open(file_path, 0, ec)) {
+      logger_.error("Failed to open file: {}", ec.message());
       return false;
     }
-    // get the file size
-    file.seekg(0, std::ios::end);
-    std::size_t file_size = file.tellg();
-    logger_.debug("File size: {}", file_size);
-    file.seekg(0, std::ios::beg);
+    logger_.debug("File size: {}", std::filesystem::file_size(file_path, ec));
     // send the file
     auto start = std::chrono::high_resolution_clock::now();
     size_t total_size = 0;
-    static constexpr std::size_t buffer_size = 1024;
-    std::unique_ptr<char[]> buffer(new char[buffer_size]);
+    // in compressed mode, the file is streamed through the compressor, which
+    // transmits each compressed block
+    std::unique_ptr<LzCompressor> compressor;
+    if (compressed_mode_) {
+      compressor = std::make_unique<LzCompressor>(LzCompressor::Config{
+          .block_size = COMPRESSION_BLOCK_SIZE, .write = make_socket_writer(*data_socket_)});
+    }
     while (true) {
-      file.read(buffer.get(), buffer_size);
-      std::size_t bytes_read = file.gcount();
-      if (bytes_read == 0) {
+      auto block = file.read_next(ec);
+      if (ec) {
+        logger_.error("Failed to read file: {}", ec.message());
+        return false;
+      }
+      if (block.empty()) {
         break;
       }
-      std::string_view data(buffer.get(), bytes_read);
-      if (!data_socket_->transmit(data, config)) {
+      std::string_view data((const char *)block.data(), block.size());
+      bool sent = compressor ? compressor->write(data) : data_socket_->transmit(data, config);
+      if (!sent) {
         logger_.error("Failed to send file");
         return false;
       }
-      total_size += bytes_read;
+      total_size += block.size();
+    }
+    if (compressor && !compressor->finish()) {
+      logger_.error("Failed to send file");
+      return false;
     }
     file.close();
     auto end = std::chrono::high_resolution_clock::now();
@@ -463,6 +518,9 @@ protected:
     if (command == "TYPE") {
       return handle_type(arguments);
     }
+    if (command == "MODE") {
+      return handle_mode(arguments);
+    }
     if (command == "PASV") {
       return handle_pasv(arguments);
     }
@@ -585,6 +643,7 @@ protected:
     message += " CWD\r\n";
     message += " CDUP\r\n";
     message += " TYPE\r\n";
+    message += " MODE\r\n";
     message += " PASV\r\n";
     message += " PORT\r\n";
     message += " LIST\r\n";
@@ -691,6 +750,35 @@ protected:
     return send_response(504, "Command not implemented for that parameter.");
   }
 
+  /// \brief Handle the MODE command.
+  /// \details The MODE command specifies the data transfer mode. Stream (S)
+  ///     mode is the default. In addition, this server supports a compressed
+  ///     (L) mode, in which every data transfer (RETR, STOR, LIST) is sent as
+  ///     an LzCompressor frame. Deflate (Z) mode is not supported.
+  /// \param arguments The arguments to the MODE command.
+  /// \return True if the command was handled, false otherwise.
+  bool handle_mode(std::string_view arguments) {
+    logger_.info("Handling mode: {}", arguments);
+    // parse the mode
+    auto mode_end = arguments.find("\r\n");
+    if (mode_end == std::string_view::npos) {
+      logger_.error("Failed to parse mode");
+      return false;
+    }
+    std::string_view mode = arguments.substr(0, mode_end);
+    // handle the stream (S) mode
+    if (mode == "S") {
+      compressed_mode_ = false;
+      return send_response(200, "Mode set to S.");
+    }
+    // handle the compressed (L) mode
+    if (mode == "L") {
+      compressed_mode_ = true;
+      return send_response(200, "Mode set to L.");
+    }
+    return send_response(504, "Command not implemented for that parameter.");
+  }
+
   /// \brief Handle the PASV command.
   /// \details The PASV command requests the server to "listen" on a data
   ///     port (which is not its default data port) and to wait for a
@@ -774,6 +862,7 @@ protected:
     data_socket_.reset();
     data_socket_ =
         std::make_unique<TcpSocket>(TcpSocket::Config{.log_level = Logger::Verbosity::WARN});
+    data_socket_->set_cancellation_token(cancellation_token_);
     is_passive_data_connection_ = false;
     return send_response(200, "PORT command successful.");
   }
@@ -1150,13 +1239,26 @@ private:
 
   std::filesystem::path current_directory_;
 
+  // file transfers are read ahead / written behind by the server's service
+  static constexpr size_t FILE_BLOCK_SIZE = 4 * 1024;
+  FileIoService &file_io_;
+
   std::filesystem::path rename_from_;
 
+  // cancelled when the session is destroyed, to interrupt blocking socket
+  // operations in the task
+  std::shared_ptr<CancellationToken> cancellation_token_{std::make_shared<CancellationToken>()};
+
   std::unique_ptr<TcpSocket> socket_;
 
   std::unique_ptr<TcpSocket> data_socket_;
   bool is_passive_data_connection_{false};
 
+  // MODE L: data transfers are LzCompressor frames
+  static constexpr size_t COMPRESSION_BLOCK_SIZE = 4 * 1024;
+  static constexpr size_t MAX_COMPRESSION_BLOCK_SIZE = 16 * 1024;
+  bool compressed_mode_{false};
+
   // used when the data connection is passive
   TcpSocket passive_socket_;
 
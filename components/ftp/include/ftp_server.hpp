@@ -16,6 +16,7 @@
 #endif
 
 #include "base_component.hpp"
+#include "file_io.hpp"
 #include "task.hpp"
 #include "tcp_socket.hpp"
 
@@ -37,7 +38,10 @@ public:
       , ip_address_(ip_address)
       , port_(port)
       , server_({.log_level = Logger::Verbosity::WARN})
-      , root_(root) {}
+      , root_(root) {
+    // allow stop() to interrupt the accept task
+    server_.set_cancellation_token(std::make_shared<CancellationToken>());
+  }
 
   /// \brief Destroy the FTP server.
   ~FtpServer() { stop(); }
@@ -51,6 +55,12 @@ public:
       return false;
     }
 
+    // if we were previously stopped, reopen the socket
+    if (!server_.is_valid()) {
+      server_.reinit();
+    }
+    server_.get_cancellation_token()->reset();
+
     if (!server_.bind(port_)) {
       logger_.error("Failed to bind to port {}", port_);
       return false;
@@ -74,15 +84,20 @@ public:
   }
 
   /// \brief Stop the FTP server.
+  /// \details Interrupts the accept task and any client sessions, so this
+  ///     does not wait for a client to connect or send a request. The
+  ///     server can be started again afterwards.
   void stop() {
-    clear_clients();
     stop_accepting();
+    clear_clients();
+    server_.close();
   }
 
 protected:
   /// \brief Stop accepting new connections.
   void stop_accepting() {
-    if (accept_task_ && accept_task_->is_started()) {
+    server_.get_cancellation_token()->cancel();
+    if (accept_task_) {
       accept_task_->stop();
     }
   }
@@ -94,6 +109,10 @@ protected:
 
   bool accept_task_function(std::mutex &m, std::condition_variable &cv) {
     auto client_ptr = server_.accept();
+    if (!client_ptr && server_.is_cancelled()) {
+      logger_.debug("Accept cancelled, stopping the accept task");
+      return true;
+    }
     if (!client_ptr) {
       logger_.error("Could not accept connection");
       // if we failed to accept that means there are no connections available
@@ -110,9 +129,16 @@ protected:
 
     logger_.info("Accepted connection from {}, id {}", client_ptr->get_remote_info(), client_id);
 
+    // the file I/O task is only started once there is a client to serve
+    if (!file_io_) {
+      file_io_ = std::make_unique<FileIoService>(FileIoService::Config{
+          .task_config = {.name = "FtpServer::file_io", .stack_size_bytes = 1024 * 4}});
+    }
+
     // create a new client session
     auto client_session_ptr =
-        std::make_unique<FtpClientSession>(client_id, ip_address_, std::move(client_ptr), root_);
+        std::make_unique<FtpClientSession>(client_id, ip_address_, std::move(client_ptr), root_,
+                                           *file_io_);
 
     // add the client session to the map of clients
     std::lock_guard<std::mutex> lk(clients_mutex_);
@@ -155,6 +181,11 @@ protected:
 
   std::filesystem::path root_;
 
+  // shared by the client sessions for their file transfers, so it must
+  // outlive them. Only created (and its task started) by the accept task
+  // when the first client connects.
+  std::unique_ptr<FileIoService> file_io_;
+
   std::mutex clients_mutex_;
   std::unordered_map<int, std::unique_ptr<FtpClientSession>> clients_;
 };
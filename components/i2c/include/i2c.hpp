@@ -110,7 +110,7 @@ public:
       return;
     }
 
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard lock(mutex_);
     auto err = i2c_driver_delete(config_.port);
     if (err != ESP_OK) {
       logger_.error("delete i2c driver failed");
@@ -123,6 +123,15 @@ public:
     initialized_ = false;
   }
 
+  /// Get the mutex which serializes transactions on the bus
+  /// \details Peripherals which share the bus can lock this mutex (e.g. by
+  ///          using espp::peripheral_lock::Bus) to make multi-transaction
+  ///          operations atomic without needing a mutex of their own. The
+  ///          mutex is recursive, so the I2c functions can be called while
+  ///          holding it.
+  /// \return Reference to the bus mutex
+  std::recursive_mutex &get_mutex() { return mutex_; }
+
   /// Write data to I2C device
   /// \param dev_addr I2C device address
   /// \param data Data to write
@@ -135,7 +144,7 @@ public:
     }
 
     logger_.debug("write {} bytes to address {:#02x}", data_len, dev_addr);
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard lock(mutex_);
     auto err = i2c_master_write_to_device(config_.port, dev_addr, data, data_len,
                                           config_.timeout_ms / portTICK_PERIOD_MS);
     if (err != ESP_OK) {
@@ -170,7 +179,7 @@ public:
 
     logger_.debug("write {} bytes and read {} bytes from address {:#02x}", write_size, read_size,
                   dev_addr);
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard lock(mutex_);
     auto err =
         i2c_master_write_read_device(config_.port, dev_addr, write_data, write_size, read_data,
                                      read_size, config_.timeout_ms / portTICK_PERIOD_MS);
@@ -208,7 +217,7 @@ public:
 
     logger_.debug("read {} bytes from address {:#02x} at register {}", data_len, dev_addr,
                   reg_addr);
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard lock(mutex_);
     auto err = i2c_master_write_read_device(config_.port, dev_addr, &reg_addr, 1, data, data_len,
                                             config_.timeout_ms / portTICK_PERIOD_MS);
     if (err != ESP_OK) {
@@ -242,7 +251,7 @@ public:
     }
 
     logger_.debug("read {} bytes from address {:#02x}", data_len, dev_addr);
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard lock(mutex_);
     auto err = i2c_master_read_from_device(config_.port, dev_addr, data, data_len,
                                            config_.timeout_ms / portTICK_PERIOD_MS);
     if (err != ESP_OK) {
@@ -271,7 +280,7 @@ public:
   bool probe_device(const uint8_t dev_addr) {
     bool success = false;
     logger_.debug("probe device {:#02x}", dev_addr);
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard lock(mutex_);
     auto cmd = i2c_cmd_link_create();
     i2c_master_start(cmd);
     i2c_master_write_byte(cmd, (dev_addr << 1) | I2C_MASTER_WRITE, true);
@@ -286,7 +295,7 @@ public:
 protected:
   Config config_;
   bool initialized_ = false;
-  std::mutex mutex_;
+  std::recursive_mutex mutex_;
 };
 } // namespace espp
 
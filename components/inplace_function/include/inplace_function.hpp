@@ -0,0 +1,234 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if defined(ESP_PLATFORM)
+#include "sdkconfig.h"
+#endif
+
+// Number of pointers which fit in an InplaceFunction by default. On ESP this
+// is set with menuconfig, elsewhere it can be overridden with a compile
+// definition.
+#if !defined(CONFIG_ESPP_INPLACE_FUNCTION_CAPACITY)
+#define CONFIG_ESPP_INPLACE_FUNCTION_CAPACITY 4
+#endif
+
+namespace espp {
+/// Default capacity (in bytes) of an InplaceFunction, used by the callback
+/// types of BasePeripheral, HighResolutionTimer, BldcMotor, LedStrip and the
+/// display drivers. By default (CONFIG_ESPP_INPLACE_FUNCTION_CAPACITY = 4)
+/// this is enough to store a lambda capturing up to four pointers /
+/// references, a std::bind of a member function to an object pointer (plus
+/// placeholders), or a std::function.
+static constexpr size_t INPLACE_FUNCTION_DEFAULT_CAPACITY =
+    CONFIG_ESPP_INPLACE_FUNCTION_CAPACITY * sizeof(void *);
+
+template <typename Signature, size_t Capacity = INPLACE_FUNCTION_DEFAULT_CAPACITY,
+          size_t Alignment = alignof(std::max_align_t)>
+class InplaceFunction;
+
+namespace detail {
+template <typename T> struct is_function_wrapper : std::false_type {};
+template <typename Signature>
+struct is_function_wrapper<std::function<Signature>> : std::true_type {};
+template <typename Signature, size_t Capacity, size_t Alignment>
+struct is_function_wrapper<InplaceFunction<Signature, Capacity, Alignment>> : std::true_type {};
+} // namespace detail
+
+/// @brief Fixed-capacity, non-allocating replacement for std::function.
+/// @details InplaceFunction stores the callable (lambda, std::bind
+///          expression, function pointer, ...) in an internal buffer of
+///          Capacity bytes instead of on the heap, so constructing, copying,
+///          and assigning it never allocates. Calling it costs a single
+///          indirect call, like std::function.
+///
+///          Callables which do not fit in the buffer are rejected at compile
+///          time (with a static_assert), rather than silently allocating. If
+///          you hit this, capture a pointer / reference to a struct holding
+///          your state instead of capturing the state by value, wrap it in a
+///          std::function, or raise CONFIG_ESPP_INPLACE_FUNCTION_CAPACITY.
+///
+///          It is used for the callbacks which are invoked in hot paths
+///          throughout espp (Task, Timer, BasePeripheral, BldcMotor, LedStrip,
+///          display drivers), and can be used anywhere you would otherwise use
+///          std::function.
+///
+/// @note Calling an empty InplaceFunction throws std::bad_function_call (or
+///       aborts if exceptions are disabled), just like std::function.
+///
+/// @tparam R The return type of the function.
+/// @tparam Args The argument types of the function.
+/// @tparam Capacity The size (in bytes) of the buffer for the callable.
+/// @tparam Alignment The alignment of the buffer for the callable.
+///
+/// Example:
+/// @code{.cpp}
+///   espp::InplaceFunction<bool(uint8_t, const uint8_t *, size_t)> write =
+///       std::bind(&espp::I2c::write, &i2c, _1, _2, _3); // fits, never allocates
+///   struct Big { uint8_t data[64]; } big;
+///   espp::InplaceFunction<void()> f = [big]() {}; // compile error: too large
+/// @endcode
+template <typename R, typename... Args, size_t Capacity, size_t Alignment>
+class InplaceFunction<R(Args...), Capacity, Alignment> {
+public:
+  /// The size (in bytes) of the buffer for the callable.
+  static constexpr size_t capacity = Capacity;
+
+  /// @brief Construct an empty function.
+  InplaceFunction() noexcept = default;
+
+  /// @brief Construct an empty function.
+  InplaceFunction(std::nullptr_t) noexcept {}
+
+  /// @brief Construct the function from a callable.
+  /// @details The callable is copied / moved into the internal buffer. Null
+  ///          function pointers and empty std::function / InplaceFunction
+  ///          objects produce an empty function.
+  /// @param f The callable to store. It must be copy constructible, invocable
+  ///          with Args... and return something convertible to R.
+  template <typename F, typename D = std::decay_t<F>>
+  requires(!std::is_same_v<D, InplaceFunction> && std::is_invocable_r_v<R, D &, Args...>)
+  InplaceFunction(F &&f) {
+    static_assert(sizeof(D) <= Capacity,
+                  "Callable is too large for this InplaceFunction; capture less state (e.g. a "
+                  "pointer to it) or increase the Capacity (for the default capacity: "
+                  "CONFIG_ESPP_INPLACE_FUNCTION_CAPACITY)");
+    static_assert(Alignment % alignof(D) == 0,
+                  "Callable is over-aligned for this InplaceFunction; increase the Alignment");
+    static_assert(std::is_copy_constructible_v<D>, "Callable must be copy constructible");
+    if constexpr (std::is_pointer_v<D> || std::is_member_pointer_v<D> ||
+                  detail::is_function_wrapper<D>::value) {
+      if (f == nullptr) {
+        return;
+      }
+    }
+    ::new (static_cast<void *>(&storage_)) D(std::forward<F>(f));
+    vtable_ = &vtable_for<D>;
+  }
+
+  /// @brief Copy constructor.
+  /// @param other The function to copy.
+  InplaceFunction(const InplaceFunction &other)
+      : vtable_(other.vtable_) {
+    vtable_->copy(&storage_, &other.storage_);
+  }
+
+  /// @brief Move constructor.
+  /// @param other The function to move from. It is left empty.
+  InplaceFunction(InplaceFunction &&other) noexcept
+      : vtable_(other.vtable_) {
+    vtable_->move(&storage_, &other.storage_);
+    other.vtable_ = &empty_vtable;
+  }
+
+  /// @brief Destroy the stored callable (if any).
+  ~InplaceFunction() { vtable_->destroy(&storage_); }
+
+  /// @brief Copy assignment.
+  /// @param other The function to copy.
+  /// @return *this
+  InplaceFunction &operator=(const InplaceFunction &other) {
+    if (this != &other) {
+      vtable_->destroy(&storage_);
+      vtable_ = &empty_vtable;
+      other.vtable_->copy(&storage_, &other.storage_);
+      vtable_ = other.vtable_;
+    }
+    return *this;
+  }
+
+  /// @brief Move assignment.
+  /// @param other The function to move from. It is left empty.
+  /// @return *this
+  InplaceFunction &operator=(InplaceFunction &&other) noexcept {
+    if (this != &other) {
+      vtable_->destroy(&storage_);
+      other.vtable_->move(&storage_, &other.storage_);
+      vtable_ = other.vtable_;
+      other.vtable_ = &empty_vtable;
+    }
+    return *this;
+  }
+
+  /// @brief Clear the function.
+  /// @return *this
+  InplaceFunction &operator=(std::nullptr_t) noexcept {
+    vtable_->destroy(&storage_);
+    vtable_ = &empty_vtable;
+    return *this;
+  }
+
+  /// @brief Replace the stored callable.
+  /// @param f The new callable.
+  /// @return *this
+  template <typename F, typename D = std::decay_t<F>>
+  requires(!std::is_same_v<D, InplaceFunction> && std::is_invocable_r_v<R, D &, Args...>)
+  InplaceFunction &operator=(F &&f) {
+    return *this = InplaceFunction(std::forward<F>(f));
+  }
+
+  /// @brief Call the stored callable.
+  /// @param args The arguments to pass to the callable.
+  /// @return The value returned by the callable.
+  R operator()(Args... args) const {
+    return vtable_->invoke(&storage_, std::forward<Args>(args)...);
+  }
+
+  /// @brief Check whether the function holds a callable.
+  /// @return True if the function is not empty.
+  explicit operator bool() const noexcept { return vtable_ != &empty_vtable; }
+
+  /// @brief Check whether the function is empty.
+  /// @param f The function to check.
+  /// @return True if the function is empty.
+  friend bool operator==(const InplaceFunction &f, std::nullptr_t) noexcept { return !f; }
+
+protected:
+  struct VTable {
+    R (*invoke)(void *, Args &&...);
+    void (*copy)(void *, const void *);
+    void (*move)(void *, void *) noexcept;
+    void (*destroy)(void *) noexcept;
+  };
+
+  template <typename D>
+  static constexpr VTable vtable_for{
+      .invoke = [](void *f, Args &&...args) -> R {
+        if constexpr (std::is_void_v<R>) {
+          // discard the result of callables which return something
+          std::invoke(*static_cast<D *>(f), std::forward<Args>(args)...);
+        } else {
+          return std::invoke(*static_cast<D *>(f), std::forward<Args>(args)...);
+        }
+      },
+      .copy = [](void *dst, const void *src) { ::new (dst) D(*static_cast<const D *>(src)); },
+      .move =
+          [](void *dst, void *src) noexcept {
+            ::new (dst) D(std::move(*static_cast<D *>(src)));
+            static_cast<D *>(src)->~D();
+          },
+      .destroy = [](void *f) noexcept { static_cast<D *>(f)->~D(); },
+  };
+
+  static constexpr VTable empty_vtable{
+      .invoke = [](void *, Args &&...) -> R {
+#if defined(__cpp_exceptions)
+        throw std::bad_function_call();
+#else
+        std::abort();
+#endif
+      },
+      .copy = [](void *, const void *) {},
+      .move = [](void *, void *) noexcept {},
+      .destroy = [](void *) noexcept {},
+  };
+
+  const VTable *vtable_{&empty_vtable};
+  alignas(Alignment) mutable std::byte storage_[Capacity];
+};
+} // namespace espp
@@ -3,6 +3,7 @@
 #include <vector>
 
 #include "i2c.hpp"
+#include "interrupt.hpp"
 #include "kts1622.hpp"
 #include "logger.hpp"
 #include "task.hpp"
@@ -82,9 +83,48 @@ extern "C" void app_main(void) {
   fmt::print("% time(s), pin values\n");
   task.start();
   //! [kts1622 example]
-  while (true) {
-    std::this_thread::sleep_for(100ms);
+  std::this_thread::sleep_for(10s);
+  task.stop();
+
+  logger.info("Starting kts1622 change detection example");
+  //! [kts1622 change detection example]
+  // the pins are only read when the INT pin (active low) signals a change, and
+  // the callback gets the debounced changes; get_pins() now returns the pins
+  // as last read, without accessing the bus
+  kts1622.enable_change_detection(
+      {
+          .mask = 0xFFFF,
+          .debounce_time = 20ms,
+          .callback =
+              [&](const espp::PinChangeDetector::Event &event) {
+                logger.info("pins: {:#06x}, changed: {:#06x}", event.pins, event.changed);
+              },
+      },
+      ec);
+  if (ec) {
+    logger.error("kts1622 enable change detection failed: {}", ec.message());
+    return;
   }
+  espp::Interrupt interrupt({
+      .interrupts = {{
+          .gpio_num = CONFIG_EXAMPLE_INT_GPIO,
+          .callback =
+              [&](const auto &event) {
+                std::error_code ec;
+                kts1622.handle_interrupt(ec);
+              },
+          .active_level = espp::Interrupt::ActiveLevel::LOW,
+          .interrupt_type = espp::Interrupt::Type::FALLING_EDGE,
+          .pullup_enabled = true,
+      }},
+      .task_config =
+          {
+              .name = "Kts1622 INT",
+              .stack_size_bytes = 4 * 1024,
+              .priority = 5,
+          },
+  });
+  //! [kts1622 change detection example]
 
   logger.info("Kts1622 example complete!");
 
@@ -1,8 +1,12 @@
 #pragma once
 
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
 
 #include "base_peripheral.hpp"
+#include "pin_change_detector.hpp"
 
 namespace espp {
 /**
@@ -13,8 +17,15 @@ namespace espp {
  * features. It supports up to 1MHz Fast-mode Plus I2C and can operate [1.65,
  * 5.5]V on the I2C bus and I/O pins (with separate power pins for each).
  *
+ * Instead of polling the pins, the expander can signal changes on its INT
+ * pin (see enable_change_detection()): each INT edge is handled with a single
+ * burst read, get_pins() is served from the last read, and debounced changes
+ * are delivered to a callback.
+ *
  * \section kts1622_ex1 KTS1622 Example
  * \snippet kts1622_example.cpp kts1622 example
+ * \section kts1622_ex2 KTS1622 Change Detection Example
+ * \snippet kts1622_example.cpp kts1622 change detection example
  */
 class Kts1622 : public BasePeripheral<> {
 public:
@@ -81,6 +92,13 @@ public:
     Logger::Verbosity log_level{Logger::Verbosity::WARN}; ///< Log verbosity for the component.
   };
 
+  /// Interrupt configuration from before enable_change_detection()
+  struct InterruptConfig {
+    uint8_t input_latch[2]{}; ///< INPUT_LATCH0, INPUT_LATCH1
+    uint8_t int_mask[2]{};    ///< INT_MASK0, INT_MASK1
+    uint8_t int_edge[4]{};    ///< INT_EDGE0A, INT_EDGE0B, INT_EDGE1A, INT_EDGE1B
+  };
+
   /**
    * @brief Construct the Kts1622. Will call initialize() if auto_init is true.
    * @param config Config structure for configuring the KTS1622
@@ -118,8 +136,17 @@ public:
    * @param port The Port for which to read the pins
    * @param ec Error code to set if an error occurs.
    * @return The pin values as an 8 bit mask.
+   * @note With change detection enabled, the pins are not read from the
+   *       device, but from the last read of handle_interrupt().
    */
   uint8_t get_pins(Port port, std::error_code &ec) {
+    {
+      std::lock_guard<std::mutex> lock(detector_mutex_);
+      if (detector_) {
+        auto pins = detector_->get_pins();
+        return port == Port::PORT0 ? (pins & 0xFF) : (pins >> 8);
+      }
+    }
     auto addr = port == Port::PORT0 ? Registers::INPORT0 : Registers::INPORT1;
     return read_u8_from_register((uint8_t)addr, ec);
   }
@@ -128,8 +155,16 @@ public:
    * @brief Read the pin values on both Port 0 and Port 1.
    * @param ec Error code to set if an error occurs.
    * @return The pin values as a 16 bit mask (P0_0 lsb, P1_7 msb).
+   * @note With change detection enabled, the pins are not read from the
+   *       device, but from the last read of handle_interrupt().
    */
   uint16_t get_pins(std::error_code &ec) {
+    {
+      std::lock_guard<std::mutex> lock(detector_mutex_);
+      if (detector_) {
+        return detector_->get_pins();
+      }
+    }
     uint16_t p0 = read_u8_from_register((uint8_t)Registers::INPORT0, ec);
     if (ec)
       return 0;
@@ -646,6 +681,127 @@ public:
     write_u8_to_register((uint8_t)addr, data, ec);
   }
 
+  /**
+   * @brief Detect changes of the pins with the INT pin instead of polling.
+   * @details Latches the inputs in \p config.mask and configures them to
+   *          interrupt on any edge. Call handle_interrupt() on the active
+   *          edge of the INT pin (e.g. from an espp::Interrupt callback). From
+   *          then on, get_pins() returns the pins as last read by
+   *          handle_interrupt(), and \p config.callback is called with each
+   *          debounced change. The previous interrupt configuration
+   *          (INPUT_LATCH, INT_MASK, and INT_EDGE) is restored by
+   *          disable_change_detection().
+   * @param config Configuration of the change detection.
+   * @param ec Error code to set if an error occurs.
+   */
+  void enable_change_detection(const PinChangeDetector::Config &config, std::error_code &ec) {
+    reset_detector();
+    if (!saved_interrupt_config_) {
+      InterruptConfig saved;
+      read_many_from_register((uint8_t)Registers::INPUT_LATCH0, saved.input_latch,
+                              sizeof(saved.input_latch), ec);
+      if (!ec) {
+        read_many_from_register((uint8_t)Registers::INT_MASK0, saved.int_mask,
+                                sizeof(saved.int_mask), ec);
+      }
+      if (!ec) {
+        read_many_from_register((uint8_t)Registers::INT_EDGE0A, saved.int_edge,
+                                sizeof(saved.int_edge), ec);
+      }
+      if (ec) {
+        logger_.error("Failed to read interrupt config: {}", ec.message());
+        return;
+      }
+      saved_interrupt_config_ = saved;
+    }
+    set_input_latch(config.mask, ec);
+    if (ec) {
+      return;
+    }
+    // INT_EDGE0A, INT_EDGE0B, INT_EDGE1A, INT_EDGE1B are sequential, with 2
+    // bits per pin
+    uint8_t edges[4] = {0, 0, 0, 0};
+    for (int i = 0; i < 16; i++) {
+      if (config.mask & (1 << i)) {
+        edges[i / 4] |= (uint8_t)InterruptType::CHANGE << ((i % 4) * 2);
+      }
+    }
+    write_many_to_register((uint8_t)Registers::INT_EDGE0A, edges, sizeof(edges), ec);
+    if (ec) {
+      logger_.error("Failed to configure interrupt edges: {}", ec.message());
+      return;
+    }
+    enable_interrupt((uint16_t)~config.mask, ec);
+    if (ec) {
+      return;
+    }
+    // reading the pins also clears any pending interrupt
+    uint8_t pins[2];
+    read_many_from_register((uint8_t)Registers::INPORT0, pins, sizeof(pins), ec);
+    if (ec) {
+      logger_.error("Failed to read pins: {}", ec.message());
+      return;
+    }
+    auto detector = std::make_unique<PinChangeDetector>(config, (pins[1] << 8) | pins[0]);
+    std::lock_guard<std::mutex> lock(detector_mutex_);
+    detector_ = std::move(detector);
+  }
+
+  /**
+   * @brief Stop detecting changes of the pins, see enable_change_detection().
+   * @details Restores the interrupt configuration from before
+   *          enable_change_detection().
+   * @param ec Error code to set if an error occurs.
+   */
+  void disable_change_detection(std::error_code &ec) {
+    reset_detector();
+    if (!saved_interrupt_config_) {
+      return;
+    }
+    const auto &saved = *saved_interrupt_config_;
+    // restore the mask first, so that the pins stop interrupting before
+    // their edges and latches change
+    write_many_to_register((uint8_t)Registers::INT_MASK0, saved.int_mask, sizeof(saved.int_mask),
+                           ec);
+    if (!ec) {
+      write_many_to_register((uint8_t)Registers::INT_EDGE0A, saved.int_edge,
+                             sizeof(saved.int_edge), ec);
+    }
+    if (!ec) {
+      write_many_to_register((uint8_t)Registers::INPUT_LATCH0, saved.input_latch,
+                             sizeof(saved.input_latch), ec);
+    }
+    if (ec) {
+      logger_.error("Failed to restore interrupt config: {}", ec.message());
+      return;
+    }
+    saved_interrupt_config_.reset();
+  }
+
+  /**
+   * @brief Read the pins, when the INT pin signals a change.
+   * @details Reads both input ports in a single burst, which also clears the
+   *          interrupt. Since the inputs are latched, the state which caused
+   *          the interrupt is read even if the pins changed back meanwhile,
+   *          in which case the device interrupts again.
+   * @param ec Error code to set if an error occurs.
+   * @note Change detection must be enabled, see enable_change_detection().
+   */
+  void handle_interrupt(std::error_code &ec) {
+    std::lock_guard<std::mutex> lock(detector_mutex_);
+    if (!detector_) {
+      ec = std::make_error_code(std::errc::operation_not_permitted);
+      return;
+    }
+    uint8_t pins[2];
+    read_many_from_register((uint8_t)Registers::INPORT0, pins, sizeof(pins), ec);
+    if (ec) {
+      logger_.error("Failed to read pins: {}", ec.message());
+      return;
+    }
+    detector_->update((pins[1] << 8) | pins[0]);
+  }
+
 protected:
   /**
    * @brief Register map for the MT23X17
@@ -703,6 +859,16 @@ protected:
     DEBOUNCE_COUNT = 0x5C, ///< Debounce count (default=0)
   };
 
+  void reset_detector() {
+    // the detector is destroyed without holding detector_mutex_, since
+    // stopping its task waits for the callback, which may call get_pins()
+    std::unique_ptr<PinChangeDetector> detector;
+    {
+      std::lock_guard<std::mutex> lock(detector_mutex_);
+      detector = std::move(detector_);
+    }
+  }
+
   void init(const Config &config, std::error_code &ec) {
     set_direction(Port::PORT0, config.port_0_direction_mask, ec);
     if (ec)
@@ -717,6 +883,10 @@ protected:
   }
 
   Config config_;
+  std::mutex detector_mutex_; ///< Guards detector_, which handle_interrupt() uses from the
+                              ///< Interrupt task
+  std::unique_ptr<PinChangeDetector> detector_;
+  std::optional<InterruptConfig> saved_interrupt_config_;
 };
 } // namespace espp
 
@@ -91,6 +91,41 @@ extern "C" void app_main(void) {
     //! [breathing led example]
   }
 
+  {
+    //! [led sequencer example]
+    fmt::print("Starting led sequencer example!\n");
+    float breathing_period = 3.5f; // seconds
+    float num_periods_to_run = 2.0f;
+    std::vector<espp::Led::ChannelConfig> led_channels{{
+        .gpio = 2,
+        .channel = LEDC_CHANNEL_5,
+        .timer = LEDC_TIMER_2,
+    }};
+    espp::Led led(espp::Led::Config{
+        .timer = LEDC_TIMER_2,
+        .frequency_hz = 5000,
+        .channels = led_channels,
+        .duty_resolution = LEDC_TIMER_10_BIT,
+    });
+    // breathe with gamma corrected brightness, played as a chain of hardware
+    // fades instead of updating the duty cycle from a task
+    uint32_t period_ms = breathing_period * 1000;
+    led.play({{
+        .channel = led_channels[0].channel,
+        .timeline =
+            {
+                .keyframes = {{0, 0.0f}, {period_ms / 2, 100.0f}, {period_ms, 0.0f}},
+                .curve = espp::LedSequencer::Curve::GAMMA,
+                .gamma = 2.2f,
+            },
+    }});
+    float wait_time = num_periods_to_run * breathing_period;
+    fmt::print("Sleeping for {:.1f}s...\n", wait_time);
+    std::this_thread::sleep_for(wait_time * 1.0s);
+    fmt::print("Sequencer woke up {} times\n", led.get_num_sequencer_wakeups());
+    //! [led sequencer example]
+  }
+
   fmt::print("LED example complete!\n");
 
   while (true) {
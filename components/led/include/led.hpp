@@ -1,7 +1,9 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <memory>
 #include <optional>
 #include <vector>
 
@@ -10,16 +12,24 @@
 #include <freertos/semphr.h>
 
 #include "base_component.hpp"
+#include "led_sequencer.hpp"
 
 namespace espp {
 /**
  *  Provides a wrapper around the LEDC peripheral in ESP-IDF which allows for
  *  thread-safe control over one or more channels of LEDs using a simpler API.
  *
+ *  Keyframe timelines (e.g. gamma corrected breathing) can be played on
+ *  multiple channels with play(), as chains of hardware fades which are
+ *  started from the fade end interrupt by a single LedSequencer task, instead
+ *  of updating the duty cycle of each channel from its own task.
+ *
  * \section led_ex1 Linear LED Example
  * \snippet led_example.cpp linear led example
  * \section led_ex2 Breathing LED Example
  * \snippet led_example.cpp breathing led example
+ * \section led_ex3 LED Sequencer Example
+ * \snippet led_example.cpp led sequencer example
  */
 class Led : public BaseComponent {
 public:
@@ -53,6 +63,10 @@ public:
         LEDC_AUTO_CLK}; /**< The LEDC clock configuration you want for these LED channels. */
     ledc_mode_t speed_mode{
         LEDC_LOW_SPEED_MODE}; /**< The LEDC speed mode you want for these LED channels. */
+    Task::BaseConfig sequencer_task_config{
+        .name = "Led Sequencer",
+        .stack_size_bytes = 3 * 1024,
+        .priority = 10}; /**< Configuration of the task started by the first call to play(). */
     Logger::Verbosity log_level{Logger::Verbosity::WARN}; /**< Log verbosity for the task.  */
   };
 
@@ -64,6 +78,7 @@ public:
       : BaseComponent("Led", config.log_level)
       , duty_resolution_(config.duty_resolution)
       , max_raw_duty_((uint32_t)(std::pow(2, (int)duty_resolution_) - 1))
+      , sequencer_task_config_(config.sequencer_task_config)
       , channels_(config.channels) {
 
     logger_.info("Initializing timer");
@@ -104,9 +119,11 @@ public:
       // go ahead and give to the semaphores so the functions will work
       xSemaphoreGive(sem);
     }
+    fade_callback_args_.resize(channels_.size());
     for (int i = 0; i < channels_.size(); i++) {
+      fade_callback_args_[i] = {this, (size_t)i};
       ledc_cb_register(channels_[i].speed_mode, channels_[i].channel, &callbacks,
-                       (void *)fade_semaphores_[i]);
+                       (void *)&fade_callback_args_[i]);
     }
   }
 
@@ -114,6 +131,9 @@ public:
    * @brief Stop the LEDC subsystem and free memory.
    */
   ~Led() {
+    // stop starting fades from the fade end ISR
+    isr_sequencer_ = nullptr;
+    sequencer_.reset();
     // clean up the semaphores
     for (auto &sem : fade_semaphores_) {
       // take the semaphore (so that we don't delete it until no one is
@@ -205,7 +225,115 @@ public:
     // the ISR
   }
 
+  /**
+   * @brief A timeline to play on a channel.
+   */
+  struct ChannelTimeline {
+    ledc_channel_t channel;          /**< The channel to play the timeline on. */
+    LedSequencer::Timeline timeline; /**< The timeline. */
+  };
+
+  /**
+   * @brief Play timelines on the channels, as chains of hardware fades
+   *        which follow the brightness curve of each timeline.
+   * @details The timelines are compiled into fades here, and the first fade
+   *          of each channel is started together. Each following fade is
+   *          started by the sequencer task when the fade end interrupt of
+   *          the channel signals it. Channels which are not in \p timelines
+   *          keep playing their previous timeline, if any.
+   * @note This function will block until the current fades of the channels
+   *       complete (if there are any).
+   * @note set_duty() and set_fade_with_time() should not be used on a channel
+   *       while it plays a timeline.
+   * @param timelines The timelines, with the channels to play them on.
+   */
+  void play(const std::vector<ChannelTimeline> &timelines) {
+    if (!sequencer_) {
+      using namespace std::placeholders;
+      sequencer_ = std::make_unique<LedSequencer>(LedSequencer::Config{
+          .num_channels = channels_.size(),
+          .max_raw_duty = max_raw_duty_,
+          .start_fade = std::bind(&Led::start_fade, this, _1, _2, _3),
+          .task_config = sequencer_task_config_,
+          .log_level = get_log_level(),
+      });
+      isr_sequencer_ = sequencer_.get();
+    }
+    std::vector<LedSequencer::Timeline> indexed(channels_.size());
+    for (const auto &t : timelines) {
+      int index = get_channel_index(t.channel);
+      if (index == -1) {
+        continue;
+      }
+      indexed[index] = t.timeline;
+      // wait for the current fade of the channel to end, so that its end
+      // does not advance the new timeline
+      stop_channel(index);
+    }
+    sequencer_->play(indexed);
+  }
+
+  /**
+   * @brief Stop playing the timelines. The fades in progress complete.
+   */
+  void stop_sequence() {
+    if (sequencer_) {
+      sequencer_->stop();
+    }
+  }
+
+  /**
+   * @brief Whether a timeline is playing on the channel.
+   * @param channel The channel to check.
+   * @return True if the channel plays a timeline which has not ended.
+   */
+  bool is_playing(ledc_channel_t channel) const {
+    int index = get_channel_index(channel);
+    return index != -1 && sequencer_ && sequencer_->is_playing(index);
+  }
+
+  /**
+   * @brief Get the number of times the sequencer task woke up, which is
+   *        at most once per fade end, e.g. to measure the CPU use of the
+   *        timelines.
+   * @return The number of wakeups, 0 if play() was never called.
+   */
+  size_t get_num_sequencer_wakeups() const {
+    return sequencer_ ? sequencer_->get_num_wakeups() : 0;
+  }
+
 protected:
+  struct FadeCallbackArg {
+    Led *led;
+    size_t index;
+  };
+
+  /**
+   * @brief Start a hardware fade to a raw duty cycle, for the sequencer.
+   * @param index Index of the channel in channels_.
+   * @param raw_duty The raw duty cycle to fade to.
+   * @param fade_time_ms The number of milliseconds for which to fade.
+   */
+  void start_fade(size_t index, uint32_t raw_duty, uint32_t fade_time_ms) {
+    const auto &conf = channels_[index];
+    // the fade end ISR gave the semaphore before notifying the sequencer
+    xSemaphoreTake(fade_semaphores_[index], portMAX_DELAY);
+    ledc_set_fade_with_time(conf.speed_mode, conf.channel, raw_duty, fade_time_ms);
+    ledc_fade_start(conf.speed_mode, conf.channel, LEDC_FADE_NO_WAIT);
+  }
+
+  /**
+   * @brief Stop the sequencer on the channel, and wait for its current fade
+   *        to end.
+   * @param index Index of the channel in channels_.
+   */
+  void stop_channel(size_t index) {
+    sequencer_->stop(index);
+    auto &sem = fade_semaphores_[index];
+    xSemaphoreTake(sem, portMAX_DELAY);
+    xSemaphoreGive(sem);
+  }
+
   /**
    * @brief Get the index of channel in channels_, -1 if not found.
    * @note We implement this instead of using std::find because we cannot use
@@ -230,18 +358,30 @@ protected:
    */
   static bool IRAM_ATTR cb_ledc_fade_end_event(const ledc_cb_param_t *param, void *user_arg) {
     portBASE_TYPE taskAwoken = pdFALSE;
+    bool sequencerAwoken = false;
 
     if (param->event == LEDC_FADE_END_EVT) {
-      SemaphoreHandle_t sem = (SemaphoreHandle_t)user_arg;
+      auto arg = (FadeCallbackArg *)user_arg;
+      // notify the sequencer before giving the semaphore, so that the end of
+      // this fade is seen by anyone who takes the semaphore afterwards
+      LedSequencer *sequencer = arg->led->isr_sequencer_;
+      if (sequencer) {
+        sequencerAwoken = sequencer->fade_ended(arg->index);
+      }
+      SemaphoreHandle_t sem = arg->led->fade_semaphores_[arg->index];
       xSemaphoreGiveFromISR(sem, &taskAwoken);
     }
 
-    return (taskAwoken == pdTRUE);
+    return (taskAwoken == pdTRUE) || sequencerAwoken;
   }
 
   ledc_timer_bit_t duty_resolution_;
   uint32_t max_raw_duty_;
   std::vector<SemaphoreHandle_t> fade_semaphores_;
+  std::vector<FadeCallbackArg> fade_callback_args_;
+  Task::BaseConfig sequencer_task_config_;
   std::vector<ChannelConfig> channels_;
+  std::unique_ptr<LedSequencer> sequencer_;
+  std::atomic<LedSequencer *> isr_sequencer_{nullptr};
 };
 } // namespace espp
@@ -0,0 +1,426 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#if defined(ESP_PLATFORM)
+#include <esp_attr.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#else
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+#endif
+
+#include "base_component.hpp"
+#include "task.hpp"
+
+namespace espp {
+/**
+ * @brief Plays keyframe timelines on multiple LED channels as chains of
+ *        hardware fades.
+ *
+ * @details Each timeline is compiled when it is played into a list of linear
+ *          fades of the raw duty, which follow the brightness curve of the
+ *          timeline (e.g. gamma corrected) to within
+ *          Config::max_error. The first fade of each channel is started by
+ *          play(), and each following fade when the backend reports the end
+ *          of the previous one with fade_ended(), which is safe to call from
+ *          the fade end ISR. A single task starts the next fade of every
+ *          channel whose fade ended, so the CPU only wakes up at the fade
+ *          boundaries, instead of periodically for each channel.
+ *
+ *          The backend starts the fades: espp::Led provides one for the LEDC
+ *          peripheral (see Led::play()), and espp::LedWaveformRecorder one
+ *          which records the waveform on the host.
+ *
+ * \section led_sequencer_ex1 Led Sequencer Example
+ * \snippet led_example.cpp led sequencer example
+ */
+class LedSequencer : public BaseComponent {
+public:
+  /**
+   * @brief Maps the brightness of the keyframes to the duty cycle.
+   */
+  enum class Curve {
+    LINEAR,  ///< The duty cycle is the brightness.
+    GAMMA,   ///< The duty cycle is the brightness to the power of Timeline::gamma.
+    CIE1931, ///< The brightness is the CIE 1931 lightness (L*) of the duty cycle.
+  };
+
+  /**
+   * @brief The brightness of a channel at a point in its timeline.
+   */
+  struct Keyframe {
+    uint32_t time_ms{0};    ///< Time from the start of the timeline (ms).
+    float brightness{0.0f}; ///< Brightness (%) [0, 100], mapped to the duty cycle by the curve.
+  };
+
+  /**
+   * @brief The keyframes of a channel. The brightness is interpolated
+   *        linearly between the keyframes, and then mapped to the duty cycle.
+   */
+  struct Timeline {
+    std::vector<Keyframe> keyframes{}; ///< Keyframes, in order of time.
+    Curve curve{Curve::GAMMA};         ///< Mapping of the brightness to the duty cycle.
+    float gamma{2.2f};                 ///< Exponent of Curve::GAMMA.
+    bool repeat{true}; ///< Whether to start over after the last keyframe. If the brightness of
+                       ///< the first and last keyframes differs, it goes back to the first one
+                       ///< in a fade of Config::min_fade_time_ms.
+  };
+
+  /**
+   * @brief A linear hardware fade.
+   */
+  struct Fade {
+    uint32_t raw_duty;     ///< Raw duty cycle to fade to.
+    uint32_t fade_time_ms; ///< Duration of the fade (ms).
+  };
+
+  /**
+   * @brief Starts a hardware fade on a channel, from its current duty cycle.
+   * @param channel Index of the channel.
+   * @param raw_duty Raw duty cycle to fade to.
+   * @param fade_time_ms Duration of the fade (ms).
+   */
+  typedef std::function<void(size_t channel, uint32_t raw_duty, uint32_t fade_time_ms)>
+      start_fade_fn;
+
+  /**
+   * @brief Configuration of the LedSequencer.
+   */
+  struct Config {
+    size_t num_channels;      ///< Number of channels, up to 32.
+    uint32_t max_raw_duty;    ///< Raw duty cycle of 100%.
+    start_fade_fn start_fade; ///< Starts a hardware fade on a channel.
+    float max_error{0.5f};    ///< Maximum difference (% of full scale) between the fades and
+                              ///< the curve of a timeline.
+    uint32_t min_fade_time_ms{10}; ///< Fades are not split into fades shorter than this.
+    Task::BaseConfig task_config{
+        .name = "LedSequencer",
+        .stack_size_bytes = 3 * 1024,
+        .priority = 10}; ///< Configuration of the task starting the fades.
+    Logger::Verbosity log_level{Logger::Verbosity::WARN}; ///< Log verbosity.
+  };
+
+  /**
+   * @brief Construct the LedSequencer and start its task.
+   * @param config Configuration of the LedSequencer.
+   */
+  explicit LedSequencer(const Config &config)
+      : BaseComponent("LedSequencer", config.log_level)
+      , max_raw_duty_(config.max_raw_duty)
+      , max_error_(config.max_error)
+      , min_fade_time_ms_(std::max<uint32_t>(config.min_fade_time_ms, 1))
+      , start_fade_(config.start_fade)
+      , channels_(std::min<size_t>(config.num_channels, 32)) {
+    using namespace std::placeholders;
+    task_ = Task::make_unique(Task::AdvancedConfig{
+        .callback = std::bind(&LedSequencer::task_fn, this, _1, _2),
+        .task_config = config.task_config,
+        .log_level = config.log_level,
+    });
+    task_->start();
+#if defined(ESP_PLATFORM)
+    // the fade end ISR notifies the task by its handle, so it must be known
+    // before play() starts any fade
+    std::unique_lock<std::mutex> lock(mutex_);
+    task_ready_cv_.wait(lock, [this] { return task_handle_.load() != nullptr; });
+#endif
+  }
+
+  /**
+   * @brief Stop the task. The fades in progress are not stopped.
+   */
+  ~LedSequencer() {
+    stopping_ = true;
+    wake();
+    task_.reset();
+  }
+
+  /**
+   * @brief Compile a timeline into a list of hardware fades.
+   * @param timeline The timeline.
+   * @param max_raw_duty Raw duty cycle of 100%.
+   * @param max_error Maximum difference (% of full scale) between the fades
+   *        and the curve of the timeline.
+   * @param min_fade_time_ms Fades are not split into fades shorter than this.
+   * @return The fades, starting with a fade of \p min_fade_time_ms to the
+   *         first keyframe. Empty if the timeline has no keyframes.
+   */
+  static std::vector<Fade> compile(const Timeline &timeline, uint32_t max_raw_duty,
+                                   float max_error = 0.5f, uint32_t min_fade_time_ms = 10) {
+    std::vector<Fade> fades;
+    const auto &keyframes = timeline.keyframes;
+    if (keyframes.empty()) {
+      return fades;
+    }
+    min_fade_time_ms = std::max<uint32_t>(min_fade_time_ms, 1);
+    float tolerance = max_error / 100.0f * max_raw_duty;
+    auto raw = [&](float brightness) { return to_raw_duty(timeline, brightness, max_raw_duty); };
+    fades.push_back({raw(keyframes[0].brightness), min_fade_time_ms});
+    for (size_t i = 1; i < keyframes.size(); i++) {
+      const auto &from = keyframes[i - 1];
+      const auto &to = keyframes[i];
+      uint32_t duration = to.time_ms > from.time_ms ? to.time_ms - from.time_ms : 0;
+      if (duration < min_fade_time_ms) {
+        // a step
+        fades.push_back({raw(to.brightness), min_fade_time_ms});
+        continue;
+      }
+      auto brightness_at = [&](uint32_t t) {
+        return from.brightness + (to.brightness - from.brightness) * t / duration;
+      };
+      split(0, duration, raw(from.brightness), raw(to.brightness), brightness_at, raw, tolerance,
+            min_fade_time_ms, fades);
+    }
+    return fades;
+  }
+
+  /**
+   * @brief Map a brightness to a raw duty cycle with the curve of a timeline.
+   * @param timeline The timeline whose curve to use.
+   * @param brightness Brightness (%) [0, 100].
+   * @param max_raw_duty Raw duty cycle of 100%.
+   * @return The raw duty cycle.
+   */
+  static uint32_t to_raw_duty(const Timeline &timeline, float brightness, uint32_t max_raw_duty) {
+    float x = std::clamp(brightness, 0.0f, 100.0f) / 100.0f;
+    float duty = x;
+    switch (timeline.curve) {
+    case Curve::GAMMA:
+      duty = std::pow(x, timeline.gamma);
+      break;
+    case Curve::CIE1931: {
+      float lightness = 100.0f * x;
+      duty = lightness <= 8.0f ? lightness / 903.3f : std::pow((lightness + 16.0f) / 116.0f, 3.0f);
+      break;
+    }
+    default:
+      break;
+    }
+    return std::lround(duty * max_raw_duty);
+  }
+
+  /**
+   * @brief Play timelines on the channels, starting their first fades.
+   * @details Channels without a timeline (or with an empty timeline) are
+   *          left alone, and keep playing their previous timeline if they
+   *          have one.
+   * @param timelines The timelines, indexed by channel.
+   * @note The backend must not report the end of a fade which was started
+   *       before this call on a channel which gets a new timeline. espp::Led
+   *       waits for the fades in progress to end first.
+   */
+  void play(const std::vector<Timeline> &timelines) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < std::min(timelines.size(), channels_.size()); i++) {
+      auto fades = compile(timelines[i], max_raw_duty_, max_error_, min_fade_time_ms_);
+      if (fades.empty()) {
+        continue;
+      }
+      auto &channel = channels_[i];
+      channel.fades = std::move(fades);
+      channel.repeat = timelines[i].repeat;
+      channel.index = 0;
+      channel.playing = true;
+      pending_ &= ~(1u << i);
+      num_fades_++;
+      start_fade_(i, channel.fades[0].raw_duty, channel.fades[0].fade_time_ms);
+    }
+  }
+
+  /**
+   * @brief Stop playing the timelines. The fades in progress are not
+   *        stopped.
+   */
+  void stop() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &channel : channels_) {
+      channel.playing = false;
+    }
+  }
+
+  /**
+   * @brief Stop playing the timeline on a channel. The fade in progress is
+   *        not stopped.
+   * @param channel Index of the channel.
+   */
+  void stop(size_t channel) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (channel < channels_.size()) {
+      channels_[channel].playing = false;
+    }
+  }
+
+  /**
+   * @brief Whether a timeline is playing on a channel.
+   * @param channel Index of the channel.
+   * @return True if the channel is playing a timeline which has not ended.
+   */
+  bool is_playing(size_t channel) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return channel < channels_.size() && channels_[channel].playing;
+  }
+
+  /**
+   * @brief Report the end of the fade on a channel, to start its next fade.
+   * @details Safe to call from an ISR (e.g. the fade end callback of the
+   *          LEDC driver).
+   * @param channel Index of the channel.
+   * @return True if a higher priority task was woken (on ESP, when called
+   *         from an ISR).
+   */
+  bool IRAM_ATTR fade_ended(size_t channel) {
+    pending_ |= 1u << channel;
+    return wake();
+  }
+
+  /**
+   * @brief Get the number of times the task woke up, which is at most once
+   *        per fade end.
+   * @return The number of wakeups.
+   */
+  size_t get_num_wakeups() const { return num_wakeups_; }
+
+  /**
+   * @brief Get the number of fades started since construction.
+   * @return The number of fades started.
+   */
+  size_t get_num_fades() const { return num_fades_; }
+
+protected:
+  struct Channel {
+    std::vector<Fade> fades;
+    size_t index{0};
+    bool repeat{false};
+    bool playing{false};
+  };
+
+  // split the fade from raw duty a at time t0 to b at t1 in two, until the
+  // fades are within the tolerance of the curve
+  template <typename BrightnessAt, typename Raw>
+  static void split(uint32_t t0, uint32_t t1, uint32_t a, uint32_t b,
+                    const BrightnessAt &brightness_at, const Raw &raw, float tolerance,
+                    uint32_t min_fade_time_ms, std::vector<Fade> &fades) {
+    uint32_t duration = t1 - t0;
+    float error = 0.0f;
+    for (int i = 1; i < 4; i++) {
+      uint32_t t = t0 + duration * i / 4;
+      float linear = a + (float(b) - float(a)) * (t - t0) / duration;
+      error = std::max(error, std::fabs(float(raw(brightness_at(t))) - linear));
+    }
+    uint32_t middle = t0 + duration / 2;
+    if (error <= tolerance || duration / 2 < min_fade_time_ms) {
+      fades.push_back({b, duration});
+      return;
+    }
+    uint32_t m = raw(brightness_at(middle));
+    split(t0, middle, a, m, brightness_at, raw, tolerance, min_fade_time_ms, fades);
+    split(middle, t1, m, b, brightness_at, raw, tolerance, min_fade_time_ms, fades);
+  }
+
+  bool IRAM_ATTR wake() {
+#if defined(ESP_PLATFORM)
+    TaskHandle_t task_handle = task_handle_.load();
+    if (!task_handle) {
+      return false;
+    }
+    if (xPortInIsrContext()) {
+      BaseType_t must_yield = pdFALSE;
+      vTaskNotifyGiveFromISR(task_handle, &must_yield);
+      return must_yield == pdTRUE;
+    }
+    xTaskNotifyGive(task_handle);
+#else
+    {
+      std::lock_guard<std::mutex> lock(wake_mutex_);
+      woken_ = true;
+    }
+    wake_cv_.notify_all();
+#endif
+    return false;
+  }
+
+  void wait() {
+#if defined(ESP_PLATFORM)
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+#else
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    wake_cv_.wait(lock, [this] { return woken_; });
+    woken_ = false;
+#endif
+  }
+
+  bool task_fn(std::mutex &m, std::condition_variable &cv) {
+#if defined(ESP_PLATFORM)
+    if (!task_handle_.load()) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task_handle_ = xTaskGetCurrentTaskHandle();
+      }
+      task_ready_cv_.notify_all();
+    }
+#endif
+    wait();
+    num_wakeups_++;
+    if (stopping_) {
+      return true;
+    }
+    uint32_t pending = pending_.exchange(0);
+    if (!pending) {
+      return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < channels_.size(); i++) {
+      auto &channel = channels_[i];
+      if (!(pending & (1u << i)) || !channel.playing) {
+        continue;
+      }
+      channel.index++;
+      if (channel.index == channel.fades.size()) {
+        if (!channel.repeat) {
+          channel.playing = false;
+          continue;
+        }
+        // skip the fade to the first keyframe if the duty is already there
+        bool at_start = channel.fades.size() > 1 &&
+                        channel.fades.back().raw_duty == channel.fades.front().raw_duty;
+        channel.index = at_start ? 1 : 0;
+      }
+      const auto &fade = channel.fades[channel.index];
+      num_fades_++;
+      start_fade_(i, fade.raw_duty, fade.fade_time_ms);
+    }
+    return false;
+  }
+
+  uint32_t max_raw_duty_;
+  float max_error_;
+  uint32_t min_fade_time_ms_;
+  start_fade_fn start_fade_;
+  mutable std::mutex mutex_;
+  std::vector<Channel> channels_;
+  std::atomic<uint32_t> pending_{0};
+  std::atomic<bool> stopping_{false};
+  std::atomic<size_t> num_wakeups_{0};
+  std::atomic<size_t> num_fades_{0};
+#if defined(ESP_PLATFORM)
+  std::atomic<TaskHandle_t> task_handle_{nullptr};
+  std::condition_variable task_ready_cv_;
+#else
+  std::mutex wake_mutex_;
+  std::condition_variable wake_cv_;
+  bool woken_{false};
+#endif
+  std::unique_ptr<Task> task_;
+};
+} // namespace espp
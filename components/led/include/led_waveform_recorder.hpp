@@ -0,0 +1,203 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace espp {
+/**
+ * @brief Host backend for the LedSequencer, which emulates the hardware
+ *        fades of the LEDC peripheral and records the duty cycle waveform
+ *        they produce, e.g. for tests.
+ *
+ * @details Each fade changes the raw duty linearly from the duty at its
+ *          start, and ends after its duration, when the fade end callback is
+ *          called (from the thread of the recorder) for each channel whose
+ *          fade ended. Starting a fade on a channel which is still fading
+ *          replaces the fade, without calling the callback for it.
+ */
+class LedWaveformRecorder {
+public:
+  /**
+   * @brief Called when the fade on a channel ends.
+   * @param channel Index of the channel.
+   */
+  typedef std::function<void(size_t channel)> fade_end_fn;
+
+  /**
+   * @brief A fade, as recorded.
+   */
+  struct Fade {
+    std::chrono::steady_clock::time_point start; ///< When the fade started.
+    uint32_t start_raw_duty;                     ///< Raw duty cycle at the start.
+    uint32_t raw_duty;                           ///< Raw duty cycle at the end.
+    std::chrono::milliseconds duration;          ///< Duration of the fade.
+  };
+
+  /**
+   * @brief Configuration of the LedWaveformRecorder.
+   */
+  struct Config {
+    size_t num_channels;          ///< Number of channels.
+    fade_end_fn on_fade_end;      ///< Called when the fade on a channel ends.
+    uint32_t initial_raw_duty{0}; ///< Raw duty cycle of the channels before any fade.
+  };
+
+  /**
+   * @brief Construct the recorder and start its thread.
+   * @param config Configuration of the recorder.
+   */
+  explicit LedWaveformRecorder(const Config &config)
+      : on_fade_end_(config.on_fade_end)
+      , channels_(config.num_channels) {
+    for (auto &channel : channels_) {
+      channel.raw_duty = config.initial_raw_duty;
+    }
+    thread_ = std::thread([this] { run(); });
+  }
+
+  /**
+   * @brief Stop the thread. No more fade end callbacks are called.
+   */
+  ~LedWaveformRecorder() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      done_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+  }
+
+  /**
+   * @brief Start a fade on a channel, from its current duty cycle. Matches
+   *        LedSequencer::start_fade_fn.
+   * @param channel Index of the channel.
+   * @param raw_duty Raw duty cycle to fade to.
+   * @param fade_time_ms Duration of the fade (ms).
+   */
+  void start_fade(size_t channel, uint32_t raw_duty, uint32_t fade_time_ms) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (channel >= channels_.size()) {
+        return;
+      }
+      auto now = std::chrono::steady_clock::now();
+      auto &state = channels_[channel];
+      Fade fade{now, duty_at(state, now), raw_duty, std::chrono::milliseconds(fade_time_ms)};
+      state.fades.push_back(fade);
+      state.raw_duty = raw_duty;
+      state.fading = true;
+    }
+    cv_.notify_all();
+  }
+
+  /**
+   * @brief Get the raw duty cycle of a channel at a point in time.
+   * @param channel Index of the channel.
+   * @param time The point in time.
+   * @return The raw duty cycle produced by the recorded fades.
+   */
+  uint32_t get_raw_duty(size_t channel, std::chrono::steady_clock::time_point time) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return channel < channels_.size() ? duty_at(channels_[channel], time) : 0;
+  }
+
+  /**
+   * @brief Get the recorded fades of a channel.
+   * @param channel Index of the channel.
+   * @return The fades, in the order they were started.
+   */
+  std::vector<Fade> get_fades(size_t channel) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return channel < channels_.size() ? channels_[channel].fades : std::vector<Fade>{};
+  }
+
+  /**
+   * @brief Sample the recorded waveform of a channel.
+   * @param channel Index of the channel.
+   * @param start When to start sampling.
+   * @param period Time between the samples.
+   * @param num_samples Number of samples.
+   * @return The raw duty cycle at each sample.
+   */
+  std::vector<uint32_t> sample(size_t channel, std::chrono::steady_clock::time_point start,
+                               std::chrono::steady_clock::duration period,
+                               size_t num_samples) const {
+    std::vector<uint32_t> samples;
+    samples.reserve(num_samples);
+    for (size_t i = 0; i < num_samples; i++) {
+      samples.push_back(get_raw_duty(channel, start + i * period));
+    }
+    return samples;
+  }
+
+protected:
+  struct Channel {
+    std::vector<Fade> fades;
+    uint32_t raw_duty{0}; // duty before any fade, or at the end of the last fade
+    bool fading{false};
+  };
+
+  static std::chrono::steady_clock::time_point end_of(const Fade &fade) {
+    return fade.start + fade.duration;
+  }
+
+  static uint32_t duty_at(const Channel &channel, std::chrono::steady_clock::time_point time) {
+    // the last fade started before the time
+    auto it = std::upper_bound(channel.fades.begin(), channel.fades.end(), time,
+                               [](auto t, const Fade &fade) { return t < fade.start; });
+    if (it == channel.fades.begin()) {
+      return channel.fades.empty() ? channel.raw_duty : channel.fades.front().start_raw_duty;
+    }
+    const auto &fade = *(it - 1);
+    if (time >= end_of(fade) || fade.duration.count() == 0) {
+      return fade.raw_duty;
+    }
+    float t = std::chrono::duration<float>(time - fade.start) /
+              std::chrono::duration<float>(fade.duration);
+    return std::lround(fade.start_raw_duty + (float(fade.raw_duty) - fade.start_raw_duty) * t);
+  }
+
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!done_) {
+      auto now = std::chrono::steady_clock::now();
+      auto next = now + std::chrono::seconds(1);
+      std::vector<size_t> ended;
+      for (size_t i = 0; i < channels_.size(); i++) {
+        auto &channel = channels_[i];
+        if (!channel.fading) {
+          continue;
+        }
+        auto end = end_of(channel.fades.back());
+        if (end <= now) {
+          channel.fading = false;
+          ended.push_back(i);
+        } else {
+          next = std::min(next, end);
+        }
+      }
+      if (!ended.empty()) {
+        lock.unlock();
+        for (auto i : ended) {
+          on_fade_end_(i);
+        }
+        lock.lock();
+        continue;
+      }
+      cv_.wait_until(lock, next);
+    }
+  }
+
+  fade_end_fn on_fade_end_;
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<Channel> channels_;
+  bool done_{false};
+  std::thread thread_;
+};
+} // namespace espp
@@ -9,6 +9,7 @@
 
 #include "base_component.hpp"
 #include "color.hpp"
+#include "inplace_function.hpp"
 
 namespace espp {
 /// \brief Class to control LED strips
@@ -47,7 +48,7 @@ public:
   /// \note The data is guaranteed to be in the order of the bytes
   /// in the strip (i.e. the first byte in the data is the first
   /// byte in the strip).
-  typedef std::function<void(const uint8_t *data, size_t length)> write_fn;
+  typedef InplaceFunction<void(const uint8_t *data, size_t length)> write_fn;
 
   /// \brief Byte order for the LEDs
   enum class ByteOrder {
@@ -9,6 +9,7 @@
 #include <esp_timer.h>
 #endif
 
+#include "clock.hpp"
 #include "format.hpp"
 
 namespace espp {
@@ -204,7 +205,7 @@ public:
     if (level_ > Verbosity::DEBUG)
       return;
     if (rate_limit_ > std::chrono::duration<float>::zero()) {
-      auto now = std::chrono::high_resolution_clock::now();
+      auto now = Clock::now();
       if (now - last_print_ < rate_limit_)
         return;
       last_print_ = now;
@@ -224,7 +225,7 @@ public:
     if (level_ > Verbosity::INFO)
       return;
     if (rate_limit_ > std::chrono::duration<float>::zero()) {
-      auto now = std::chrono::high_resolution_clock::now();
+      auto now = Clock::now();
       if (now - last_print_ < rate_limit_)
         return;
       last_print_ = now;
@@ -244,7 +245,7 @@ public:
     if (level_ > Verbosity::WARN)
       return;
     if (rate_limit_ > std::chrono::duration<float>::zero()) {
-      auto now = std::chrono::high_resolution_clock::now();
+      auto now = Clock::now();
       if (now - last_print_ < rate_limit_)
         return;
       last_print_ = now;
@@ -264,7 +265,7 @@ public:
     if (level_ > Verbosity::ERROR)
       return;
     if (rate_limit_ > std::chrono::duration<float>::zero()) {
-      auto now = std::chrono::high_resolution_clock::now();
+      auto now = Clock::now();
       if (now - last_print_ < rate_limit_)
         return;
       last_print_ = now;
@@ -277,14 +278,20 @@ protected:
   /**
    *   Start time for the logging system.
    */
-  static std::chrono::steady_clock::time_point start_time_;
+  static Clock::time_point start_time_;
 
   /**
    *   Get the current time in seconds since the start of the logging system.
+   *   @note When simulated time is enabled (see Clock::set_simulated()), the
+   *         simulated time is used on all platforms.
    *   @return time in seconds since the start of the logging system.
    */
   static std::string get_time() {
 #if defined(ESP_PLATFORM)
+    if (Clock::is_simulated()) {
+      auto seconds = std::chrono::duration<float>(Clock::now() - start_time_).count();
+      return fmt::format("{:.3f}", seconds);
+    }
     // use esp_timer_get_time to get the time in microseconds
     uint64_t time = esp_timer_get_time();
     uint64_t seconds = time / 1e6f;
@@ -293,7 +300,7 @@ protected:
 #else
     // get the elapsed time since the start of the logging system as floating
     // point seconds
-    auto now = std::chrono::steady_clock::now();
+    auto now = Clock::now();
     auto seconds = std::chrono::duration<float>(now - start_time_).count();
     return fmt::format("{:.3f}", seconds);
 #endif
@@ -318,7 +325,7 @@ protected:
   /**
    *   Last time a log was printed. Used for rate limiting.
    */
-  std::chrono::high_resolution_clock::time_point last_print_{};
+  Clock::time_point last_print_{};
 
   /**
    *   Whether to include the time in the log.
@@ -2,4 +2,4 @@
 
 using namespace espp;
 
-std::chrono::steady_clock::time_point Logger::start_time_ = std::chrono::steady_clock::now();
+Clock::time_point Logger::start_time_ = Clock::now();
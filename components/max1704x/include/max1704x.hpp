@@ -17,7 +17,7 @@ namespace espp {
  * @section max1704x_ex1 MAX1704X Example
  * @snippet max1704x_example.cpp max1704x example
  */
-class Max1704x : public BasePeripheral<> {
+class Max1704x : public BasePeripheral<std::uint8_t, true, peripheral_lock::Configurable> {
 public:
   static constexpr uint8_t DEFAULT_ADDRESS = 0x36; ///< Default address of the MAX1704x.
 
@@ -37,6 +37,10 @@ public:
     BasePeripheral::write_fn write;          //< Function to write bytes to the device.
     BasePeripheral::read_fn read;            //< Function to read bytes from the device.
     bool auto_init{true};                    ///< Whether to automatically initialize the MAX1704x.
+    peripheral_lock::Mode lock_mode{
+        peripheral_lock::Mode::MUTEX}; ///< How register access is locked, see espp::peripheral_lock.
+    std::recursive_mutex *bus_mutex{nullptr}; ///< Bus mutex for peripheral_lock::Mode::BUS, e.g.
+                                              ///< espp::I2c::get_mutex().
     Logger::Verbosity log_level{Logger::Verbosity::WARN}; ///< Log level for the MAX1704x.
   };
 
@@ -48,6 +52,7 @@ public:
       : BasePeripheral(
             {.address = config.device_address, .write = config.write, .read = config.read},
             "Max1704x", config.log_level) {
+    set_lock_mode(config.lock_mode, config.bus_mutex);
     if (config.auto_init) {
       std::error_code ec;
       initalize(ec);
@@ -61,7 +66,7 @@ public:
    * @brief Initialize the MAX1704x.
    */
   void initalize(std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::lock_guard lock(base_mutex_);
     // Get the IC version
     version_ = get_version(ec);
     if (ec) {
@@ -82,7 +87,7 @@ public:
    * @return The IC version.
    */
   uint16_t get_version(std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::lock_guard lock(base_mutex_);
     uint16_t data = read_u16_from_register((uint8_t)Register::VERSION, ec);
     if (ec) {
       return 0;
@@ -97,7 +102,7 @@ public:
    * @return The chip ID.
    */
   uint8_t get_chip_id(std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::lock_guard lock(base_mutex_);
     uint16_t data = read_u16_from_register((uint8_t)Register::CHIPID, ec);
     if (ec) {
       return 0;
@@ -112,7 +117,7 @@ public:
    * @return The battery voltage in V.
    */
   float get_battery_voltage(std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::lock_guard lock(base_mutex_);
     uint16_t data = read_u16_from_register((uint8_t)Register::VCELL, ec);
     if (ec) {
       return 0;
@@ -128,7 +133,7 @@ public:
    * @return The battery state of charge in %.
    */
   float get_battery_percentage(std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::lock_guard lock(base_mutex_);
     uint16_t data = read_u16_from_register((uint8_t)Register::SOC, ec);
     if (ec) {
       return 0;
@@ -146,7 +151,7 @@ public:
    * @return The battery charge or discharge rate in %/hr.
    */
   float get_battery_charge_rate(std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::lock_guard lock(base_mutex_);
     int16_t data = read_u16_from_register((uint8_t)Register::CRATE, ec);
     if (ec) {
       return 0;
@@ -162,7 +167,7 @@ public:
    * @return The battery alert status as an AlertStatus.
    */
   AlertStatus get_alert_status(std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::lock_guard lock(base_mutex_);
     uint16_t data = read_u16_from_register((uint8_t)Register::STATUS, ec);
     if (ec) {
       return AlertStatus::SOC_CHANGE;
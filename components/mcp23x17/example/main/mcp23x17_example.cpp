@@ -3,6 +3,7 @@
 #include <vector>
 
 #include "i2c.hpp"
+#include "interrupt.hpp"
 #include "mcp23x17.hpp"
 #include "task.hpp"
 
@@ -93,6 +94,68 @@ extern "C" void app_main(void) {
     }
   }
 
+  {
+    std::atomic<bool> quit_test = false;
+    fmt::print("Starting mcp23x17 change detection example, press button on B7 quit!\n");
+    //! [mcp23x17 change detection example]
+    espp::I2c i2c({
+        .port = I2C_NUM_0,
+        .sda_io_num = (gpio_num_t)CONFIG_EXAMPLE_I2C_SDA_GPIO,
+        .scl_io_num = (gpio_num_t)CONFIG_EXAMPLE_I2C_SCL_GPIO,
+    });
+    espp::Mcp23x17 mcp23x17(
+        {.port_0_direction_mask = (1 << 0), // input on A0
+         .port_1_direction_mask = (1 << 7), // input on B7
+         .write = std::bind(&espp::I2c::write, &i2c, std::placeholders::_1, std::placeholders::_2,
+                            std::placeholders::_3),
+         .read_register =
+             std::bind(&espp::I2c::read_at_register, &i2c, std::placeholders::_1,
+                       std::placeholders::_2, std::placeholders::_3, std::placeholders::_4),
+         .log_level = espp::Logger::Verbosity::WARN});
+    std::error_code ec;
+    mcp23x17.set_pull_up(espp::Mcp23x17::Port::PORT0, (1 << 0), ec);
+    mcp23x17.set_pull_up(espp::Mcp23x17::Port::PORT1, (1 << 7), ec);
+    // the pins are only read when the INT pin (active low) signals a change,
+    // and the callback gets the debounced changes
+    mcp23x17.enable_change_detection(
+        {
+            .mask = (1 << 0) | (1 << 15), // A0 and B7
+            .debounce_time = 20ms,
+            .callback =
+                [&](const espp::PinChangeDetector::Event &event) {
+                  fmt::print("pins: {:#06x}, changed: {:#06x}\n", event.pins, event.changed);
+                  quit_test = !(event.pins & (1 << 15));
+                },
+        },
+        ec);
+    if (ec) {
+      fmt::print("enable_change_detection failed: {}\n", ec.message());
+    }
+    espp::Interrupt interrupt({
+        .interrupts = {{
+            .gpio_num = CONFIG_EXAMPLE_INT_GPIO,
+            .callback =
+                [&](const auto &event) {
+                  std::error_code ec;
+                  mcp23x17.handle_interrupt(ec);
+                },
+            .active_level = espp::Interrupt::ActiveLevel::LOW,
+            .interrupt_type = espp::Interrupt::Type::FALLING_EDGE,
+            .pullup_enabled = true,
+        }},
+        .task_config =
+            {
+                .name = "Mcp23x17 INT",
+                .stack_size_bytes = 4 * 1024,
+                .priority = 5,
+            },
+    });
+    //! [mcp23x17 change detection example]
+    while (!quit_test) {
+      std::this_thread::sleep_for(100ms);
+    }
+  }
+
   fmt::print("Mcp23x17 example complete!\n");
 
   while (true) {
@@ -1,16 +1,27 @@
 #pragma once
 
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
 
 #include "base_peripheral.hpp"
+#include "pin_change_detector.hpp"
 
 namespace espp {
 /**
  * Class for communicating with and controlling a MCP23X17 (23017, 23S17) GPIO
  * expander including interrupt configuration.
  *
+ * Instead of polling the pins, the expander can signal changes on its INT
+ * pin (see enable_change_detection()): each INT edge is handled with a single
+ * burst read, get_pins() is served from the last read, and debounced changes
+ * are delivered to a callback.
+ *
  * \section mcp23x17_ex1 MCP23x17 Example
  * \snippet mcp23x17_example.cpp mcp23x17 example
+ * \section mcp23x17_ex2 MCP23x17 Change Detection Example
+ * \snippet mcp23x17_example.cpp mcp23x17 change detection example
  */
 class Mcp23x17 : public BasePeripheral<> {
 public:
@@ -42,6 +53,12 @@ public:
     Logger::Verbosity log_level{Logger::Verbosity::WARN}; ///< Log verbosity for the component.
   };
 
+  /// Interrupt configuration from before enable_change_detection()
+  struct InterruptConfig {
+    uint8_t registers[6]{}; ///< GPINTENA, GPINTENB, DEFVALA, DEFVALB, INTCONA, INTCONB
+    uint8_t iocon{0};       ///< IOCON
+  };
+
   /**
    * @brief Construct the Mcp23x17 and configure it.
    * @param config Config structure for configuring the MCP23X17
@@ -77,8 +94,17 @@ public:
    * @param port The Port for which to read the pins
    * @param ec Error code to set if there is an error.
    * @return The pin values as an 8 bit mask.
+   * @note With change detection enabled, the pins are not read from the
+   *       device, but from the last read of handle_interrupt().
    */
   uint8_t get_pins(Port port, std::error_code &ec) {
+    {
+      std::lock_guard<std::mutex> lock(detector_mutex_);
+      if (detector_) {
+        auto pins = detector_->get_pins();
+        return port == Port::PORT0 ? (pins & 0xFF) : (pins >> 8);
+      }
+    }
     auto addr = port == Port::PORT0 ? Registers::GPIOA : Registers::GPIOB;
     auto val = read_u8_from_register((uint8_t)addr, ec);
     if (ec) {
@@ -92,8 +118,16 @@ public:
    * @brief Read the pin values on both Port A and Port B.
    * @param ec Error code to set if an error occurs.
    * @return The pin values as a 16 bit mask (PA_0 lsb, PB_7 msb).
+   * @note With change detection enabled, the pins are not read from the
+   *       device, but from the last read of handle_interrupt().
    */
   uint16_t get_pins(std::error_code &ec) {
+    {
+      std::lock_guard<std::mutex> lock(detector_mutex_);
+      if (detector_) {
+        return detector_->get_pins();
+      }
+    }
     uint16_t p0 = read_u8_from_register((uint8_t)Registers::GPIOA, ec);
     if (ec)
       return 0;
@@ -229,9 +263,9 @@ public:
     }
     logger_.debug("Read config: {}", config);
     if (mirror) {
-      config &= (1 << (int)ConfigBit::MIRROR);
+      config |= (1 << (int)ConfigBit::MIRROR);
     } else {
-      config ^= (1 << (int)ConfigBit::MIRROR);
+      config &= ~(1 << (int)ConfigBit::MIRROR);
     }
     // now write it back
     logger_.debug("Writing new config: {}", config);
@@ -254,15 +288,127 @@ public:
     }
     logger_.debug("Read config: {}", config);
     if (active_high) {
-      config &= (1 << (int)ConfigBit::INTPOL);
+      config |= (1 << (int)ConfigBit::INTPOL);
     } else {
-      config ^= (1 << (int)ConfigBit::INTPOL);
+      config &= ~(1 << (int)ConfigBit::INTPOL);
     }
     // now write it back
     logger_.debug("Writing new config: {}", config);
     write_u8_to_register(addr, config, ec);
   }
 
+  /**
+   * @brief Detect changes of the pins with the INT pin instead of polling.
+   * @details Configures the pins in \p config.mask to interrupt on change
+   *          (compared to their previous value) and mirrors the INT pins, so
+   *          that either INT pin signals changes on both ports. Call
+   *          handle_interrupt() on the active edge of the INT pin (e.g. from
+   *          an espp::Interrupt callback). From then on, get_pins() returns
+   *          the pins as last read by handle_interrupt(), and \p
+   *          config.callback is called with each debounced change. The
+   *          previous interrupt configuration (GPINTEN, DEFVAL, INTCON, and
+   *          IOCON) is restored by disable_change_detection().
+   * @param config Configuration of the change detection.
+   * @param ec Error code to set if there is an error.
+   */
+  void enable_change_detection(const PinChangeDetector::Config &config, std::error_code &ec) {
+    reset_detector();
+    if (!saved_interrupt_config_) {
+      InterruptConfig saved;
+      read_many_from_register((uint8_t)Registers::GPINTENA, saved.registers,
+                              sizeof(saved.registers), ec);
+      if (ec) {
+        logger_.error("Failed to read interrupt config: {}", ec.message());
+        return;
+      }
+      saved.iocon = read_u8_from_register((uint8_t)Registers::IOCON, ec);
+      if (ec) {
+        logger_.error("Failed to read config: {}", ec.message());
+        return;
+      }
+      saved_interrupt_config_ = saved;
+    }
+    set_interrupt_mirror(true, ec);
+    if (ec) {
+      return;
+    }
+    // GPINTENA, GPINTENB, DEFVALA, DEFVALB, INTCONA, INTCONB are sequential,
+    // so they are configured in a single write (INTCON = 0 compares the pins
+    // against their previous value, so DEFVAL is unused)
+    const uint8_t data[] = {uint8_t(config.mask & 0xFF), uint8_t(config.mask >> 8), 0, 0, 0, 0};
+    write_many_to_register((uint8_t)Registers::GPINTENA, data, sizeof(data), ec);
+    if (ec) {
+      logger_.error("Failed to enable interrupt on change: {}", ec.message());
+      return;
+    }
+    // reading the pins also clears any pending interrupt
+    uint8_t pins[2];
+    read_many_from_register((uint8_t)Registers::GPIOA, pins, sizeof(pins), ec);
+    if (ec) {
+      logger_.error("Failed to read pins: {}", ec.message());
+      return;
+    }
+    auto detector = std::make_unique<PinChangeDetector>(config, (pins[1] << 8) | pins[0]);
+    std::lock_guard<std::mutex> lock(detector_mutex_);
+    detector_ = std::move(detector);
+  }
+
+  /**
+   * @brief Stop detecting changes of the pins, see enable_change_detection().
+   * @details Restores the interrupt configuration from before
+   *          enable_change_detection().
+   * @param ec Error code to set if there is an error.
+   */
+  void disable_change_detection(std::error_code &ec) {
+    reset_detector();
+    if (!saved_interrupt_config_) {
+      return;
+    }
+    const auto &saved = *saved_interrupt_config_;
+    write_many_to_register((uint8_t)Registers::GPINTENA, saved.registers, sizeof(saved.registers),
+                           ec);
+    if (ec) {
+      logger_.error("Failed to restore interrupt config: {}", ec.message());
+      return;
+    }
+    write_u8_to_register((uint8_t)Registers::IOCON, saved.iocon, ec);
+    if (ec) {
+      logger_.error("Failed to restore config: {}", ec.message());
+      return;
+    }
+    saved_interrupt_config_.reset();
+  }
+
+  /**
+   * @brief Read the pins which changed, when the INT pin signals a change.
+   * @details Reads INTF, INTCAP, and GPIO of both ports in a single burst,
+   *          which also clears the interrupt. The captured state of the pins
+   *          which caused the interrupt is passed to the debouncing before
+   *          the current state, so short pulses still restart the debounce
+   *          time.
+   * @param ec Error code to set if there is an error.
+   * @note Change detection must be enabled, see enable_change_detection().
+   */
+  void handle_interrupt(std::error_code &ec) {
+    std::lock_guard<std::mutex> lock(detector_mutex_);
+    if (!detector_) {
+      ec = std::make_error_code(std::errc::operation_not_permitted);
+      return;
+    }
+    // INTFA, INTFB, INTCAPA, INTCAPB, GPIOA, GPIOB
+    uint8_t data[6];
+    read_many_from_register((uint8_t)Registers::INTFA, data, sizeof(data), ec);
+    if (ec) {
+      logger_.error("Failed to read interrupt state: {}", ec.message());
+      return;
+    }
+    uint16_t flags = (data[1] << 8) | data[0];
+    uint16_t captured = (data[3] << 8) | data[2];
+    uint16_t pins = (data[5] << 8) | data[4];
+    detector_->update((detector_->get_pins() & ~flags) | (captured & flags));
+    detector_->update(pins);
+  }
+
 protected:
   /**
    * @brief Register map for the MT23X17
@@ -315,6 +461,16 @@ protected:
               ///< associated with each port are separated into different banks
   };
 
+  void reset_detector() {
+    // the detector is destroyed without holding detector_mutex_, since
+    // stopping its task waits for the callback, which may call get_pins()
+    std::unique_ptr<PinChangeDetector> detector;
+    {
+      std::lock_guard<std::mutex> lock(detector_mutex_);
+      detector = std::move(detector_);
+    }
+  }
+
   void init(std::error_code &ec) {
     set_direction(Port::PORT0, port_0_direction_mask_, ec);
     if (ec)
@@ -332,5 +488,9 @@ protected:
   uint8_t port_0_interrupt_mask_;
   uint8_t port_1_direction_mask_;
   uint8_t port_1_interrupt_mask_;
+  std::mutex detector_mutex_; ///< Guards detector_, which handle_interrupt() uses from the
+                              ///< Interrupt task
+  std::unique_ptr<PinChangeDetector> detector_;
+  std::optional<InterruptConfig> saved_interrupt_config_;
 };
 } // namespace espp
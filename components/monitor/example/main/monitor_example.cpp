@@ -4,6 +4,7 @@
 
 #include "task.hpp"
 #include "task_monitor.hpp"
+#include "task_snapshot.hpp"
 
 // for doing work
 #include <math.h>
@@ -116,6 +117,49 @@ extern "C" void app_main(void) {
     //! [get_latest_info example]
   }
 
+  {
+    //! [TaskSnapshot example]
+    // create threads
+    auto start = std::chrono::high_resolution_clock::now();
+    auto task_fn = [&start](int task_id, auto &, auto &) {
+      auto now = std::chrono::high_resolution_clock::now();
+      auto seconds_since_start = std::chrono::duration<float>(now - start).count();
+      // do some work
+      float x = 2.0f * M_PI * sin(exp(task_id) * seconds_since_start);
+      // sleep
+      std::this_thread::sleep_for((10ms * std::abs(x)) + 1ms);
+      // don't want to stop the task
+      return false;
+    };
+    std::vector<std::unique_ptr<espp::Task>> tasks;
+    size_t num_tasks = 10;
+    tasks.resize(num_tasks);
+    for (size_t i = 0; i < num_tasks; i++) {
+      std::string task_name = fmt::format("Task {}", i);
+      auto task = espp::Task::make_unique({.name = task_name,
+                                           .callback = std::bind(task_fn, i, _1, _2),
+                                           .stack_size_bytes = 5 * 1024});
+      tasks[i] = std::move(task);
+      tasks[i]->start();
+    }
+    // the snapshot is large, so keep it off the stack; updating it does not
+    // allocate
+    static espp::TaskSnapshot<32> snapshot;
+    snapshot.update();
+    for (int i = 0; i < 3; i++) {
+      std::this_thread::sleep_for(1s);
+      snapshot.update();
+      fmt::print("Tasks over the last {} ms:\n",
+                 std::chrono::duration_cast<std::chrono::milliseconds>(snapshot.get_interval())
+                     .count());
+      for (const auto &t : snapshot) {
+        fmt::print("  {:16} {:5.1f}% stack high water mark {} B ({:+} B)\n", t.name,
+                   t.cpu_percent, t.high_water_mark, t.high_water_mark_change);
+      }
+    }
+    //! [TaskSnapshot example]
+  }
+
   fmt::print("Monitor example finished!\n");
 
   // sleep forever
@@ -7,6 +7,7 @@
 
 #include "base_component.hpp"
 #include "task.hpp"
+#include "task_snapshot.hpp"
 
 #include "esp_freertos_hooks.h"
 #include "freertos/FreeRTOS.h"
@@ -29,6 +30,13 @@ namespace espp {
  *     CONFIG_FREERTOS_VTASKLIST_INCLUDE_COREID. If you do not enable this
  *     option, the core id will be -2.
  *
+ *  @note The periodic log uses a TaskSnapshot, so the CPU % it logs is over
+ *     the last period, and logging does not allocate. The snapshot holds up
+ *     to CONFIG_ESPP_TASK_MONITOR_MAX_NUM_TASKS tasks; if there are more, an
+ *     error is logged and the log falls back to get_latest_info_string().
+ *     TaskSnapshot can also be used directly, instead of the
+ *     get_latest_info_*() functions which allocate strings for each task.
+ *
  * \section task_monitor_ex1 Basic Task Monitor Example
  * \snippet monitor_example.cpp TaskMonitor example
  *
@@ -40,6 +48,12 @@ namespace espp {
  */
 class TaskMonitor : public BaseComponent {
 public:
+  /**
+   * Maximum number of tasks in the snapshot used for the periodic log,
+   * configured by CONFIG_ESPP_TASK_MONITOR_MAX_NUM_TASKS.
+   */
+  static constexpr size_t MAX_NUM_TASKS = CONFIG_ESPP_TASK_MONITOR_MAX_NUM_TASKS;
+
   /**
    * Info structure for each task monitored.
    */
@@ -67,6 +81,7 @@ public:
       , period_(config.period) {
 #if CONFIG_FREERTOS_USE_TRACE_FACILITY && CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
     using namespace std::placeholders;
+    snapshot_ = std::make_unique<TaskSnapshot<MAX_NUM_TASKS>>();
     task_ = Task::make_unique({.name = "TaskMonitor Task",
                                .callback = std::bind(&TaskMonitor::task_callback, this, _1, _2),
                                .stack_size_bytes = config.task_stack_size_bytes});
@@ -230,8 +245,28 @@ public:
 protected:
   bool task_callback(std::mutex &m, std::condition_variable &cv) {
     auto start = std::chrono::high_resolution_clock::now();
-    // print out the monitor information
-    fmt::print("[TM]{}\n", get_latest_info_string());
+    // print out the monitor information, in the format of
+    // get_latest_info_string(), without building the string
+    if (snapshot_->update()) {
+      fmt::print("[TM]");
+      for (const auto &t : *snapshot_) {
+        if (t.cpu_percent >= 1.0f) {
+          fmt::print("{},{},{},{},{};", t.name, uint32_t(t.cpu_percent), t.high_water_mark,
+                     t.priority, t.core_id);
+        } else {
+          fmt::print("{},<1%,{},{},{};", t.name, t.high_water_mark, t.priority, t.core_id);
+        }
+      }
+      fmt::print("\n");
+    } else {
+      if (!logged_snapshot_error_) {
+        logger_.error("More than {} tasks, cannot take a TaskSnapshot; increase "
+                      "CONFIG_ESPP_TASK_MONITOR_MAX_NUM_TASKS to log without allocating",
+                      MAX_NUM_TASKS);
+        logged_snapshot_error_ = true;
+      }
+      fmt::print("[TM]{}\n", get_latest_info_string());
+    }
     // sleep until our period is up
     {
       std::unique_lock<std::mutex> lk(m);
@@ -242,6 +277,8 @@ protected:
   }
 
   std::chrono::duration<float> period_;
+  std::unique_ptr<TaskSnapshot<MAX_NUM_TASKS>> snapshot_;
+  bool logged_snapshot_error_{false};
   std::unique_ptr<Task> task_;
 };
 } // namespace espp
@@ -0,0 +1,330 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(ESP_PLATFORM)
+#include "sdkconfig.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace espp {
+/**
+ * @brief Stats of a task in a TaskSnapshot.
+ */
+struct TaskStats {
+#if defined(ESP_PLATFORM)
+  static constexpr size_t MAX_NAME_LENGTH = CONFIG_FREERTOS_MAX_TASK_NAME_LEN;
+#else
+  // Linux thread names are up to 15 characters
+  static constexpr size_t MAX_NAME_LENGTH = 16;
+#endif
+
+  uint32_t id;                    ///< FreeRTOS task number, or Linux thread id.
+  char name[MAX_NAME_LENGTH];     ///< Name of the task, null terminated.
+  float cpu_percent;              ///< % CPU time used since the previous snapshot.
+  uint64_t run_time_us;           ///< Total CPU time the task has used (us).
+  uint32_t high_water_mark;       ///< Stack high water mark (bytes), 0 on Linux.
+  int32_t high_water_mark_change; ///< Change of the high water mark since the previous
+                                  ///< snapshot, negative if the stack grew deeper.
+  uint32_t priority;              ///< Current priority of the task. On Linux, the real-time
+                                  ///< priority (0 for normal threads).
+  int core_id;                    ///< On FreeRTOS, the core the task is pinned to (-1 if not
+                                  ///< pinned, -2 if CONFIG_FREERTOS_VTASKLIST_INCLUDE_COREID is
+                                  ///< not set). On Linux, the core the thread last ran on.
+};
+
+/**
+ * @brief Structured snapshot of the tasks running in the system, in a fixed
+ *        capacity array. Each update() takes a new snapshot, with the CPU
+ *        usage of each task over the interval since the previous snapshot and
+ *        the change of its stack high water mark.
+ *
+ * @details Taking a snapshot does not allocate or format any strings: on
+ *          FreeRTOS it is filled directly from uxTaskGetSystemState(), and on
+ *          Linux from /proc/self/task/<tid>/stat, so it can be used to monitor
+ *          a process on the host as well. It is much cheaper than
+ *          TaskMonitor::get_latest_info_vector(), which allocates a name
+ *          string per task.
+ *
+ *          CPU usage is relative to a single core, as with the FreeRTOS run
+ *          time stats: a task which kept one core busy for the interval uses
+ *          100%.
+ *
+ * @note On FreeRTOS, this needs CONFIG_FREERTOS_USE_TRACE_FACILITY and
+ *       CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS, and \p MaxTasks must be at
+ *       least the number of tasks in the system.
+ *
+ * @note Run times are in microseconds, which is the unit of the FreeRTOS run
+ *       time counter with the default CONFIG_FREERTOS_RUN_TIME_COUNTER_CLK. On
+ *       Linux, they have the resolution of the kernel clock tick (usually
+ *       10 ms), and stack high water marks are not available.
+ *
+ * \section task_snapshot_ex1 TaskSnapshot Example
+ * \snippet monitor_example.cpp TaskSnapshot example
+ */
+template <size_t MaxTasks = 32> class TaskSnapshot {
+public:
+  /**
+   * @brief Take a new snapshot of the tasks.
+   * @return True if the snapshot was taken, false if there were more than
+   *         \p MaxTasks tasks (or the run time stats are not enabled), in
+   *         which case the snapshot is empty.
+   */
+  bool update() {
+    num_tasks_ = 0;
+    uint64_t total_time_us = 0;
+    if (!read_tasks(total_time_us)) {
+      num_tasks_ = 0;
+      return false;
+    }
+    // sort by id, to match the tasks against the previous snapshot
+    std::sort(tasks_.begin(), tasks_.begin() + num_tasks_,
+              [](const TaskStats &a, const TaskStats &b) { return a.id < b.id; });
+    interval_us_ = total_time_us - previous_total_time_us_;
+    size_t p = 0;
+    for (size_t i = 0; i < num_tasks_; i++) {
+      auto &task = tasks_[i];
+      while (p < num_previous_ && previous_[p].id < task.id) {
+        p++;
+      }
+      bool existed = p < num_previous_ && previous_[p].id == task.id;
+      uint64_t previous_run_time = existed ? previous_[p].run_time_us : 0;
+      task.cpu_percent = interval_us_ > 0 ? 100.0f * (task.run_time_us - previous_run_time) /
+                                                interval_us_
+                                          : 0.0f;
+      task.high_water_mark_change =
+          existed ? int32_t(task.high_water_mark) - int32_t(previous_[p].high_water_mark) : 0;
+    }
+    for (size_t i = 0; i < num_tasks_; i++) {
+      previous_[i] = {tasks_[i].id, tasks_[i].run_time_us, tasks_[i].high_water_mark};
+    }
+    num_previous_ = num_tasks_;
+    previous_total_time_us_ = total_time_us;
+    return true;
+  }
+
+  /**
+   * @brief Get the number of tasks in the snapshot.
+   * @return The number of tasks.
+   */
+  size_t size() const { return num_tasks_; }
+
+  /**
+   * @brief Get the stats of a task in the snapshot, which are sorted by id.
+   * @param index Index of the task, less than size().
+   * @return The stats of the task.
+   */
+  const TaskStats &operator[](size_t index) const { return tasks_[index]; }
+
+  /**
+   * @brief Iterator to the first task in the snapshot.
+   * @return Pointer to the stats of the first task.
+   */
+  const TaskStats *begin() const { return tasks_.data(); }
+
+  /**
+   * @brief Iterator past the last task in the snapshot.
+   * @return Pointer past the stats of the last task.
+   */
+  const TaskStats *end() const { return tasks_.data() + num_tasks_; }
+
+  /**
+   * @brief Get the interval covered by the CPU usage of the snapshot.
+   * @return The time since the previous snapshot, or since the system
+   *         started for the first snapshot.
+   */
+  std::chrono::microseconds get_interval() const {
+    return std::chrono::microseconds(interval_us_);
+  }
+
+protected:
+  struct PreviousStats {
+    uint32_t id;
+    uint64_t run_time_us;
+    uint32_t high_water_mark;
+  };
+
+#if defined(ESP_PLATFORM)
+  bool read_tasks(uint64_t &total_time_us) {
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY && CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    using RunTime = decltype(TaskStatus_t::ulRunTimeCounter);
+    RunTime total_run_time = 0;
+    // returns 0 if the array is too small for all the tasks
+    UBaseType_t num_tasks = uxTaskGetSystemState(status_.data(), MaxTasks, &total_run_time);
+    if (num_tasks == 0) {
+      return false;
+    }
+    // extend the run time counters past their wraparound
+    total_time_us = extend(previous_total_time_us_, total_run_time);
+    for (size_t i = 0; i < num_tasks; i++) {
+      const auto &status = status_[i];
+      auto &task = tasks_[i];
+      task.id = status.xTaskNumber;
+      std::strncpy(task.name, status.pcTaskName, sizeof(task.name) - 1);
+      task.name[sizeof(task.name) - 1] = '\0';
+      task.run_time_us = extend(find_previous_run_time(task.id), status.ulRunTimeCounter);
+      task.high_water_mark = status.usStackHighWaterMark;
+      task.priority = status.uxCurrentPriority;
+      task.core_id = -2;
+#if CONFIG_FREERTOS_VTASKLIST_INCLUDE_COREID
+      task.core_id = status.xCoreID == tskNO_AFFINITY ? -1 : status.xCoreID;
+#endif
+    }
+    num_tasks_ = num_tasks;
+    return true;
+#else
+    return false;
+#endif
+  }
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY && CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+  template <typename RunTime> static uint64_t extend(uint64_t previous, RunTime counter) {
+    if constexpr (sizeof(RunTime) >= sizeof(uint64_t)) {
+      return counter;
+    } else {
+      return previous + RunTime(counter - RunTime(previous));
+    }
+  }
+
+  uint64_t find_previous_run_time(uint32_t id) const {
+    for (size_t i = 0; i < num_previous_; i++) {
+      if (previous_[i].id == id) {
+        return previous_[i].run_time_us;
+      }
+    }
+    return 0;
+  }
+
+  std::array<TaskStatus_t, MaxTasks> status_;
+#endif
+#else
+  bool read_tasks(uint64_t &total_time_us) {
+    timespec now{};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    total_time_us = uint64_t(now.tv_sec) * 1'000'000 + now.tv_nsec / 1000;
+    int dir = open("/proc/self/task", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir < 0) {
+      return false;
+    }
+    // getdents64 lists the directory into our buffer, where opendir() would
+    // allocate
+    struct DirEntry {
+      uint64_t ino;
+      int64_t off;
+      unsigned short reclen;
+      unsigned char type;
+      char name[1];
+    };
+    alignas(8) char entries[2048];
+    bool ok = true;
+    long length = 0;
+    while (ok && (length = syscall(SYS_getdents64, dir, entries, sizeof(entries))) > 0) {
+      for (long offset = 0; offset < length;) {
+        auto *entry = reinterpret_cast<const DirEntry *>(entries + offset);
+        offset += entry->reclen;
+        if (entry->name[0] < '0' || entry->name[0] > '9') {
+          continue;
+        }
+        if (num_tasks_ == MaxTasks) {
+          ok = false;
+          break;
+        }
+        if (read_thread(dir, entry->name, tasks_[num_tasks_])) {
+          num_tasks_++;
+        }
+      }
+    }
+    close(dir);
+    return ok && length == 0;
+  }
+
+  // parse /proc/self/task/<tid>/stat, see proc(5)
+  static bool read_thread(int dir, const char *tid, TaskStats &task) {
+    char path[32];
+    size_t tid_length = strnlen(tid, sizeof(path) - sizeof("/stat"));
+    std::memcpy(path, tid, tid_length);
+    std::memcpy(path + tid_length, "/stat", sizeof("/stat"));
+    int fd = openat(dir, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      // the thread exited
+      return false;
+    }
+    char stat[512];
+    ssize_t length = read(fd, stat, sizeof(stat) - 1);
+    close(fd);
+    if (length <= 0) {
+      return false;
+    }
+    stat[length] = '\0';
+    // the name is in parentheses, and may contain spaces and parentheses
+    char *name_start = std::strchr(stat, '(');
+    char *name_end = std::strrchr(stat, ')');
+    if (!name_start || !name_end || name_end < name_start) {
+      return false;
+    }
+    size_t name_length = std::min<size_t>(name_end - name_start - 1, sizeof(task.name) - 1);
+    std::memcpy(task.name, name_start + 1, name_length);
+    task.name[name_length] = '\0';
+    task.id = parse_number(stat);
+    // fields after the name, starting with the state (field 3)
+    uint64_t utime = 0, stime = 0;
+    const char *field = name_end + 1;
+    for (int index = 3; index <= 40 && *field; index++) {
+      while (*field == ' ') {
+        field++;
+      }
+      switch (index) {
+      case 14:
+        utime = parse_number(field);
+        break;
+      case 15:
+        stime = parse_number(field);
+        break;
+      case 39:
+        task.core_id = parse_number(field);
+        break;
+      case 40:
+        task.priority = parse_number(field);
+        break;
+      default:
+        break;
+      }
+      while (*field && *field != ' ') {
+        field++;
+      }
+    }
+    static const uint64_t ticks_per_second = sysconf(_SC_CLK_TCK);
+    task.run_time_us = (utime + stime) * 1'000'000 / ticks_per_second;
+    task.high_water_mark = 0;
+    return true;
+  }
+
+  static uint64_t parse_number(const char *text) {
+    uint64_t value = 0;
+    while (*text >= '0' && *text <= '9') {
+      value = value * 10 + (*text++ - '0');
+    }
+    return value;
+  }
+#endif
+
+  std::array<TaskStats, MaxTasks> tasks_{};
+  size_t num_tasks_{0};
+  std::array<PreviousStats, MaxTasks> previous_{};
+  size_t num_previous_{0};
+  uint64_t previous_total_time_us_{0};
+  uint64_t interval_us_{0};
+};
+} // namespace espp
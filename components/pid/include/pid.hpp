@@ -5,6 +5,7 @@
 #include <mutex>
 
 #include "base_component.hpp"
+#include "clock.hpp"
 
 namespace espp {
 /**
@@ -96,8 +97,8 @@ public:
     }
     float t = (curr_ts - prev_ts_) / 1e6f; // convert to seconds from microseconds
 #else                                      // ESP_PLATFORM
-    auto curr_ts = std::chrono::high_resolution_clock::now();
-    if (prev_ts_ == std::chrono::high_resolution_clock::time_point())
+    auto curr_ts = Clock::now();
+    if (prev_ts_ == Clock::time_point())
       prev_ts_ = curr_ts;
     float t = std::chrono::duration<float>(curr_ts - prev_ts_).count();
 #endif                                     // ESP_PLATFORM
@@ -161,7 +162,7 @@ protected:
 #if defined(ESP_PLATFORM)
   uint64_t prev_ts_{0};
 #else
-  std::chrono::high_resolution_clock::time_point prev_ts_;
+  Clock::time_point prev_ts_;
 #endif
   std::recursive_mutex mutex_; ///< For protecting the config
 };
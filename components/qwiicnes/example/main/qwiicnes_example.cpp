@@ -26,16 +26,15 @@ extern "C" void app_main(void) {
          .read_register =
              std::bind(&espp::I2c::read_at_register, &i2c, std::placeholders::_1,
                        std::placeholders::_2, std::placeholders::_3, std::placeholders::_4),
+         .idle_polling_interval = 50ms, // poll slowly once no button was pressed for a while
+         .auto_start = true,
          .log_level = espp::Logger::Verbosity::WARN});
-    // and finally, make the task to periodically poll the qwiicnes and print
-    // the state
+    // and finally, make the task to print the button events and the state
     auto task_fn = [&quit_test, &qwiicnes](std::mutex &m, std::condition_variable &cv) {
       static espp::QwiicNes::ButtonState last_button_state;
-      std::error_code ec;
-      qwiicnes.update(ec);
-      if (ec) {
-        fmt::print("QwiicNes update failed: {}\n", ec.message());
-        return true; // stop the task
+      espp::InputEvent event;
+      while (qwiicnes.pop_event(event)) {
+        fmt::print("Button {} {}\n", event.code, event.pressed ? "pressed" : "released");
       }
       auto button_state = qwiicnes.get_button_state();
       if (button_state != last_button_state) {
@@ -1,8 +1,14 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <functional>
+#include <memory>
+#include <optional>
 
 #include "base_peripheral.hpp"
+#include "input_event_queue.hpp"
+#include "task.hpp"
 
 namespace espp {
 /// @brief A class to interface with the Qwiic NES controller.
@@ -11,6 +17,15 @@ namespace espp {
 ///         controller.
 ///         The Qwiic NES controller uses the I2C bus to communicate.
 ///
+///         Each update() reads the current state of the buttons and the
+///         button accumulator in a single transaction, and adds the
+///         presses and releases of the buttons to a lock-free event queue
+///         (see pop_event()), with the time they were read. Since the
+///         accumulator holds the buttons pressed since the last update(),
+///         presses shorter than the polling interval are not lost. The
+///         controller can be polled by its own task (see start()), quickly
+///         while buttons are being pressed, and slowly while idle.
+///
 /// \section Example
 /// \snippet qwiicnes_example.cpp qwiicnes example
 class QwiicNes : public BasePeripheral<> {
@@ -47,6 +62,17 @@ public:
     BasePeripheral::write_fn write; ///< The function to write data to the I2C bus.
     BasePeripheral::read_register_fn
         read_register; ///< The function to write then read data from the I2C bus.
+    std::chrono::milliseconds polling_interval{
+        10}; ///< The polling interval of the task while buttons are being pressed.
+    std::optional<std::chrono::milliseconds> idle_polling_interval{
+        std::nullopt}; ///< The polling interval of the task once no button has been pressed for
+                       ///< idle_timeout. If not set (the default), the task always polls at
+                       ///< polling_interval.
+    std::chrono::milliseconds idle_timeout{
+        500};               ///< How long after the last button press the task polls at
+                            ///< polling_interval.
+    bool auto_start{false}; ///< Whether to start the polling task on construction. If false,
+                            ///< update() must be called periodically instead, or start().
     espp::Logger::Verbosity log_level{
         espp::Logger::Verbosity::WARN}; ///< The log level for the class.
   };
@@ -57,7 +83,47 @@ public:
       : BasePeripheral({.address = DEFAULT_ADDRESS,
                         .write = config.write,
                         .read_register = config.read_register},
-                       "QwiicNes", config.log_level) {}
+                       "QwiicNes", config.log_level)
+      , polling_interval_(config.polling_interval)
+      , idle_polling_interval_(config.idle_polling_interval.value_or(config.polling_interval))
+      , idle_timeout_(config.idle_timeout) {
+    task_ = std::make_shared<espp::Task>(espp::Task::Config{
+        .name = "qwiicnes_task",
+        .callback =
+            std::bind(&QwiicNes::poll_task, this, std::placeholders::_1, std::placeholders::_2),
+        .stack_size_bytes = 4 * 1024,
+    });
+    if (config.auto_start) {
+      start();
+    }
+  }
+
+  /// @brief Start the polling task, which calls update() quickly while
+  ///        buttons are being pressed, and slowly while idle.
+  /// @return True if the task was started, false otherwise.
+  bool start() { return task_->start(); }
+
+  /// @brief Stop the polling task.
+  /// @return True if the task was stopped, false otherwise.
+  bool stop() { return task_->stop(); }
+
+  /// @brief Get the oldest button press or release from the event queue.
+  /// @details Each update() adds the presses and releases of the buttons
+  ///          since the previous update(), with InputEvent::code being the
+  ///          Button. A button which was pressed and released between two
+  ///          updates is reported as a press and a release with the same
+  ///          timestamp, and a button which was held at both updates but
+  ///          pressed again in between (as reported by the accumulator) as a
+  ///          release and a press.
+  /// @param event Set to the oldest event, if there is one.
+  /// @return True if there was an event, false if the queue was empty.
+  /// @note This should only be called from one task at a time.
+  bool pop_event(InputEvent &event) { return events_.pop(event); }
+
+  /// @brief Get the number of button events which were dropped because the
+  ///        event queue was full.
+  /// @return The number of dropped events.
+  size_t get_num_dropped_events() const { return events_.get_num_dropped(); }
 
   /// @brief Return true if the given button is pressed.
   /// @param state The byte returned by read_current_state().
@@ -79,29 +145,34 @@ public:
   /// @return The current state of the buttons.
   /// @details This function uses the accumulated button states which are
   ///          updated by the update() function.
-  ButtonState get_button_state() const { return button_state_; }
+  ButtonState get_button_state() const {
+    ButtonState state;
+    state.raw = accumulated_states_;
+    return state;
+  }
 
   /// @brief Update the state of the buttons.
   /// @param ec The error code if the function fails.
   /// @details This function reads the current state of the buttons and updates
-  ///          the accumulated button states.
+  ///          the accumulated button states, and adds the button events to
+  ///          the event queue (see pop_event()).
   ///          This function should be called periodically to ensure the
   ///          accumulated button states are up to date.
   ///          This function will log an error if it fails to read the current
   ///          state of the buttons.
   ///          The accumulated states represent all buttons which have been
   ///          pressed since the last time this function was called.
+  ///          This function fails with operation_in_progress while the
+  ///          polling task is running.
   /// @see get_button_state()
   /// @see is_pressed()
   void update(std::error_code &ec) {
-    auto buttons = read_button_accumulator(ec);
-    if (ec) {
-      logger_.error("failed to read button accumulator: {}", ec.message());
+    if (task_->is_running()) {
+      logger_.error("Polling task is running, use pop_event() instead");
+      ec = std::make_error_code(std::errc::operation_in_progress);
       return;
     }
-    logger_.info("updated state: {:02X}", buttons);
-    accumulated_states_ = buttons;
-    button_state_.raw = buttons;
+    poll(ec);
   }
 
   /// @brief Read the current state of the buttons.
@@ -170,8 +241,63 @@ protected:
     return read_u8_from_register((uint8_t)Registers::ACCUMULATOR, ec);
   }
 
-  uint8_t accumulated_states_{0};
-  ButtonState button_state_{};
+  void poll(std::error_code &ec) {
+    // CURRENT_STATE and ACCUMULATOR are sequential
+    uint8_t data[2];
+    read_many_from_register((uint8_t)Registers::CURRENT_STATE, data, sizeof(data), ec);
+    if (ec) {
+      logger_.error("failed to read button state: {}", ec.message());
+      return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    uint8_t current = data[0];
+    uint8_t buttons = data[1];
+    logger_.info("updated state: {:02X}", buttons);
+    for (int i = 0; i < 8; i++) {
+      uint8_t bit = 1 << i;
+      bool pressed = current_state_ & bit;
+      bool is_pressed = current & bit;
+      if ((buttons & bit) || (!pressed && is_pressed)) {
+        // pressed since the previous update, so a button which was already
+        // pressed must have been released in between
+        if (pressed) {
+          events_.push({.code = (uint16_t)i, .pressed = false, .timestamp = now});
+        }
+        events_.push({.code = (uint16_t)i, .pressed = true, .timestamp = now});
+        pressed = true;
+      }
+      if (pressed && !is_pressed) {
+        events_.push({.code = (uint16_t)i, .pressed = false, .timestamp = now});
+      }
+    }
+    if (current || buttons) {
+      last_active_time_ = now;
+    }
+    current_state_ = current;
+    accumulated_states_ = buttons;
+  }
+
+  bool poll_task(std::mutex &m, std::condition_variable &cv) {
+    auto start_time = std::chrono::steady_clock::now();
+    std::error_code ec;
+    poll(ec);
+    // poll quickly while buttons are being pressed, and slowly while idle
+    bool active = start_time - last_active_time_ < idle_timeout_;
+    {
+      std::unique_lock<std::mutex> lock(m);
+      cv.wait_until(lock, start_time + (active ? polling_interval_ : idle_polling_interval_));
+    }
+    return false;
+  }
+
+  std::atomic<uint8_t> accumulated_states_{0};
+  uint8_t current_state_{0};
+  std::chrono::milliseconds polling_interval_;
+  std::chrono::milliseconds idle_polling_interval_;
+  std::chrono::milliseconds idle_timeout_;
+  std::chrono::steady_clock::time_point last_active_time_{};
+  InputEventQueue<> events_;
+  std::shared_ptr<espp::Task> task_;
 };
 } // namespace espp
 
@@ -74,6 +74,14 @@ extern "C" void app_main(void) {
   rtsp_server.send_frame(jpeg_frame);
   //! [rtsp_server_example]
 
+  //! [mjpeg_server_example]
+  // serve the same frames to browsers (and other HTTP clients) at
+  // http://<ip>:8080/mjpeg
+  espp::MjpegServer mjpeg_server({.port = 8080, .path = "/mjpeg"});
+  mjpeg_server.start();
+  rtsp_server.set_mjpeg_server(&mjpeg_server);
+  //! [mjpeg_server_example]
+
   //! [rtsp_client_example]
   espp::RtspClient rtsp_client({
       .server_address = ip_address, // string of the form {}.{}.{}.{}
@@ -2,6 +2,7 @@
 
 #include "jpeg_header.hpp"
 #include "rtp_jpeg_packet.hpp"
+#include "rtp_jpeg_packet_view.hpp"
 
 namespace espp {
 /// A class that represents a complete JPEG frame.
@@ -25,6 +26,22 @@ public:
     add_scan(packet);
   }
 
+  /// Construct a JpegFrame from a RtpJpegPacketView.
+  ///
+  /// This constructor will parse the header of the packet and add the JPEG
+  /// data to the frame. The packet data is only read, the frame does not keep
+  /// a reference to it.
+  ///
+  /// @param packet The packet view to parse.
+  explicit JpegFrame(const RtpJpegPacketView &packet)
+      : header_(packet.get_width(), packet.get_height(), packet.get_q_table(0),
+                packet.get_q_table(1)) {
+    // add the jpeg header
+    serialize_header();
+    // add the jpeg data
+    add_scan(packet);
+  }
+
   /// Construct a JpegFrame from buffer of jpeg data
   /// @param data The buffer containing the jpeg data.
   /// @param size The size of the buffer.
@@ -53,6 +70,11 @@ public:
   /// @param packet The packet containing the scan to append.
   void append(const RtpJpegPacket &packet) { add_scan(packet); }
 
+  /// Append a RtpJpegPacketView to the frame.
+  /// This will add the JPEG data to the frame.
+  /// @param packet The packet view containing the scan to append.
+  void append(const RtpJpegPacketView &packet) { add_scan(packet); }
+
   /// Append a JPEG scan to the frame.
   /// This will add the JPEG data to the frame.
   /// @note If the packet contains the EOI marker, the frame will be
@@ -65,6 +87,18 @@ public:
     }
   }
 
+  /// Append a JPEG scan to the frame.
+  /// This will add the JPEG data to the frame.
+  /// @note If the packet contains the EOI marker, the frame will be
+  ///       finalized, and no further scans can be added.
+  /// @param packet The packet view containing the scan to append.
+  void add_scan(const RtpJpegPacketView &packet) {
+    add_scan(packet.get_jpeg_data());
+    if (packet.get_marker()) {
+      finalize();
+    }
+  }
+
   /// Get the serialized data.
   /// This will return the serialized data.
   /// @return The serialized data.
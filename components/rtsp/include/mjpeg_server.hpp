@@ -0,0 +1,361 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "base_component.hpp"
+#include "task.hpp"
+#include "tcp_socket.hpp"
+
+#include "jpeg_frame.hpp"
+
+namespace espp {
+/// Class for streaming MJPEG data to browsers and other HTTP clients, as a
+/// multipart/x-mixed-replace response (e.g. for an <img> tag).
+///
+/// Each frame passed to send_frame() is copied once into a buffer shared by
+/// all clients, and each client's task sends the latest frame with a single
+/// vectored write of the part header, the JPEG data and the part trailer.
+/// A client which is still sending a frame when newer frames arrive skips
+/// them (drop-if-behind), so slow clients neither delay the other clients
+/// nor buffer frames, and a client which stalls for longer than the send
+/// timeout is disconnected.
+///
+/// The server can be fed with the same frames as an RtspServer, see
+/// RtspServer::set_mjpeg_server().
+///
+/// \section MjpegServer example
+/// \snippet rtsp_example.cpp mjpeg_server_example
+class MjpegServer : public BaseComponent {
+public:
+  /// @brief Statistics of the frames sent to the clients
+  struct Stats {
+    size_t frames_sent{0};    ///< Frames sent, summed over all clients
+    size_t frames_dropped{0}; ///< Frames skipped by clients which were behind
+  };
+
+  /// @brief Configuration for the MJPEG server
+  struct Config {
+    int port;                   ///< The port to listen on
+    std::string path{"/"};      ///< The path of the stream, e.g. http://<ip>:<port>/<path>
+    size_t max_num_clients{8};  ///< Further connections are closed immediately
+    std::chrono::duration<float> send_timeout{2.0f}; ///< Clients stalled longer are dropped
+    Task::BaseConfig client_task_config{
+        .name = "MjpegClient", .stack_size_bytes = 4 * 1024}; ///< Each client's task config
+    Logger::Verbosity log_level = Logger::Verbosity::WARN; ///< The log level for the server
+  };
+
+  /// @brief Construct an MJPEG server
+  /// @param config The configuration for the MJPEG server
+  explicit MjpegServer(const Config &config)
+      : BaseComponent("MJPEG Server", config.log_level)
+      , port_(config.port)
+      , path_(config.path)
+      , max_num_clients_(config.max_num_clients)
+      , send_timeout_(config.send_timeout)
+      , client_task_config_(config.client_task_config)
+      , socket_({.log_level = espp::Logger::Verbosity::WARN}) {
+    // allow stop() to interrupt the accept task
+    socket_.set_cancellation_token(std::make_shared<CancellationToken>());
+    if (path_.empty() || path_[0] != '/') {
+      path_ = "/" + path_;
+    }
+  }
+
+  /// @brief Destroy the MJPEG server
+  ~MjpegServer() { stop(); }
+
+  /// @brief Start the MJPEG server
+  /// Binds the socket and starts the accept task
+  /// @return True if the server was started successfully, false otherwise
+  bool start() {
+    if (accept_task_ && accept_task_->is_started()) {
+      logger_.error("Server is already running");
+      return false;
+    }
+
+    logger_.info("Starting MJPEG server on port {}", port_);
+
+    // if we were previously stopped, reopen the socket
+    if (!socket_.is_valid()) {
+      socket_.reinit();
+    }
+    socket_.get_cancellation_token()->reset();
+    {
+      std::lock_guard<std::mutex> lk(frame_mutex_);
+      stopping_ = false;
+    }
+    frames_sent_ = 0;
+    frames_dropped_ = 0;
+
+    if (!socket_.bind(port_)) {
+      logger_.error("Failed to bind to port {}", port_);
+      return false;
+    }
+
+    int max_pending_connections = 5;
+    if (!socket_.listen(max_pending_connections)) {
+      logger_.error("Failed to listen on port {}", port_);
+      return false;
+    }
+
+    using namespace std::placeholders;
+    accept_task_ = std::make_unique<Task>(Task::Config{
+        .name = "MJPEG Accept Task",
+        .callback = std::bind(&MjpegServer::accept_task_function, this, _1, _2),
+        .stack_size_bytes = 4 * 1024,
+        .log_level = espp::Logger::Verbosity::WARN,
+    });
+    accept_task_->start();
+    return true;
+  }
+
+  /// @brief Stop the MJPEG server
+  /// Stops the accept task and disconnects all clients. The server can be
+  /// started again afterwards.
+  void stop() {
+    logger_.info("Stopping MJPEG server");
+    socket_.get_cancellation_token()->cancel();
+    if (accept_task_) {
+      accept_task_->stop();
+    }
+    // no new connections while the clients are disconnected
+    socket_.close();
+    {
+      std::lock_guard<std::mutex> lk(frame_mutex_);
+      stopping_ = true;
+    }
+    frame_cv_.notify_all();
+    std::vector<std::unique_ptr<Client>> clients;
+    {
+      std::lock_guard<std::mutex> lk(clients_mutex_);
+      clients = std::move(clients_);
+      clients_.clear();
+    }
+    // stopping the tasks waits for any frame being sent (bounded by the send
+    // timeout), then the sockets are closed
+    for (auto &client : clients) {
+      client->socket->get_cancellation_token()->cancel();
+      client->task->stop();
+    }
+    clients.clear();
+  }
+
+  /// @brief Send a frame to all connected clients
+  /// Copies the frame into the shared buffer and wakes up the clients' tasks,
+  /// but does not send it.
+  /// @note Replaces any frame which has not been sent to a client yet
+  /// @param frame The frame to send
+  void send_frame(const JpegFrame &frame) { send_frame(frame.get_data()); }
+
+  /// @brief Send an encoded JPEG image to all connected clients
+  /// @param jpeg_data The JPEG image
+  void send_frame(std::string_view jpeg_data) {
+    auto shared = std::make_shared<Frame>();
+    shared->header = fmt::format("--{}\r\nContent-Type: image/jpeg\r\nContent-Length: {}\r\n\r\n",
+                                 BOUNDARY, jpeg_data.size());
+    shared->data.assign(jpeg_data.begin(), jpeg_data.end());
+    {
+      std::lock_guard<std::mutex> lk(frame_mutex_);
+      shared->id = ++frame_id_;
+      frame_ = std::move(shared);
+    }
+    frame_cv_.notify_all();
+  }
+
+  /// @brief Get the number of connected clients
+  /// @return The number of clients which are streaming (or about to)
+  size_t get_num_clients() {
+    std::lock_guard<std::mutex> lk(clients_mutex_);
+    size_t num_clients = 0;
+    for (const auto &client : clients_) {
+      num_clients += client->closed ? 0 : 1;
+    }
+    return num_clients;
+  }
+
+  /// @brief Get the statistics of the frames sent to the clients
+  /// @return The statistics, summed over all clients since start()
+  Stats get_stats() const {
+    return {.frames_sent = frames_sent_, .frames_dropped = frames_dropped_};
+  }
+
+protected:
+  static constexpr const char *BOUNDARY = "espp-mjpeg-frame";
+  static constexpr size_t MAX_REQUEST_SIZE = 1024;
+
+  struct Frame {
+    uint32_t id{0};
+    std::string header;
+    std::vector<char> data;
+  };
+
+  struct Client {
+    std::unique_ptr<TcpSocket> socket;
+    std::unique_ptr<Task> task;
+    uint32_t last_frame_id{0};
+    bool streaming{false};
+    std::atomic<bool> closed{false};
+  };
+
+  bool accept_task_function(std::mutex &m, std::condition_variable &cv) {
+    auto socket = socket_.accept();
+    if (!socket && socket_.is_cancelled()) {
+      logger_.debug("Accept cancelled, stopping accept task");
+      return true;
+    }
+    if (!socket) {
+      logger_.error("Failed to accept new connection");
+      return false;
+    }
+
+    std::lock_guard<std::mutex> lk(clients_mutex_);
+    remove_closed_clients();
+    if (clients_.size() >= max_num_clients_) {
+      logger_.warn("Too many clients ({}), closing new connection", clients_.size());
+      socket->close();
+      return false;
+    }
+    logger_.info("Accepted new connection from {}", socket->get_remote_info());
+    socket->set_cancellation_token(std::make_shared<CancellationToken>());
+    socket->set_send_timeout(send_timeout_);
+    auto client = std::make_unique<Client>();
+    client->socket = std::move(socket);
+    using namespace std::placeholders;
+    auto task_config = client_task_config_;
+    task_config.name += std::to_string(next_client_number_++);
+    client->task = Task::make_unique(Task::AdvancedConfig{
+        .callback = std::bind(&MjpegServer::client_task_function, this, client.get(), _1, _2),
+        .task_config = task_config,
+        .log_level = espp::Logger::Verbosity::WARN,
+    });
+    client->task->start();
+    clients_.push_back(std::move(client));
+    // we do not want to stop the task
+    return false;
+  }
+
+  bool client_task_function(Client *client, std::mutex &m, std::condition_variable &cv) {
+    if (!client->streaming) {
+      client->streaming = handle_request(*client);
+      if (!client->streaming) {
+        client->closed = true;
+        return true;
+      }
+      return false;
+    }
+
+    std::shared_ptr<const Frame> frame;
+    {
+      std::unique_lock<std::mutex> lk(frame_mutex_);
+      frame_cv_.wait(lk, [&] {
+        return stopping_ || (frame_ && frame_->id != client->last_frame_id);
+      });
+      if (stopping_) {
+        return true;
+      }
+      frame = frame_;
+    }
+    if (client->last_frame_id != 0) {
+      // frames which arrived while the previous one was being sent
+      frames_dropped_ += frame->id - client->last_frame_id - 1;
+    }
+    client->last_frame_id = frame->id;
+
+    std::array<std::string_view, 3> buffers{
+        frame->header,
+        std::string_view(frame->data.data(), frame->data.size()),
+        std::string_view("\r\n"),
+    };
+    if (!client->socket->transmit(buffers)) {
+      logger_.info("Client disconnected or stalled, closing connection");
+      client->closed = true;
+      return true;
+    }
+    frames_sent_++;
+    return false;
+  }
+
+  // read the HTTP request, and send the response header if it is for the
+  // stream
+  bool handle_request(Client &client) {
+    auto &socket = *client.socket;
+    socket.set_receive_timeout(send_timeout_);
+    std::string request;
+    std::array<uint8_t, 256> buffer;
+    while (request.find("\r\n\r\n") == std::string::npos) {
+      size_t num_bytes = socket.receive(buffer.data(), buffer.size());
+      if (num_bytes == 0 || request.size() + num_bytes > MAX_REQUEST_SIZE) {
+        logger_.debug("Failed to receive the request");
+        return false;
+      }
+      request.append(reinterpret_cast<const char *>(buffer.data()), num_bytes);
+    }
+    // request line: GET <path> HTTP/1.x
+    auto line = std::string_view(request).substr(0, request.find("\r\n"));
+    auto path_start = line.find(' ');
+    auto path_end = line.find(' ', path_start + 1);
+    if (line.substr(0, path_start) != "GET" || path_end == std::string_view::npos ||
+        line.substr(path_start + 1, path_end - path_start - 1) != path_) {
+      logger_.info("Invalid request: '{}'", line);
+      std::string_view response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n"
+                                  "Connection: close\r\n\r\n";
+      socket.transmit(response);
+      return false;
+    }
+    std::string response =
+        fmt::format("HTTP/1.1 200 OK\r\n"
+                    "Content-Type: multipart/x-mixed-replace; boundary={}\r\n"
+                    "Cache-Control: no-cache, no-store\r\n"
+                    "Connection: close\r\n\r\n",
+                    BOUNDARY);
+    std::array<std::string_view, 1> buffers{response};
+    if (!socket.transmit(buffers)) {
+      return false;
+    }
+    // start with the latest frame (if any)
+    std::lock_guard<std::mutex> lk(frame_mutex_);
+    client.last_frame_id = frame_ ? frame_->id - 1 : 0;
+    return true;
+  }
+
+  // NOTE: must be called with clients_mutex_ held
+  void remove_closed_clients() {
+    for (auto it = clients_.begin(); it != clients_.end();) {
+      if ((*it)->closed) {
+        (*it)->task->stop();
+        it = clients_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  int port_;
+  std::string path_;
+  size_t max_num_clients_;
+  std::chrono::duration<float> send_timeout_;
+  Task::BaseConfig client_task_config_;
+
+  TcpSocket socket_;
+
+  std::mutex frame_mutex_;
+  std::condition_variable frame_cv_;
+  std::shared_ptr<const Frame> frame_;
+  uint32_t frame_id_{0};
+  bool stopping_{false};
+
+  std::atomic<size_t> frames_sent_{0};
+  std::atomic<size_t> frames_dropped_{0};
+
+  std::mutex clients_mutex_;
+  std::vector<std::unique_ptr<Client>> clients_;
+  size_t next_client_number_{0};
+
+  std::unique_ptr<Task> accept_task_;
+};
+} // namespace espp
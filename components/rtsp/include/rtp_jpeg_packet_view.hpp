@@ -0,0 +1,136 @@
+#pragma once
+
+#include "rtp_packet_view.hpp"
+
+namespace espp {
+/// Non-owning view of an RTP packet for JPEG video.
+/// The RTP payload for JPEG is defined in RFC 2435.
+/// @details This is the non-owning counterpart of RtpJpegPacket. The JPEG and
+///          quantization table headers are parsed lazily from the viewed
+///          buffer, so no data is copied and no memory is allocated.
+/// @note The view is only valid as long as the underlying buffer is valid and
+///       unmodified.
+class RtpJpegPacketView : public RtpPacketView {
+public:
+  /// Construct an empty (invalid) view.
+  RtpJpegPacketView() = default;
+
+  /// Construct a view over the provided packet data.
+  /// @param data The packet data to view. Must outlive the view.
+  explicit RtpJpegPacketView(std::string_view data)
+      : RtpPacketView(data) {}
+
+  /// Construct a view over the provided packet data.
+  /// @param data The packet data to view. Must outlive the view.
+  explicit RtpJpegPacketView(std::span<const uint8_t> data)
+      : RtpPacketView(data) {}
+
+  /// Check whether the viewed data contains a complete RTP header and JPEG
+  /// header (and quantization table header, if it is indicated by the q
+  /// field).
+  /// @return True if the packet can be safely parsed, false otherwise.
+  bool is_valid() const {
+    if (!RtpPacketView::is_valid())
+      return false;
+    auto payload = get_payload();
+    if (payload.size() < MJPEG_HEADER_SIZE)
+      return false;
+    if (has_q_tables() && payload.size() < MJPEG_HEADER_SIZE + QUANT_HEADER_SIZE)
+      return false;
+    return get_jpeg_data_offset() <= payload.size();
+  }
+
+  /// Get the type-specific field.
+  /// @return The type-specific field.
+  int get_type_specific() const { return payload_byte(0); }
+
+  /// Get the offset field.
+  /// @return The offset field.
+  int get_offset() const {
+    return (payload_byte(1) << 16) | (payload_byte(2) << 8) | payload_byte(3);
+  }
+
+  /// Get the fragment type field.
+  /// @return The fragment type field.
+  int get_fragment_type() const { return payload_byte(4); }
+
+  /// Get the q field.
+  /// @return The q field.
+  int get_q() const { return payload_byte(5); }
+
+  /// Get the width field.
+  /// @return The width of the image in pixels.
+  int get_width() const { return payload_byte(6) * 8; }
+
+  /// Get the height field.
+  /// @return The height of the image in pixels.
+  int get_height() const { return payload_byte(7) * 8; }
+
+  /// Get the mjpeg header.
+  /// @return The mjpeg header.
+  std::string_view get_mjpeg_header() const { return get_payload().substr(0, MJPEG_HEADER_SIZE); }
+
+  /// Get whether the packet contains quantization tables.
+  /// @note This check is based on the value of the q field. If the q field
+  ///       is 128-255, the packet contains quantization tables.
+  /// @return Whether the packet contains quantization tables.
+  bool has_q_tables() const { return get_q() >= 128; }
+
+  /// Get the number of quantization tables.
+  /// @note Only the first packet in a frame contains quantization tables, and
+  ///       only tables matching the format produced by RtpJpegPacket (two
+  ///       tables of 64 bytes) are recognized.
+  /// @return The number of quantization tables.
+  int get_num_q_tables() const { return has_expected_q_tables() ? NUM_Q_TABLES : 0; }
+
+  /// Get the quantization table at the specified index.
+  /// @param index The index of the quantization table.
+  /// @return The quantization table at the specified index, or an empty
+  ///         string_view if the packet does not contain that table.
+  std::string_view get_q_table(int index) const {
+    if (index < 0 || index >= get_num_q_tables())
+      return {};
+    size_t offset = MJPEG_HEADER_SIZE + QUANT_HEADER_SIZE + index * Q_TABLE_SIZE;
+    return get_payload().substr(offset, Q_TABLE_SIZE);
+  }
+
+  /// Get the JPEG data.
+  /// The jpeg data is the payload minus the mjpeg header and quantization
+  /// tables.
+  /// @return The JPEG data.
+  std::string_view get_jpeg_data() const {
+    auto payload = get_payload();
+    size_t offset = get_jpeg_data_offset();
+    if (offset > payload.size())
+      return {};
+    return payload.substr(offset);
+  }
+
+protected:
+  static constexpr int MJPEG_HEADER_SIZE = 8;
+  static constexpr int QUANT_HEADER_SIZE = 4;
+  static constexpr int NUM_Q_TABLES = 2;
+  static constexpr int Q_TABLE_SIZE = 64;
+
+  uint8_t payload_byte(size_t index) const {
+    auto payload = get_payload();
+    return index < payload.size() ? static_cast<uint8_t>(payload[index]) : 0;
+  }
+
+  bool has_expected_q_tables() const {
+    if (!has_q_tables())
+      return false;
+    // the quantization table header is: mbz (8), precision (8), length (16)
+    int length = (payload_byte(MJPEG_HEADER_SIZE + 2) << 8) | payload_byte(MJPEG_HEADER_SIZE + 3);
+    return length == NUM_Q_TABLES * Q_TABLE_SIZE;
+  }
+
+  size_t get_jpeg_data_offset() const {
+    size_t offset = MJPEG_HEADER_SIZE;
+    if (has_expected_q_tables()) {
+      offset += QUANT_HEADER_SIZE + NUM_Q_TABLES * Q_TABLE_SIZE;
+    }
+    return offset;
+  }
+};
+} // namespace espp
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace espp {
+/// RtpPacketView is a non-owning view of an RTP packet.
+/// @details Unlike RtpPacket, this class does not copy the packet data and
+///          does not parse the header up front. Each getter reads the
+///          relevant bytes directly from the underlying buffer, so
+///          constructing a view is free and only the fields that are
+///          actually used are ever decoded. This makes it suitable for the
+///          receive path of a client or for relaying packets.
+/// @note The view is only valid as long as the underlying buffer is valid and
+///       unmodified.
+class RtpPacketView {
+public:
+  /// Construct an empty (invalid) view.
+  RtpPacketView() = default;
+
+  /// Construct a view over the provided packet data.
+  /// @param data The packet data to view. Must outlive the view.
+  explicit RtpPacketView(std::string_view data)
+      : data_(data) {}
+
+  /// Construct a view over the provided packet data.
+  /// @param data The packet data to view. Must outlive the view.
+  explicit RtpPacketView(std::span<const uint8_t> data)
+      : data_(reinterpret_cast<const char *>(data.data()), data.size()) {}
+
+  /// Check whether the viewed data contains a complete RTP header.
+  /// @details Checks the version field and that the buffer is large enough to
+  ///          contain the fixed header, any CSRC identifiers, and the header
+  ///          extension (if present).
+  /// @return True if the header can be safely parsed, false otherwise.
+  bool is_valid() const {
+    if (data_.size() < RTP_HEADER_SIZE || get_version() != 2)
+      return false;
+    return get_rtp_header_size() <= data_.size();
+  }
+
+  /// Getters for the RTP header fields.
+  int get_version() const { return (byte(0) & 0xC0) >> 6; }
+  bool get_padding() const { return byte(0) & 0x20; }
+  bool get_extension() const { return byte(0) & 0x10; }
+  int get_csrc_count() const { return byte(0) & 0x0F; }
+  bool get_marker() const { return byte(1) & 0x80; }
+  int get_payload_type() const { return byte(1) & 0x7F; }
+  uint16_t get_sequence_number() const { return read_u16(2); }
+  uint32_t get_timestamp() const { return read_u32(4); }
+  uint32_t get_ssrc() const { return read_u32(8); }
+
+  /// Get the size of the RTP header, including CSRC identifiers and the header
+  /// extension (if present).
+  /// @return The size of the RTP header.
+  size_t get_rtp_header_size() const {
+    size_t size = RTP_HEADER_SIZE + get_csrc_count() * 4;
+    if (get_extension() && data_.size() >= size + 4) {
+      // extension header is 16 bits profile + 16 bits length (in 32-bit words)
+      size += 4 + read_u16(size + 2) * 4;
+    }
+    return size;
+  }
+
+  /// Get a string_view of the whole packet.
+  /// @return A string_view of the whole packet.
+  std::string_view get_data() const { return data_; }
+
+  /// Get a string_view of the RTP header.
+  /// @return A string_view of the RTP header.
+  std::string_view get_rtp_header() const { return data_.substr(0, get_rtp_header_size()); }
+
+  /// Get a string_view of the payload.
+  /// @note If the padding bit is set, the padding bytes are not included in
+  ///       the payload.
+  /// @return A string_view of the payload.
+  std::string_view get_payload() const {
+    size_t header_size = get_rtp_header_size();
+    if (header_size > data_.size())
+      return {};
+    size_t payload_size = data_.size() - header_size;
+    if (get_padding() && payload_size > 0) {
+      size_t padding = byte(data_.size() - 1);
+      payload_size = padding <= payload_size ? payload_size - padding : 0;
+    }
+    return data_.substr(header_size, payload_size);
+  }
+
+protected:
+  static constexpr int RTP_HEADER_SIZE = 12;
+
+  uint8_t byte(size_t index) const { return static_cast<uint8_t>(data_[index]); }
+  uint16_t read_u16(size_t index) const { return (byte(index) << 8) | byte(index + 1); }
+  uint32_t read_u32(size_t index) const {
+    return (uint32_t(byte(index)) << 24) | (byte(index + 1) << 16) | (byte(index + 2) << 8) |
+           byte(index + 3);
+  }
+
+  std::string_view data_;
+};
+
+/// RtpPacketMutableView is a non-owning view of an RTP packet which allows the
+/// header fields to be rewritten in place.
+/// @details This is intended for relaying / forwarding packets, where only a
+///          few header fields (e.g. SSRC and sequence number) need to be
+///          changed before the packet is sent on. No copy of the packet is
+///          made.
+class RtpPacketMutableView : public RtpPacketView {
+public:
+  /// Construct a mutable view over the provided packet data.
+  /// @param data The packet data to view. Must outlive the view.
+  explicit RtpPacketMutableView(std::span<uint8_t> data)
+      : RtpPacketView(std::span<const uint8_t>(data))
+      , mutable_data_(data) {}
+
+  /// Setters for the RTP header fields. These write directly into the
+  /// underlying buffer.
+  /// @note The caller must ensure the view is_valid() before calling these.
+  void set_marker(bool marker) {
+    mutable_data_[1] = (mutable_data_[1] & 0x7F) | (marker ? 0x80 : 0x00);
+  }
+  void set_payload_type(int payload_type) {
+    mutable_data_[1] = (mutable_data_[1] & 0x80) | (payload_type & 0x7F);
+  }
+  void set_sequence_number(uint16_t sequence_number) { write_u16(2, sequence_number); }
+  void set_timestamp(uint32_t timestamp) { write_u32(4, timestamp); }
+  void set_ssrc(uint32_t ssrc) { write_u32(8, ssrc); }
+
+protected:
+  void write_u16(size_t index, uint16_t value) {
+    mutable_data_[index] = value >> 8;
+    mutable_data_[index + 1] = value & 0xFF;
+  }
+  void write_u32(size_t index, uint32_t value) {
+    mutable_data_[index] = value >> 24;
+    mutable_data_[index + 1] = (value >> 16) & 0xFF;
+    mutable_data_[index + 2] = (value >> 8) & 0xFF;
+    mutable_data_[index + 3] = value & 0xFF;
+  }
+
+  std::span<uint8_t> mutable_data_;
+};
+
+/// RtpRelay rewrites the SSRC and sequence number of RTP packets in place so
+/// that they can be forwarded as a new stream.
+/// @details The first relayed packet establishes the offset between the
+///          incoming and outgoing sequence numbers, so that gaps / reordering
+///          in the incoming stream are preserved in the outgoing stream.
+///          Packets are never copied.
+class RtpRelay {
+public:
+  /// Configuration for the RtpRelay.
+  struct Config {
+    uint32_t ssrc;                      ///< SSRC to write into relayed packets.
+    uint16_t initial_sequence_number{0}; ///< Sequence number of the first relayed packet.
+  };
+
+  /// Construct an RtpRelay.
+  /// @param config The configuration for the relay.
+  explicit RtpRelay(const Config &config)
+      : ssrc_(config.ssrc)
+      , initial_sequence_number_(config.initial_sequence_number) {}
+
+  /// Rewrite the SSRC and sequence number of the packet in place.
+  /// @param packet The packet data to rewrite.
+  /// @return True if the packet was a valid RTP packet and was rewritten,
+  ///         false otherwise (in which case the data is not modified).
+  bool relay(std::span<uint8_t> packet) {
+    RtpPacketMutableView view(packet);
+    if (!view.is_valid())
+      return false;
+    uint16_t sequence_number = view.get_sequence_number();
+    if (!has_offset_) {
+      sequence_offset_ = initial_sequence_number_ - sequence_number;
+      has_offset_ = true;
+    }
+    view.set_sequence_number(sequence_number + sequence_offset_);
+    view.set_ssrc(ssrc_);
+    return true;
+  }
+
+  /// Reset the relay so that the next relayed packet re-establishes the
+  /// sequence number offset.
+  /// @param initial_sequence_number Sequence number of the next relayed packet.
+  void reset(uint16_t initial_sequence_number) {
+    initial_sequence_number_ = initial_sequence_number;
+    has_offset_ = false;
+  }
+
+protected:
+  uint32_t ssrc_;
+  uint16_t initial_sequence_number_;
+  uint16_t sequence_offset_{0};
+  bool has_offset_{false};
+};
+} // namespace espp
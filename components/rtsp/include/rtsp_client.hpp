@@ -38,6 +38,9 @@ public:
                                   ///< to the server address and port to form the full path of the
                                   ///< form "rtsp://<server_address>:<rtsp_port><path>"
     jpeg_frame_callback_t on_jpeg_frame; ///< The callback to call when a JPEG frame is received
+    bool receive_tasks{true}; ///< Start tasks receiving the RTP / RTCP packets in setup(). If
+                              ///< false, the RTP packets must be passed to handle_rtp_packet()
+                              ///< instead, e.g. by a reactor shared by many clients
     espp::Logger::Verbosity log_level =
         espp::Logger::Verbosity::INFO; ///< The verbosity of the logger
   };
@@ -52,6 +55,7 @@ public:
       , rtp_socket_({.log_level = espp::Logger::Verbosity::WARN})
       , rtcp_socket_({.log_level = espp::Logger::Verbosity::WARN})
       , on_jpeg_frame_(config.on_jpeg_frame)
+      , receive_tasks_(config.receive_tasks)
       , cseq_(0)
       , path_("rtsp://" + server_address_ + ":" + std::to_string(rtsp_port_) + config.path) {}
 
@@ -160,8 +164,10 @@ public:
   /// Disconnects from the RTSP server and sends the TEARDOWN request.
   /// \param ec The error code to set if an error occurs
   void disconnect(std::error_code &ec) {
-    // send the teardown request
-    teardown(ec);
+    // send the teardown request, unless we already disconnected
+    if (rtsp_socket_.is_connected()) {
+      teardown(ec);
+    }
     rtsp_socket_.reinit();
   }
 
@@ -233,7 +239,7 @@ public:
 
   /// Setup the RTSP stream
   /// Sends the SETUP request to the RTSP server and parses the response.
-  /// \note Starts the RTP and RTCP threads.
+  /// \note Starts the RTP and RTCP threads, unless receive_tasks is false.
   /// \param rtp_port The RTP client port
   /// \param rtcp_port The RTCP client port
   /// \param ec The error code to set if an error occurs
@@ -253,8 +259,10 @@ public:
       return;
     }
 
-    init_rtp(rtp_port, ec);
-    init_rtcp(rtcp_port, ec);
+    if (receive_tasks_) {
+      init_rtp(rtp_port, ec);
+      init_rtcp(rtcp_port, ec);
+    }
   }
 
   /// Play the RTSP stream
@@ -293,6 +301,60 @@ public:
     send_request("TEARDOWN", path_, {}, ec);
   }
 
+  /// Handle a received RTP packet
+  /// \note Parses the RTP/JPEG packet and appends it to the current JPEG
+  ///       frame. If the packet is the last fragment of the frame, the frame
+  ///       is sent to the on_jpeg_frame callback, from the calling task.
+  /// \note Called by the RTP socket task, or by the owner of the RTP socket
+  ///       if receive_tasks is false.
+  /// \param packet The RTP packet
+  void handle_rtp_packet(std::string_view packet) {
+    logger_.debug("Got RTP packet of size: {}", packet.size());
+
+    // parse the rtp packet in place, without copying it
+    RtpJpegPacketView rtp_jpeg_packet(packet);
+    if (!rtp_jpeg_packet.is_valid()) {
+      logger_.warn("Received invalid RTP/JPEG packet of size: {}", packet.size());
+      return;
+    }
+    auto frag_offset = rtp_jpeg_packet.get_offset();
+    if (frag_offset == 0) {
+      // first fragment
+      logger_.debug("Received first fragment, size: {}, sequence number: {}",
+                    rtp_jpeg_packet.get_data().size(), rtp_jpeg_packet.get_sequence_number());
+      if (jpeg_frame_) {
+        // we already have a frame, this is an error
+        logger_.warn("Received first fragment but already have a frame");
+        jpeg_frame_.reset();
+      }
+      jpeg_frame_ = std::make_unique<JpegFrame>(rtp_jpeg_packet);
+    } else if (jpeg_frame_) {
+      logger_.debug("Received middle fragment, size: {}, sequence number: {}",
+                    rtp_jpeg_packet.get_data().size(), rtp_jpeg_packet.get_sequence_number());
+      // middle fragment
+      jpeg_frame_->append(rtp_jpeg_packet);
+    } else {
+      // we don't have a frame to append to but we got a middle fragment
+      // this is an error
+      logger_.warn("Received middle fragment without a frame");
+      return;
+    }
+
+    // check if this is the last packet of the frame (the last packet will have
+    // the marker bit set)
+    if (jpeg_frame_ && jpeg_frame_->is_complete()) {
+      // get the jpeg data
+      auto jpeg_data = jpeg_frame_->get_data();
+      logger_.debug("Received jpeg frame of size: {} B", jpeg_data.size());
+      // call the on_jpeg_frame callback
+      if (on_jpeg_frame_) {
+        on_jpeg_frame_(std::move(jpeg_frame_));
+      }
+      // the frame is done, whether or not the callback took it
+      jpeg_frame_.reset();
+    }
+  }
+
 protected:
   /// Parse the RTSP response
   /// \note Parses response data for the following fields:
@@ -317,7 +379,7 @@ protected:
     //   std::regex response_regex("RTSP/1.0 (\\d+) (.*)\r\n(.*)\r\n\r\n");
     // parse the response but don't use regex since it may be slow on embedded platforms
     // make sure it matches the expected response format
-    if (response_data.starts_with("RTSP/1.0") != 0) {
+    if (!response_data.starts_with("RTSP/1.0")) {
       ec = std::make_error_code(std::errc::protocol_error);
       logger_.error("Invalid response");
       return false;
@@ -359,8 +421,9 @@ protected:
     auto rtp_config = espp::UdpSocket::ReceiveConfig{
         .port = rtp_port,
         .buffer_size = 2 * 1024,
-        .on_receive_callback = std::bind(&RtspClient::handle_rtp_packet, this,
-                                         std::placeholders::_1, std::placeholders::_2),
+        .on_receive_callback = [this](auto &data, auto &sender_info) {
+          return handle_rtp_packet(data, sender_info);
+        },
     };
     if (!rtp_socket_.start_receiving(rtp_task_config, rtp_config)) {
       ec = std::make_error_code(std::errc::operation_canceled);
@@ -398,57 +461,13 @@ protected:
   }
 
   /// Handle an RTP packet
-  /// \note Parses the RTP packet and appends it to the current JPEG frame.
-  /// \note If the packet is the last fragment of the JPEG frame, the frame is sent to the
-  /// on_jpeg_frame callback. \note This function is called by the RTP socket task. \param data The
-  /// data to handle \param sender_info The sender info \return Optional data to send back to the
-  /// sender
+  /// \note Called by the RTP socket task, see handle_rtp_packet(std::string_view).
+  /// \param data The data to handle
+  /// \param sender_info The sender info
+  /// \return Optional data to send back to the sender
   std::optional<std::vector<uint8_t>> handle_rtp_packet(std::vector<uint8_t> &data,
                                                         const espp::Socket::Info &sender_info) {
-    // jpeg frame that we are building
-    static std::unique_ptr<JpegFrame> jpeg_frame;
-
-    logger_.debug("Got RTP packet of size: {}", data.size());
-
-    std::string_view packet(reinterpret_cast<char *>(data.data()), data.size());
-    // parse the rtp packet
-    RtpJpegPacket rtp_jpeg_packet(packet);
-    auto frag_offset = rtp_jpeg_packet.get_offset();
-    if (frag_offset == 0) {
-      // first fragment
-      logger_.debug("Received first fragment, size: {}, sequence number: {}",
-                    rtp_jpeg_packet.get_data().size(), rtp_jpeg_packet.get_sequence_number());
-      if (jpeg_frame) {
-        // we already have a frame, this is an error
-        logger_.warn("Received first fragment but already have a frame");
-        jpeg_frame.reset();
-      }
-      jpeg_frame = std::make_unique<JpegFrame>(rtp_jpeg_packet);
-    } else if (jpeg_frame) {
-      logger_.debug("Received middle fragment, size: {}, sequence number: {}",
-                    rtp_jpeg_packet.get_data().size(), rtp_jpeg_packet.get_sequence_number());
-      // middle fragment
-      jpeg_frame->append(rtp_jpeg_packet);
-    } else {
-      // we don't have a frame to append to but we got a middle fragment
-      // this is an error
-      logger_.warn("Received middle fragment without a frame");
-      return {};
-    }
-
-    // check if this is the last packet of the frame (the last packet will have
-    // the marker bit set)
-    if (jpeg_frame && jpeg_frame->is_complete()) {
-      // get the jpeg data
-      auto jpeg_data = jpeg_frame->get_data();
-      logger_.debug("Received jpeg frame of size: {} B", jpeg_data.size());
-      // call the on_jpeg_frame callback
-      if (on_jpeg_frame_) {
-        on_jpeg_frame_(std::move(jpeg_frame));
-      }
-      logger_.debug("Sent jpeg frame to callback, now jpeg_frame is nullptr? {}",
-                    jpeg_frame == nullptr);
-    }
+    handle_rtp_packet(std::string_view(reinterpret_cast<char *>(data.data()), data.size()));
     // return an empty vector to indicate that we don't want to send a response
     return {};
   }
@@ -476,6 +495,8 @@ protected:
   espp::UdpSocket rtcp_socket_;
 
   jpeg_frame_callback_t on_jpeg_frame_{nullptr};
+  bool receive_tasks_{true};
+  std::unique_ptr<JpegFrame> jpeg_frame_; ///< The JPEG frame being received
 
   int cseq_ = 0;
   int video_port_ = 0;
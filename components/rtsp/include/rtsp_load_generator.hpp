@@ -0,0 +1,567 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "base_component.hpp"
+#include "rtp_packet_view.hpp"
+#include "rtsp_client.hpp"
+
+namespace espp {
+/// Load generator / soak test for RTSP servers (e.g. an RtspServer).
+///
+/// Connects a growing number of lightweight RtspClients to a server
+/// following a ramp-up profile. Each client runs OPTIONS / DESCRIBE / SETUP /
+/// PLAY (the control plane, from the calling task), but instead of the two
+/// receive tasks of a normal RtspClient, the RTP and RTCP sockets of all
+/// clients are served by a single reactor task (poll()), which checks the
+/// RTP sequence numbers for loss and passes the packets to the clients to
+/// reassemble and validate the JPEG frames. This way a single host can
+/// simulate hundreds of viewers.
+///
+/// Every sample period, the generator records the number of clients, their
+/// frame rate, packet loss and latency, and (on Linux, if the server runs on
+/// the same host) the CPU use of the server process. The latency of a frame
+/// is its transit time (arrival time - RTP timestamp) above the smallest
+/// transit time seen by that client, i.e. the delay added by queueing in the
+/// server and the network, since client and server clocks are not
+/// synchronized. The results can be written as JSON for regression tracking.
+///
+/// \section RtspLoadGenerator example
+/// \snippet rtsp_load_generator.cpp rtsp load generator example
+class RtspLoadGenerator : public BaseComponent {
+public:
+  /// A stage of the load profile
+  struct Stage {
+    size_t num_clients;                      ///< Number of clients at the end of the stage
+    std::chrono::duration<float> ramp_time;  ///< Time to connect (or remove) the clients over
+    std::chrono::duration<float> hold_time;  ///< Time to hold the number of clients afterwards
+  };
+
+  /// Configuration for the load generator
+  struct Config {
+    std::string server_address;   ///< The server IP address
+    int rtsp_port{8554};          ///< The port of the RTSP server
+    std::string path{"/mjpeg/1"}; ///< The path of the stream on the server
+    std::vector<Stage> profile;   ///< The stages of the load, run in order
+    std::chrono::duration<float> sample_period{1.0f}; ///< Period of the samples
+    int server_pid{-1}; ///< PID of the server process to sample the CPU use of (Linux only)
+    Logger::Verbosity client_log_level{Logger::Verbosity::NONE}; ///< The clients' log level
+    Logger::Verbosity log_level{Logger::Verbosity::WARN};        ///< The log level
+  };
+
+  /// Results of a single client
+  struct ClientResult {
+    size_t id{0};                 ///< Index of the client, in connection order
+    bool connected{false};        ///< Whether the client got to PLAY
+    std::string error;            ///< Why the client failed to connect (if it did)
+    float connect_time_ms{0};     ///< Time from connecting to the PLAY response
+    float duration_s{0};          ///< Time the client was playing
+    size_t num_frames{0};         ///< Valid frames received
+    size_t num_invalid_frames{0}; ///< Frames which could not be decoded
+    size_t num_packets{0};        ///< RTP packets received
+    size_t num_packets_lost{0};   ///< RTP packets missing (sequence number gaps)
+    float frame_rate{0};          ///< Average frame rate
+    float median_latency_ms{0};   ///< Median frame latency
+    float max_latency_ms{0};      ///< Maximum frame latency
+  };
+
+  /// A sample of the whole load over time
+  struct Sample {
+    float time_s{0};              ///< Time since the start of the run
+    size_t num_clients{0};        ///< Clients playing
+    size_t num_failed{0};         ///< Clients which failed to connect so far
+    float mean_frame_rate{0};     ///< Mean frame rate of the playing clients
+    float min_frame_rate{0};      ///< Frame rate of the slowest playing client
+    float packet_loss_percent{0}; ///< Packets lost in this sample period
+    float median_latency_ms{0};   ///< Median frame latency in this sample period
+    float p99_latency_ms{0};      ///< 99th percentile frame latency in this sample period
+    float server_cpu_percent{-1}; ///< CPU use of the server process, -1 if unknown
+  };
+
+  /// Results of a run
+  struct Results {
+    std::vector<Sample> samples;       ///< The load over time
+    std::vector<ClientResult> clients; ///< Per client results
+
+    /// Get the results as JSON
+    /// @return The results as a JSON object
+    std::string to_json() const {
+      std::string json = "{\n  \"samples\": [";
+      for (size_t i = 0; i < samples.size(); i++) {
+        const auto &s = samples[i];
+        json += fmt::format(
+            "{}\n    {{\"time_s\": {:.3f}, \"num_clients\": {}, \"num_failed\": {}, "
+            "\"mean_frame_rate\": {:.2f}, \"min_frame_rate\": {:.2f}, "
+            "\"packet_loss_percent\": {:.3f}, \"median_latency_ms\": {:.3f}, "
+            "\"p99_latency_ms\": {:.3f}, \"server_cpu_percent\": {:.2f}}}",
+            i ? "," : "", s.time_s, s.num_clients, s.num_failed, s.mean_frame_rate,
+            s.min_frame_rate, s.packet_loss_percent, s.median_latency_ms, s.p99_latency_ms,
+            s.server_cpu_percent);
+      }
+      json += "\n  ],\n  \"clients\": [";
+      for (size_t i = 0; i < clients.size(); i++) {
+        const auto &c = clients[i];
+        json += fmt::format(
+            "{}\n    {{\"id\": {}, \"connected\": {}, \"error\": \"{}\", "
+            "\"connect_time_ms\": {:.3f}, \"duration_s\": {:.3f}, \"num_frames\": {}, "
+            "\"num_invalid_frames\": {}, \"num_packets\": {}, \"num_packets_lost\": {}, "
+            "\"frame_rate\": {:.2f}, \"median_latency_ms\": {:.3f}, \"max_latency_ms\": {:.3f}}}",
+            i ? "," : "", c.id, c.connected, c.error, c.connect_time_ms, c.duration_s,
+            c.num_frames, c.num_invalid_frames, c.num_packets, c.num_packets_lost, c.frame_rate,
+            c.median_latency_ms, c.max_latency_ms);
+      }
+      json += "\n  ]\n}\n";
+      return json;
+    }
+  };
+
+  /// Construct the load generator
+  /// @param config The configuration for the load generator
+  explicit RtspLoadGenerator(const Config &config)
+      : BaseComponent("RtspLoadGenerator", config.log_level)
+      , config_(config) {}
+
+  /// Run the load profile
+  /// @note Blocks until the whole profile has been run, or stop() is called.
+  /// @return The results of the run
+  Results run() {
+    stopping_ = false;
+    num_clients_ = 0;
+    start_time_ = std::chrono::steady_clock::now();
+    last_sample_time_ = start_time_;
+    next_sample_time_ = start_time_ + sample_duration();
+    last_server_cpu_ = get_server_cpu_time();
+    Results results;
+    std::thread reactor(&RtspLoadGenerator::reactor_fn, this);
+
+    for (const auto &stage : config_.profile) {
+      if (stopping_) {
+        break;
+      }
+      // clients which failed to connect count towards the stage's clients,
+      // so that the server's limit shows as failures
+      size_t start_count = num_clients_;
+      size_t num_steps = std::max(start_count, stage.num_clients) -
+                         std::min(start_count, stage.num_clients);
+      auto stage_start = std::chrono::steady_clock::now();
+      auto ramp = std::chrono::duration_cast<std::chrono::steady_clock::duration>(stage.ramp_time);
+      for (size_t step = 1; step <= num_steps && !stopping_; step++) {
+        wait_until(stage_start + ramp * step / num_steps, results);
+        if (stage.num_clients > start_count) {
+          add_client();
+        } else {
+          remove_client(results);
+        }
+      }
+      auto hold = std::chrono::duration_cast<std::chrono::steady_clock::duration>(stage.hold_time);
+      wait_until(stage_start + ramp + hold, results);
+    }
+
+    // remove all clients, keeping their results
+    while (num_clients_ > 0) {
+      remove_client(results);
+    }
+    stopping_ = true;
+    reactor.join();
+    {
+      std::lock_guard<std::mutex> lk(clients_mutex_);
+      for (auto &client : failed_) {
+        results.clients.push_back(client->result);
+      }
+      failed_.clear();
+    }
+    std::sort(results.clients.begin(), results.clients.end(),
+              [](const auto &a, const auto &b) { return a.id < b.id; });
+    return results;
+  }
+
+  /// Stop a run early (e.g. from a signal handler's task)
+  void stop() { stopping_ = true; }
+
+protected:
+  struct Client {
+    ClientResult result;
+    std::unique_ptr<RtspClient> rtsp;
+    int rtp_fd{-1};
+    int rtcp_fd{-1};
+    std::chrono::steady_clock::time_point play_time;
+    // updated by the reactor
+    bool have_sequence{false};
+    uint16_t last_sequence{0};
+    bool have_transit{false};
+    double min_transit_ms{0};
+    double last_transit_ms{0};
+    std::vector<float> latencies_ms;
+    // read by the sampler (under clients_mutex_)
+    std::atomic<size_t> frames{0};
+    std::atomic<size_t> packets{0};
+    std::atomic<size_t> lost{0};
+    size_t sampled_frames{0};
+    size_t sampled_packets{0};
+    size_t sampled_lost{0};
+
+    ~Client() {
+      if (rtp_fd >= 0) {
+        ::close(rtp_fd);
+      }
+      if (rtcp_fd >= 0) {
+        ::close(rtcp_fd);
+      }
+    }
+  };
+
+  std::chrono::steady_clock::duration sample_duration() const {
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(config_.sample_period);
+  }
+
+  // sleep until the deadline, taking the samples which are due meanwhile
+  void wait_until(std::chrono::steady_clock::time_point deadline, Results &results) {
+    while (!stopping_) {
+      auto now = std::chrono::steady_clock::now();
+      if (now >= next_sample_time_) {
+        results.samples.push_back(take_sample(now));
+        next_sample_time_ += sample_duration();
+        continue;
+      }
+      if (now >= deadline) {
+        return;
+      }
+      std::this_thread::sleep_until(std::min(deadline, next_sample_time_));
+    }
+  }
+
+  static int open_udp_socket(uint16_t &port) {
+    int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+      return -1;
+    }
+    // bursts of frames to many clients queue up while the reactor is busy
+    int buffer_size = 1024 * 1024;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+    struct sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = 0;
+    socklen_t addr_len = sizeof(addr);
+    if (::bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        getsockname(fd, (struct sockaddr *)&addr, &addr_len) < 0) {
+      ::close(fd);
+      return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    port = ntohs(addr.sin_port);
+    return fd;
+  }
+
+  void add_client() {
+    num_clients_++;
+    auto client = std::make_unique<Client>();
+    client->result.id = next_client_id_++;
+    Client *c = client.get();
+    client->rtsp = std::make_unique<RtspClient>(RtspClient::Config{
+        .server_address = config_.server_address,
+        .rtsp_port = config_.rtsp_port,
+        .path = config_.path,
+        .on_jpeg_frame = [this, c](auto frame) { handle_frame(*c, std::move(frame)); },
+        .receive_tasks = false,
+        .log_level = config_.client_log_level,
+    });
+    uint16_t rtp_port = 0;
+    uint16_t rtcp_port = 0;
+    client->rtp_fd = open_udp_socket(rtp_port);
+    client->rtcp_fd = open_udp_socket(rtcp_port);
+    auto start = std::chrono::steady_clock::now();
+    std::error_code ec;
+    if (client->rtp_fd < 0 || client->rtcp_fd < 0) {
+      ec = std::error_code(errno, std::generic_category());
+    }
+    client->rtsp->connect(ec);
+    client->rtsp->describe(ec);
+    client->rtsp->setup(rtp_port, rtcp_port, ec);
+    client->rtsp->play(ec);
+    auto end = std::chrono::steady_clock::now();
+    client->result.connect_time_ms = std::chrono::duration<float, std::milli>(end - start).count();
+    client->play_time = end;
+    if (ec) {
+      logger_.warn("Client {} failed to connect: {}", client->result.id, ec.message());
+      client->result.error = ec.message();
+      client->rtsp.reset();
+      std::lock_guard<std::mutex> lk(clients_mutex_);
+      failed_.push_back(std::move(client));
+      return;
+    }
+    client->result.connected = true;
+    logger_.info("Client {} playing, connected in {:.1f} ms", client->result.id,
+                 client->result.connect_time_ms);
+    std::lock_guard<std::mutex> lk(clients_mutex_);
+    clients_.push_back(std::move(client));
+    clients_changed_ = true;
+  }
+
+  // remove the newest playing client (if any), with a TEARDOWN
+  void remove_client(Results &results) {
+    num_clients_--;
+    std::unique_ptr<Client> client;
+    {
+      std::lock_guard<std::mutex> lk(clients_mutex_);
+      if (clients_.empty()) {
+        return;
+      }
+      client = std::move(clients_.back());
+      clients_.pop_back();
+      clients_changed_ = true;
+    }
+    // wait for the reactor to stop using the client
+    std::unique_lock<std::mutex> lk(reactor_mutex_);
+    finish_client(*client);
+    results.clients.push_back(client->result);
+    lk.unlock();
+    std::error_code ec;
+    client->rtsp->disconnect(ec);
+  }
+
+  // NOTE: must be called with reactor_mutex_ held
+  void finish_client(Client &client) {
+    auto &r = client.result;
+    r.duration_s =
+        std::chrono::duration<float>(std::chrono::steady_clock::now() - client.play_time).count();
+    r.num_frames = client.frames;
+    r.num_packets = client.packets;
+    r.num_packets_lost = client.lost;
+    r.frame_rate = r.duration_s > 0 ? r.num_frames / r.duration_s : 0;
+    auto &latencies = client.latencies_ms;
+    if (!latencies.empty()) {
+      std::sort(latencies.begin(), latencies.end());
+      r.median_latency_ms = latencies[latencies.size() / 2];
+      r.max_latency_ms = latencies.back();
+    }
+  }
+
+  Sample take_sample(std::chrono::steady_clock::time_point now) {
+    Sample sample;
+    sample.time_s = std::chrono::duration<float>(now - start_time_).count();
+    float period = std::chrono::duration<float>(now - last_sample_time_).count();
+    last_sample_time_ = now;
+    std::vector<float> latencies;
+    size_t packets = 0;
+    size_t lost = 0;
+    float total_frame_rate = 0;
+    sample.min_frame_rate = std::numeric_limits<float>::max();
+    {
+      // same lock order as the reactor
+      std::lock_guard<std::mutex> reactor_lk(reactor_mutex_);
+      std::lock_guard<std::mutex> lk(clients_mutex_);
+      sample.num_clients = clients_.size();
+      sample.num_failed = failed_.size();
+      for (auto &client : clients_) {
+        size_t frames = client->frames;
+        size_t client_packets = client->packets;
+        size_t client_lost = client->lost;
+        float frame_rate = (frames - client->sampled_frames) / period;
+        total_frame_rate += frame_rate;
+        sample.min_frame_rate = std::min(sample.min_frame_rate, frame_rate);
+        packets += client_packets - client->sampled_packets;
+        lost += client_lost - client->sampled_lost;
+        client->sampled_frames = frames;
+        client->sampled_packets = client_packets;
+        client->sampled_lost = client_lost;
+      }
+      std::swap(latencies, interval_latencies_ms_);
+    }
+    if (sample.num_clients == 0) {
+      sample.min_frame_rate = 0;
+    } else {
+      sample.mean_frame_rate = total_frame_rate / sample.num_clients;
+    }
+    if (packets + lost > 0) {
+      sample.packet_loss_percent = 100.0f * lost / (packets + lost);
+    }
+    if (!latencies.empty()) {
+      std::sort(latencies.begin(), latencies.end());
+      sample.median_latency_ms = latencies[latencies.size() / 2];
+      sample.p99_latency_ms = latencies[latencies.size() * 99 / 100];
+    }
+    float server_cpu = get_server_cpu_time();
+    if (server_cpu >= 0 && last_server_cpu_ >= 0) {
+      sample.server_cpu_percent = 100.0f * (server_cpu - last_server_cpu_) / period;
+    }
+    last_server_cpu_ = server_cpu;
+    logger_.info("{:.1f} s: {} clients ({} failed), {:.1f} fps (min {:.1f}), {:.2f}% loss, "
+                 "latency {:.2f} ms (p99 {:.2f} ms), server CPU {:.1f}%",
+                 sample.time_s, sample.num_clients, sample.num_failed, sample.mean_frame_rate,
+                 sample.min_frame_rate, sample.packet_loss_percent, sample.median_latency_ms,
+                 sample.p99_latency_ms, sample.server_cpu_percent);
+    return sample;
+  }
+
+  // CPU time (user + system) of the server process in seconds, -1 if unknown
+  float get_server_cpu_time() const {
+#if defined(__linux__)
+    if (config_.server_pid < 0) {
+      return -1;
+    }
+    std::ifstream file("/proc/" + std::to_string(config_.server_pid) + "/stat");
+    std::string stat;
+    if (!std::getline(file, stat)) {
+      return -1;
+    }
+    // the fields after the command (which may contain spaces): state is
+    // field 3, utime and stime are fields 14 and 15
+    auto pos = stat.rfind(')');
+    if (pos == std::string::npos) {
+      return -1;
+    }
+    std::istringstream fields(stat.substr(pos + 2));
+    std::string field;
+    unsigned long long utime = 0, stime = 0;
+    for (int i = 3; i <= 15 && fields >> field; i++) {
+      if (i == 14) {
+        utime = std::stoull(field);
+      } else if (i == 15) {
+        stime = std::stoull(field);
+      }
+    }
+    return float(utime + stime) / sysconf(_SC_CLK_TCK);
+#else
+    return -1;
+#endif
+  }
+
+  void reactor_fn() {
+    std::vector<struct pollfd> fds;
+    std::vector<Client *> fd_clients;
+    std::vector<uint8_t> buffer(64 * 1024);
+    while (!stopping_) {
+      {
+        std::lock_guard<std::mutex> lk(clients_mutex_);
+        if (clients_changed_) {
+          clients_changed_ = false;
+          fds.clear();
+          fd_clients.clear();
+          for (auto &client : clients_) {
+            fds.push_back({client->rtp_fd, POLLIN, 0});
+            fds.push_back({client->rtcp_fd, POLLIN, 0});
+            fd_clients.push_back(client.get());
+            fd_clients.push_back(client.get());
+          }
+        }
+      }
+      // wake up regularly to pick up new clients and to stop
+      int num_ready = ::poll(fds.data(), fds.size(), REACTOR_POLL_MS);
+      if (num_ready <= 0) {
+        if (fds.empty()) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(REACTOR_POLL_MS));
+        }
+        continue;
+      }
+      std::lock_guard<std::mutex> lk(reactor_mutex_);
+      for (size_t i = 0; i < fds.size(); i++) {
+        if (!(fds[i].revents & POLLIN)) {
+          continue;
+        }
+        // removed clients are still in the list until it is rebuilt
+        if (!is_playing(fd_clients[i])) {
+          clients_changed_ = true;
+          continue;
+        }
+        bool is_rtp = i % 2 == 0;
+        // drain the socket
+        while (true) {
+          ssize_t size = ::recv(fds[i].fd, buffer.data(), buffer.size(), 0);
+          if (size <= 0) {
+            break;
+          }
+          if (is_rtp) {
+            handle_rtp(*fd_clients[i], std::string_view((const char *)buffer.data(), size));
+          }
+        }
+      }
+    }
+  }
+
+  bool is_playing(const Client *client) {
+    std::lock_guard<std::mutex> lk(clients_mutex_);
+    return std::any_of(clients_.begin(), clients_.end(),
+                       [client](const auto &c) { return c.get() == client; });
+  }
+
+  // NOTE: called by the reactor with reactor_mutex_ held
+  void handle_rtp(Client &client, std::string_view packet) {
+    RtpPacketView rtp(packet);
+    if (!rtp.is_valid()) {
+      return;
+    }
+    client.packets++;
+    uint16_t sequence = rtp.get_sequence_number();
+    if (client.have_sequence) {
+      uint16_t gap = sequence - client.last_sequence - 1;
+      // ignore reordered / duplicated packets
+      if (gap < 0x8000) {
+        client.lost += gap;
+      }
+    }
+    client.have_sequence = true;
+    client.last_sequence = sequence;
+    // transit time of the packet, relative to the server's RTP clock (90 kHz)
+    double now_ms = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - start_time_)
+                        .count();
+    double transit_ms = now_ms - rtp.get_timestamp() / 90.0;
+    if (!client.have_transit || transit_ms < client.min_transit_ms) {
+      client.have_transit = true;
+      client.min_transit_ms = transit_ms;
+    }
+    client.last_transit_ms = transit_ms;
+    client.rtsp->handle_rtp_packet(packet);
+  }
+
+  // NOTE: called by the reactor with reactor_mutex_ held
+  void handle_frame(Client &client, std::unique_ptr<JpegFrame> frame) {
+    if (!frame || frame->get_width() <= 0 || frame->get_height() <= 0 ||
+        frame->get_scan_data().empty()) {
+      client.result.num_invalid_frames++;
+      return;
+    }
+    client.frames++;
+    // the frame is complete when its last packet arrives
+    float latency_ms = client.last_transit_ms - client.min_transit_ms;
+    client.latencies_ms.push_back(latency_ms);
+    interval_latencies_ms_.push_back(latency_ms);
+  }
+
+  static constexpr int REACTOR_POLL_MS = 10;
+
+  Config config_;
+  std::atomic<bool> stopping_{false};
+  std::chrono::steady_clock::time_point start_time_;
+  std::chrono::steady_clock::time_point last_sample_time_;
+  std::chrono::steady_clock::time_point next_sample_time_;
+  float last_server_cpu_{-1};
+  size_t next_client_id_{0};
+  // clients added and not removed yet, including the failed ones
+  size_t num_clients_{0};
+
+  std::mutex clients_mutex_;
+  std::vector<std::unique_ptr<Client>> clients_;
+  std::vector<std::unique_ptr<Client>> failed_;
+  std::atomic<bool> clients_changed_{false};
+
+  // held by the reactor while it handles packets
+  std::mutex reactor_mutex_;
+  std::vector<float> interval_latencies_ms_;
+};
+} // namespace espp
@@ -3,6 +3,7 @@
 #include <memory>
 #include <string>
 #include <system_error>
+#include <unordered_map>
 #include <vector>
 
 #if defined(ESP_PLATFORM)
@@ -12,11 +13,13 @@
 #endif
 
 #include "base_component.hpp"
+#include "clock.hpp"
 #include "task.hpp"
 #include "tcp_socket.hpp"
 #include "udp_socket.hpp"
 
 #include "jpeg_frame.hpp"
+#include "mjpeg_server.hpp"
 #include "rtcp_packet.hpp"
 #include "rtp_jpeg_packet.hpp"
 #include "rtp_packet.hpp"
@@ -56,6 +59,8 @@ public:
       , path_(config.path)
       , rtsp_socket_({.log_level = espp::Logger::Verbosity::WARN})
       , max_data_size_(config.max_data_size) {
+    // allow stop() to interrupt the accept task
+    rtsp_socket_.set_cancellation_token(std::make_shared<CancellationToken>());
     // generate a random ssrc
 #if defined(ESP_PLATFORM)
     ssrc_ = esp_random();
@@ -77,6 +82,13 @@ public:
   /// @param log_level The log level to set
   void set_session_log_level(Logger::Verbosity log_level) { session_log_level_ = log_level; }
 
+  /// @brief Also send the frames passed to send_frame() to an MjpegServer
+  /// This serves the same stream to HTTP clients (e.g. browsers) which
+  /// cannot play RTSP, without a transcoding proxy.
+  /// @param mjpeg_server The MJPEG server, which must outlive this server, or
+  ///        nullptr to stop sending frames to it
+  void set_mjpeg_server(MjpegServer *mjpeg_server) { mjpeg_server_ = mjpeg_server; }
+
   /// @brief Start the RTSP server
   /// Starts the accept task, session task, and binds the RTSP socket
   /// @return True if the server was started successfully, false otherwise
@@ -88,6 +100,12 @@ public:
 
     logger_.info("Starting RTSP server on port {}", port_);
 
+    // if we were previously stopped, reopen the socket
+    if (!rtsp_socket_.is_valid()) {
+      rtsp_socket_.reinit();
+    }
+    rtsp_socket_.get_cancellation_token()->reset();
+
     if (!rtsp_socket_.bind(port_)) {
       logger_.error("Failed to bind to port {}", port_);
       return false;
@@ -110,11 +128,15 @@ public:
     return true;
   }
 
-  /// @brief Stop the FTP server
+  /// @brief Stop the RTSP server
   /// Stops the accept task, session task, and closes the RTSP socket
+  /// @note This interrupts the accept task and the sessions' control tasks,
+  ///       so it does not wait for a client to connect or send a request.
+  ///       The server can be started again afterwards.
   void stop() {
     logger_.info("Stopping RTSP server");
     // stop the accept task
+    rtsp_socket_.get_cancellation_token()->cancel();
     if (accept_task_) {
       accept_task_->stop();
     }
@@ -123,7 +145,10 @@ public:
       session_task_->stop();
     }
     // clear the list of sessions
-    sessions_.clear();
+    {
+      std::lock_guard<std::mutex> lk(session_mutex_);
+      sessions_.clear();
+    }
     // close the RTSP socket
     rtsp_socket_.close();
   }
@@ -133,8 +158,14 @@ public:
   /// packets and stores it to be sent over the RTP socket, but does not
   /// actually send it
   /// @note Overwrites any existing frame that has not been sent
+  /// @note Also sends the frame to the MjpegServer, if one was set with
+  ///       set_mjpeg_server()
   /// @param frame The frame to send
   void send_frame(const JpegFrame &frame) {
+    if (mjpeg_server_) {
+      mjpeg_server_->send_frame(frame);
+    }
+
     // get the frame scan data
     auto frame_header = frame.get_header();
     auto frame_data = frame.get_scan_data();
@@ -184,8 +215,8 @@ public:
       // set the sequence number
       packet->set_sequence_number(sequence_number_++);
       // set the timestamp
-      static auto start_time = std::chrono::steady_clock::now();
-      auto now = std::chrono::steady_clock::now();
+      static auto start_time = Clock::now();
+      auto now = Clock::now();
       auto timestamp =
           std::chrono::duration_cast<std::chrono::milliseconds>(now - start_time).count();
       packet->set_timestamp(timestamp * 90);
@@ -220,6 +251,10 @@ protected:
   bool accept_task_function(std::mutex &m, std::condition_variable &cv) {
     // accept a new connection
     auto control_socket = rtsp_socket_.accept();
+    if (!control_socket && rtsp_socket_.is_cancelled()) {
+      logger_.debug("Accept cancelled, stopping accept task");
+      return true;
+    }
     if (!control_socket) {
       logger_.error("Failed to accept new connection");
       return false;
@@ -236,7 +271,10 @@ protected:
 
     // add the session to the list of sessions
     auto session_id = session->get_session_id();
-    sessions_.emplace(session_id, std::move(session));
+    {
+      std::lock_guard<std::mutex> lk(session_mutex_);
+      sessions_.emplace(session_id, std::move(session));
+    }
 
     // start the session task if it is not already running
     using namespace std::placeholders;
@@ -322,12 +360,14 @@ protected:
 
   size_t max_data_size_;
 
+  MjpegServer *mjpeg_server_{nullptr};
+
   std::mutex rtp_packets_mutex_;
   std::vector<std::unique_ptr<RtpJpegPacket>> rtp_packets_;
 
   Logger::Verbosity session_log_level_{Logger::Verbosity::WARN};
   std::mutex session_mutex_;
-  std::unordered_map<int, std::unique_ptr<RtspSession>> sessions_;
+  std::unordered_map<uint32_t, std::unique_ptr<RtspSession>> sessions_;
 
   std::unique_ptr<Task> accept_task_;
   std::unique_ptr<Task> session_task_;
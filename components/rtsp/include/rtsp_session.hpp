@@ -45,6 +45,8 @@ public:
       , client_address_(control_socket_->get_remote_info().address) {
     // set the logger tag to include the session id
     logger_.set_tag("RtspSession " + std::to_string(session_id_));
+    // allow the destructor to interrupt the control task
+    control_socket_->set_cancellation_token(cancellation_token_);
     // start the session task to handle RTSP commands
     using namespace std::placeholders;
     control_task_ = std::make_unique<Task>(Task::Config{
@@ -58,6 +60,7 @@ public:
 
   ~RtspSession() {
     teardown();
+    cancellation_token_->cancel();
     // stop the session task
     if (control_task_ && control_task_->is_started()) {
       logger_.info("Stopping control task");
@@ -503,6 +506,7 @@ protected:
     return true;
   }
 
+  std::shared_ptr<CancellationToken> cancellation_token_{std::make_shared<CancellationToken>()};
   std::unique_ptr<espp::TcpSocket> control_socket_;
   espp::UdpSocket rtp_socket_;
   espp::UdpSocket rtcp_socket_;
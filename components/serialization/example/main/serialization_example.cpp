@@ -1,10 +1,12 @@
 #include <bitset>
 #include <chrono>
+#include <cstring>
 #include <thread>
 #include <vector>
 
 #include "format.hpp"
 #include "serialization.hpp"
+#include "time_series.hpp"
 
 using namespace std::chrono_literals;
 
@@ -150,6 +152,43 @@ extern "C" void app_main(void) {
     //! [bitfield serialization example]
   }
 
+  {
+    fmt::print("Starting time series example!\n");
+    //! [time series example]
+    struct Sample {
+      uint32_t timestamp_ms;
+      float temperature;
+      int16_t accel_z;
+      uint8_t status;
+    };
+    // one second of 100 Hz samples
+    std::vector<Sample> samples;
+    for (uint32_t i = 0; i < 100; i++) {
+      samples.push_back({.timestamp_ms = i * 10,
+                         .temperature = 25.0f + (i / 20) * 0.0625f,
+                         .accel_z = int16_t(1000 + (i % 5) - 2),
+                         .status = 1});
+    }
+    espp::TimeSeriesEncoder<Sample> encoder;
+    std::vector<uint8_t> buffer;
+    auto bytes_written = encoder.encode(samples, buffer);
+    fmt::print("Encoded {} samples into {}B ({:.2f} B / sample)\n", samples.size(), bytes_written,
+               float(bytes_written) / samples.size());
+    for (auto codec : encoder.get_selected_codecs()) {
+      fmt::print("\tcodec: {}\n", codec);
+    }
+    espp::TimeSeriesDecoder<Sample> decoder;
+    std::vector<Sample> decoded;
+    std::error_code ec;
+    if (decoder.decode(buffer, decoded, ec) && decoded.size() == samples.size() &&
+        std::memcmp(decoded.data(), samples.data(), samples.size() * sizeof(Sample)) == 0) {
+      fmt::print("Decoded successfully!\n");
+    } else {
+      fmt::print("Decoding failed: {}\n", ec.message());
+    }
+    //! [time series example]
+  }
+
   fmt::print("Serialization example complete!\n");
 
   while (true) {
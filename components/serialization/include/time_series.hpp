@@ -0,0 +1,785 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <system_error>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "format.hpp"
+
+namespace espp {
+/**
+ * @brief Encoding of a single field (column) of a time series.
+ *
+ * @details Integer (and enum / bool) fields can be encoded as their values,
+ *          their deltas (x[i] - x[i-1]) or their deltas of deltas (for
+ *          values which change at a roughly constant rate, such as
+ *          timestamps), each of which is zigzag encoded and then packed
+ *          either as a varint or bit-packed in blocks of 32 values sharing a
+ *          bit width. Floating point fields are XOR encoded (as in Facebook's
+ *          Gorilla): consecutive values which share their sign, exponent and
+ *          high mantissa bits only store the bits which changed.
+ */
+enum class TimeSeriesCodec : uint8_t {
+  AUTO,                   ///< Encoder picks the smallest encoding for the field.
+  RAW,                    ///< Fixed width, little endian (like fixed_length_encoding).
+  VARINT,                 ///< Zigzag varints of the values.
+  DELTA_VARINT,           ///< Zigzag varints of the deltas.
+  DELTA_OF_DELTA_VARINT,  ///< Zigzag varints of the deltas of the deltas.
+  BITPACK,                ///< Bit-packed zigzag values.
+  DELTA_BITPACK,          ///< Bit-packed zigzag deltas.
+  DELTA_OF_DELTA_BITPACK, ///< Bit-packed zigzag deltas of the deltas.
+  XOR,                    ///< XOR with the previous value (floating point fields only).
+};
+
+namespace detail {
+/// Type which converts to anything, used to count the fields of an aggregate.
+struct AnyField {
+  template <class T> constexpr operator T() const noexcept { return {}; }
+};
+
+/// Number of fields of the aggregate T, found by trying to brace-initialize
+/// it with more and more values (the same way alpaca reflects types).
+template <class T, class... Fields> constexpr size_t count_fields() {
+  if constexpr (sizeof...(Fields) <= 16 && requires { T{Fields{}..., AnyField{}}; }) {
+    return count_fields<T, Fields..., AnyField>();
+  } else {
+    return sizeof...(Fields);
+  }
+}
+
+/// Tie the fields of the aggregate \p t into a tuple of references.
+template <class T> constexpr auto tie_fields(T &t) {
+  constexpr size_t n = count_fields<std::remove_cv_t<T>>();
+  static_assert(n > 0 && n <= 16, "Time series samples must have 1 - 16 fields");
+  if constexpr (n == 1) {
+    auto &[f0] = t;
+    return std::tie(f0);
+  } else if constexpr (n == 2) {
+    auto &[f0, f1] = t;
+    return std::tie(f0, f1);
+  } else if constexpr (n == 3) {
+    auto &[f0, f1, f2] = t;
+    return std::tie(f0, f1, f2);
+  } else if constexpr (n == 4) {
+    auto &[f0, f1, f2, f3] = t;
+    return std::tie(f0, f1, f2, f3);
+  } else if constexpr (n == 5) {
+    auto &[f0, f1, f2, f3, f4] = t;
+    return std::tie(f0, f1, f2, f3, f4);
+  } else if constexpr (n == 6) {
+    auto &[f0, f1, f2, f3, f4, f5] = t;
+    return std::tie(f0, f1, f2, f3, f4, f5);
+  } else if constexpr (n == 7) {
+    auto &[f0, f1, f2, f3, f4, f5, f6] = t;
+    return std::tie(f0, f1, f2, f3, f4, f5, f6);
+  } else if constexpr (n == 8) {
+    auto &[f0, f1, f2, f3, f4, f5, f6, f7] = t;
+    return std::tie(f0, f1, f2, f3, f4, f5, f6, f7);
+  } else if constexpr (n == 9) {
+    auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8] = t;
+    return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8);
+  } else if constexpr (n == 10) {
+    auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9] = t;
+    return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9);
+  } else if constexpr (n == 11) {
+    auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10] = t;
+    return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10);
+  } else if constexpr (n == 12) {
+    auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11] = t;
+    return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11);
+  } else if constexpr (n == 13) {
+    auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12] = t;
+    return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12);
+  } else if constexpr (n == 14) {
+    auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13] = t;
+    return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13);
+  } else if constexpr (n == 15) {
+    auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14] = t;
+    return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14);
+  } else if constexpr (n == 16) {
+    auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15] = t;
+    return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15);
+  }
+}
+
+/// Fields which can be encoded in a time series.
+template <class F>
+concept TimeSeriesField = std::is_arithmetic_v<F> || std::is_enum_v<F>;
+
+/// Descriptor of a field, stored in the header to validate the schema:
+/// bit 7 = floating point, bit 6 = signed, bits 0-3 = size in bytes.
+template <class F> struct field_value {
+  using type = F;
+};
+template <class F>
+requires std::is_enum_v<F>
+struct field_value<F> {
+  using type = std::underlying_type_t<F>;
+};
+
+template <class F> constexpr uint8_t field_descriptor() {
+  using V = typename field_value<F>::type;
+  return (std::is_floating_point_v<V> ? 0x80 : 0) | (std::is_signed_v<V> ? 0x40 : 0) |
+         uint8_t(sizeof(V));
+}
+
+/// Value of a field as 64 bits: floating point values as their bit pattern,
+/// integers sign (or zero) extended.
+template <class F> uint64_t field_to_bits(const F &value) {
+  if constexpr (std::is_same_v<F, float>) {
+    return std::bit_cast<uint32_t>(value);
+  } else if constexpr (std::is_same_v<F, double>) {
+    return std::bit_cast<uint64_t>(value);
+  } else if constexpr (std::is_enum_v<F>) {
+    return uint64_t(int64_t(std::underlying_type_t<F>(value)));
+  } else {
+    return uint64_t(int64_t(value));
+  }
+}
+
+/// Inverse of field_to_bits().
+template <class F> F field_from_bits(uint64_t bits) {
+  if constexpr (std::is_same_v<F, float>) {
+    return std::bit_cast<float>(uint32_t(bits));
+  } else if constexpr (std::is_same_v<F, double>) {
+    return std::bit_cast<double>(bits);
+  } else if constexpr (std::is_enum_v<F>) {
+    return F(std::underlying_type_t<F>(bits));
+  } else if constexpr (std::is_same_v<F, bool>) {
+    return bits != 0;
+  } else {
+    return F(bits);
+  }
+}
+
+inline uint64_t zigzag_encode(uint64_t value) {
+  return (value << 1) ^ uint64_t(int64_t(value) >> 63);
+}
+
+inline uint64_t zigzag_decode(uint64_t value) { return (value >> 1) ^ (~(value & 1) + 1); }
+
+inline size_t varint_size(uint64_t value) {
+  return std::max<size_t>(1, (std::bit_width(value) + 6) / 7);
+}
+
+inline void write_varint(std::vector<uint8_t> &output, uint64_t value) {
+  while (value >= 0x80) {
+    output.push_back(uint8_t(value) | 0x80);
+    value >>= 7;
+  }
+  output.push_back(uint8_t(value));
+}
+
+/// Writes bits LSB first.
+class BitWriter {
+public:
+  explicit BitWriter(std::vector<uint8_t> &output)
+      : output_(output) {}
+
+  void write(uint64_t value, unsigned num_bits) {
+    if (num_bits > 32) {
+      write(value & 0xffffffff, 32);
+      write(value >> 32, num_bits - 32);
+      return;
+    }
+    if (num_bits < 32) {
+      value &= (uint64_t(1) << num_bits) - 1;
+    }
+    accumulator_ |= value << num_pending_;
+    num_pending_ += num_bits;
+    while (num_pending_ >= 8) {
+      output_.push_back(uint8_t(accumulator_));
+      accumulator_ >>= 8;
+      num_pending_ -= 8;
+    }
+  }
+
+  void flush() {
+    if (num_pending_ > 0) {
+      output_.push_back(uint8_t(accumulator_));
+    }
+    accumulator_ = 0;
+    num_pending_ = 0;
+  }
+
+protected:
+  std::vector<uint8_t> &output_;
+  uint64_t accumulator_{0};
+  unsigned num_pending_{0};
+};
+
+/// Bounds-checked reader for bytes, varints and bits (LSB first).
+class ByteReader {
+public:
+  explicit ByteReader(std::span<const uint8_t> data)
+      : data_(data) {}
+
+  bool read_byte(uint8_t &value) {
+    if (position_ >= data_.size()) {
+      return false;
+    }
+    value = data_[position_++];
+    return true;
+  }
+
+  bool read_varint(uint64_t &value) {
+    value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+      uint8_t byte;
+      if (!read_byte(byte)) {
+        return false;
+      }
+      value |= uint64_t(byte & 0x7f) << shift;
+      if (!(byte & 0x80)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool read_span(size_t size, std::span<const uint8_t> &span) {
+    if (data_.size() - position_ < size) {
+      return false;
+    }
+    span = data_.subspan(position_, size);
+    position_ += size;
+    return true;
+  }
+
+  bool read_bits(unsigned num_bits, uint64_t &value) {
+    value = 0;
+    for (unsigned shift = 0; shift < num_bits;) {
+      if (num_bits_left_ == 0) {
+        if (!read_byte(bits_)) {
+          return false;
+        }
+        num_bits_left_ = 8;
+      }
+      unsigned count = std::min(num_bits - shift, num_bits_left_);
+      value |= uint64_t(bits_ & ((1u << count) - 1)) << shift;
+      bits_ >>= count;
+      num_bits_left_ -= count;
+      shift += count;
+    }
+    return true;
+  }
+
+  void align() { num_bits_left_ = 0; }
+
+  bool at_end() const { return position_ == data_.size(); }
+
+protected:
+  std::span<const uint8_t> data_;
+  size_t position_{0};
+  uint8_t bits_{0};
+  unsigned num_bits_left_{0};
+};
+
+/// Number of values which share a bit width when bit-packed.
+static constexpr size_t BITPACK_BLOCK_SIZE = 32;
+/// Number of bits used to store the leading zeros of an XOR.
+static constexpr unsigned XOR_LEADING_BITS = 5;
+
+// transforms the values in place: 0 = none, 1 = delta, 2 = delta of delta
+inline void apply_transform(std::span<uint64_t> values, int order) {
+  for (int o = 0; o < order; o++) {
+    uint64_t previous = 0;
+    for (auto &value : values) {
+      uint64_t current = value;
+      value = current - previous;
+      previous = current;
+    }
+  }
+}
+
+inline void invert_transform(std::span<uint64_t> values, int order) {
+  for (int o = 0; o < order; o++) {
+    uint64_t previous = 0;
+    for (auto &value : values) {
+      value += previous;
+      previous = value;
+    }
+  }
+}
+
+inline size_t bitpacked_size(std::span<const uint64_t> values) {
+  size_t size = 0;
+  for (size_t start = 0; start < values.size(); start += BITPACK_BLOCK_SIZE) {
+    auto block = values.subspan(start, std::min(BITPACK_BLOCK_SIZE, values.size() - start));
+    uint64_t all_bits = 0;
+    for (auto value : block) {
+      all_bits |= value;
+    }
+    size += 1 + (block.size() * std::bit_width(all_bits) + 7) / 8;
+  }
+  return size;
+}
+
+inline void write_bitpacked(std::vector<uint8_t> &output, std::span<const uint64_t> values) {
+  for (size_t start = 0; start < values.size(); start += BITPACK_BLOCK_SIZE) {
+    auto block = values.subspan(start, std::min(BITPACK_BLOCK_SIZE, values.size() - start));
+    uint64_t all_bits = 0;
+    for (auto value : block) {
+      all_bits |= value;
+    }
+    unsigned width = std::bit_width(all_bits);
+    output.push_back(uint8_t(width));
+    BitWriter writer(output);
+    for (auto value : block) {
+      writer.write(value, width);
+    }
+    writer.flush();
+  }
+}
+
+inline bool read_bitpacked(ByteReader &reader, std::span<uint64_t> values) {
+  for (size_t start = 0; start < values.size(); start += BITPACK_BLOCK_SIZE) {
+    auto block = values.subspan(start, std::min(BITPACK_BLOCK_SIZE, values.size() - start));
+    uint8_t width;
+    if (!reader.read_byte(width) || width > 64) {
+      return false;
+    }
+    for (auto &value : block) {
+      if (!reader.read_bits(width, value)) {
+        return false;
+      }
+    }
+    reader.align();
+  }
+  return true;
+}
+
+/// XOR (Gorilla) encoding of the bit patterns of \p WIDTH bit floating point
+/// values.
+template <unsigned WIDTH>
+void write_xor(std::vector<uint8_t> &output, std::span<const uint64_t> values) {
+  constexpr unsigned length_bits = std::bit_width(WIDTH - 1);
+  BitWriter writer(output);
+  uint64_t previous = 0;
+  unsigned previous_leading = WIDTH + 1; // no previous window yet
+  unsigned previous_trailing = 0;
+  for (size_t i = 0; i < values.size(); i++) {
+    if (i == 0) {
+      writer.write(values[0], WIDTH);
+      previous = values[0];
+      continue;
+    }
+    uint64_t x = values[i] ^ previous;
+    previous = values[i];
+    if (x == 0) {
+      writer.write(0, 1);
+      continue;
+    }
+    unsigned leading = std::min<unsigned>(std::countl_zero(x) - (64 - WIDTH), 31);
+    unsigned trailing = std::countr_zero(x);
+    if (previous_leading <= WIDTH && leading >= previous_leading &&
+        trailing >= previous_trailing) {
+      // the changed bits fit into the previous window
+      writer.write(0b01, 2);
+      writer.write(x >> previous_trailing, WIDTH - previous_leading - previous_trailing);
+    } else {
+      unsigned length = WIDTH - leading - trailing;
+      writer.write(0b11, 2);
+      writer.write(leading, XOR_LEADING_BITS);
+      writer.write(length - 1, length_bits);
+      writer.write(x >> trailing, length);
+      previous_leading = leading;
+      previous_trailing = trailing;
+    }
+  }
+  writer.flush();
+}
+
+/// Inverse of write_xor().
+template <unsigned WIDTH> bool read_xor(ByteReader &reader, std::span<uint64_t> values) {
+  constexpr unsigned length_bits = std::bit_width(WIDTH - 1);
+  uint64_t previous = 0;
+  unsigned previous_leading = WIDTH + 1;
+  unsigned previous_trailing = 0;
+  for (size_t i = 0; i < values.size(); i++) {
+    if (i == 0) {
+      if (!reader.read_bits(WIDTH, previous)) {
+        return false;
+      }
+      values[0] = previous;
+      continue;
+    }
+    uint64_t control, x;
+    if (!reader.read_bits(1, control)) {
+      return false;
+    }
+    if (control == 0) {
+      values[i] = previous;
+      continue;
+    }
+    if (!reader.read_bits(1, control)) {
+      return false;
+    }
+    if (control == 1) {
+      uint64_t leading, length;
+      if (!reader.read_bits(XOR_LEADING_BITS, leading) || !reader.read_bits(length_bits, length) ||
+          leading + length + 1 > WIDTH) {
+        return false;
+      }
+      previous_leading = unsigned(leading);
+      previous_trailing = WIDTH - previous_leading - unsigned(length + 1);
+    } else if (previous_leading > WIDTH) {
+      return false;
+    }
+    if (!reader.read_bits(WIDTH - previous_leading - previous_trailing, x)) {
+      return false;
+    }
+    previous ^= x << previous_trailing;
+    values[i] = previous;
+  }
+  reader.align();
+  return true;
+}
+
+inline bool is_integer_codec(TimeSeriesCodec codec) {
+  return codec >= TimeSeriesCodec::VARINT && codec <= TimeSeriesCodec::DELTA_OF_DELTA_BITPACK;
+}
+
+inline int transform_order(TimeSeriesCodec codec) {
+  switch (codec) {
+  case TimeSeriesCodec::DELTA_VARINT:
+  case TimeSeriesCodec::DELTA_BITPACK:
+    return 1;
+  case TimeSeriesCodec::DELTA_OF_DELTA_VARINT:
+  case TimeSeriesCodec::DELTA_OF_DELTA_BITPACK:
+    return 2;
+  default:
+    return 0;
+  }
+}
+
+inline bool is_bitpacked(TimeSeriesCodec codec) {
+  return codec >= TimeSeriesCodec::BITPACK && codec <= TimeSeriesCodec::DELTA_OF_DELTA_BITPACK;
+}
+} // namespace detail
+
+/**
+ * @brief Columnar encoder for time series of telemetry structs.
+ *
+ * @details Encodes an array of samples (aggregates of integer, enum, bool
+ *          and floating point fields, like the structs used with
+ *          espp::serialize) field by field, so that consecutive values of the
+ *          same field, which usually barely change, can be delta / XOR
+ *          encoded. Each field (column) uses its own TimeSeriesCodec, which
+ *          by default is picked automatically as the one producing the
+ *          smallest output for that field.
+ *
+ *          The encoded format is:
+ *          - 'T' 'S', version (1), number of fields, one descriptor (type and
+ *            size) per field and the number of samples (varint).
+ *          - per field: the codec (1 byte), the size of the encoded column
+ *            (varint) and the encoded column.
+ *
+ *          The encoder keeps its scratch buffers between calls, so encoding
+ *          batches of the same size does not allocate after the first one.
+ *
+ * @tparam T The sample type, an aggregate with 1 - 16 fields.
+ *
+ * \section time_series_ex1 Time Series Example
+ * \snippet serialization_example.cpp time series example
+ */
+template <class T> class TimeSeriesEncoder {
+public:
+  /// Number of fields of T.
+  static constexpr size_t NUM_FIELDS = detail::count_fields<T>();
+  /// Codec per field of T.
+  typedef std::array<TimeSeriesCodec, NUM_FIELDS> Codecs;
+
+  /**
+   * @brief Construct the encoder.
+   * @param codecs Codec to use for each field (default AUTO). Codecs which
+   *        do not apply to a field (e.g. XOR for an integer field) are
+   *        treated as AUTO.
+   */
+  explicit TimeSeriesEncoder(const Codecs &codecs = {})
+      : codecs_(codecs) {
+    static_assert(std::is_aggregate_v<T>, "Time series samples must be aggregates");
+  }
+
+  /**
+   * @brief Encode samples, appending them to the container.
+   * @param samples The samples to encode.
+   * @param container Container (e.g. std::vector<uint8_t>) to append to.
+   * @return The number of bytes appended.
+   */
+  template <class Container> size_t encode(std::span<const T> samples, Container &container) {
+    buffer_.clear();
+    buffer_.push_back('T');
+    buffer_.push_back('S');
+    buffer_.push_back(VERSION);
+    buffer_.push_back(uint8_t(NUM_FIELDS));
+    for_each_field([&]<size_t I, class F>() { buffer_.push_back(detail::field_descriptor<F>()); });
+    detail::write_varint(buffer_, samples.size());
+    for_each_field([&]<size_t I, class F>() { encode_field<I, F>(samples); });
+    container.insert(container.end(), buffer_.begin(), buffer_.end());
+    return buffer_.size();
+  }
+
+  /**
+   * @brief Get the codecs used for each field by the last call to encode().
+   * @return The codec used for each field.
+   */
+  const Codecs &get_selected_codecs() const { return selected_codecs_; }
+
+  /// Version of the encoded format.
+  static constexpr uint8_t VERSION = 1;
+
+protected:
+  template <class Fn> static void for_each_field(Fn &&fn) {
+    [&]<size_t... I>(std::index_sequence<I...>) {
+      (fn.template operator()<I, field_type<I>>(), ...);
+    }(std::make_index_sequence<NUM_FIELDS>());
+  }
+
+  using Fields = decltype(detail::tie_fields(std::declval<T &>()));
+  template <size_t I> using field_type = std::remove_cvref_t<std::tuple_element_t<I, Fields>>;
+
+  template <size_t I, class F> void encode_field(std::span<const T> samples) {
+    static_assert(detail::TimeSeriesField<F>,
+                  "Time series fields must be integers, enums, bools or floating point");
+    values_.resize(samples.size());
+    for (size_t i = 0; i < samples.size(); i++) {
+      values_[i] = detail::field_to_bits(std::get<I>(detail::tie_fields(samples[i])));
+    }
+    TimeSeriesCodec codec = codecs_[I];
+    size_t raw_size = samples.size() * sizeof(F);
+    column_.clear();
+    if constexpr (std::is_floating_point_v<F>) {
+      if (codec != TimeSeriesCodec::RAW) {
+        detail::write_xor<sizeof(F) * 8>(column_, values_);
+        codec = column_.size() < raw_size || codec == TimeSeriesCodec::XOR
+                    ? TimeSeriesCodec::XOR
+                    : TimeSeriesCodec::RAW;
+      }
+    } else {
+      if (codec != TimeSeriesCodec::RAW && !detail::is_integer_codec(codec)) {
+        codec = select_integer_codec(raw_size);
+      }
+      if (codec != TimeSeriesCodec::RAW) {
+        detail::apply_transform(values_, detail::transform_order(codec));
+        for (auto &value : values_) {
+          value = detail::zigzag_encode(value);
+        }
+        if (detail::is_bitpacked(codec)) {
+          detail::write_bitpacked(column_, values_);
+        } else {
+          for (auto value : values_) {
+            detail::write_varint(column_, value);
+          }
+        }
+      }
+    }
+    if (codec == TimeSeriesCodec::RAW) {
+      column_.clear();
+      for (size_t i = 0; i < samples.size(); i++) {
+        for (size_t b = 0; b < sizeof(F); b++) {
+          column_.push_back(uint8_t(values_[i] >> (8 * b)));
+        }
+      }
+    }
+    selected_codecs_[I] = codec;
+    buffer_.push_back(uint8_t(codec));
+    detail::write_varint(buffer_, column_.size());
+    buffer_.insert(buffer_.end(), column_.begin(), column_.end());
+  }
+
+  // sizes every integer encoding of values_ (without writing it)
+  TimeSeriesCodec select_integer_codec(size_t raw_size) {
+    TimeSeriesCodec best = TimeSeriesCodec::RAW;
+    size_t best_size = raw_size;
+    transformed_.assign(values_.begin(), values_.end());
+    for (int order = 0; order <= 2; order++) {
+      if (order > 0) {
+        detail::apply_transform(transformed_, 1);
+      }
+      zigzagged_.resize(transformed_.size());
+      size_t varint_size = 0;
+      for (size_t i = 0; i < transformed_.size(); i++) {
+        zigzagged_[i] = detail::zigzag_encode(transformed_[i]);
+        varint_size += detail::varint_size(zigzagged_[i]);
+      }
+      size_t bitpacked_size = detail::bitpacked_size(zigzagged_);
+      auto varint_codec = TimeSeriesCodec(uint8_t(TimeSeriesCodec::VARINT) + order);
+      auto bitpack_codec = TimeSeriesCodec(uint8_t(TimeSeriesCodec::BITPACK) + order);
+      if (varint_size < best_size) {
+        best = varint_codec;
+        best_size = varint_size;
+      }
+      if (bitpacked_size < best_size) {
+        best = bitpack_codec;
+        best_size = bitpacked_size;
+      }
+    }
+    return best;
+  }
+
+  Codecs codecs_;
+  Codecs selected_codecs_{};
+  std::vector<uint8_t> buffer_;
+  std::vector<uint8_t> column_;
+  std::vector<uint64_t> values_;
+  std::vector<uint64_t> transformed_;
+  std::vector<uint64_t> zigzagged_;
+};
+
+/**
+ * @brief Decoder for time series encoded by the TimeSeriesEncoder.
+ *
+ * @details Decodes directly into the fields of T (found by reflecting the
+ *          same aggregate type the encoder used), after validating that the
+ *          number and types of the fields in the encoded header match T.
+ *
+ * @tparam T The sample type, an aggregate with 1 - 16 fields.
+ */
+template <class T> class TimeSeriesDecoder : protected TimeSeriesEncoder<T> {
+public:
+  /**
+   * @brief Decode samples.
+   * @param data The encoded time series.
+   * @param samples Set to the decoded samples.
+   * @param ec Set to std::errc::invalid_argument if the encoded fields do
+   *        not match T, or std::errc::bad_message if the data is malformed.
+   * @return True on success, false on error.
+   */
+  bool decode(std::span<const uint8_t> data, std::vector<T> &samples, std::error_code &ec) {
+    detail::ByteReader reader(data);
+    uint8_t magic[2], version, num_fields;
+    if (!reader.read_byte(magic[0]) || !reader.read_byte(magic[1]) ||
+        !reader.read_byte(version) || !reader.read_byte(num_fields) || magic[0] != 'T' ||
+        magic[1] != 'S' || version != Base::VERSION) {
+      ec = std::make_error_code(std::errc::bad_message);
+      return false;
+    }
+    bool schema_matches = num_fields == Base::NUM_FIELDS;
+    Base::for_each_field([&]<size_t I, class F>() {
+      uint8_t descriptor = 0;
+      schema_matches = schema_matches && reader.read_byte(descriptor) &&
+                       descriptor == detail::field_descriptor<F>();
+    });
+    if (!schema_matches) {
+      ec = std::make_error_code(std::errc::invalid_argument);
+      return false;
+    }
+    uint64_t num_samples;
+    // the densest encoding of a field is a bit-packed block of width 0 (e.g.
+    // a constant column), which stores BITPACK_BLOCK_SIZE samples in a byte
+    if (!reader.read_varint(num_samples) ||
+        num_samples > data.size() * detail::BITPACK_BLOCK_SIZE) {
+      ec = std::make_error_code(std::errc::bad_message);
+      return false;
+    }
+    samples.resize(num_samples);
+    bool ok = true;
+    Base::for_each_field(
+        [&]<size_t I, class F>() { ok = ok && decode_field<I, F>(reader, samples); });
+    if (!ok || !reader.at_end()) {
+      ec = std::make_error_code(std::errc::bad_message);
+      return false;
+    }
+    return true;
+  }
+
+protected:
+  using Base = TimeSeriesEncoder<T>;
+  using Base::values_;
+
+  template <size_t I, class F>
+  bool decode_field(detail::ByteReader &reader, std::vector<T> &samples) {
+    uint8_t codec_byte;
+    uint64_t size;
+    std::span<const uint8_t> column;
+    if (!reader.read_byte(codec_byte) || !reader.read_varint(size) ||
+        !reader.read_span(size, column)) {
+      return false;
+    }
+    auto codec = TimeSeriesCodec(codec_byte);
+    detail::ByteReader column_reader(column);
+    values_.resize(samples.size());
+    if (codec == TimeSeriesCodec::RAW) {
+      std::span<const uint8_t> bytes;
+      if (!column_reader.read_span(samples.size() * sizeof(F), bytes)) {
+        return false;
+      }
+      for (size_t i = 0; i < samples.size(); i++) {
+        uint64_t value = 0;
+        for (size_t b = 0; b < sizeof(F); b++) {
+          value |= uint64_t(bytes[i * sizeof(F) + b]) << (8 * b);
+        }
+        values_[i] = value;
+      }
+    } else if constexpr (std::is_floating_point_v<F>) {
+      if (codec != TimeSeriesCodec::XOR ||
+          !detail::read_xor<sizeof(F) * 8>(column_reader, values_)) {
+        return false;
+      }
+    } else {
+      if (!detail::is_integer_codec(codec)) {
+        return false;
+      }
+      if (detail::is_bitpacked(codec)) {
+        if (!detail::read_bitpacked(column_reader, values_)) {
+          return false;
+        }
+      } else {
+        for (auto &value : values_) {
+          if (!column_reader.read_varint(value)) {
+            return false;
+          }
+        }
+      }
+      for (auto &value : values_) {
+        value = detail::zigzag_decode(value);
+      }
+      detail::invert_transform(values_, detail::transform_order(codec));
+    }
+    for (size_t i = 0; i < samples.size(); i++) {
+      std::get<I>(detail::tie_fields(samples[i])) = detail::field_from_bits<F>(values_[i]);
+    }
+    return column_reader.at_end();
+  }
+};
+} // namespace espp
+
+// for allowing easy serialization/printing of the
+// espp::TimeSeriesCodec enum
+template <> struct fmt::formatter<espp::TimeSeriesCodec> {
+  template <typename ParseContext> constexpr auto parse(ParseContext &ctx) { return ctx.begin(); }
+
+  template <typename FormatContext>
+  auto format(espp::TimeSeriesCodec const &codec, FormatContext &ctx) {
+    switch (codec) {
+    case espp::TimeSeriesCodec::AUTO:
+      return fmt::format_to(ctx.out(), "AUTO");
+    case espp::TimeSeriesCodec::RAW:
+      return fmt::format_to(ctx.out(), "RAW");
+    case espp::TimeSeriesCodec::VARINT:
+      return fmt::format_to(ctx.out(), "VARINT");
+    case espp::TimeSeriesCodec::DELTA_VARINT:
+      return fmt::format_to(ctx.out(), "DELTA_VARINT");
+    case espp::TimeSeriesCodec::DELTA_OF_DELTA_VARINT:
+      return fmt::format_to(ctx.out(), "DELTA_OF_DELTA_VARINT");
+    case espp::TimeSeriesCodec::BITPACK:
+      return fmt::format_to(ctx.out(), "BITPACK");
+    case espp::TimeSeriesCodec::DELTA_BITPACK:
+      return fmt::format_to(ctx.out(), "DELTA_BITPACK");
+    case espp::TimeSeriesCodec::DELTA_OF_DELTA_BITPACK:
+      return fmt::format_to(ctx.out(), "DELTA_OF_DELTA_BITPACK");
+    case espp::TimeSeriesCodec::XOR:
+      return fmt::format_to(ctx.out(), "XOR");
+    default:
+      return fmt::format_to(ctx.out(), "UNKNOWN");
+    }
+  }
+};
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(ESP_PLATFORM)
+#include <esp_vfs_eventfd.h>
+#elif defined(__linux__)
+#include <sys/eventfd.h>
+#endif
+
+namespace espp {
+/**
+ *   @brief Token which can be used to interrupt blocking socket operations
+ *          (accept / receive) from another thread.
+ *
+ *   @details A Socket which has a CancellationToken (see
+ *            Socket::set_cancellation_token()) waits on both its own file
+ *            descriptor and the token's file descriptor before blocking in
+ *            accept() / recv(). Calling cancel() makes the token's file
+ *            descriptor readable, so any waiting (or future) socket operation
+ *            returns immediately instead of waiting for data, a timeout, or
+ *            the socket to be closed out from under it.
+ *
+ *            The token is shared (std::shared_ptr) so that a single token can
+ *            be used by all the sockets owned by an object (e.g. the control
+ *            and data sockets of an FTP session) and so that it outlives any
+ *            of them.
+ *
+ *            On Linux and ESP-IDF this is backed by an eventfd, elsewhere by
+ *            a pipe. If the file descriptor cannot be created (e.g. if all
+ *            the ESP-IDF eventfds are in use), sockets fall back to polling
+ *            the token every CancellationToken::POLL_INTERVAL.
+ *
+ *   @note On ESP-IDF this registers the eventfd VFS driver if it has not
+ *         already been registered.
+ */
+class CancellationToken {
+public:
+  /**
+   * @brief How often sockets check the token if it has no file descriptor.
+   */
+  static constexpr auto POLL_INTERVAL = std::chrono::milliseconds(50);
+
+  /**
+   * @brief Create the token (in the not cancelled state).
+   */
+  CancellationToken() { open(); }
+
+  /**
+   * @brief Release the resources associated with the token.
+   */
+  ~CancellationToken() { close(); }
+
+  CancellationToken(const CancellationToken &) = delete;
+  CancellationToken &operator=(const CancellationToken &) = delete;
+
+  /**
+   * @brief Cancel any current and future blocking socket operations which
+   *        use this token, until reset() is called.
+   */
+  void cancel() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (cancelled_) {
+      return;
+    }
+    cancelled_ = true;
+#if defined(ESP_PLATFORM) || defined(__linux__)
+    uint64_t value = 1;
+    [[maybe_unused]] auto written = ::write(read_fd_, &value, sizeof(value));
+#else
+    uint8_t value = 1;
+    [[maybe_unused]] auto written = ::write(write_fd_, &value, sizeof(value));
+#endif
+  }
+
+  /**
+   * @brief Return the token to the not cancelled state, e.g. so that a
+   *        stopped server can be started again.
+   */
+  void reset() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (!cancelled_) {
+      return;
+    }
+    cancelled_ = false;
+    if (read_fd_ >= 0) {
+      // drain the file descriptor. cancel() only ever writes once, so this
+      // cannot block.
+#if defined(ESP_PLATFORM) || defined(__linux__)
+      uint64_t value;
+#else
+      uint8_t value;
+#endif
+      [[maybe_unused]] auto num_read = ::read(read_fd_, &value, sizeof(value));
+    }
+  }
+
+  /**
+   * @brief Has the token been cancelled?
+   * @return true if cancel() has been called since construction / the last
+   *         reset().
+   */
+  bool is_cancelled() const { return cancelled_; }
+
+  /**
+   * @brief Get the file descriptor which becomes readable when the token is
+   *        cancelled, for use with select().
+   * @return The file descriptor, or -1 if the token has no file descriptor
+   *         and must be polled with is_cancelled().
+   */
+  int native_handle() const { return read_fd_; }
+
+protected:
+  void open() {
+#if defined(ESP_PLATFORM)
+    static std::once_flag registered;
+    std::call_once(registered, []() {
+      esp_vfs_eventfd_config_t config = ESP_VFS_EVENTD_CONFIG_DEFAULT();
+      // NOTE: this fails with ESP_ERR_INVALID_STATE if the application has
+      //       already registered the driver, which is fine.
+      esp_vfs_eventfd_register(&config);
+    });
+    read_fd_ = eventfd(0, 0);
+#elif defined(__linux__)
+    read_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#else
+    int fds[2];
+    if (pipe(fds) == 0) {
+      fcntl(fds[0], F_SETFL, O_NONBLOCK);
+      fcntl(fds[1], F_SETFL, O_NONBLOCK);
+      read_fd_ = fds[0];
+      write_fd_ = fds[1];
+    }
+#endif
+  }
+
+  void close() {
+    if (read_fd_ >= 0) {
+      ::close(read_fd_);
+      read_fd_ = -1;
+    }
+    if (write_fd_ >= 0) {
+      ::close(write_fd_);
+      write_fd_ = -1;
+    }
+  }
+
+  std::mutex mutex_;
+  std::atomic<bool> cancelled_{false};
+  int read_fd_{-1};
+  int write_fd_{-1};
+};
+} // namespace espp
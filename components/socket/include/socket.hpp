@@ -1,6 +1,9 @@
 #pragma once
 
+#include <algorithm>
+#include <chrono>
 #include <functional>
+#include <memory>
 #include <optional>
 #include <string>
 #include <vector>
@@ -17,6 +20,7 @@
 #include <math.h>
 
 #include "base_component.hpp"
+#include "cancellation_token.hpp"
 #include "format.hpp"
 
 namespace espp {
@@ -219,6 +223,7 @@ public:
     if (seconds <= 0) {
       return true;
     }
+    receive_timeout_ = std::chrono::duration_cast<std::chrono::microseconds>(timeout);
     float intpart;
     float fractpart = modf(seconds, &intpart);
     const time_t response_timeout_s = (int)intpart;
@@ -239,6 +244,52 @@ public:
     return true;
   }
 
+  /**
+   * @brief Set the send timeout on the provided socket.
+   * @param timeout requested timeout, must be > 0.
+   * @return true if SO_SNDTIMEO was successfully set.
+   */
+  bool set_send_timeout(const std::chrono::duration<float> &timeout) {
+    float seconds = timeout.count();
+    if (seconds <= 0) {
+      return true;
+    }
+    auto timeout_us = std::chrono::duration_cast<std::chrono::microseconds>(timeout).count();
+    struct timeval tv;
+    tv.tv_sec = timeout_us / 1000000;
+    tv.tv_usec = timeout_us % 1000000;
+    int err = setsockopt(socket_, SOL_SOCKET, SO_SNDTIMEO, (const char *)&tv, sizeof(tv));
+    return err >= 0;
+  }
+
+  /**
+   * @brief Set the token used to interrupt blocking operations on this
+   *        socket.
+   * @details When a token is set, blocking operations (accept / receive)
+   *          first wait for the socket to become readable or for the token
+   *          to be cancelled, and return immediately (as if they had timed
+   *          out) once the token is cancelled.
+   * @param token The token to use, or nullptr to block without being
+   *        interruptible.
+   */
+  void set_cancellation_token(std::shared_ptr<CancellationToken> token) {
+    cancellation_token_ = std::move(token);
+  }
+
+  /**
+   * @brief Get the token used to interrupt blocking operations on this
+   *        socket.
+   * @return The token, or nullptr if the socket is not interruptible.
+   */
+  std::shared_ptr<CancellationToken> get_cancellation_token() const { return cancellation_token_; }
+
+  /**
+   * @brief Is the socket's cancellation token (if any) cancelled?
+   * @return true if the socket has a cancellation token which has been
+   *         cancelled, false otherwise.
+   */
+  bool is_cancelled() const { return cancellation_token_ && cancellation_token_->is_cancelled(); }
+
   /**
    * @brief Allow others to use this address/port combination after we're done
    *        with it.
@@ -383,6 +434,70 @@ public:
   }
 
 protected:
+  /**
+   * @brief Wait until the socket is readable (data or a connection is
+   *        available), the receive timeout (if set) expires, or the
+   *        cancellation token (if set) is cancelled.
+   * @note If the socket has no cancellation token, this returns true
+   *       immediately and the subsequent blocking call handles the receive
+   *       timeout itself.
+   * @return true if the socket is readable, false if the wait timed out,
+   *         was cancelled, or failed.
+   */
+  bool wait_for_readable() {
+    if (!cancellation_token_) {
+      return true;
+    }
+    using clock = std::chrono::steady_clock;
+    std::optional<clock::time_point> deadline;
+    if (receive_timeout_.count() > 0) {
+      deadline = clock::now() + receive_timeout_;
+    }
+    int token_fd = cancellation_token_->native_handle();
+    while (!cancellation_token_->is_cancelled()) {
+      fd_set readfds;
+      FD_ZERO(&readfds);
+      FD_SET(socket_, &readfds);
+      int nfds = socket_ + 1;
+      if (token_fd >= 0) {
+        FD_SET(token_fd, &readfds);
+        nfds = std::max(nfds, token_fd + 1);
+      }
+      // if the token cannot wake us, we have to periodically check it
+      std::optional<clock::duration> timeout;
+      if (token_fd < 0) {
+        timeout = CancellationToken::POLL_INTERVAL;
+      }
+      if (deadline) {
+        auto remaining = std::max(clock::duration::zero(), *deadline - clock::now());
+        timeout = timeout ? std::min(*timeout, remaining) : remaining;
+      }
+      struct timeval tv;
+      if (timeout) {
+        auto timeout_us = std::chrono::duration_cast<std::chrono::microseconds>(*timeout).count();
+        tv.tv_sec = timeout_us / 1000000;
+        tv.tv_usec = timeout_us % 1000000;
+      }
+      int retval = ::select(nfds, &readfds, nullptr, nullptr, timeout ? &tv : nullptr);
+      if (retval < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        logger_.error("select failed: {} - '{}'", errno, strerror(errno));
+        return false;
+      }
+      if (retval > 0 && FD_ISSET(socket_, &readfds)) {
+        return !cancellation_token_->is_cancelled();
+      }
+      if (deadline && clock::now() >= *deadline) {
+        logger_.debug("Timed out waiting for socket to be readable");
+        return false;
+      }
+    }
+    logger_.debug("Socket wait cancelled");
+    return false;
+  }
+
   /**
    * @brief Create the TCP socket and enable reuse.
    * @return true if the socket was initialized properly, false otherwise
@@ -418,6 +533,8 @@ protected:
   static constexpr int ip_protocol_{IPPROTO_IP};
 
   int socket_;
+  std::chrono::microseconds receive_timeout_{0};
+  std::shared_ptr<CancellationToken> cancellation_token_;
 };
 } // namespace espp
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <optional>
+#include <span>
 #include <string_view>
 #include <vector>
 
@@ -93,12 +94,17 @@ public:
       cleanup();
     }
     init(Type::STREAM);
+    connected_ = false;
   }
 
   /**
    * @brief Close the socket.
+   * @note The socket can be reopened with reinit().
    */
-  void close() { ::close(socket_); }
+  void close() {
+    cleanup();
+    connected_ = false;
+  }
 
   /**
    * @brief Check if the socket is connected to a remote endpoint.
@@ -195,7 +201,7 @@ public:
     }
     // write
     logger_.info("Client sending {} bytes", data.size());
-    int num_bytes_sent = write(socket_, data.data(), data.size());
+    int num_bytes_sent = ::send(socket_, data.data(), data.size(), SEND_FLAGS);
     if (num_bytes_sent < 0) {
       logger_.error("Error occurred during sending: {} - '{}'", errno, strerror(errno));
       // update our connection state here since remote end was likely closed...
@@ -229,6 +235,65 @@ public:
     return true;
   }
 
+  /**
+   * @brief Send several buffers to the connected endpoint with vectored
+   *        writes (sendmsg), e.g. a header and a payload which are stored
+   *        separately, without copying them into a single buffer.
+   * @note Blocks until all of the data has been sent, the send timeout (if
+   *       set) expires, or an error occurs.
+   * @param buffers The buffers to send, in order.
+   * @return true if all of the data was sent, false otherwise.
+   */
+  bool transmit(std::span<const std::string_view> buffers) {
+    if (!is_valid()) {
+      logger_.error("Socket invalid, cannot send");
+      return false;
+    }
+    static constexpr size_t MAX_NUM_BUFFERS = 8;
+    if (buffers.size() > MAX_NUM_BUFFERS) {
+      logger_.error("Too many buffers ({}), at most {} can be sent at once", buffers.size(),
+                    MAX_NUM_BUFFERS);
+      return false;
+    }
+    struct iovec iov[MAX_NUM_BUFFERS];
+    size_t num_buffers = 0;
+    for (const auto &buffer : buffers) {
+      if (!buffer.empty()) {
+        iov[num_buffers].iov_base = const_cast<char *>(buffer.data());
+        iov[num_buffers].iov_len = buffer.size();
+        num_buffers++;
+      }
+    }
+    struct iovec *next = iov;
+    while (num_buffers > 0) {
+      struct msghdr msg {};
+      msg.msg_iov = next;
+      msg.msg_iovlen = num_buffers;
+      ssize_t num_bytes_sent = ::sendmsg(socket_, &msg, SEND_FLAGS);
+      if (num_bytes_sent < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        logger_.debug("Error occurred during sending: {} - '{}'", errno, strerror(errno));
+        connected_ = false;
+        return false;
+      }
+      // skip the buffers which were sent completely, and the sent part of
+      // the next one
+      size_t remaining = num_bytes_sent;
+      while (num_buffers > 0 && remaining >= next->iov_len) {
+        remaining -= next->iov_len;
+        next++;
+        num_buffers--;
+      }
+      if (num_buffers > 0) {
+        next->iov_base = static_cast<char *>(next->iov_base) + remaining;
+        next->iov_len -= remaining;
+      }
+    }
+    return true;
+  }
+
   /**
    * @brief Call read on the socket, assuming it has already been configured
    *        appropriately.
@@ -254,8 +319,9 @@ public:
   /**
    * @brief Call read on the socket, assuming it has already been configured
    *        appropriately.
-   * @note This function will block until max_num_bytes are received or the
-   *       receive timeout is reached.
+   * @note This function will block until max_num_bytes are received, the
+   *       receive timeout is reached, or the socket's cancellation token (if
+   *       any) is cancelled.
    * @note The data pointed to by data must be at least max_num_bytes in size.
    * @param data Pointer to buffer to receive data.
    * @param max_num_bytes Maximum number of bytes to receive.
@@ -271,6 +337,10 @@ public:
       return 0;
     }
     logger_.info("Receiving up to {} bytes", max_num_bytes);
+    // wait for data, unless we're cancelled first
+    if (!wait_for_readable()) {
+      return 0;
+    }
     // now actually read data from the socket
     int num_bytes_received = ::recv(socket_, data, max_num_bytes, 0);
     // if we didn't receive anything return false and don't do anything else
@@ -335,9 +405,10 @@ public:
 
   /**
    * @brief Accept an incoming connection.
-   * @note Blocks until a connection is accepted.
+   * @note Blocks until a connection is accepted, or until the socket's
+   *       cancellation token (if any) is cancelled.
    * @note Must be called after listen.
-   * @note This function will block until a connection is accepted.
+   * @note The accepted socket shares this socket's cancellation token.
    * @return A unique pointer to a TcpClientSession if a connection was
    *         accepted, nullptr otherwise.
    */
@@ -349,6 +420,10 @@ public:
     Socket::Info connected_client_info;
     auto sender_address = connected_client_info.ipv4_ptr();
     socklen_t socklen = sizeof(*sender_address);
+    // wait for a connection, unless we're cancelled first
+    if (!wait_for_readable()) {
+      return nullptr;
+    }
     // accept connection
     auto accepted_socket = ::accept(socket_, (struct sockaddr *)sender_address, &socklen);
     if (accepted_socket < 0) {
@@ -359,10 +434,20 @@ public:
     logger_.info("Server accepted connection with {}", connected_client_info);
     // NOTE: have to use new here because we can't use make_unique with a
     //       protected or private constructor
-    return std::unique_ptr<TcpSocket>(new TcpSocket(accepted_socket, connected_client_info));
+    auto client = std::unique_ptr<TcpSocket>(new TcpSocket(accepted_socket, connected_client_info));
+    // the accepted connection can be interrupted the same way as we can
+    client->set_cancellation_token(cancellation_token_);
+    return client;
   }
 
 protected:
+#if defined(MSG_NOSIGNAL)
+  // a remote which closed the connection must not raise SIGPIPE
+  static constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+  static constexpr int SEND_FLAGS = 0;
+#endif
+
   /**
    * @brief Construct a new TcpSocket object
    * @note This sets connected_ to true, under the assumption that the socket
@@ -78,8 +78,12 @@ public:
    * @brief Tear down any resources associted with the socket.
    */
   ~UdpSocket() {
-    // we have to explicitly call cleanup here so that the server recvfrom
-    // will return and the task can stop.
+    // interrupt the server recvfrom (if any) so that the task can stop
+    // before we close the socket out from under it.
+    if (task_ && task_->is_started()) {
+      cancellation_token_->cancel();
+      task_->stop();
+    }
     cleanup();
   }
 
@@ -197,6 +201,10 @@ public:
     std::unique_ptr<uint8_t[]> receive_buffer(new uint8_t[max_num_bytes]());
     // now actually receive
     logger_.info("Receiving up to {} bytes", max_num_bytes);
+    // wait for data, unless we're cancelled first
+    if (!wait_for_readable()) {
+      return false;
+    }
     int num_bytes_received = recvfrom(socket_, receive_buffer.get(), max_num_bytes, 0,
                                       (struct sockaddr *)remote_address, &socklen);
     // if we didn't receive anything return false and don't do anything else
@@ -215,6 +223,9 @@ public:
   /**
    * @brief Configure a server socket and start a thread to continuously
    *        receive and handle data coming in on that socket.
+   * @note If the socket does not have a cancellation token, one is created
+   *       so that the receive task can be stopped promptly. The token is
+   *       cancelled when the socket is destroyed.
    *
    * @param task_config Task::Config struct for configuring the receive task.
    * @param receive_config ReceiveConfig struct with socket and callback info.
@@ -255,6 +266,10 @@ public:
         return false;
       }
     }
+    // make sure the receive task can be interrupted when we are destroyed
+    if (!cancellation_token_) {
+      set_cancellation_token(std::make_shared<CancellationToken>());
+    }
     // set the callback function
     using namespace std::placeholders;
     task_config.callback =
@@ -0,0 +1,60 @@
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <numbers>
+#include <thread>
+#include <vector>
+
+#include "esp_random.h"
+
+#include "spectrum.hpp"
+
+/**
+ * @brief Get a random number in the range [-1.0f, 1.0f]
+ * @return Random floating point number.
+ */
+float get_random() { return ((float)esp_random() / (float)UINT32_MAX) * 2.0f - 1.0f; }
+
+extern "C" void app_main(void) {
+  {
+    fmt::print("Starting spectrum example\n");
+    //! [spectrum example]
+    static constexpr float sample_rate_hz = 4000.0f;
+    espp::Spectrum spectrum({
+        .fft_size = 1024,
+        .sample_rate_hz = sample_rate_hz,
+        .window = espp::Spectrum::Window::HANN,
+        .num_averages = 8, // Welch PSD, averaging 8 overlapping frames
+        .log_level = espp::Logger::Verbosity::INFO,
+    });
+    // in a real application, these blocks would come from an ADC / sensor
+    std::vector<float> block(128);
+    size_t sample = 0;
+    for (int i = 0; i < 100; i++) {
+      for (auto &x : block) {
+        float t = sample++ / sample_rate_hz;
+        x = std::sin(2.0f * std::numbers::pi_v<float> * 50.0f * t) +
+            0.25f * std::sin(2.0f * std::numbers::pi_v<float> * 440.0f * t) +
+            0.1f * get_random();
+      }
+      // feed() returns the number of spectra completed by this block
+      if (spectrum.feed(block) == 0) {
+        continue;
+      }
+      std::array<espp::Spectrum::Peak, 2> peaks;
+      size_t num_peaks = spectrum.find_peaks(peaks);
+      for (size_t p = 0; p < num_peaks; p++) {
+        fmt::print("peak {}: {}\n", p, peaks[p]);
+      }
+      fmt::print("power below 100 Hz: {:.4f}, total power: {:.4f}\n",
+                 spectrum.get_band_power(0, 100), spectrum.get_band_power());
+    }
+    //! [spectrum example]
+  }
+
+  fmt::print("Spectrum example complete!\n");
+
+  while (true) {
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+  }
+}
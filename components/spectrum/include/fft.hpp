@@ -0,0 +1,195 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <numbers>
+#include <span>
+#include <utility>
+#include <vector>
+
+#if defined(ESP_PLATFORM)
+#include "esp_dsp.h"
+#endif
+
+namespace espp {
+/**
+ * @brief Fast Fourier transform of real-valued input with a fixed
+ *        (power of two) size, whose tables and buffers are allocated once
+ *        in the constructor.
+ *
+ * @details The N-point real FFT is computed as an N/2-point complex FFT of
+ *          the even / odd input samples followed by a split step, which is
+ *          about twice as fast as transforming the samples as complex values.
+ *          On ESP32 the complex FFT is the esp-dsp radix-2 FFT (which uses
+ *          the vector instructions of the ESP32-S3 / the optimized assembly
+ *          of the ESP32) whenever N/2 fits into the esp-dsp twiddle table
+ *          (CONFIG_DSP_MAX_FFT_SIZE). Otherwise (and on the host) it is a
+ *          portable radix-2 FFT which stores the data and the per-stage
+ *          twiddle factors as separate, contiguous real and imaginary arrays
+ *          so that the compiler can vectorize the butterflies.
+ *
+ * @note Not thread safe: forward() uses the internal work buffers.
+ *
+ * \section fft_ex1 Example
+ * @code{.cpp}
+ *   espp::RealFft fft(1024);
+ *   std::vector<float> samples(1024);
+ *   std::vector<std::complex<float>> bins(fft.get_num_bins());
+ *   fft.forward(samples, bins);
+ * @endcode
+ */
+class RealFft {
+public:
+  /**
+   * @brief Construct the FFT, precomputing its tables.
+   * @param size Number of (real) input samples. Rounded up to the next power
+   *        of two, with a minimum of 4.
+   */
+  explicit RealFft(size_t size)
+      : size_(std::bit_ceil(std::max<size_t>(size, 4)))
+      , half_size_(size_ / 2)
+      , re_(half_size_)
+      , im_(half_size_)
+      , twiddle_re_(half_size_)
+      , twiddle_im_(half_size_)
+      , split_re_(half_size_)
+      , split_im_(half_size_) {
+    init_bit_reverse_table();
+    // twiddles for each stage stored contiguously: the stage with butterfly
+    // span 2*h uses entries [h, 2h)
+    for (size_t h = 1; h < half_size_; h *= 2) {
+      for (size_t j = 0; j < h; j++) {
+        double angle = -std::numbers::pi * double(j) / double(h);
+        twiddle_re_[h + j] = float(std::cos(angle));
+        twiddle_im_[h + j] = float(std::sin(angle));
+      }
+    }
+    for (size_t k = 0; k < half_size_; k++) {
+      double angle = -2.0 * std::numbers::pi * double(k) / double(size_);
+      split_re_[k] = float(std::cos(angle));
+      split_im_[k] = float(std::sin(angle));
+    }
+#if defined(ESP_PLATFORM)
+    use_esp_dsp_ = half_size_ <= CONFIG_DSP_MAX_FFT_SIZE &&
+                   dsps_fft2r_init_fc32(nullptr, CONFIG_DSP_MAX_FFT_SIZE) == ESP_OK;
+    if (use_esp_dsp_) {
+      interleaved_.resize(2 * half_size_);
+    }
+#endif
+  }
+
+  /**
+   * @brief Get the number of (real) input samples.
+   * @return The size of the FFT.
+   */
+  size_t get_size() const { return size_; }
+
+  /**
+   * @brief Get the number of output bins, size / 2 + 1 (DC to Nyquist).
+   * @return The number of output bins.
+   */
+  size_t get_num_bins() const { return half_size_ + 1; }
+
+  /**
+   * @brief Compute the FFT of \p input.
+   * @param input get_size() real samples.
+   * @param output get_num_bins() complex bins, from DC to Nyquist. Not
+   *        normalized, i.e. output[0] is the sum of the input.
+   */
+  void forward(std::span<const float> input, std::span<std::complex<float>> output) {
+    // pack the even / odd samples as the real / imaginary parts
+    for (size_t i = 0; i < half_size_; i++) {
+      re_[i] = input[2 * i];
+      im_[i] = input[2 * i + 1];
+    }
+    complex_fft();
+    // split the spectra of the even / odd samples and combine them:
+    // X[k] = E[k] + W^k O[k], E[k] = (Z[k] + Z*[m-k]) / 2,
+    // O[k] = -i (Z[k] - Z*[m-k]) / 2
+    output[0] = {re_[0] + im_[0], 0.0f};
+    output[half_size_] = {re_[0] - im_[0], 0.0f};
+    for (size_t k = 1; k < half_size_; k++) {
+      size_t c = half_size_ - k;
+      float even_re = 0.5f * (re_[k] + re_[c]);
+      float even_im = 0.5f * (im_[k] - im_[c]);
+      float odd_re = 0.5f * (im_[k] + im_[c]);
+      float odd_im = -0.5f * (re_[k] - re_[c]);
+      output[k] = {even_re + split_re_[k] * odd_re - split_im_[k] * odd_im,
+                   even_im + split_re_[k] * odd_im + split_im_[k] * odd_re};
+    }
+  }
+
+protected:
+  void init_bit_reverse_table() {
+    size_t bits = std::countr_zero(half_size_);
+    for (size_t i = 0; i < half_size_; i++) {
+      size_t reversed = 0;
+      for (size_t b = 0; b < bits; b++) {
+        reversed |= ((i >> b) & 1) << (bits - 1 - b);
+      }
+      if (i < reversed) {
+        swaps_.emplace_back(i, reversed);
+      }
+    }
+  }
+
+  void complex_fft() {
+#if defined(ESP_PLATFORM)
+    if (use_esp_dsp_) {
+      for (size_t i = 0; i < half_size_; i++) {
+        interleaved_[2 * i] = re_[i];
+        interleaved_[2 * i + 1] = im_[i];
+      }
+      dsps_fft2r_fc32(interleaved_.data(), half_size_);
+      dsps_bit_rev_fc32(interleaved_.data(), half_size_);
+      for (size_t i = 0; i < half_size_; i++) {
+        re_[i] = interleaved_[2 * i];
+        im_[i] = interleaved_[2 * i + 1];
+      }
+      return;
+    }
+#endif
+    for (const auto &[a, b] : swaps_) {
+      std::swap(re_[a], re_[b]);
+      std::swap(im_[a], im_[b]);
+    }
+    float *re = re_.data();
+    float *im = im_.data();
+    for (size_t h = 1; h < half_size_; h *= 2) {
+      const float *w_re = twiddle_re_.data() + h;
+      const float *w_im = twiddle_im_.data() + h;
+      for (size_t start = 0; start < half_size_; start += 2 * h) {
+        float *a_re = re + start;
+        float *a_im = im + start;
+        float *b_re = a_re + h;
+        float *b_im = a_im + h;
+        for (size_t j = 0; j < h; j++) {
+          float t_re = b_re[j] * w_re[j] - b_im[j] * w_im[j];
+          float t_im = b_re[j] * w_im[j] + b_im[j] * w_re[j];
+          b_re[j] = a_re[j] - t_re;
+          b_im[j] = a_im[j] - t_im;
+          a_re[j] += t_re;
+          a_im[j] += t_im;
+        }
+      }
+    }
+  }
+
+  size_t size_;
+  size_t half_size_;
+  std::vector<float> re_;
+  std::vector<float> im_;
+  std::vector<float> twiddle_re_;
+  std::vector<float> twiddle_im_;
+  std::vector<float> split_re_;
+  std::vector<float> split_im_;
+  std::vector<std::pair<size_t, size_t>> swaps_;
+#if defined(ESP_PLATFORM)
+  bool use_esp_dsp_{false};
+  std::vector<float> interleaved_;
+#endif
+};
+} // namespace espp
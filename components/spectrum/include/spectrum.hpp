@@ -0,0 +1,385 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <functional>
+#include <limits>
+#include <numbers>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "base_component.hpp"
+#include "fft.hpp"
+
+namespace espp {
+/**
+ * @brief Streaming spectral analysis of a sampled signal, as a short-time
+ *        Fourier transform (STFT) or as a Welch power spectral density (PSD)
+ *        estimate.
+ *
+ * @details Samples are fed in arbitrary sized blocks (e.g. from an ADC or
+ *          sensor task). Every hop_size samples, the last fft_size samples
+ *          are windowed and transformed (see RealFft), and the one-sided PSD
+ *          of the frame (in units^2 / Hz) is accumulated. After num_averages
+ *          frames the averaged PSD is published and passed to the callback:
+ *          with num_averages = 1 this is an STFT (one spectrum per frame),
+ *          with num_averages > 1 it is Welch's method (averaging overlapping,
+ *          windowed frames to reduce the variance of the estimate).
+ *
+ *          All buffers are allocated in the constructor, so feeding samples
+ *          never allocates. The PSD is normalized such that integrating it
+ *          over frequency (see get_band_power()) gives the mean square of the
+ *          signal in that band, independent of the window and FFT size.
+ *
+ * @note Not thread safe. The callback is called from the context of
+ *       feed(), and the spectrum passed to it is only valid until the next
+ *       call to feed().
+ *
+ * \section spectrum_ex1 Example
+ * \snippet spectrum_example.cpp spectrum example
+ */
+class Spectrum : public BaseComponent {
+public:
+  /**
+   * @brief Window functions which can be applied to each frame.
+   */
+  enum class Window {
+    RECTANGULAR,     ///< No window. Best resolution, worst leakage.
+    HANN,            ///< Hann window. Good general purpose window.
+    HAMMING,         ///< Hamming window. Lower first sidelobe than Hann.
+    BLACKMAN,        ///< Blackman window. Lower leakage, wider main lobe.
+    BLACKMAN_HARRIS, ///< 4-term Blackman-Harris window. Very low leakage.
+    FLAT_TOP,        ///< Flat top window. Accurate amplitudes of tones.
+  };
+
+  /**
+   * @brief Callback for completed spectra.
+   * @param psd One-sided power spectral density (units^2 / Hz), with
+   *        get_num_bins() bins from DC to the Nyquist frequency.
+   */
+  typedef std::function<void(std::span<const float> psd)> spectrum_callback_fn;
+
+  /**
+   * @brief A peak in the spectrum.
+   */
+  struct Peak {
+    float frequency_hz{0}; ///< Frequency of the peak, interpolated between bins.
+    float psd{0};          ///< Power spectral density at the peak bin (units^2 / Hz).
+  };
+
+  /**
+   * @brief Configuration for the spectrum.
+   */
+  struct Config {
+    size_t fft_size{1024}; ///< Number of samples per frame, rounded up to a power of two.
+    size_t hop_size{0}; ///< Samples between frames (<= fft_size). 0 means fft_size / 2.
+    float sample_rate_hz{1000.0f}; ///< Sample rate of the signal.
+    Window window{Window::HANN};   ///< Window applied to each frame.
+    size_t num_averages{1}; ///< Frames averaged per spectrum, 1 for an STFT.
+    spectrum_callback_fn callback{nullptr}; ///< Called with each new spectrum. Optional.
+    Logger::Verbosity log_level{Logger::Verbosity::WARN}; ///< Log verbosity.
+  };
+
+  /**
+   * @brief Construct the spectrum, allocating all of its buffers.
+   * @param config Configuration for the spectrum.
+   */
+  explicit Spectrum(const Config &config)
+      : BaseComponent("Spectrum", config.log_level)
+      , fft_(config.fft_size)
+      , fft_size_(fft_.get_size())
+      , hop_size_(std::clamp<size_t>(config.hop_size ? config.hop_size : fft_size_ / 2, 1,
+                                     fft_size_))
+      , num_averages_(std::max<size_t>(config.num_averages, 1))
+      , sample_rate_hz_(config.sample_rate_hz)
+      , callback_(config.callback)
+      , frame_(fft_size_)
+      , window_(fft_size_)
+      , windowed_(fft_size_)
+      , bins_(fft_.get_num_bins())
+      , accumulator_(fft_.get_num_bins())
+      , spectrum_(fft_.get_num_bins()) {
+    if (fft_size_ != config.fft_size) {
+      logger_.warn("FFT size {} is not a power of two, using {}", config.fft_size, fft_size_);
+    }
+    make_window(config.window, window_);
+    float window_power = 0;
+    for (auto w : window_) {
+      window_power += w * w;
+    }
+    // one-sided PSD scaling: |X|^2 / (fs * sum(w^2)), doubled for all bins
+    // except DC and Nyquist, whose power is not mirrored
+    scale_ = 1.0f / (sample_rate_hz_ * window_power);
+    logger_.debug("fft size {}, hop size {}, averages {}, resolution {:.3f} Hz", fft_size_,
+                  hop_size_, num_averages_, get_frequency_resolution());
+  }
+
+  /**
+   * @brief Feed a block of samples.
+   * @param samples Samples of the signal.
+   * @return The number of spectra completed (and passed to the callback)
+   *         while consuming the samples.
+   */
+  size_t feed(std::span<const float> samples) { return feed<float>(samples, 1.0f); }
+
+  /**
+   * @brief Feed a block of raw samples (e.g. ADC counts), scaling them.
+   * @param samples Samples of the signal.
+   * @param scale Factor to convert the samples into the desired units.
+   * @return The number of spectra completed (and passed to the callback)
+   *         while consuming the samples.
+   */
+  template <typename T>
+  requires std::is_arithmetic_v<T>
+  size_t feed(std::span<const T> samples, float scale) {
+    size_t num_spectra = 0;
+    while (!samples.empty()) {
+      size_t count = std::min(samples.size(), fft_size_ - num_buffered_);
+      float *dst = frame_.data() + num_buffered_;
+      for (size_t i = 0; i < count; i++) {
+        dst[i] = static_cast<float>(samples[i]) * scale;
+      }
+      num_buffered_ += count;
+      samples = samples.subspan(count);
+      if (num_buffered_ == fft_size_) {
+        num_spectra += process_frame();
+        // keep the overlap with the next frame
+        std::copy(frame_.begin() + hop_size_, frame_.end(), frame_.begin());
+        num_buffered_ = fft_size_ - hop_size_;
+      }
+    }
+    return num_spectra;
+  }
+
+  /**
+   * @brief Discard all buffered samples and partially averaged frames.
+   */
+  void reset() {
+    num_buffered_ = 0;
+    num_accumulated_ = 0;
+    std::fill(accumulator_.begin(), accumulator_.end(), 0.0f);
+  }
+
+  /**
+   * @brief Get the most recently completed spectrum.
+   * @return One-sided PSD (units^2 / Hz) from DC to Nyquist, all zeros
+   *         until the first spectrum has been completed.
+   */
+  std::span<const float> get_spectrum() const { return spectrum_; }
+
+  /**
+   * @brief Get the FFT size (number of samples per frame).
+   * @return The FFT size.
+   */
+  size_t get_fft_size() const { return fft_size_; }
+
+  /**
+   * @brief Get the number of samples between frames.
+   * @return The hop size.
+   */
+  size_t get_hop_size() const { return hop_size_; }
+
+  /**
+   * @brief Get the number of bins in the spectrum, fft_size / 2 + 1.
+   * @return The number of bins.
+   */
+  size_t get_num_bins() const { return spectrum_.size(); }
+
+  /**
+   * @brief Get the spacing between bins.
+   * @return The frequency resolution in Hz.
+   */
+  float get_frequency_resolution() const { return sample_rate_hz_ / fft_size_; }
+
+  /**
+   * @brief Get the center frequency of a bin.
+   * @param bin Index of the bin.
+   * @return The frequency of the bin in Hz.
+   */
+  float get_bin_frequency(size_t bin) const { return bin * get_frequency_resolution(); }
+
+  /**
+   * @brief Find the largest peak of the most recent spectrum.
+   * @param min_frequency_hz Lower bound of the search.
+   * @param max_frequency_hz Upper bound of the search.
+   * @return The largest peak. Its frequency is interpolated between bins.
+   */
+  Peak find_peak(float min_frequency_hz = 0,
+                 float max_frequency_hz = std::numeric_limits<float>::max()) const {
+    auto [first, last] = get_bin_range(min_frequency_hz, max_frequency_hz);
+    if (first > last) {
+      return {};
+    }
+    auto max = std::max_element(spectrum_.begin() + first, spectrum_.begin() + last + 1);
+    return make_peak(std::distance(spectrum_.begin(), max));
+  }
+
+  /**
+   * @brief Find the largest local maxima of the most recent spectrum.
+   * @param peaks Filled with the largest peaks, sorted by decreasing PSD.
+   * @param min_psd Ignore peaks whose PSD is below this value.
+   * @return The number of peaks found (at most peaks.size()).
+   */
+  size_t find_peaks(std::span<Peak> peaks, float min_psd = 0) const {
+    size_t num_peaks = 0;
+    for (size_t bin = 1; bin + 1 < spectrum_.size(); bin++) {
+      float psd = spectrum_[bin];
+      if (psd < min_psd || psd <= spectrum_[bin - 1] || psd < spectrum_[bin + 1]) {
+        continue;
+      }
+      // insertion into the (sorted, bounded) output
+      size_t pos = num_peaks;
+      while (pos > 0 && peaks[pos - 1].psd < psd) {
+        pos--;
+      }
+      if (pos >= peaks.size()) {
+        continue;
+      }
+      num_peaks = std::min(num_peaks + 1, peaks.size());
+      std::copy_backward(peaks.begin() + pos, peaks.begin() + num_peaks - 1,
+                         peaks.begin() + num_peaks);
+      peaks[pos] = make_peak(bin);
+    }
+    return num_peaks;
+  }
+
+  /**
+   * @brief Get the power of the signal in a frequency band of the most
+   *        recent spectrum.
+   * @param min_frequency_hz Lower bound of the band.
+   * @param max_frequency_hz Upper bound of the band.
+   * @return The integral of the PSD over the bins within the band, i.e. the
+   *         mean square of the band-limited signal (units^2).
+   */
+  float get_band_power(float min_frequency_hz = 0,
+                       float max_frequency_hz = std::numeric_limits<float>::max()) const {
+    auto [first, last] = get_bin_range(min_frequency_hz, max_frequency_hz);
+    float power = 0;
+    for (size_t bin = first; bin <= last && bin < spectrum_.size(); bin++) {
+      power += spectrum_[bin];
+    }
+    return power * get_frequency_resolution();
+  }
+
+  /**
+   * @brief Fill \p window with the coefficients of a (periodic) window.
+   * @param window The window function.
+   * @param coefficients Filled with the window coefficients.
+   */
+  static void make_window(Window window, std::span<float> coefficients) {
+    size_t n = coefficients.size();
+    for (size_t i = 0; i < n; i++) {
+      double x = 2.0 * std::numbers::pi * double(i) / double(n);
+      double w = 1.0;
+      switch (window) {
+      case Window::RECTANGULAR:
+        break;
+      case Window::HANN:
+        w = 0.5 - 0.5 * std::cos(x);
+        break;
+      case Window::HAMMING:
+        w = 0.54 - 0.46 * std::cos(x);
+        break;
+      case Window::BLACKMAN:
+        w = 0.42 - 0.5 * std::cos(x) + 0.08 * std::cos(2 * x);
+        break;
+      case Window::BLACKMAN_HARRIS:
+        w = 0.35875 - 0.48829 * std::cos(x) + 0.14128 * std::cos(2 * x) -
+            0.01168 * std::cos(3 * x);
+        break;
+      case Window::FLAT_TOP:
+        w = 0.21557895 - 0.41663158 * std::cos(x) + 0.277263158 * std::cos(2 * x) -
+            0.083578947 * std::cos(3 * x) + 0.006947368 * std::cos(4 * x);
+        break;
+      }
+      coefficients[i] = float(w);
+    }
+  }
+
+protected:
+  size_t process_frame() {
+    for (size_t i = 0; i < fft_size_; i++) {
+      windowed_[i] = frame_[i] * window_[i];
+    }
+    fft_.forward(windowed_, bins_);
+    size_t last = bins_.size() - 1;
+    accumulator_[0] += std::norm(bins_[0]) * scale_;
+    for (size_t k = 1; k < last; k++) {
+      accumulator_[k] += std::norm(bins_[k]) * (2.0f * scale_);
+    }
+    accumulator_[last] += std::norm(bins_[last]) * scale_;
+    if (++num_accumulated_ < num_averages_) {
+      return 0;
+    }
+    float inverse_count = 1.0f / num_accumulated_;
+    for (size_t k = 0; k < accumulator_.size(); k++) {
+      spectrum_[k] = accumulator_[k] * inverse_count;
+      accumulator_[k] = 0;
+    }
+    num_accumulated_ = 0;
+    if (callback_) {
+      callback_(spectrum_);
+    }
+    return 1;
+  }
+
+  std::pair<size_t, size_t> get_bin_range(float min_frequency_hz, float max_frequency_hz) const {
+    float resolution = get_frequency_resolution();
+    float last_bin = float(spectrum_.size() - 1);
+    float first = std::clamp(std::ceil(min_frequency_hz / resolution), 0.0f, last_bin);
+    float last = std::clamp(std::floor(max_frequency_hz / resolution), 0.0f, last_bin);
+    if (min_frequency_hz > max_frequency_hz || min_frequency_hz / resolution > last_bin) {
+      return {1, 0};
+    }
+    return {size_t(first), size_t(last)};
+  }
+
+  Peak make_peak(size_t bin) const {
+    float offset = 0;
+    if (bin > 0 && bin + 1 < spectrum_.size()) {
+      // parabolic interpolation of the log PSD, which is exact for a
+      // gaussian main lobe and close for the usual windows
+      constexpr float tiny = std::numeric_limits<float>::min();
+      float left = std::log(spectrum_[bin - 1] + tiny);
+      float center = std::log(spectrum_[bin] + tiny);
+      float right = std::log(spectrum_[bin + 1] + tiny);
+      float denominator = left - 2.0f * center + right;
+      if (denominator < 0) {
+        offset = std::clamp(0.5f * (left - right) / denominator, -0.5f, 0.5f);
+      }
+    }
+    return {.frequency_hz = (bin + offset) * get_frequency_resolution(),
+            .psd = spectrum_[bin]};
+  }
+
+  RealFft fft_;
+  size_t fft_size_;
+  size_t hop_size_;
+  size_t num_averages_;
+  float sample_rate_hz_;
+  float scale_;
+  spectrum_callback_fn callback_;
+  std::vector<float> frame_;
+  std::vector<float> window_;
+  std::vector<float> windowed_;
+  std::vector<std::complex<float>> bins_;
+  std::vector<float> accumulator_;
+  std::vector<float> spectrum_;
+  size_t num_buffered_{0};
+  size_t num_accumulated_{0};
+};
+} // namespace espp
+
+// for allowing easy serialization/printing of the
+// espp::Spectrum::Peak
+template <> struct fmt::formatter<espp::Spectrum::Peak> {
+  template <typename ParseContext> constexpr auto parse(ParseContext &ctx) { return ctx.begin(); }
+
+  template <typename FormatContext>
+  auto format(const espp::Spectrum::Peak &peak, FormatContext &ctx) {
+    return fmt::format_to(ctx.out(), "{{frequency_hz: {:.3f}, psd: {:.3e}}}", peak.frequency_hz,
+                          peak.psd);
+  }
+};
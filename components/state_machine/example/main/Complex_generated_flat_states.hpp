@@ -0,0 +1,549 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "flat_state_machine.hpp"
+#include "state_base.hpp"
+
+#include "Complex_event_data.hpp"
+
+// User Includes for the HFSM
+//::::/c::::Includes::::
+#include <stdio.h>
+
+// Flat table backend for the Complex HFSM: the same model as
+// Complex_generated_states.hpp, with the state tree flattened into an enum and
+// the transitions into constexpr tables run by espp::state_machine::FlatStateMachine.
+namespace espp::state_machine::ComplexFlat {
+
+typedef std::function<void(std::string_view)> LogCallback;
+
+using Complex::ENDEVENTEventData;
+using Complex::EVENT1EventData;
+using Complex::EVENT2EventData;
+using Complex::EVENT3EventData;
+using Complex::EVENT4EventData;
+
+enum class EventType : uint8_t {
+  ENDEVENT,
+  EVENT1,
+  EVENT2,
+  EVENT3,
+  EVENT4,
+}; // ENUMS GENERATED FROM MODEL
+
+static constexpr std::array<std::string_view, 5> event_names = {
+    "ENDEVENT", "EVENT1", "EVENT2", "EVENT3", "EVENT4",
+};
+
+/**
+ * @brief Event which can be passed to Root::handleEvent() through the
+ *  StateBase interface.
+ */
+class GeneratedEventBase : public EventBase {
+public:
+  explicit GeneratedEventBase(EventType t)
+      : type(t) {}
+  EventType get_type() const { return type; }
+  std::string to_string() const override {
+    return std::string(event_names[static_cast<size_t>(type)]);
+  }
+
+protected:
+  EventType type;
+}; // Class GeneratedEventBase
+
+static constexpr uint32_t event_bit(EventType event) { return 1u << static_cast<size_t>(event); }
+
+/**
+ * @brief The User Declarations of the HFSM, which the guards and actions
+ *  operate on.
+ */
+struct Context {
+  // User Declarations for the HFSM
+  //::::/c::::Declarations::::
+  bool goToEnd = false;
+  bool goToChoice = true;
+  bool goToHistory = false;
+  bool nextState = false;
+  bool killedState = false;
+  bool someGuard = true;
+  bool someTest = true;
+
+  int someNumber = 40;
+  int someValue = 50;
+};
+
+/**
+ * @brief The flattened model of the HFSM, see FlatStateMachine.
+ */
+struct Model {
+  using Context = ComplexFlat::Context;
+  using Event = EventType;
+
+  enum class State : uint8_t {
+    ROOT,                         // /c
+    STATE_1,                      // /c/Y
+    STATE_2,                      // /c/v
+    STATE_2__CHILDSTATE,          // /c/v/K
+    STATE_2__CHILDSTATE2,         // /c/v/e
+    STATE_2__CHILDSTATE3,         // /c/v/z
+    STATE_2__CHILDSTATE3__GRAND,  // /c/v/z/6
+    STATE_2__CHILDSTATE3__GRAND2, // /c/v/z/c
+    STATE3,                       // /c/T
+    STATE3__CHILDSTATE2,          // /c/T/0
+    STATE3__CHILDSTATE,           // /c/T/W
+    STATE3__CHILDSTATE3,          // /c/T/w
+    END_STATE,
+  };
+
+  static constexpr size_t num_states = 13;
+  static constexpr size_t num_events = 5;
+  static constexpr size_t max_depth = 3;
+  static constexpr State end_state = State::END_STATE;
+
+  using Transition = FlatTransition<Context, State, Event, max_depth>;
+  using Action = void (*)(Context &);
+
+  static constexpr std::array<State, num_states> parent = {
+      State::ROOT,
+      State::ROOT,
+      State::ROOT,
+      State::STATE_2,
+      State::STATE_2,
+      State::STATE_2,
+      State::STATE_2__CHILDSTATE3,
+      State::STATE_2__CHILDSTATE3,
+      State::ROOT,
+      State::STATE3,
+      State::STATE3,
+      State::STATE3,
+      State::ROOT,
+  };
+
+  static constexpr std::array<State, num_states> initial = {
+      State::STATE_1,
+      State::STATE_1,
+      State::STATE_2__CHILDSTATE,
+      State::STATE_2__CHILDSTATE,
+      State::STATE_2__CHILDSTATE2,
+      State::STATE_2__CHILDSTATE3__GRAND,
+      State::STATE_2__CHILDSTATE3__GRAND,
+      State::STATE_2__CHILDSTATE3__GRAND2,
+      State::STATE3__CHILDSTATE,
+      State::STATE3__CHILDSTATE2,
+      State::STATE3__CHILDSTATE,
+      State::STATE3__CHILDSTATE3,
+      State::END_STATE,
+  };
+
+  static constexpr std::array<std::string_view, num_states> name = {
+      "Root",
+      "State_1",
+      "State_2",
+      "State_2::ChildState",
+      "State_2::ChildState2",
+      "State_2::ChildState3",
+      "State_2::ChildState3::Grand",
+      "State_2::ChildState3::Grand2",
+      "State3",
+      "State3::ChildState2",
+      "State3::ChildState",
+      "State3::ChildState3",
+      "End_State",
+  };
+
+  static constexpr std::array<double, num_states> timer_period = {
+      0, 0.1, 0, 0.1, 0.1, 0, 0.1, 0.1, 0, 0.1, 0.1, 0.1, 0,
+  };
+
+  // Entry, Exit, and Tick actions for /c/Y
+  static void state_1_entry(Context &) {
+    //::::/c/Y::::Entry::::
+    [[maybe_unused]] int a = 2;
+    printf("SerialTask :: initializing State 1\n");
+  }
+  static void state_1_exit(Context &) {
+    //::::/c/Y::::Exit::::
+    printf("Exiting State 1\n");
+  }
+  static void state_1_tick(Context &) {
+    //::::/c/Y::::Tick::::
+    printf("SerialTask::State 1::tick()\n");
+  }
+
+  static constexpr std::array<Action, num_states> entry = {nullptr, state_1_entry};
+  static constexpr std::array<Action, num_states> exit = {nullptr, state_1_exit};
+  static constexpr std::array<Action, num_states> tick = {nullptr, state_1_tick};
+
+  static constexpr std::array<uint32_t, num_states> ignored_events = {
+      0,
+      event_bit(Event::ENDEVENT) | event_bit(Event::EVENT3),
+      event_bit(Event::ENDEVENT) | event_bit(Event::EVENT1),
+      event_bit(Event::ENDEVENT),
+      event_bit(Event::ENDEVENT) | event_bit(Event::EVENT1),
+      event_bit(Event::ENDEVENT) | event_bit(Event::EVENT1),
+      event_bit(Event::ENDEVENT),
+      0,
+      event_bit(Event::EVENT1),
+      event_bit(Event::EVENT1),
+      0,
+      event_bit(Event::EVENT1),
+      0,
+  };
+
+  // Internal Transition Action for /c/Y/t
+  static void c_Y_t_action(Context &) {
+    //::::/c/Y/t::::Action::::
+    int testVal = 32;
+    for (int i = 0; i < testVal; i++) {
+      printf("Action iterating: %d\n", i);
+    }
+  }
+
+  // /c/m
+  static constexpr Transition initial_transition = {
+      .source = State::ROOT,
+      .event = Event::ENDEVENT,
+      .target = FlatTarget::STATE,
+      .entries = {State::STATE_1},
+  };
+
+  static constexpr auto transitions = std::to_array<Transition>({
+      // State_1 : /c/Y
+      {// /c/Y/t
+       .source = State::STATE_1,
+       .event = Event::EVENT1,
+       .guard = [](Context &c) { return c.someNumber < c.someValue; },
+       .action = c_Y_t_action},
+      {// /c/Y/X
+       .source = State::STATE_1,
+       .event = Event::EVENT2,
+       .guard = [](Context &c) { return c.someNumber > c.someValue; }},
+      {// /c/I -> /c/h
+       .source = State::STATE_1,
+       .event = Event::EVENT4,
+       .guard = [](Context &c) { return c.someTest && c.goToHistory; },
+       .target = FlatTarget::SHALLOW_HISTORY,
+       .exits = {State::STATE_1},
+       .entries = {State::STATE3}},
+      {// /c/I -> /c/k
+       .source = State::STATE_1,
+       .event = Event::EVENT4,
+       .guard = [](Context &c) { return c.someTest && c.nextState; },
+       .target = FlatTarget::STATE,
+       .exits = {State::STATE_1},
+       .entries = {State::STATE_2, State::STATE_2__CHILDSTATE}},
+      {// /c/I -> /c/r
+       .source = State::STATE_1,
+       .event = Event::EVENT4,
+       .guard = [](Context &c) { return c.someTest; },
+       .target = FlatTarget::STATE,
+       .exits = {State::STATE_1},
+       .entries = {State::STATE3, State::STATE3__CHILDSTATE}},
+      // State_2 : /c/v
+      {// /c/E
+       .source = State::STATE_2,
+       .event = Event::EVENT2,
+       .target = FlatTarget::STATE,
+       .exits = {State::STATE_2},
+       .entries = {State::STATE3, State::STATE3__CHILDSTATE}},
+      {// /c/t
+       .source = State::STATE_2,
+       .event = Event::EVENT3,
+       .target = FlatTarget::SHALLOW_HISTORY,
+       .exits = {State::STATE_2},
+       .entries = {State::STATE3}},
+      {// /c/Q
+       .source = State::STATE_2,
+       .event = Event::EVENT4,
+       .target = FlatTarget::DEEP_HISTORY,
+       .exits = {State::STATE_2},
+       .entries = {State::STATE3}},
+      // State_2::ChildState : /c/v/K
+      {// /c/v/S
+       .source = State::STATE_2__CHILDSTATE,
+       .event = Event::EVENT1,
+       .target = FlatTarget::STATE,
+       .exits = {State::STATE_2__CHILDSTATE},
+       .entries = {State::STATE_2__CHILDSTATE2}},
+      // State_2::ChildState2 : /c/v/e
+      {// /c/v/W
+       .source = State::STATE_2__CHILDSTATE2,
+       .event = Event::EVENT2,
+       .target = FlatTarget::STATE,
+       .exits = {State::STATE_2__CHILDSTATE2},
+       .entries = {State::STATE_2__CHILDSTATE3, State::STATE_2__CHILDSTATE3__GRAND}},
+      // State_2::ChildState3 : /c/v/z
+      {// /c/v/P
+       .source = State::STATE_2__CHILDSTATE3,
+       .event = Event::EVENT3,
+       .guard = [](Context &c) { return c.someGuard; },
+       .target = FlatTarget::STATE,
+       .exits = {State::STATE_2__CHILDSTATE3},
+       .entries = {State::STATE_2__CHILDSTATE}},
+      // State_2::ChildState3::Grand : /c/v/z/6
+      {// /c/v/z/z
+       .source = State::STATE_2__CHILDSTATE3__GRAND,
+       .event = Event::EVENT1,
+       .target = FlatTarget::STATE,
+       .exits = {State::STATE_2__CHILDSTATE3__GRAND},
+       .entries = {State::STATE_2__CHILDSTATE3__GRAND2}},
+      // State_2::ChildState3::Grand2 : /c/v/z/c
+      {// /c/v/z/9 -> /c/v/F -> /c/v/g -> /c/F
+       .source = State::STATE_2__CHILDSTATE3__GRAND2,
+       .event = Event::ENDEVENT,
+       .guard = [](Context &c) { return c.killedState; },
+       .target = FlatTarget::END,
+       .exits = {State::STATE_2__CHILDSTATE3__GRAND2, State::STATE_2__CHILDSTATE3,
+                 State::STATE_2}},
+      {// /c/v/z/9 -> /c/v/F -> /c/v/2
+       .source = State::STATE_2__CHILDSTATE3__GRAND2,
+       .event = Event::ENDEVENT,
+       .target = FlatTarget::STATE,
+       .exits = {State::STATE_2__CHILDSTATE3__GRAND2, State::STATE_2__CHILDSTATE3},
+       .entries = {State::STATE_2__CHILDSTATE3, State::STATE_2__CHILDSTATE3__GRAND}},
+      {// /c/v/z/a
+       .source = State::STATE_2__CHILDSTATE3__GRAND2,
+       .event = Event::EVENT1,
+       .target = FlatTarget::STATE,
+       .exits = {State::STATE_2__CHILDSTATE3__GRAND2},
+       .entries = {State::STATE_2__CHILDSTATE3__GRAND}},
+      {// /c/v/z/R -> /c/v/z/j -> /c/v/F -> /c/v/g -> /c/F
+       .source = State::STATE_2__CHILDSTATE3__GRAND2,
+       .event = Event::EVENT2,
+       .guard = [](Context &c) { return c.goToEnd && c.killedState; },
+       .target = FlatTarget::END,
+       .exits = {State::STATE_2__CHILDSTATE3__GRAND2, State::STATE_2__CHILDSTATE3,
+                 State::STATE_2}},
+      {// /c/v/z/R -> /c/v/z/j -> /c/v/F -> /c/v/2
+       .source = State::STATE_2__CHILDSTATE3__GRAND2,
+       .event = Event::EVENT2,
+       .guard = [](Context &c) { return c.goToEnd; },
+       .target = FlatTarget::STATE,
+       .exits = {State::STATE_2__CHILDSTATE3__GRAND2, State::STATE_2__CHILDSTATE3},
+       .entries = {State::STATE_2__CHILDSTATE3, State::STATE_2__CHILDSTATE3__GRAND}},
+      {// /c/v/z/R -> /c/v/z/g -> /c/h
+       .source = State::STATE_2__CHILDSTATE3__GRAND2,
+       .event = Event::EVENT2,
+       .guard = [](Context &c) { return c.goToChoice && c.goToHistory; },
+       .target = FlatTarget::SHALLOW_HISTORY,
+       .exits = {State::STATE_2__CHILDSTATE3__GRAND2, State::STATE_2__CHILDSTATE3,
+                 State::STATE_2},
+       .entries = {State::STATE3}},
+      {// /c/v/z/R -> /c/v/z/g -> /c/k
+       .source = State::STATE_2__CHILDSTATE3__GRAND2,
+       .event = Event::EVENT2,
+       .guard = [](Context &c) { return c.goToChoice && c.nextState; },
+       .target = FlatTarget::STATE,
+       .exits = {State::STATE_2__CHILDSTATE3__GRAND2, State::STATE_2__CHILDSTATE3,
+                 State::STATE_2},
+       .entries = {State::STATE_2, State::STATE_2__CHILDSTATE}},
+      {// /c/v/z/R -> /c/v/z/g -> /c/r
+       .source = State::STATE_2__CHILDSTATE3__GRAND2,
+       .event = Event::EVENT2,
+       .guard = [](Context &c) { return c.goToChoice; },
+       .target = FlatTarget::STATE,
+       .exits = {State::STATE_2__CHILDSTATE3__GRAND2, State::STATE_2__CHILDSTATE3,
+                 State::STATE_2},
+       .entries = {State::STATE3, State::STATE3__CHILDSTATE}},
+      {// /c/v/z/R -> /c/v/z/O
+       .source = State::STATE_2__CHILDSTATE3__GRAND2,
+       .event = Event::EVENT2,
+       .target = FlatTarget::STATE,
+       .exits = {State::STATE_2__CHILDSTATE3__GRAND2},
+       .entries = {State::STATE_2__CHILDSTATE3__GRAND2}},
+      // State3 : /c/T
+      {// /c/L
+       .source = State::STATE3,
+       .event = Event::ENDEVENT,
+       .target = FlatTarget::STATE,
+       .exits = {State::STATE3},
+       .entries = {State::STATE_1}},
+      {// /c/z
+       .source = State::STATE3,
+       .event = Event::EVENT2,
+       .target = FlatTarget::STATE,
+       .exits = {State::STATE3},
+       .entries = {State::STATE_2, State::STATE_2__CHILDSTATE}},
+      {// /c/C
+       .source = State::STATE3,
+       .event = Event::EVENT3,
+       .target = FlatTarget::SHALLOW_HISTORY,
+       .exits = {State::STATE3},
+       .entries = {State::STATE_2}},
+      {// /c/w
+       .source = State::STATE3,
+       .event = Event::EVENT4,
+       .target = FlatTarget::DEEP_HISTORY,
+       .exits = {State::STATE3},
+       .entries = {State::STATE_2}},
+      // State3::ChildState2 : /c/T/0
+      {// /c/T/h -> /c/A
+       .source = State::STATE3__CHILDSTATE2,
+       .event = Event::ENDEVENT,
+       .target = FlatTarget::END,
+       .exits = {State::STATE3__CHILDSTATE2, State::STATE3}},
+      {// /c/T/j
+       .source = State::STATE3__CHILDSTATE2,
+       .event = Event::EVENT2,
+       .target = FlatTarget::STATE,
+       .exits = {State::STATE3__CHILDSTATE2},
+       .entries = {State::STATE3__CHILDSTATE3}},
+      // State3::ChildState : /c/T/W
+      {// /c/T/L
+       .source = State::STATE3__CHILDSTATE,
+       .event = Event::EVENT1,
+       .target = FlatTarget::STATE,
+       .exits = {State::STATE3__CHILDSTATE},
+       .entries = {State::STATE3__CHILDSTATE2}},
+      // State3::ChildState3 : /c/T/w
+      {// /c/T/p
+       .source = State::STATE3__CHILDSTATE3,
+       .event = Event::EVENT3,
+       .target = FlatTarget::STATE,
+       .exits = {State::STATE3__CHILDSTATE3},
+       .entries = {State::STATE3__CHILDSTATE}},
+  });
+};
+
+using State = Model::State;
+
+/**
+ * @brief The ROOT of the HFSM, with the same API as the class based
+ *  generated Root, and the StateBase API as a facade over the
+ *  FlatStateMachine.
+ */
+class Root : public StateBase, public Context {
+public:
+  Root()
+      : StateBase()
+      , hfsm_(*this) {}
+
+  void set_log_callback(LogCallback cb) { hfsm_.set_log_callback(cb); }
+
+  // helper functions for spawning events into the HFSM (the events of this
+  // model carry no data, so only their types are queued)
+  void spawn_ENDEVENT_event(const ENDEVENTEventData &) { spawn(EventType::ENDEVENT); }
+  void spawn_EVENT1_event(const EVENT1EventData &) { spawn(EventType::EVENT1); }
+  void spawn_EVENT2_event(const EVENT2EventData &) { spawn(EventType::EVENT2); }
+  void spawn_EVENT3_event(const EVENT3EventData &) { spawn(EventType::EVENT3); }
+  void spawn_EVENT4_event(const EVENT4EventData &) { spawn(EventType::EVENT4); }
+
+  /**
+   * @brief Fully initializes the HFSM, entering its initial states.
+   */
+  void initialize(void) override { hfsm_.initialize(); }
+
+  /**
+   * @brief Returns true if there are any events in the event queue.
+   */
+  bool has_events(void) {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    return !events_.empty();
+  }
+
+  /**
+   * @brief Sleeps until an event is available or the current state's timer
+   *  period expires.
+   */
+  void sleep_until_event(void) {
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    queue_cv_.wait_for(lock, std::chrono::duration<double>(getTimerPeriod()));
+  }
+
+  /**
+   * @brief Waits for an event to be available, then returns.
+   */
+  void wait_for_events(void) {
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    queue_cv_.wait(lock);
+  }
+
+  /**
+   * @brief Handles all events in the event queue, including any events
+   *  spawned while handling them.
+   */
+  void handle_all_events(void) {
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    while (!events_.empty()) {
+      EventType event = events_.front();
+      events_.pop_front();
+      lock.unlock();
+      hfsm_.handle_event(event);
+      lock.lock();
+    }
+  }
+
+  /**
+   * @brief Terminates the HFSM, calling the exit actions from the active
+   *  leaf state up to the root.
+   */
+  void terminate(void) { hfsm_.terminate(); }
+
+  /**
+   * @brief Restarts the HFSM by calling terminate and then initialize.
+   */
+  void restart(void) {
+    terminate();
+    initialize();
+  }
+
+  /**
+   * @brief Returns true if the HFSM has reached its END State
+   */
+  bool has_stopped(void) { return hfsm_.has_stopped(); }
+
+  /**
+   * @brief Handles the event immediately, without queueing it.
+   * @return true if event is consumed, false otherwise
+   */
+  bool handle_event(EventType event) { return hfsm_.handle_event(event); }
+
+  /**
+   * @brief Handles a GeneratedEventBase immediately, for the StateBase API.
+   * @return true if event is consumed, false otherwise
+   */
+  bool handleEvent(EventBase *event) override {
+    return hfsm_.handle_event(static_cast<GeneratedEventBase *>(event)->get_type());
+  }
+
+  /**
+   * @brief Runs the tick actions from the root down to the active leaf.
+   */
+  void tick(void) override { hfsm_.tick(); }
+
+  /**
+   * @brief Returns the timer period of the active leaf state. Since the
+   *  active states are not StateBase objects, getActiveLeaf() returns the
+   *  root, so getActiveLeaf()->getTimerPeriod() works as with the class
+   *  based HFSM.
+   */
+  double getTimerPeriod(void) override { return hfsm_.get_timer_period(); }
+
+  /**
+   * @brief Returns the active leaf state.
+   */
+  State get_active_leaf(void) const { return hfsm_.get_active_leaf(); }
+
+protected:
+  void spawn(EventType event) {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    events_.push_back(event);
+    queue_cv_.notify_one();
+  }
+
+  FlatStateMachine<Model> hfsm_;
+  std::mutex queue_mutex_;
+  std::condition_variable queue_cv_;
+  std::deque<EventType> events_;
+}; // class Root
+
+}; // namespace espp::state_machine::ComplexFlat
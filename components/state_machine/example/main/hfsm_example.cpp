@@ -1,3 +1,4 @@
+#include <array>
 #include <chrono>
 #include <iostream>
 #include <thread>
@@ -7,6 +8,7 @@
 #include "format.hpp"
 #include "task.hpp"
 
+#include "Complex_generated_flat_states.hpp"
 #include "Complex_generated_states.hpp"
 
 using namespace std::chrono_literals;
@@ -79,6 +81,107 @@ extern "C" void app_main(void) {
     //! [hfsm example]
   }
 
+  {
+    fmt::print("Starting flat hfsm example!\n");
+    //! [flat hfsm example]
+    // the flat table backend of the same HFSM has the same API
+    espp::state_machine::ComplexFlat::Root flat_root;
+
+    // set the log callback to print to stdout
+    flat_root.set_log_callback([](std::string_view msg) { fmt::print("{}\n", msg); });
+
+    // initialize the HFSM
+    flat_root.initialize();
+
+    // start a task to run the hfsm
+    auto task_fn = [&flat_root](std::mutex &m, std::condition_variable &cv) {
+      // execute the state machine
+      flat_root.handle_all_events();
+      flat_root.tick();
+      flat_root.handle_all_events();
+      // the active leaf is not a StateBase, but getTimerPeriod() on the root
+      // returns the active leaf's period
+      auto current_hfsm_period = flat_root.getTimerPeriod();
+      {
+        std::unique_lock<std::mutex> lk(m);
+        cv.wait_for(lk, std::chrono::duration<float>(current_hfsm_period));
+      }
+      // stop the task if the hfsm has stopped (reached its end state)
+      return flat_root.has_stopped();
+    };
+    auto task = espp::Task(
+        {.name = "Flat HFSM", .callback = task_fn, .log_level = espp::Logger::Verbosity::DEBUG});
+    task.start();
+
+    flat_root.spawn_EVENT4_event({});
+    flat_root.spawn_EVENT1_event({});
+    flat_root.spawn_EVENT2_event({});
+    flat_root.spawn_EVENT3_event({});
+    flat_root.spawn_EVENT1_event({});
+    flat_root.spawn_ENDEVENT_event({});
+
+    // give the hfsm some time to handle the events before we fully exit
+    std::this_thread::sleep_for(1s);
+    //! [flat hfsm example]
+  }
+
+  {
+    fmt::print("Starting hfsm benchmark!\n");
+    //! [hfsm benchmark example]
+    // a cycle of events which takes both HFSMs through every level of the
+    // state tree, choices, and deep history, back to State_2::ChildState
+    using espp::state_machine::Complex::EventType;
+    constexpr std::array<EventType, 10> cycle = {
+        EventType::EVENT1, EventType::EVENT2, EventType::EVENT1, EventType::EVENT2,
+        EventType::EVENT1, EventType::EVENT2, EventType::EVENT3, EventType::EVENT4,
+        EventType::EVENT1, EventType::EVENT3,
+    };
+    constexpr size_t num_cycles = 100000;
+    constexpr size_t num_transitions = num_cycles * cycle.size();
+
+    espp::state_machine::Complex::Root complex_root;
+    espp::state_machine::ComplexFlat::Root flat_root;
+    complex_root.initialize();
+    flat_root.initialize();
+    // State_1 -> State3 -> State_2::ChildState
+    complex_root.spawn_EVENT4_event({});
+    complex_root.spawn_EVENT2_event({});
+    complex_root.handle_all_events();
+    flat_root.spawn_EVENT4_event({});
+    flat_root.spawn_EVENT2_event({});
+    flat_root.handle_all_events();
+
+    std::vector<espp::state_machine::Complex::GeneratedEventBase> complex_events;
+    for (auto type : cycle) {
+      complex_events.emplace_back(type);
+    }
+    size_t num_handled = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < num_cycles; i++) {
+      for (auto &event : complex_events) {
+        num_handled += complex_root.handleEvent(&event);
+      }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    float complex_rate = num_transitions / std::chrono::duration<float>(end - start).count();
+
+    start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < num_cycles; i++) {
+      for (auto type : cycle) {
+        num_handled += flat_root.handle_event(
+            static_cast<espp::state_machine::ComplexFlat::EventType>(type));
+      }
+    }
+    end = std::chrono::high_resolution_clock::now();
+    float flat_rate = num_transitions / std::chrono::duration<float>(end - start).count();
+
+    fmt::print("Handled {} of {} events\n", num_handled, 2 * num_transitions);
+    fmt::print("Class hierarchy HFSM: {:.0f} transitions/s\n", complex_rate);
+    fmt::print("Flat table HFSM:      {:.0f} transitions/s ({:.1f}x)\n", flat_rate,
+               flat_rate / complex_rate);
+    //! [hfsm benchmark example]
+  }
+
   {
     fmt::print("Starting test bench hfsm example!\n");
     //! [hfsm test bench example]
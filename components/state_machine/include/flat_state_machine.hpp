@@ -0,0 +1,336 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace espp::state_machine {
+
+/**
+ * @brief What a FlatTransition does after exiting its states and running
+ *        its action.
+ */
+enum class FlatTarget : uint8_t {
+  INTERNAL,        ///< Internal transition: only the action runs.
+  STATE,           ///< Enter the states in FlatTransition::entries.
+  SHALLOW_HISTORY, ///< Enter the last entry, then its last active substate.
+  DEEP_HISTORY,    ///< Enter the last entry, then its last active leaf.
+  END,             ///< Go to the end state of the HFSM.
+};
+
+/**
+ * @brief A transition of a flattened HFSM, with the states to exit and enter
+ *        precomputed from the model instead of walking the state tree when
+ *        the transition is taken.
+ *
+ * @details Transitions through choice pseudostates are flattened into one
+ *          FlatTransition per path through the choices, guarded by the
+ *          conjunction of the guards along the path, and running the actions
+ *          along it. The transitions of a state for an event must be adjacent
+ *          and in the order in which their guards are evaluated (internal
+ *          transitions first).
+ *
+ *          \p exits and \p entries end at the first root state (0), so
+ *          unused elements can be left default initialized. The active
+ *          substates of \p source are exited before \p exits. For a STATE
+ *          transition, \p entries goes from below the least common ancestor
+ *          of the source and target down to the target, followed by the
+ *          target's initial substates down to a leaf.
+ */
+template <typename Context, typename State, typename Event, size_t MaxDepth>
+struct FlatTransition {
+  State source;                            ///< State handling the event.
+  Event event;                             ///< Event triggering the transition.
+  bool (*guard)(Context &){nullptr};       ///< Guard, nullptr if unguarded.
+  void (*action)(Context &){nullptr};      ///< Action, nullptr if none.
+  FlatTarget target{FlatTarget::INTERNAL}; ///< What the transition does.
+  std::array<State, MaxDepth> exits{};     ///< From the source up to the LCA.
+  std::array<State, MaxDepth> entries{};   ///< From below the LCA down.
+};
+
+/**
+ * @brief Runs a HFSM from flat, constexpr tables generated from its model,
+ *        as an alternative to the class hierarchy generated from
+ *        webgme-hfsm. The active state is a single enum value, history is
+ *        one array, and events are dispatched through a table indexed by
+ *        state and event, so handling an event needs no virtual calls or
+ *        recursion.
+ *
+ * @details The \p Model is a (generated) struct providing:
+ *          - `Context`: the type holding the model's user declarations,
+ *            passed to the guards and actions.
+ *          - `State`: an enum of all the states, with the root as 0.
+ *          - `Event`: an enum of all the events, numbered from 0.
+ *          - `num_states`, `num_events`, `max_depth`, and `end_state`.
+ *          - `parent`, `initial`: the parent and initial substate of each
+ *            state, indexed by state. Leaves are their own initial state.
+ *          - `name`, `timer_period`: indexed by state.
+ *          - `entry`, `exit`, `tick`: action function pointers (or nullptr)
+ *            indexed by state.
+ *          - `ignored_events`: bitmask of the events each state ignores.
+ *          - `initial_transition`: the transition run by initialize().
+ *          - `transitions`: all the other transitions, grouped by source
+ *            state and event.
+ *
+ *          Semantics match the class based generated code, including
+ *          history: each composite state remembers its last active substate
+ *          after it is exited.
+ */
+template <typename Model> class FlatStateMachine {
+public:
+  using Context = typename Model::Context;
+  using State = typename Model::State;
+  using Event = typename Model::Event;
+  using Transition = FlatTransition<Context, State, Event, Model::max_depth>;
+  typedef std::function<void(std::string_view)> LogCallback;
+
+  /**
+   * @brief Create the state machine, which starts out inactive.
+   * @param context The context passed to the guards and actions.
+   */
+  explicit FlatStateMachine(Context &context)
+      : context_(context) {
+    for (size_t i = 0; i < Model::num_states; i++) {
+      active_child_[i] = static_cast<State>(i);
+    }
+  }
+
+  /**
+   * @brief Set a callback to log entries, exits, and state transitions.
+   * @param callback The callback, or nullptr to stop logging.
+   */
+  void set_log_callback(const LogCallback &callback) { log_callback_ = callback; }
+
+  /**
+   * @brief Enter the initial states of the HFSM.
+   */
+  void initialize() { enter(Model::initial_transition); }
+
+  /**
+   * @brief Exit the active states, from the active leaf up to the root.
+   */
+  void terminate() { exit_substates(ROOT); }
+
+  /**
+   * @brief Handle an event, taking the first transition for it whose guard
+   *        passes, from the active leaf up through its ancestors.
+   * @param event The event to handle.
+   * @return True if the event was handled, false if it was ignored.
+   */
+  bool handle_event(Event event) {
+    if (leaf_ == Model::end_state) {
+      // the end state consumes all events
+      return true;
+    }
+    const uint32_t event_bit = 1u << index(event);
+    for (State state = leaf_; state != ROOT; state = Model::parent[index(state)]) {
+      if (Model::ignored_events[index(state)] & event_bit) {
+        return false;
+      }
+      const auto &dispatch = DISPATCH[index(state)][index(event)];
+      for (size_t i = dispatch.first; i < dispatch.first + dispatch.count; i++) {
+        const auto &transition = Model::transitions[i];
+        if (transition.guard && !transition.guard(context_)) {
+          continue;
+        }
+        take(transition);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * @brief Run the tick actions of the active states, from the root down to
+   *        the active leaf.
+   */
+  void tick() {
+    std::array<State, Model::max_depth> path{};
+    size_t depth = 0;
+    for (State state = leaf_; state != ROOT; state = Model::parent[index(state)]) {
+      path[depth++] = state;
+    }
+    while (depth > 0) {
+      call(Model::tick, path[--depth]);
+    }
+  }
+
+  /**
+   * @brief Get the active leaf state.
+   * @return The active leaf state, the root if not initialized.
+   */
+  State get_active_leaf() const { return leaf_; }
+
+  /**
+   * @brief Get the timer period of the active leaf state.
+   * @return The timer period of the active leaf state, in seconds.
+   */
+  double get_timer_period() const { return Model::timer_period[index(leaf_)]; }
+
+  /**
+   * @brief Whether the HFSM has reached its end state.
+   * @return True if the active leaf is the end state.
+   */
+  bool has_stopped() const { return leaf_ == Model::end_state; }
+
+protected:
+  static constexpr State ROOT = static_cast<State>(0);
+
+  struct Dispatch {
+    uint16_t first; // index of the first transition for the state and event
+    uint16_t count;
+  };
+
+  static constexpr size_t index(State state) { return static_cast<size_t>(state); }
+  static constexpr size_t index(Event event) { return static_cast<size_t>(event); }
+
+  static constexpr bool transitions_are_grouped() {
+    const auto &transitions = Model::transitions;
+    for (size_t i = 1; i < transitions.size(); i++) {
+      bool same = transitions[i].source == transitions[i - 1].source &&
+                  transitions[i].event == transitions[i - 1].event;
+      for (size_t j = 0; !same && j + 1 < i; j++) {
+        if (transitions[j].source == transitions[i].source &&
+            transitions[j].event == transitions[i].event) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+  static_assert(transitions_are_grouped(),
+                "Model::transitions must be grouped by source state and event");
+  static_assert(Model::num_events <= 32, "ignored_events holds up to 32 events");
+
+  // the transitions of each state for each event
+  static constexpr auto DISPATCH = [] {
+    std::array<std::array<Dispatch, Model::num_events>, Model::num_states> table{};
+    for (size_t i = 0; i < Model::transitions.size(); i++) {
+      const auto &transition = Model::transitions[i];
+      auto &dispatch = table[index(transition.source)][index(transition.event)];
+      if (dispatch.count == 0) {
+        dispatch.first = static_cast<uint16_t>(i);
+      }
+      dispatch.count++;
+    }
+    return table;
+  }();
+
+  void call(const std::array<void (*)(Context &), Model::num_states> &actions, State state) {
+    if (actions[index(state)]) {
+      actions[index(state)](context_);
+    }
+  }
+
+  void log(std::string_view prefix, State state) {
+    if (log_callback_) {
+      log_callback_(std::string(prefix) + std::string(Model::name[index(state)]));
+    }
+  }
+
+  void take(const Transition &transition) {
+    if (transition.target == FlatTarget::INTERNAL) {
+      if (transition.action) {
+        transition.action(context_);
+      }
+      return;
+    }
+    State from = leaf_;
+    exit_substates(transition.source);
+    for (State state : transition.exits) {
+      if (state == ROOT) {
+        break;
+      }
+      log("EXIT::", state);
+      call(Model::exit, state);
+    }
+    if (transition.action) {
+      transition.action(context_);
+    }
+    enter(transition);
+    if (log_callback_) {
+      log_callback_("STATE TRANSITION: " + std::string(Model::name[index(from)]) + "->" +
+                    std::string(Model::name[index(leaf_)]));
+    }
+  }
+
+  // exit the active substates of the state, from the active leaf up
+  void exit_substates(State state) {
+    for (State s = leaf_; s != state && s != ROOT; s = Model::parent[index(s)]) {
+      log("EXIT::", s);
+      call(Model::exit, s);
+    }
+  }
+
+  void enter(const Transition &transition) {
+    State last = ROOT;
+    for (State state : transition.entries) {
+      if (state == ROOT) {
+        break;
+      }
+      log("ENTRY::", state);
+      call(Model::entry, state);
+      last = state;
+    }
+    switch (transition.target) {
+    case FlatTarget::STATE:
+      make_active(last);
+      break;
+    case FlatTarget::SHALLOW_HISTORY:
+      enter_history(last, false);
+      break;
+    case FlatTarget::DEEP_HISTORY:
+      enter_history(last, true);
+      break;
+    case FlatTarget::END:
+      make_active(Model::end_state);
+      break;
+    default:
+      break;
+    }
+  }
+
+  // enter the last active substate of the (entered) state, which is
+  // initialized for shallow history, or re-entered down to its last active
+  // leaf for deep history
+  void enter_history(State state, bool deep) {
+    State child = active_child_[index(state)];
+    while (child != state) {
+      log("ENTRY::", child);
+      call(Model::entry, child);
+      state = child;
+      child = deep ? active_child_[index(state)] : state;
+    }
+    enter_initial(state);
+  }
+
+  // enter the initial substates of the (entered) state down to a leaf
+  void enter_initial(State state) {
+    while (Model::initial[index(state)] != state) {
+      state = Model::initial[index(state)];
+      log("ENTRY::", state);
+      call(Model::entry, state);
+    }
+    make_active(state);
+  }
+
+  // make the leaf active, and the active child of each of its ancestors
+  void make_active(State leaf) {
+    leaf_ = leaf;
+    for (State state = leaf; state != ROOT; state = Model::parent[index(state)]) {
+      active_child_[index(Model::parent[index(state)])] = state;
+    }
+  }
+
+  Context &context_;
+  LogCallback log_callback_{nullptr};
+  State leaf_{ROOT};
+  // the active (or last active) child of each state, or the state itself if
+  // it has not been active yet; this is the history of the HFSM
+  std::array<State, Model::num_states> active_child_{};
+};
+
+} // namespace espp::state_machine
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "deep_history_state.hpp"
+#include "flat_state_machine.hpp"
 #include "shallow_history_state.hpp"
 #include "state_base.hpp"
 #define MAGIC_ENUM_NO_CHECK_SUPPORT 1
@@ -24,6 +25,10 @@ namespace espp {
  * \snippet hfsm_example.cpp hfsm example
  * \section hfsm_ex2 Running the HFSM Test Bench on a Real Device:
  * \snippet hfsm_example.cpp hfsm test bench example
+ * \section hfsm_ex3 Flat Table Backend of the Complex example hfsm
+ * \snippet hfsm_example.cpp flat hfsm example
+ * \section hfsm_ex4 Benchmarking the Class Hierarchy and Flat Table Backends
+ * \snippet hfsm_example.cpp hfsm benchmark example
  */
 class __state_machine_documentation__ {};
 
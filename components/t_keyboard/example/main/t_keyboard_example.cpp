@@ -26,7 +26,6 @@ extern "C" void app_main(void) {
                             std::placeholders::_3),
          .read = std::bind(&espp::I2c::read, &i2c, std::placeholders::_1, std::placeholders::_2,
                            std::placeholders::_3),
-         .key_cb = [](uint8_t key) { fmt::print("'{}' Pressed!\n", (char)key); },
          .auto_start = false, // can't auto start since we need to provide power
          .log_level = espp::Logger::Verbosity::WARN});
 
@@ -43,10 +42,16 @@ extern "C" void app_main(void) {
 
     fmt::print("Tkeyboard ready!\n");
     tkeyboard.start();
-    //! [tkeyboard example]
+
+    // print the keys pressed since the last time we checked
     while (true) {
+      espp::InputEvent event;
+      while (tkeyboard.pop_event(event)) {
+        fmt::print("'{}' Pressed!\n", (char)event.code);
+      }
       std::this_thread::sleep_for(100ms);
     }
+    //! [tkeyboard example]
   }
 
   fmt::print("Tkeyboard example complete!\n");
@@ -3,8 +3,10 @@
 #include <atomic>
 #include <chrono>
 #include <functional>
+#include <optional>
 
 #include "base_peripheral.hpp"
+#include "input_event_queue.hpp"
 #include "task.hpp"
 
 namespace espp {
@@ -14,6 +16,12 @@ namespace espp {
 ///          interface such as I2C. On The T-Keyboard, you can press Alt+B to
 ///          toggle the keyboard backlight.
 ///
+///          The keyboard task reads the last pressed key in a single
+///          transaction per poll, and adds each key press to a lock-free
+///          event queue (see pop_event()), with the time it was read. The
+///          keyboard only holds the last key pressed, so it is polled quickly
+///          while keys are being pressed, and slowly while idle.
+///
 /// \section Example
 /// \snippet t_keyboard_example.cpp tkeyboard example
 class TKeyboard : public BasePeripheral<> {
@@ -36,14 +44,25 @@ public:
 
     /// The key callback function to use. This function will be called when a
     /// key is pressed if it is not null and the keyboard task is running.
-    key_cb_fn key_cb;
+    key_cb_fn key_cb{nullptr};
 
     /// The address of the keyboard.
     uint8_t address = DEFAULT_ADDRESS;
 
-    /// The polling interval for the keyboard
+    /// The polling interval for the keyboard while keys are being pressed.
     std::chrono::milliseconds polling_interval = std::chrono::milliseconds(10);
 
+    /// The polling interval for the keyboard while idle, i.e. once no key has
+    /// been pressed for idle_timeout. If not set (the default), the keyboard
+    /// is always polled at polling_interval. This should be shorter than the
+    /// time between two key presses, since the keyboard only holds the last
+    /// key.
+    std::optional<std::chrono::milliseconds> idle_polling_interval = std::nullopt;
+
+    /// How long after the last key press the keyboard is polled at
+    /// polling_interval.
+    std::chrono::milliseconds idle_timeout = std::chrono::milliseconds(500);
+
     /// Whether or not to automatically start the keyboard task.
     bool auto_start = true;
 
@@ -57,7 +76,9 @@ public:
       : BasePeripheral({.address = config.address, .write = config.write, .read = config.read},
                        "TKeyboard", config.log_level)
       , key_cb_(config.key_cb)
-      , polling_interval_(config.polling_interval) {
+      , polling_interval_(config.polling_interval)
+      , idle_polling_interval_(config.idle_polling_interval.value_or(config.polling_interval))
+      , idle_timeout_(config.idle_timeout) {
     logger_.info("TKeyboard created");
     task_ = std::make_shared<espp::Task>(espp::Task::Config{
         .name = "tkeyboard_task",
@@ -76,6 +97,20 @@ public:
   /// \note This function will return 0 if no key has been pressed.
   uint8_t get_key() const { return pressed_key_; }
 
+  /// \brief Get the oldest key press from the event queue.
+  /// \details The keyboard task adds an event for each key it reads, with
+  ///          InputEvent::code being the key. The keyboard does not report
+  ///          key releases.
+  /// \param event Set to the oldest event, if there is one.
+  /// \return True if there was an event, false if the queue was empty.
+  /// \note This should only be called from one task at a time.
+  bool pop_event(InputEvent &event) { return events_.pop(event); }
+
+  /// \brief Get the number of key presses which were dropped because the
+  ///        event queue was full.
+  /// \return The number of dropped events.
+  size_t get_num_dropped_events() const { return events_.get_num_dropped(); }
+
   /// \brief Read a key from the keyboard.
   /// \details This function reads a key from the keyboard.
   /// \param ec The error code to set if an error occurs.
@@ -114,16 +149,22 @@ protected:
     auto key = read_u8(ec);
     if (!ec) {
       pressed_key_ = key;
-      if (key != 0 && key_cb_) {
-        key_cb_(key);
+      if (key != 0) {
+        last_key_time_ = start_time;
+        events_.push({.code = key, .pressed = true, .timestamp = start_time});
+        if (key_cb_) {
+          key_cb_(key);
+        }
       }
     } else {
       logger_.error("Failed to get key: {}", ec.message());
       pressed_key_ = 0;
     }
+    // poll quickly while keys are being pressed, and slowly while idle
+    bool active = start_time - last_key_time_ < idle_timeout_;
     {
       std::unique_lock<std::mutex> lock(m);
-      cv.wait_until(lock, start_time + polling_interval_);
+      cv.wait_until(lock, start_time + (active ? polling_interval_ : idle_polling_interval_));
     }
     return false;
   }
@@ -131,6 +172,10 @@ protected:
   key_cb_fn key_cb_;
   std::atomic<uint8_t> pressed_key_{0};
   std::chrono::milliseconds polling_interval_;
+  std::chrono::milliseconds idle_polling_interval_;
+  std::chrono::milliseconds idle_timeout_;
+  std::chrono::steady_clock::time_point last_key_time_{};
+  InputEventQueue<> events_;
   std::shared_ptr<espp::Task> task_;
 };
 } // namespace espp
@@ -1,18 +1,33 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <cerrno>
 #include <condition_variable>
+#include <cstring>
+#include <deque>
 #include <functional>
+#include <future>
 #include <memory>
+#include <optional>
 #include <thread>
+#include <vector>
 
 #if defined(ESP_PLATFORM)
 #include <esp_pthread.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 #endif
 
 #include "base_component.hpp"
+#include "clock.hpp"
+#include "inplace_function.hpp"
 
 namespace espp {
 
@@ -39,11 +54,44 @@ namespace espp {
  * \section task_ex5 Task Request Stop Example
  * \snippet task_example.cpp Task Request Stop example
  *
+ * \section task_linux Linux
+ * On Linux, the BaseConfig is applied using pthreads:
+ *   * `stack_size_bytes` sets the thread's stack size, if it is larger than
+ *     the default stack size of a thread on the host (usually 8 MiB, from
+ *     `ulimit -s`). Stack sizes sized for the ESP (a few KiB) are too small
+ *     for code built for the host, so they get the host's default instead.
+ *   * `priority` > 0 lowers the thread's nice value (by up to 20), if the
+ *     process is allowed to. If real-time scheduling has been enabled with
+ *     Task::set_realtime_scheduling(), the thread instead runs with the
+ *     SCHED_FIFO policy at that priority (clamped to the valid range), falling
+ *     back to the nice value if the process is not allowed to use it.
+ *   * `core_id` >= 0 pins the thread to that CPU. If the CPU does not exist,
+ *     a warning is logged and the thread runs unpinned.
+ *   * `name` is used as the thread name (truncated to 15 characters).
+ *
+ * \section task_clock Simulated Time
+ * Each running Task is a participant in the espp::Clock, so when simulated
+ * time is enabled (see Clock::set_simulated()), time only advances while
+ * every Task is blocked in a Clock wait. Task callbacks should therefore use
+ * Clock::wait_for() / Clock::wait_until() with the provided mutex and
+ * condition variable, rather than waiting on the condition variable
+ * directly, so that they can be run in simulated time.
+ *
  * \section run_on_core_ex1 Run on Core Example
  * \snippet task_example.cpp run on core example
  */
 class Task : public BaseComponent {
 public:
+  /**
+   * @brief Size (in bytes) of the storage for the Task callbacks.
+   * @details The callbacks are stored in an espp::InplaceFunction, so they
+   *          never allocate. This is enough for a lambda capturing up to
+   *          eight pointers / references or a std::bind of a member function
+   *          with a few bound arguments. Callables which are larger fail to
+   *          compile.
+   */
+  static constexpr size_t CALLBACK_CAPACITY = 8 * sizeof(void *);
+
   /**
    * @brief Task callback function signature.
    *
@@ -68,7 +116,8 @@ public:
    * @return Whether or not the callback's thread / task should stop - True to
    *         stop, false to continue running.
    */
-  typedef std::function<bool(std::mutex &m, std::condition_variable &cv)> callback_fn;
+  typedef InplaceFunction<bool(std::mutex &m, std::condition_variable &cv), CALLBACK_CAPACITY>
+      callback_fn;
 
   /**
    * @brief Simple callback function signature.
@@ -78,7 +127,7 @@ public:
    *        other tasks.
    * @return True to stop the task, false to continue running.
    */
-  typedef std::function<bool()> simple_callback_fn;
+  typedef InplaceFunction<bool(), CALLBACK_CAPACITY> simple_callback_fn;
 
   /**
    * @brief Base configuration struct for the Task.
@@ -203,9 +252,7 @@ public:
       stop();
     }
     // ensure we stop the thread if it's still around
-    if (thread_.joinable()) {
-      thread_.join();
-    }
+    join_thread();
     logger_.debug("Task destroyed");
   }
 
@@ -248,17 +295,32 @@ public:
           config_.stack_size_bytes, PTHREAD_STACK_MIN, name_);
       return false;
     }
+#elif defined(__linux__)
+    if (config_.core_id >= get_num_cores()) {
+      logger_.warn("core_id ({}) is larger than the number of cores ({}), Task '{}' will not be "
+                   "pinned",
+                   config_.core_id, get_num_cores(), name_);
+    }
 #endif
 
-    if (thread_.joinable()) {
-      thread_.join();
-    }
+    join_thread();
 
     // set the atomic so that when the thread starts it won't immediately
     // exit.
     started_ = true;
-    // create and start the std::thread
+    // register the thread with the clock before it is created so that
+    // simulated time cannot advance before the thread starts running
+    Clock::add_participant();
+    // create and start the thread
+#if defined(__linux__) && !defined(ESP_PLATFORM)
+    if (!create_linux_thread()) {
+      started_ = false;
+      Clock::remove_participant();
+      return false;
+    }
+#else
     thread_ = std::thread(&Task::thread_function, this);
+#endif
 
     logger_.debug("Task started");
     return true;
@@ -272,15 +334,35 @@ public:
    */
   bool stop() {
     logger_.debug("Stopping task");
-    started_ = false;
-    cv_.notify_all();
-    if (thread_.joinable()) {
-      thread_.join();
+    {
+      // hold the mutex while clearing the flag so that the notification
+      // cannot be lost if the callback is about to wait on the cv
+      std::lock_guard<std::mutex> lock(cv_m_);
+      started_ = false;
     }
+    cv_.notify_all();
+    join_thread();
     logger_.debug("Task stopped");
     return true;
   }
 
+  /**
+   * @brief Enable or disable real-time (SCHED_FIFO) scheduling for Tasks
+   *        started afterwards.
+   * @details This only has an effect on Linux, where it is disabled by
+   *          default so that a busy Task with a priority > 0 cannot starve
+   *          the rest of the system when the process has the privileges for
+   *          real-time scheduling. See \ref task_linux.
+   * @param enabled Whether Tasks with a priority > 0 should use SCHED_FIFO.
+   */
+  static void set_realtime_scheduling(bool enabled) { realtime_scheduling_ = enabled; }
+
+  /**
+   * @brief Is real-time scheduling enabled for Tasks?
+   * @return true if Tasks with a priority > 0 use SCHED_FIFO on Linux.
+   */
+  static bool is_realtime_scheduling() { return realtime_scheduling_; }
+
   /**
    * @brief Has the task been started or not?
    *
@@ -321,6 +403,8 @@ public:
                        uxTaskGetStackHighWaterMark(freertos_handle));
   }
 
+#endif
+
   /// Run the given function on the specific core, then return the result (if any)
   /// @details This function will run the given function on the specified core,
   ///         then return the result (if any). If the provided core is the same
@@ -329,79 +413,311 @@ public:
   ///         specified core and the result will be returned to the calling
   ///         thread. Note that this function will block the calling thread until
   ///         the function has completed, regardless of the core it is run on.
+  /// @details The function is run by a persistent worker task for the core,
+  ///          which is created the first time a function is run on that core
+  ///          and then re-used for all subsequent calls, so no task is created
+  ///          per call. If a call needs a larger stack or a higher priority
+  ///          than the worker has, the worker is replaced by one with the
+  ///          larger stack / priority (after the old worker has finished the
+  ///          functions already queued on it).
   /// @param f The function to run
   /// @param core_id The core to run the function on
-  /// @param stack_size_bytes The stack size to allocate for the function
-  /// @param priority The priority of the task
-  /// @note This function is only available on ESP32
+  /// @param stack_size_bytes The minimum stack size of the core's worker task.
+  /// @param priority The minimum priority of the core's worker task.
   /// @note If you provide a core_id < 0, the function will run on the current
   ///       core (same core as the caller)
-  /// @note If you provide a core_id >= configNUM_CORES, the function will run on
-  ///       the last core
+  /// @note If you provide a core_id >= the number of cores, the function will
+  ///       run on the last core
+  /// @note Calling run_on_core() from within a function which is running on
+  ///       the same core's worker runs the nested function directly (on the
+  ///       worker's stack), rather than deadlocking on the worker. Functions
+  ///       which block on each other across cores (a function on core 0
+  ///       waiting for a function on core 1 which waits for core 0) still
+  ///       deadlock.
   static auto run_on_core(const auto &f, int core_id, size_t stack_size_bytes = 2048,
                           size_t priority = 5) {
-    if (core_id < 0 || core_id == xPortGetCoreID()) {
-      // If no core id specified or we are already executing on the desired core,
-      // run the function directly
+    if (core_id < 0 || is_current_core(core_id) || CoreWorker::is_current_worker(core_id)) {
+      // If no core id specified or we are already executing on the desired core
+      // (or within its worker, which would otherwise deadlock waiting on
+      // itself), run the function directly
       return f();
-    } else {
-      // Otherwise run the function on the desired core
-      if (core_id > configNUM_CORES - 1) {
-        // If the core id is larger than the number of cores, run on the last core
-        core_id = configNUM_CORES - 1;
-      }
-      std::mutex mutex;
-      std::unique_lock lock(mutex); // cppcheck-suppress localMutex
-      std::condition_variable cv;   ///< Signal for when the task is done / function is run
-      if constexpr (!std::is_void_v<decltype(f())>) {
-        // the function returns something
-        decltype(f()) ret_val;
-        auto f_task = espp::Task::make_unique(espp::Task::Config{
-            .name = "run_on_core_task",
-            .callback = [&mutex, &cv, &f, &ret_val](auto &cb_m, auto &cb_cv) -> bool {
-              // synchronize with the main thread - block here until the main thread
-              // waits on the condition variable (cv), then run the function
-              std::unique_lock lock(mutex);
-              // run the function
-              ret_val = f();
-              // signal that the task is done
-              cv.notify_all();
-              return true; // stop the task
-            },
-            .stack_size_bytes = stack_size_bytes,
-            .priority = priority,
-            .core_id = core_id,
-        });
-        f_task->start();
-        cv.wait(lock);
-        return ret_val;
+    }
+    auto worker = CoreWorker::get(core_id, stack_size_bytes, priority);
+    // The job lives on this stack frame, and only a pointer to it is queued so
+    // that submitting the job does not allocate.
+    using return_t = decltype(f());
+    using function_t = std::remove_cvref_t<decltype(f)>;
+    struct Job {
+      const function_t &function;
+      std::conditional_t<std::is_void_v<return_t>, bool, std::optional<return_t>> result{};
+      bool done{false};
+      std::mutex mutex{};
+      std::condition_variable cv{};
+    } job{f};
+    worker->submit([job = &job]() {
+      if constexpr (std::is_void_v<return_t>) {
+        job->function();
       } else {
-        // the function returns void
-        auto f_task = espp::Task::make_unique(espp::Task::Config{
-            .name = "run_on_core_task",
-            .callback = [&mutex, &cv, &f](auto &cb_m, auto &cb_cv) -> bool {
-              // synchronize with the main thread - block here until the main thread
-              // waits on the condition variable (cv), then run the function
-              std::unique_lock lock(mutex);
-              // run the function
-              f();
-              // signal that the task is done
-              cv.notify_all();
-              return true; // stop the task
-            },
-            .stack_size_bytes = stack_size_bytes,
-            .priority = priority,
-            .core_id = core_id,
-        });
-        f_task->start();
-        cv.wait(lock);
+        job->result = job->function();
+      }
+      {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        job->done = true;
       }
+      job->cv.notify_all();
+    });
+    std::unique_lock<std::mutex> lock(job.mutex);
+    job.cv.wait(lock, [&job] { return job.done; });
+    if constexpr (!std::is_void_v<return_t>) {
+      return std::move(*job.result);
     }
   }
-#endif
+
+  /// Run the given function on the specific core without waiting for it to
+  /// complete.
+  /// @details Like run_on_core(), but instead of blocking until the function
+  ///          has run, this queues the function on the core's worker task and
+  ///          returns a std::future which can be used to wait for / get the
+  ///          result.
+  /// @param f The function to run. It is copied, so it may go out of scope
+  ///        before it is run.
+  /// @param core_id The core to run the function on
+  /// @param stack_size_bytes The minimum stack size of the core's worker task.
+  /// @param priority The minimum priority of the core's worker task.
+  /// @return A std::future for the result of the function.
+  /// @note If you provide a core_id < 0, the function will be run immediately
+  ///       on the calling thread and the returned future will be ready.
+  static auto run_on_core_non_blocking(const auto &f, int core_id, size_t stack_size_bytes = 2048,
+                                       size_t priority = 5) {
+    using return_t = decltype(f());
+    auto task = std::make_shared<std::packaged_task<return_t()>>(f);
+    auto future = task->get_future();
+    if (core_id < 0) {
+      (*task)();
+      return future;
+    }
+    CoreWorker::get(core_id, stack_size_bytes, priority)->submit([task]() { (*task)(); });
+    return future;
+  }
+
 
 protected:
+  /// Persistent worker task which runs the jobs submitted by run_on_core() /
+  /// run_on_core_non_blocking() for a single core.
+  class CoreWorker {
+  public:
+    CoreWorker(int core_id, size_t stack_size_bytes, size_t priority)
+        : core_id_(core_id)
+        , stack_size_bytes_(stack_size_bytes)
+        , priority_(priority) {
+      task_ = std::make_unique<Task>(Task::Config{
+          .name = fmt::format("core {} worker", core_id),
+          .callback = [this](auto &, auto &) -> bool { return work(); },
+          .stack_size_bytes = stack_size_bytes,
+          .priority = priority,
+          .core_id = core_id,
+      });
+      task_->start();
+    }
+
+    ~CoreWorker() {
+      {
+        // let the worker finish the jobs which were already submitted, since
+        // their callers may be waiting on them
+        std::unique_lock<std::mutex> lock(mutex_);
+        stopping_ = true;
+        cv_.notify_all();
+        cv_.wait(lock, [this] { return stopped_; });
+      }
+      task_->stop();
+    }
+
+    /// Get the worker for the given core, creating it if necessary, or
+    /// replacing it if it has a smaller stack or a lower priority than
+    /// requested.
+    static std::shared_ptr<CoreWorker> get(int core_id, size_t stack_size_bytes,
+                                           size_t priority) {
+      static std::mutex workers_mutex;
+      static std::vector<std::shared_ptr<CoreWorker>> workers(get_num_cores());
+      core_id = clamp_core_id(core_id);
+      // declared before the lock, so that a replaced worker is destroyed
+      // (which waits for its jobs) after the lock has been released
+      std::shared_ptr<CoreWorker> replaced;
+      std::lock_guard<std::mutex> lock(workers_mutex);
+      auto &worker = workers[core_id];
+      if (!worker) {
+        worker = std::make_shared<CoreWorker>(core_id, stack_size_bytes, priority);
+      } else if (stack_size_bytes > worker->stack_size_bytes_ || priority > worker->priority_) {
+        replaced = std::move(worker);
+        worker = std::make_shared<CoreWorker>(
+            core_id, std::max(stack_size_bytes, replaced->stack_size_bytes_),
+            std::max(priority, replaced->priority_));
+      }
+      return worker;
+    }
+
+    /// Is the calling thread a worker for the given core?
+    static bool is_current_worker(int core_id) {
+      return current_worker_core_id_ == clamp_core_id(core_id);
+    }
+
+    void submit(InplaceFunction<void()> job) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.push_back(std::move(job));
+      }
+      cv_.notify_one();
+    }
+
+  protected:
+    // If the core id is larger than the number of cores, run on the last core
+    static int clamp_core_id(int core_id) { return std::min(core_id, get_num_cores() - 1); }
+
+    bool work() {
+      current_worker_core_id_ = core_id_;
+      InplaceFunction<void()> job;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopping_ && jobs_.empty()) {
+          Clock::wait(cv_, lock);
+        }
+        if (jobs_.empty()) {
+          // stopping, and all jobs are done
+          stopped_ = true;
+          cv_.notify_all();
+          return true;
+        }
+        job = std::move(jobs_.front());
+        jobs_.pop_front();
+      }
+      job();
+      return false;
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<InplaceFunction<void()>> jobs_;
+    bool stopping_{false};
+    bool stopped_{false};
+    int core_id_;
+    size_t stack_size_bytes_;
+    size_t priority_;
+    std::unique_ptr<Task> task_;
+    static inline thread_local int current_worker_core_id_{-1};
+  };
+
+#if defined(ESP_PLATFORM)
+  static int get_num_cores() { return configNUM_CORES; }
+  static bool is_current_core(int core_id) { return core_id == xPortGetCoreID(); }
+#else
+  static int get_num_cores() { return std::max(1u, std::thread::hardware_concurrency()); }
+  // threads are not bound to a core unless pinned, so we can never be sure
+  // that we're already running on the requested core
+  static bool is_current_core(int) { return false; }
+#endif
+
+#if defined(__linux__) && !defined(ESP_PLATFORM)
+
+  static void *linux_thread_entry(void *task) {
+    static_cast<Task *>(task)->thread_function();
+    return nullptr;
+  }
+
+  /// Create the thread with the configured stack size.
+  /// @details std::thread does not expose the thread attributes, so the thread
+  ///          is created with pthread_create and its own attributes, which
+  ///          does not affect any other thread created in the process.
+  /// @return true if the thread was created.
+  bool create_linux_thread() {
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    // a new attr has the default stack size of the host, which is only
+    // overridden by larger configured stack sizes
+    size_t default_stack_size = 0;
+    pthread_attr_getstacksize(&attr, &default_stack_size);
+    if (config_.stack_size_bytes > default_stack_size) {
+      int err = pthread_attr_setstacksize(&attr, config_.stack_size_bytes);
+      if (err != 0) {
+        logger_.warn("Could not set stack size ({}) for Task '{}' ({}), using default",
+                     config_.stack_size_bytes, name_, strerror(err));
+      }
+    }
+    int err = pthread_create(&thread_, &attr, &Task::linux_thread_entry, this);
+    pthread_attr_destroy(&attr);
+    if (err != 0) {
+      logger_.error("Could not create thread for Task '{}': {}", name_, strerror(err));
+      return false;
+    }
+    thread_joinable_ = true;
+    return true;
+  }
+
+  /// Apply the name, core affinity, and priority of the BaseConfig to the
+  /// calling thread. Failures (e.g. missing privileges for real-time
+  /// scheduling) are logged, but the task continues to run.
+  void apply_linux_thread_config() {
+    auto self = pthread_self();
+    // thread names are limited to 16 characters including the terminator
+    std::string thread_name = name_.substr(0, 15);
+    pthread_setname_np(self, thread_name.c_str());
+    if (config_.core_id >= 0 && config_.core_id < get_num_cores()) {
+      cpu_set_t cpu_set;
+      CPU_ZERO(&cpu_set);
+      CPU_SET(config_.core_id, &cpu_set);
+      int err = pthread_setaffinity_np(self, sizeof(cpu_set), &cpu_set);
+      if (err != 0) {
+        logger_.warn("Could not pin Task '{}' to core {}: {}", name_, config_.core_id,
+                     strerror(err));
+      }
+    }
+    if (config_.priority == 0) {
+      return;
+    }
+    int err = 0;
+    if (realtime_scheduling_) {
+      int min_priority = sched_get_priority_min(SCHED_FIFO);
+      int max_priority = sched_get_priority_max(SCHED_FIFO);
+      sched_param param{};
+      param.sched_priority = std::clamp((int)config_.priority, min_priority, max_priority);
+      err = pthread_setschedparam(self, SCHED_FIFO, &param);
+      if (err == 0) {
+        return;
+      }
+    }
+    // use a lower nice value, which only affects this thread since nice
+    // values are per-thread on linux
+    int nice_value = -std::clamp((int)config_.priority, 0, 20);
+    pid_t tid = syscall(SYS_gettid);
+    if (setpriority(PRIO_PROCESS, tid, nice_value) == 0) {
+      if (err != 0) {
+        logger_.info("Could not use SCHED_FIFO ({}) for Task '{}', using nice {}", strerror(err),
+                     name_, nice_value);
+      }
+    } else {
+      logger_.warn("Could not set priority {} for Task '{}' ({}), using default", config_.priority,
+                   name_, strerror(errno));
+    }
+  }
+#endif
+
+  void join_thread() {
+#if defined(__linux__) && !defined(ESP_PLATFORM)
+    if (thread_joinable_) {
+      pthread_join(thread_, nullptr);
+      thread_joinable_ = false;
+    }
+#else
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+#endif
+  }
+
   void thread_function() {
+    Clock::Participant clock_participant(Clock::Participant::adopt_t{});
+#if defined(__linux__) && !defined(ESP_PLATFORM)
+    apply_linux_thread_config();
+#endif
     while (started_) {
       if (callback_) {
         bool should_stop = callback_(cv_m_, cv_);
@@ -451,7 +767,14 @@ protected:
   std::atomic<bool> started_{false};
   std::condition_variable cv_;
   std::mutex cv_m_;
+#if defined(__linux__) && !defined(ESP_PLATFORM)
+  pthread_t thread_{};
+  bool thread_joinable_{false};
+#else
   std::thread thread_;
+#endif
+
+  static inline std::atomic<bool> realtime_scheduling_{false};
 };
 } // namespace espp
 
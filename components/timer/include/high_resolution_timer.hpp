@@ -10,6 +10,7 @@
 #include <esp_timer.h>
 
 #include "base_component.hpp"
+#include "inplace_function.hpp"
 #include "task.hpp"
 
 namespace espp {
@@ -29,7 +30,7 @@ namespace espp {
 class HighResolutionTimer : public espp::BaseComponent {
 public:
   /// Callback type for the timer
-  typedef std::function<void()> Callback;
+  typedef InplaceFunction<void()> Callback;
 
   /// Configuration of the timer
   struct Config {
@@ -5,6 +5,8 @@
 #include <string>
 
 #include "base_component.hpp"
+#include "clock.hpp"
+#include "inplace_function.hpp"
 #include "task.hpp"
 
 namespace espp {
@@ -28,6 +30,9 @@ namespace espp {
 ///          automatically, then the timer can be started by calling start().
 ///          The timer can be canceled at any time by calling cancel().
 ///
+/// @note The timer reads time from espp::Clock, so it can be run in
+///       simulated time (see Clock::set_simulated()).
+///
 /// @note The timer uses a task to run in the background, so the timer
 ///       callback function will be called in the context of the task. The
 ///       timer callback function should not block for a long time because it
@@ -49,8 +54,9 @@ namespace espp {
 /// \snippet timer_example.cpp timer update period example
 class Timer : public BaseComponent {
 public:
-  typedef std::function<bool()>
-      callback_fn; ///< The callback function type. Return true to cancel the timer.
+  typedef InplaceFunction<bool(), Task::CALLBACK_CAPACITY>
+      callback_fn; ///< The callback function type. Return true to cancel the timer. Like the
+                   ///< Task callbacks, it never allocates.
 
   /// @brief The configuration for the timer.
   struct Config {
@@ -180,10 +186,10 @@ protected:
     // initial delay, if any - this is only used the first time the timer
     // runs
     if (delay_float > 0) {
-      auto start_time = std::chrono::steady_clock::now();
+      auto start_time = Clock::now();
       logger_.debug("waiting for delay {:.3f} s", delay_float);
       std::unique_lock<std::mutex> lock(m);
-      cv.wait_until(lock, start_time + delay_);
+      Clock::wait_until(cv, lock, start_time + delay_);
       if (!running_) {
         logger_.debug("delay canceled, stopping");
         return true;
@@ -193,7 +199,7 @@ protected:
       delay_float = 0;
     }
     // now run the callback
-    auto start_time = std::chrono::steady_clock::now();
+    auto start_time = Clock::now();
     logger_.debug("running callback");
     bool requested_stop = callback_();
     if (requested_stop || period_float <= 0) {
@@ -202,7 +208,7 @@ protected:
       running_ = false;
       return true;
     }
-    auto end = std::chrono::steady_clock::now();
+    auto end = Clock::now();
     float elapsed = std::chrono::duration<float>(end - start_time).count();
     if (elapsed > period_float) {
       // if the callback took longer than the period, then we should just
@@ -215,7 +221,7 @@ protected:
     // the callback)
     {
       std::unique_lock<std::mutex> lock(m);
-      cv.wait_until(lock, start_time + period_);
+      Clock::wait_until(cv, lock, start_time + period_);
       // Note: we don't care about cv_retval here because we are going to
       // return from the function anyway. If the timer was canceled, then
       // the task will be stopped and the callback will not be called again.
@@ -5,10 +5,12 @@
 #include <functional>
 #include <mutex>
 #include <numeric>
+#include <span>
 #include <thread>
 #include <unordered_map>
 
 #include "base_peripheral.hpp"
+#include "flat_map.hpp"
 
 namespace espp {
 /**
@@ -25,12 +27,14 @@ namespace espp {
  * \section tla2528_ex1 TLA2528 Example
  * \snippet tla2528_example.cpp tla2528 example
  */
-class Tla2528 : public BasePeripheral<> {
+class Tla2528 : public BasePeripheral<std::uint8_t, true, peripheral_lock::Configurable> {
 public:
   static constexpr uint8_t DEFAULT_ADDRESS =
       (0x10); ///< Default I2C address of the device (when both R1 and R2 are DNP) (see data sheet
               ///< Table 2, p. 16)
 
+  static constexpr size_t NUM_CHANNELS = 8; ///< Number of channels on the ADC
+
   /// @brief Possible oversampling ratios, see data sheet Table 15 (p. 34)
   enum class OversamplingRatio : uint8_t {
     NONE = 0,   ///< No oversampling
@@ -59,6 +63,9 @@ public:
     CH7 = 7, ///< Channel 7
   };
 
+  /// @brief Fixed-capacity (non-allocating) map from channel to value.
+  template <typename T> using ChannelMap = espp::FlatMap<Channel, T, NUM_CHANNELS>;
+
   /// @brief Possible modes for analog input conversion
   ///
   /// The ADS7128 device has the following sampling modes:
@@ -131,6 +138,10 @@ public:
     BasePeripheral::read_fn read;   ///< Function to read from the ADC
     bool auto_init = true;          ///< Automatically initialize the ADC on construction. If false,
                                     ///< initialize() must be called before any other functions.
+    peripheral_lock::Mode lock_mode =
+        peripheral_lock::Mode::MUTEX; ///< How register access is locked, see espp::peripheral_lock.
+    std::recursive_mutex *bus_mutex = nullptr; ///< Bus mutex for peripheral_lock::Mode::BUS, e.g.
+                                               ///< espp::I2c::get_mutex().
     espp::Logger::Verbosity log_level{espp::Logger::Verbosity::WARN}; ///< Verbosity for the logger.
   };
 
@@ -156,6 +167,7 @@ public:
     if (data_format_ == DataFormat::AVERAGED && append_ == Append::CHANNEL_ID) {
       num_bytes_per_sample_ = 3;
     }
+    set_lock_mode(config.lock_mode, config.bus_mutex);
     // initialize the ADC
     if (config.auto_init) {
       std::error_code ec;
@@ -191,7 +203,7 @@ public:
    *       configured as an analog input.
    */
   float get_mv(Channel channel, std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::lock_guard lock(base_mutex_);
     // we need to trigger a conversion and then read the result
     trigger_conversion(channel, ec);
     if (ec) {
@@ -222,18 +234,43 @@ public:
    *       ADC's buffer (blocking until conversion is complete).
    */
   std::vector<float> get_all_mv(std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::vector<float> values(analog_inputs_.size());
+    get_all_mv(values, ec);
+    if (ec) {
+      return {};
+    }
+    return values;
+  }
+
+  /**
+   * @brief Communicate with the ADC to get the analog value for all channels
+   *        and store them in \p values, without allocating.
+   * @param values Buffer to store the voltages (in mV) in. Must have room for
+   *        (at least) the number of analog inputs configured in the
+   *        constructor.
+   * @param ec Error code to set if an error occurs.
+   * @return The part of \p values which was filled in, in the order of the
+   *         channels configured in the constructor. Empty on error.
+   * @note See get_all_mv(std::error_code &) for more information.
+   */
+  std::span<float> get_all_mv(std::span<float> values, std::error_code &ec) {
+    std::lock_guard lock(base_mutex_);
+    if (values.size() < analog_inputs_.size()) {
+      logger_.error("Buffer too small for {} analog inputs", analog_inputs_.size());
+      ec = std::make_error_code(std::errc::invalid_argument);
+      return {};
+    }
     // TODO: handle the non-autonomous case
-    auto raw_values = read_all(ec);
+    uint16_t raw_buffer[NUM_CHANNELS];
+    auto raw_values = read_all(raw_buffer, ec);
     if (ec) {
       return {};
     }
-    std::vector<float> values(analog_inputs_.size());
     // convert the raw values (uint16_t) to mv (float)
-    for (int i = 0; i < raw_values.size(); i++) {
+    for (size_t i = 0; i < raw_values.size(); i++) {
       values[i] = raw_to_mv(raw_values[i]);
     }
-    return values;
+    return values.first(raw_values.size());
   }
 
   /**
@@ -248,18 +285,35 @@ public:
    *       ADC's buffer (blocking until conversion is complete).
    */
   std::unordered_map<Channel, float> get_all_mv_map(std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
-    std::unordered_map<Channel, float> values;
-    // TODO: handle the non-autonomous case
-    auto raw_values = read_all_map(ec);
+    ChannelMap<float> mapped_values;
+    get_all_mv_map(mapped_values, ec);
     if (ec) {
       return {};
     }
+    return {mapped_values.begin(), mapped_values.end()};
+  }
+
+  /**
+   * @brief Communicate with the ADC to get the analog value for all channels
+   *        and store them in \p values, without allocating.
+   * @param values Map to store the voltages (in mV) read from each channel
+   *        in. It is cleared first.
+   * @param ec Error code to set if an error occurs.
+   * @note See get_all_mv_map(std::error_code &) for more information.
+   */
+  void get_all_mv_map(ChannelMap<float> &values, std::error_code &ec) {
+    std::lock_guard lock(base_mutex_);
+    values.clear();
+    // TODO: handle the non-autonomous case
+    ChannelMap<uint16_t> raw_values;
+    read_all_map(raw_values, ec);
+    if (ec) {
+      return;
+    }
     // convert the raw values (uint16_t) to mv (float)
     for (auto &[channel, raw] : raw_values) {
       values[channel] = raw_to_mv(raw);
     }
-    return values;
   }
 
   /// @brief Configure the digital output mode for the given channel.
@@ -268,7 +322,7 @@ public:
   /// @param ec Error code to set if an error occurs.
   /// @note The channel must have been configured as a digital output.
   void set_digital_output_mode(Channel channel, OutputMode output_mode, std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::lock_guard lock(base_mutex_);
     if (!is_digital_output(channel)) {
       logger_.error("Channel {} is not configured as a digital output", channel);
       ec = std::make_error_code(std::errc::invalid_argument);
@@ -291,7 +345,7 @@ public:
    * @note The channel must have been configured as a digital output.
    */
   void set_digital_output_value(Channel channel, bool value, std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::lock_guard lock(base_mutex_);
     if (!is_digital_output(channel)) {
       logger_.error("Channel {} is not configured as a digital output", channel);
       ec = std::make_error_code(std::errc::invalid_argument);
@@ -312,7 +366,7 @@ public:
    * @note The channel must have been configured as a digital input.
    */
   bool get_digital_input_value(Channel channel, std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::lock_guard lock(base_mutex_);
     if (!is_digital_input(channel)) {
       logger_.error("Channel {} is not configured as a digital input", channel);
       ec = std::make_error_code(std::errc::invalid_argument);
@@ -342,7 +396,7 @@ public:
   /// @note This will reset all registers to their default values (converting
   ///       all channels to analog inputs and disabling all events).
   void reset(std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    std::lock_guard lock(base_mutex_);
     // reset the device
     write_one_(Register::GENERAL_CFG, SW_RST, ec);
     if (ec) {
@@ -654,7 +708,7 @@ protected:
     clear_bits_(Register::SEQUENCE_CFG, SEQ_START, ec);
   }
 
-  std::vector<uint16_t> read_all(std::error_code &ec) {
+  std::span<uint16_t> read_all(std::span<uint16_t, NUM_CHANNELS> values, std::error_code &ec) {
     if (mode_ == Mode::MANUAL) {
       logger_.error("cannot read_all when in MANUAL mode!");
       ec = std::make_error_code(std::errc::protocol_error);
@@ -662,9 +716,9 @@ protected:
     }
     logger_.info("Reading recent values for all channels");
     size_t num_inputs = analog_inputs_.size();
-    std::vector<uint16_t> values(num_inputs);
     size_t num_bytes = num_inputs * num_bytes_per_sample_;
-    uint8_t raw_values[num_bytes];
+    // up to 3 bytes per sample (when averaging with the channel id appended)
+    uint8_t raw_values[NUM_CHANNELS * 3];
     // start the auto conversion sequence
     start_auto_conversion(ec);
     if (ec) {
@@ -684,7 +738,7 @@ protected:
     for (int i = 0; i < num_bytes; i += num_bytes_per_sample_) {
       values[analog_index++] = parse_frame(&raw_values[i]);
     }
-    return values;
+    return values.first(analog_index);
   }
 
   uint16_t parse_frame(const uint8_t *frame_ptr) {
@@ -707,18 +761,18 @@ protected:
     return value;
   }
 
-  std::unordered_map<Channel, uint16_t> read_all_map(std::error_code &ec) {
-    auto raw_values = read_all(ec);
+  void read_all_map(ChannelMap<uint16_t> &map_values, std::error_code &ec) {
+    map_values.clear();
+    uint16_t raw_buffer[NUM_CHANNELS];
+    auto raw_values = read_all(raw_buffer, ec);
     if (ec) {
-      return {};
+      return;
     }
-    // convert the vector (in order of analog_inputs) into a map
-    std::unordered_map<Channel, uint16_t> map_values;
-    for (int i = 0; i < analog_inputs_.size(); i++) {
+    // convert the values (in order of analog_inputs) into a map
+    for (size_t i = 0; i < raw_values.size(); i++) {
       auto ch = analog_inputs_[i];
       map_values[ch] = raw_values[i];
     }
-    return map_values;
   }
 
   void trigger_conversion(Channel ch, std::error_code &ec) {
@@ -829,7 +883,6 @@ protected:
   // used, so we don't use the subclass's read_* and write_* methods directly
 
   uint8_t read_one_(Register reg, std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
     uint8_t data = 0;
     uint8_t read_one_command[] = {OP_READ_ONE, (uint8_t)reg};
     write_then_read(read_one_command, sizeof(read_one_command), &data, 1, ec);
@@ -852,25 +905,21 @@ protected:
   }
 
   void read_block_(Register reg, uint8_t *data, uint8_t len, std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
     uint8_t read_block_command[] = {OP_READ_BLOCK, (uint8_t)reg};
     write_then_read(read_block_command, sizeof(read_block_command), data, len, ec);
   }
 
   void set_bits_(Register reg, uint8_t bit, std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
     uint8_t data[] = {OP_SET_BITS, (uint8_t)reg, bit};
     write_many(data, sizeof(data), ec);
   }
 
   void clear_bits_(Register reg, uint8_t bit, std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
     uint8_t data[] = {OP_CLR_BITS, (uint8_t)reg, bit};
     write_many(data, sizeof(data), ec);
   }
 
   void write_one_(Register reg, uint8_t value, std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
     uint8_t data[] = {OP_WRITE_ONE, (uint8_t)reg, value};
     write_many(data, sizeof(data), ec);
   }
@@ -880,7 +929,6 @@ protected:
   }
 
   void write_block_(Register reg, const uint8_t *data, uint8_t len, std::error_code &ec) {
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
     uint8_t total_len = len + 2;
     uint8_t data_with_header[total_len];
     data_with_header[0] = OP_WRITE_BLOCK;
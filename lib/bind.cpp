@@ -17,6 +17,41 @@
 namespace py = pybind11;
 using namespace espp;
 
+// Allow python callables to be used wherever espp uses an InplaceFunction, by
+// converting them to a std::function (which holds a reference to the python
+// object). This requires the InplaceFunction to be able to hold a
+// std::function, which the default capacity can.
+namespace pybind11::detail {
+template <typename R, typename... Args, size_t Capacity, size_t Alignment>
+struct type_caster<espp::InplaceFunction<R(Args...), Capacity, Alignment>> {
+  using type = espp::InplaceFunction<R(Args...), Capacity, Alignment>;
+  using function_type = std::function<R(Args...)>;
+  using function_caster = make_caster<function_type>;
+  static_assert(sizeof(function_type) <= Capacity,
+                "InplaceFunction is too small to hold the std::function wrapping a python "
+                "callable");
+
+  PYBIND11_TYPE_CASTER(type, function_caster::name);
+
+  bool load(handle src, bool convert) {
+    function_caster caster;
+    if (!caster.load(src, convert)) {
+      return false;
+    }
+    value = cast_op<function_type &&>(std::move(caster));
+    return true;
+  }
+
+  template <typename Func>
+  static handle cast(Func &&f, return_value_policy policy, handle parent) {
+    if (!f) {
+      return none().release();
+    }
+    return function_caster::cast(function_type(std::forward<Func>(f)), policy, parent);
+  }
+};
+} // namespace pybind11::detail
+
 PYBIND11_MODULE(espp, m) {
 
   // Logger Verbosity
@@ -0,0 +1,303 @@
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ads1x15.hpp"
+#include "logger.hpp"
+
+using namespace std::chrono_literals;
+using Clock = std::chrono::steady_clock;
+
+// Model of an ADS1115 on a 400 kHz I2C bus: the pointer, config, threshold,
+// and conversion registers, single-shot and continuous conversions at the
+// configured data rate (with its oscillator running 5% slow), and the
+// ALERT/RDY pin in conversion ready mode. Each transaction takes as long as
+// its bytes would on the bus.
+class SimulatedAds1115 {
+public:
+  static constexpr float oscillator_error = 1.05f;
+  static constexpr auto byte_time = std::chrono::nanoseconds(9 * 1'000'000'000LL / 400'000);
+
+  explicit SimulatedAds1115(std::function<void()> alert_callback)
+      : alert_callback_(alert_callback) {
+    alert_thread_ = std::thread([this] { run_alert(); });
+  }
+
+  ~SimulatedAds1115() {
+    done_ = true;
+    alert_thread_.join();
+  }
+
+  // the raw value converted on each channel
+  static int16_t channel_value(int channel) { return 1000 * (channel + 1); }
+
+  bool write(uint8_t, const uint8_t *data, size_t length) {
+    bus_time(length);
+    std::lock_guard<std::mutex> lock(mutex_);
+    num_transactions_++;
+    update(Clock::now());
+    if (length == 0) {
+      return false;
+    }
+    pointer_ = data[0] & 0x3;
+    if (length < 3) {
+      return true;
+    }
+    uint16_t value = (data[1] << 8) | data[2];
+    if (pointer_ != 1) {
+      registers_[pointer_] = value;
+      return true;
+    }
+    registers_[1] = value & 0x7FFF;
+    channel_ = ((value >> 12) & 0x7) - 4;
+    auto now = Clock::now();
+    if (!(value & 0x0100)) {
+      // continuous mode
+      busy_ = true;
+      continuous_ = true;
+      conversion_done_ = now + conversion_time();
+    } else if (value & 0x8000) {
+      // start a single-shot conversion
+      busy_ = true;
+      continuous_ = false;
+      conversion_done_ = now + conversion_time();
+    } else {
+      continuous_ = false;
+    }
+    return true;
+  }
+
+  bool read(uint8_t, uint8_t *data, size_t length) {
+    bus_time(length);
+    std::lock_guard<std::mutex> lock(mutex_);
+    num_transactions_++;
+    update(Clock::now());
+    uint16_t value = registers_[pointer_];
+    if (pointer_ == 1 && !busy_) {
+      // OS bit reads 1 when no conversion is in progress
+      value |= 0x8000;
+    }
+    if (length > 0) {
+      data[0] = value >> 8;
+    }
+    if (length > 1) {
+      data[1] = value & 0xFF;
+    }
+    return true;
+  }
+
+  size_t get_num_transactions() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return num_transactions_;
+  }
+
+protected:
+  static void bus_time(size_t length) {
+    // address byte + data bytes
+    auto end = Clock::now() + byte_time * (length + 1);
+    while (Clock::now() < end) {
+    }
+  }
+
+  std::chrono::nanoseconds conversion_time() const {
+    static constexpr float rates[] = {8, 16, 32, 64, 128, 250, 475, 860};
+    float rate = rates[(registers_[1] >> 5) & 0x7];
+    return std::chrono::nanoseconds(int64_t(1e9f * oscillator_error / rate));
+  }
+
+  // complete the conversions which are done by now, returning the number of
+  // ALERT/RDY pulses
+  size_t update(Clock::time_point now) {
+    size_t num_pulses = 0;
+    while (busy_ && now >= conversion_done_) {
+      registers_[0] = channel_value(channel_);
+      num_pulses++;
+      if (continuous_) {
+        conversion_done_ += conversion_time();
+      } else {
+        busy_ = false;
+      }
+    }
+    // conversion ready mode: MSB of HITHRESH is 1, MSB of LOWTHRESH is 0, and
+    // the comparator queue is enabled
+    bool ready_mode =
+        (registers_[3] & 0x8000) && !(registers_[2] & 0x8000) && (registers_[1] & 0x3) != 0x3;
+    return ready_mode ? num_pulses : 0;
+  }
+
+  void run_alert() {
+    while (!done_) {
+      size_t num_pulses = 0;
+      Clock::time_point next;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        num_pulses = update(Clock::now());
+        next = busy_ ? conversion_done_ : Clock::now() + 100us;
+      }
+      for (size_t i = 0; i < num_pulses; i++) {
+        alert_callback_();
+      }
+      std::this_thread::sleep_until(std::min(next, Clock::now() + 1ms));
+    }
+  }
+
+  std::function<void()> alert_callback_;
+  std::mutex mutex_;
+  uint8_t pointer_{0};
+  uint16_t registers_[4]{0, 0x8583, 0x8000, 0x7FFF};
+  int channel_{0};
+  bool busy_{false};
+  bool continuous_{false};
+  Clock::time_point conversion_done_;
+  size_t num_transactions_{0};
+  std::atomic<bool> done_{false};
+  std::thread alert_thread_;
+};
+
+struct Result {
+  float samples_per_second;
+  float transactions_per_sample;
+};
+
+int main() {
+  espp::Logger logger({.tag = "Ads1x15 Test", .level = espp::Logger::Verbosity::INFO});
+
+  logger.info("Starting ADS1x15 test");
+
+  static constexpr auto duration = 500ms;
+  // the simulator is destroyed first, so its ALERT/RDY callback never
+  // outlives the ADC
+  SimulatedAds1115 *sim_ptr = nullptr;
+  espp::Ads1x15 ads(espp::Ads1x15::Ads1115Config{
+      .write = [&sim_ptr](uint8_t addr, const uint8_t *data,
+                          size_t len) { return sim_ptr->write(addr, data, len); },
+      .read = [&sim_ptr](uint8_t addr, uint8_t *data,
+                         size_t len) { return sim_ptr->read(addr, data, len); },
+      .sample_rate = espp::Ads1x15::Ads1115Rate::SPS860,
+  });
+  SimulatedAds1115 sim([&ads] { ads.notify_conversion_ready(); });
+  sim_ptr = &sim;
+
+  auto mv = [](int channel) {
+    // gain 2/3: +/-6.144 V full scale
+    return SimulatedAds1115::channel_value(channel) * (6144.0f / 32768);
+  };
+
+  // baseline: sample each of the 4 channels in turn with sample_mv()
+  Result baseline{};
+  {
+    std::error_code ec;
+    size_t num_samples = 0;
+    size_t start_transactions = sim.get_num_transactions();
+    auto start = Clock::now();
+    while (Clock::now() - start < duration) {
+      int channel = num_samples % 4;
+      float value = ads.sample_mv(channel, ec);
+      if (ec || value != mv(channel)) {
+        logger.error("sample_mv({}) returned {} mV: {}", channel, value, ec.message());
+        return 1;
+      }
+      num_samples++;
+    }
+    float elapsed = std::chrono::duration<float>(Clock::now() - start).count();
+    baseline.samples_per_second = num_samples / elapsed;
+    baseline.transactions_per_sample =
+        float(sim.get_num_transactions() - start_transactions) / num_samples;
+  }
+
+  std::vector<espp::Ads1x15::Sample> samples;
+  samples.reserve(1024);
+  auto scan = [&](const std::vector<int> &channels, bool use_alert_pin) -> Result {
+    std::error_code ec;
+    if (!ads.start_scan({.channels = channels, .buffer_size = 1024, .use_alert_pin = use_alert_pin},
+                        ec)) {
+      logger.error("start_scan failed: {}", ec.message());
+      return {};
+    }
+    // sample_mv() is not allowed while scanning
+    ads.sample_mv(0, ec);
+    if (ec != std::errc::device_or_resource_busy) {
+      logger.error("sample_mv() should fail while scanning");
+      return {};
+    }
+    size_t start_transactions = sim.get_num_transactions();
+    std::this_thread::sleep_for(duration);
+    ads.stop_scan();
+    size_t num_transactions = sim.get_num_transactions() - start_transactions;
+    ads.read_samples(samples);
+    if (samples.size() < 2 || ads.get_num_dropped_samples() > 0) {
+      logger.error("got {} samples, dropped {}", samples.size(), ads.get_num_dropped_samples());
+      return {};
+    }
+    for (size_t i = 0; i < samples.size(); i++) {
+      const auto &sample = samples[i];
+      if (sample.channel != channels[i % channels.size()] || sample.mv != mv(sample.channel) ||
+          (i > 0 && sample.timestamp < samples[i - 1].timestamp)) {
+        logger.error("sample {} is channel {} = {} mV", i, sample.channel, sample.mv);
+        return {};
+      }
+    }
+    float elapsed =
+        std::chrono::duration<float>(samples.back().timestamp - samples.front().timestamp).count();
+    return {
+        .samples_per_second = (samples.size() - 1) / elapsed,
+        .transactions_per_sample = float(num_transactions) / samples.size(),
+    };
+  };
+
+  auto polled = scan({0, 1, 2, 3}, false);
+  auto alert = scan({0, 1, 2, 3}, true);
+  auto continuous = scan({2}, true);
+
+  // at 860 SPS, with the simulated oscillator 5% slow
+  float max_rate = 860.0f / SimulatedAds1115::oscillator_error;
+  logger.info("ADS1115 at 860 SPS (max {:.0f} samples/s), 400 kHz I2C:", max_rate);
+  auto report = [&](std::string_view name, const Result &result) {
+    logger.info("  {:<36} {:6.1f} samples/s, {:5.2f} transactions/sample", name,
+                result.samples_per_second, result.transactions_per_sample);
+  };
+  report("sample_mv(), 4 channels", baseline);
+  report("polled scan, 4 channels", polled);
+  report("ALERT/RDY scan, 4 channels", alert);
+  report("ALERT/RDY continuous scan, 1 channel", continuous);
+
+  // the scans must keep up with the data rate (less the latency of waking the
+  // scan task, which is large on a loaded host), with a fraction of the bus
+  // transactions
+  if (polled.samples_per_second < max_rate * 0.5f || alert.samples_per_second < max_rate * 0.5f ||
+      continuous.samples_per_second < max_rate * 0.75f || polled.transactions_per_sample > 3.1f ||
+      alert.transactions_per_sample > 3.1f || continuous.transactions_per_sample > 1.1f ||
+      baseline.transactions_per_sample < 6.0f) {
+    logger.error("Scanning should keep up with the data rate, with fewer bus transactions");
+    return 1;
+  }
+
+  // invalid scans
+  std::error_code ec;
+  if (ads.start_scan({.channels = {}}, ec) || ec != std::errc::invalid_argument ||
+      ads.start_scan({.channels = {0, 4}}, ec) || ads.is_scanning()) {
+    logger.error("Invalid scans should not start");
+    return 1;
+  }
+
+  // a small ring buffer which is not read keeps the latest samples
+  ec.clear();
+  auto start = Clock::now();
+  ads.start_scan({.channels = {1}, .buffer_size = 8, .use_alert_pin = true}, ec);
+  std::this_thread::sleep_for(50ms);
+  ads.stop_scan();
+  ads.read_samples(samples);
+  if (ec || samples.size() != 8 || ads.get_num_dropped_samples() == 0 ||
+      samples.front().timestamp < start + 20ms) {
+    logger.error("Ring buffer overflow: {} samples, {} dropped", samples.size(),
+                 ads.get_num_dropped_samples());
+    return 1;
+  }
+
+  logger.info("ADS1x15 test complete");
+
+  return 0;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Replaces the global operator new / delete to count every heap allocation
+// made by a test. Since the replacements are not inline, include this header
+// in exactly one file of the test (each test is a single file).
+//
+// All the allocating forms (plain, array, aligned, nothrow) are counted, and
+// all the deallocating forms free with std::free, so that no form falls back
+// to the default operator new / delete of the standard library.
+
+static std::atomic<size_t> num_allocations{0};
+
+namespace alloc_counter {
+inline void *allocate(size_t size) {
+  num_allocations++;
+  // malloc(0) may return nullptr, but operator new must not
+  return std::malloc(size ? size : 1);
+}
+
+inline void *allocate(size_t size, std::align_val_t alignment) {
+  num_allocations++;
+  auto align = static_cast<size_t>(alignment);
+  // aligned_alloc needs a size which is a multiple of the alignment
+  size_t aligned_size = (size + align - 1) / align * align;
+  return std::aligned_alloc(align, aligned_size ? aligned_size : align);
+}
+
+// not inlined into the operator delete call sites, where GCC would otherwise
+// warn (-Wmismatched-new-delete) that memory from operator new is freed with
+// std::free, not knowing that this operator new allocates with std::malloc
+[[gnu::noinline]] inline void deallocate(void *ptr) noexcept { std::free(ptr); }
+} // namespace alloc_counter
+
+void *operator new(size_t size) {
+  if (void *ptr = alloc_counter::allocate(size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new[](size_t size) {
+  if (void *ptr = alloc_counter::allocate(size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new(size_t size, std::align_val_t alignment) {
+  if (void *ptr = alloc_counter::allocate(size, alignment)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new[](size_t size, std::align_val_t alignment) {
+  if (void *ptr = alloc_counter::allocate(size, alignment)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  return alloc_counter::allocate(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+  return alloc_counter::allocate(size);
+}
+
+void *operator new(size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+  return alloc_counter::allocate(size, alignment);
+}
+
+void *operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+  return alloc_counter::allocate(size, alignment);
+}
+
+void operator delete(void *ptr) noexcept { alloc_counter::deallocate(ptr); }
+void operator delete[](void *ptr) noexcept { alloc_counter::deallocate(ptr); }
+void operator delete(void *ptr, size_t) noexcept { alloc_counter::deallocate(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { alloc_counter::deallocate(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept { alloc_counter::deallocate(ptr); }
+void operator delete[](void *ptr, std::align_val_t) noexcept { alloc_counter::deallocate(ptr); }
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept {
+  alloc_counter::deallocate(ptr);
+}
+void operator delete[](void *ptr, size_t, std::align_val_t) noexcept {
+  alloc_counter::deallocate(ptr);
+}
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { alloc_counter::deallocate(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept {
+  alloc_counter::deallocate(ptr);
+}
+void operator delete(void *ptr, std::align_val_t, const std::nothrow_t &) noexcept {
+  alloc_counter::deallocate(ptr);
+}
+void operator delete[](void *ptr, std::align_val_t, const std::nothrow_t &) noexcept {
+  alloc_counter::deallocate(ptr);
+}
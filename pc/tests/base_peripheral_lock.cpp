@@ -0,0 +1,139 @@
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include "base_peripheral.hpp"
+#include "logger.hpp"
+
+using namespace std::chrono_literals;
+
+// Register-level model of an I2C bus with a single device with 256 8-bit
+// registers. Like espp::I2c, every transaction locks the bus mutex.
+struct SimulatedBus {
+  std::recursive_mutex mutex;
+  uint8_t registers[256]{};
+
+  bool write(uint8_t, const uint8_t *data, size_t length) {
+    std::lock_guard lock(mutex);
+    // first byte is the register address, the rest is data
+    for (size_t i = 1; i < length; i++) {
+      registers[(data[0] + i - 1) % 256] = data[i];
+    }
+    return true;
+  }
+
+  bool read_register(uint8_t, uint8_t reg, uint8_t *data, size_t length) {
+    std::lock_guard lock(mutex);
+    for (size_t i = 0; i < length; i++) {
+      data[i] = registers[(reg + i) % 256];
+    }
+    return true;
+  }
+};
+
+template <typename LockPolicy>
+class SimulatedDevice : public espp::BasePeripheral<uint8_t, true, LockPolicy> {
+public:
+  using Base = espp::BasePeripheral<uint8_t, true, LockPolicy>;
+
+  explicit SimulatedDevice(SimulatedBus &bus)
+      : Base(
+            {
+                .address = 0x10,
+                .write = [&bus](uint8_t address, const uint8_t *data,
+                                size_t length) { return bus.write(address, data, length); },
+                .read_register =
+                    [&bus](uint8_t address, uint8_t reg, uint8_t *data, size_t length) {
+                      return bus.read_register(address, reg, data, length);
+                    },
+            },
+            "SimulatedDevice") {}
+
+  uint8_t read(uint8_t reg, std::error_code &ec) { return this->read_u8_from_register(reg, ec); }
+
+  void set_bits(uint8_t reg, uint8_t mask, std::error_code &ec) {
+    this->set_bits_in_register(reg, mask, ec);
+  }
+
+  // read-modify-write which must be atomic with respect to other devices
+  void increment(uint8_t reg, std::error_code &ec) {
+    std::lock_guard lock(this->base_mutex_);
+    uint8_t value = this->read_u8_from_register(reg, ec);
+    this->write_u8_to_register(reg, value + 1, ec);
+  }
+};
+
+int main() {
+  espp::Logger logger({.tag = "BasePeripheral Lock Test", .level = espp::Logger::Verbosity::INFO});
+
+  logger.info("Starting BasePeripheral lock test");
+
+  static constexpr size_t num_iterations = 5'000'000;
+  auto benchmark = [&](std::string_view name, auto &device) {
+    std::error_code ec;
+    size_t checksum = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < num_iterations; i++) {
+      checksum += device.read(i, ec);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    float read_s = std::chrono::duration<float>(end - start).count();
+    start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < num_iterations; i++) {
+      device.set_bits(i, 1 << (i % 8), ec);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    float set_bits_s = std::chrono::duration<float>(end - start).count();
+    logger.info("{}: read_u8_from_register {:5.1f} M/s, set_bits_in_register {:5.1f} M/s "
+                "(checksum {})",
+                name, num_iterations / read_s / 1e6f, num_iterations / set_bits_s / 1e6f,
+                checksum);
+  };
+
+  SimulatedBus bus;
+  SimulatedDevice<espp::peripheral_lock::Mutex> mutex_device(bus);
+  SimulatedDevice<espp::peripheral_lock::None> unlocked_device(bus);
+  SimulatedDevice<espp::peripheral_lock::Bus> bus_locked_device(bus);
+  bus_locked_device.set_bus_mutex(bus.mutex);
+  benchmark("peripheral_lock::Mutex", mutex_device);
+  benchmark("peripheral_lock::None ", unlocked_device);
+  benchmark("peripheral_lock::Bus  ", bus_locked_device);
+  // drivers which select the lock in their Config at runtime
+  SimulatedDevice<espp::peripheral_lock::Configurable> configurable_device(bus);
+  benchmark("Configurable (MUTEX)  ", configurable_device);
+  configurable_device.set_lock_mode(espp::peripheral_lock::Mode::NONE);
+  benchmark("Configurable (NONE)   ", configurable_device);
+  configurable_device.set_lock_mode(espp::peripheral_lock::Mode::BUS, &bus.mutex);
+  benchmark("Configurable (BUS)    ", configurable_device);
+
+  // two devices sharing the bus lock must not interleave their
+  // read-modify-write cycles
+  static constexpr uint8_t counter_register = 0x42;
+  static constexpr int num_increments = 100'000;
+  bus.registers[counter_register] = 0;
+  // a configurable device in bus mode shares the same lock
+  auto &other_device = configurable_device;
+  size_t total = 0;
+  auto count = [&](auto &device) {
+    std::error_code ec;
+    for (int i = 0; i < num_increments; i++) {
+      device.increment(counter_register, ec);
+    }
+  };
+  std::thread t1([&]() { count(bus_locked_device); });
+  std::thread t2([&]() { count(other_device); });
+  t1.join();
+  t2.join();
+  // the register is 8 bits, so compare modulo 256
+  total = bus.registers[counter_register];
+  if (total != (2 * num_increments) % 256) {
+    logger.error("Shared bus read-modify-write was not atomic: got {}, expected {}", total,
+                 (2 * num_increments) % 256);
+    return 1;
+  }
+  logger.info("Shared bus read-modify-write is atomic");
+
+  logger.info("BasePeripheral lock test complete");
+
+  return 0;
+}
@@ -0,0 +1,332 @@
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "compressed_socket.hpp"
+#include "compression.hpp"
+#include "ftp_server.hpp"
+#include "logger.hpp"
+
+using namespace std::chrono_literals;
+
+// binary telemetry records, like a sensor task would log / stream
+std::vector<uint8_t> make_telemetry_corpus(size_t size) {
+  struct __attribute__((packed)) Record {
+    uint32_t timestamp_ms;
+    int16_t accel[3];
+    float temperature;
+    uint16_t battery_mv;
+    uint8_t status;
+  };
+  std::mt19937 gen(1);
+  std::normal_distribution<float> noise(0.0f, 1.0f);
+  std::vector<uint8_t> corpus;
+  Record record{.timestamp_ms = 0, .accel = {0, 0, 1000}, .temperature = 25.0f,
+                .battery_mv = 4100, .status = 1};
+  while (corpus.size() < size) {
+    record.timestamp_ms += 10;
+    for (int i = 0; i < 3; i++) {
+      record.accel[i] = int16_t((i == 2 ? 1000 : 0) + noise(gen) * 4);
+    }
+    record.temperature = 25.0f + std::round(noise(gen)) * 0.0625f;
+    record.battery_mv = 4100 - record.timestamp_ms / 10000;
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&record);
+    corpus.insert(corpus.end(), bytes, bytes + sizeof(record));
+  }
+  corpus.resize(size);
+  return corpus;
+}
+
+// text logs, like espp::Logger output
+std::vector<uint8_t> make_log_corpus(size_t size) {
+  std::mt19937 gen(2);
+  std::uniform_int_distribution<int> dist(0, 9999);
+  static constexpr std::array<std::string_view, 4> tags = {"Motor", "Battery", "Wifi", "Ads7138"};
+  std::string corpus;
+  float time = 0;
+  while (corpus.size() < size) {
+    time += dist(gen) / 10000.0f;
+    int value = dist(gen);
+    switch (value % 4) {
+    case 0:
+      corpus += fmt::format("[{}/I][{:.3f}]: speed = {} rpm, current = {:.2f} A\n", tags[0], time,
+                            value, value / 5000.0f);
+      break;
+    case 1:
+      corpus += fmt::format("[{}/I][{:.3f}]: voltage = {} mV, soc = {}%\n", tags[1], time,
+                            3000 + value / 10, value / 100);
+      break;
+    case 2:
+      corpus += fmt::format("[{}/W][{:.3f}]: rssi = -{} dBm, retrying connection\n", tags[2],
+                            time, value / 100);
+      break;
+    default:
+      corpus += fmt::format("[{}/D][{:.3f}]: ch0 = {} mV, ch1 = {} mV, ch2 = {} mV\n", tags[3],
+                            time, value % 3300, (value * 7) % 3300, (value * 13) % 3300);
+      break;
+    }
+  }
+  corpus.resize(size);
+  return std::vector<uint8_t>(corpus.begin(), corpus.end());
+}
+
+std::vector<uint8_t> make_random_corpus(size_t size) {
+  std::mt19937 gen(3);
+  std::vector<uint8_t> corpus(size);
+  for (auto &byte : corpus) {
+    byte = uint8_t(gen());
+  }
+  return corpus;
+}
+
+bool benchmark(espp::Logger &logger, std::string_view name, const std::vector<uint8_t> &corpus,
+               size_t block_size, bool independent_blocks) {
+  static constexpr size_t num_iterations = 10;
+  std::vector<uint8_t> compressed;
+  compressed.reserve(corpus.size() + corpus.size() / 100 + 64);
+  size_t compressed_size = 0;
+  espp::LzCompressor compressor({
+      .block_size = block_size,
+      .independent_blocks = independent_blocks,
+      .write =
+          [&compressed_size](std::span<const uint8_t> data) {
+            compressed_size += data.size();
+            return true;
+          },
+  });
+  auto start = std::chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < num_iterations; i++) {
+    compressor.write(corpus);
+    compressor.finish();
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  float compress_s = std::chrono::duration<float>(end - start).count() / num_iterations;
+
+  espp::lz_compress(corpus, compressed, block_size);
+  if (!independent_blocks) {
+    compressed.clear();
+    espp::LzCompressor linked({.block_size = block_size,
+                               .independent_blocks = false,
+                               .write = espp::make_container_writer(compressed)});
+    linked.write(corpus);
+    linked.finish();
+  }
+  size_t decompressed_size = 0;
+  espp::LzDecompressor decompressor({.write = [&decompressed_size](std::span<const uint8_t> data) {
+    decompressed_size += data.size();
+    return true;
+  }});
+  std::error_code ec;
+  start = std::chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < num_iterations; i++) {
+    decompressor.feed(compressed, ec);
+  }
+  end = std::chrono::high_resolution_clock::now();
+  float decompress_s = std::chrono::duration<float>(end - start).count() / num_iterations;
+
+  std::vector<uint8_t> roundtrip;
+  if (!espp::lz_decompress(compressed, roundtrip, ec) || roundtrip != corpus) {
+    logger.error("{}: round trip failed: {}", name, ec.message());
+    return false;
+  }
+  float mb = corpus.size() / 1e6f;
+  logger.info("{:9} {:5} KiB {:11}: ratio {:5.2f}, compress {:6.1f} MB/s, decompress {:7.1f} "
+              "MB/s",
+              name, block_size / 1024, independent_blocks ? "independent" : "linked",
+              float(corpus.size()) / (compressed_size / num_iterations), mb / compress_s,
+              mb / decompress_s);
+  return true;
+}
+
+bool test_streaming(espp::Logger &logger) {
+  auto corpus = make_log_corpus(100'000);
+  std::vector<uint8_t> compressed;
+  espp::LzCompressor compressor({.block_size = 1024,
+                                 .independent_blocks = false,
+                                 .write = espp::make_container_writer(compressed)});
+  // write in odd-sized chunks and flush in the middle of a block
+  for (size_t offset = 0; offset < corpus.size(); offset += 777) {
+    size_t count = std::min<size_t>(777, corpus.size() - offset);
+    compressor.write(std::span(corpus).subspan(offset, count));
+    if (offset % 7 == 0) {
+      compressor.flush();
+    }
+  }
+  compressor.finish();
+  // two concatenated frames, the second one empty
+  compressor.finish();
+
+  // feed byte by byte
+  std::vector<uint8_t> output;
+  espp::LzDecompressor decompressor(
+      {.max_block_size = 1024, .write = espp::make_container_writer(output)});
+  std::error_code ec;
+  for (size_t i = 0; i < compressed.size(); i++) {
+    if (!decompressor.feed(std::span(compressed).subspan(i, 1), ec)) {
+      logger.error("byte-wise decompression failed at {}: {}", i, ec.message());
+      return false;
+    }
+  }
+  if (output != corpus || !decompressor.is_complete()) {
+    logger.error("byte-wise decompression mismatch");
+    return false;
+  }
+
+  // truncated frames are incomplete, too large blocks are rejected
+  output.clear();
+  if (espp::lz_decompress(std::span(compressed).first(compressed.size() / 2), output, ec)) {
+    logger.error("truncated frame was not detected");
+    return false;
+  }
+  espp::LzDecompressor small({.max_block_size = 256});
+  std::vector<uint8_t> large_blocks;
+  espp::lz_compress(corpus, large_blocks, 64 * 1024);
+  if (small.feed(large_blocks, ec) || ec != std::errc::not_supported) {
+    logger.error("too large block size was not rejected");
+    return false;
+  }
+
+  // corrupted data must be detected or at least decode safely
+  std::mt19937 gen(4);
+  size_t num_detected = 0;
+  static constexpr size_t num_corruptions = 2000;
+  for (size_t i = 0; i < num_corruptions; i++) {
+    auto corrupted = compressed;
+    corrupted[gen() % corrupted.size()] ^= uint8_t(1 + gen() % 255);
+    output.clear();
+    if (!espp::lz_decompress(corrupted, output, ec) || output != corpus) {
+      num_detected++;
+    }
+  }
+  logger.info("streaming round trip ok, {} / {} corruptions changed the output", num_detected,
+              num_corruptions);
+  return true;
+}
+
+// minimal FTP client, to transfer a file in MODE L
+class FtpTestClient {
+public:
+  explicit FtpTestClient(int port) {
+    control_.set_receive_timeout(2s);
+    control_.connect({.ip_address = "127.0.0.1", .port = (size_t)port});
+    response();
+  }
+
+  std::string command(std::string_view command) {
+    control_.transmit(fmt::format("{}\r\n", command));
+    return response();
+  }
+
+  std::string response() {
+    std::vector<uint8_t> data;
+    control_.receive(data, 1024);
+    return std::string(data.begin(), data.end());
+  }
+
+  std::unique_ptr<espp::TcpSocket> open_data_connection() {
+    auto pasv = command("PASV");
+    int h1, h2, h3, h4, p1, p2;
+    if (sscanf(pasv.c_str(), "227 Entering Passive Mode (%d,%d,%d,%d,%d,%d)", &h1, &h2, &h3, &h4,
+               &p1, &p2) != 6) {
+      return nullptr;
+    }
+    auto data = std::make_unique<espp::TcpSocket>(espp::TcpSocket::Config{});
+    data->set_receive_timeout(2s);
+    if (!data->connect({.ip_address = "127.0.0.1", .port = size_t(p1 * 256 + p2)})) {
+      return nullptr;
+    }
+    return data;
+  }
+
+protected:
+  espp::TcpSocket control_{{}};
+};
+
+bool test_ftp(espp::Logger &logger) {
+  static constexpr int port = 18121;
+  auto root = std::filesystem::temp_directory_path() / "espp_compression_test";
+  std::filesystem::create_directories(root);
+  auto corpus = make_log_corpus(200'000);
+  {
+    std::ofstream file(root / "log.txt", std::ios::binary);
+    file.write((const char *)corpus.data(), corpus.size());
+  }
+  espp::FtpServer server("127.0.0.1", port, root);
+  server.start();
+  std::this_thread::sleep_for(50ms);
+  FtpTestClient client(port);
+  client.command("USER anonymous");
+  client.command("PASS anonymous");
+  if (!client.command("MODE L").starts_with("200") ||
+      !client.command("MODE Z").starts_with("504")) {
+    logger.error("MODE L not accepted");
+    return false;
+  }
+
+  // download
+  auto data = client.open_data_connection();
+  if (!data) {
+    logger.error("Could not open data connection");
+    return false;
+  }
+  client.command("RETR log.txt");
+  std::vector<uint8_t> downloaded;
+  espp::LzDecompressor decompressor({.write = espp::make_container_writer(downloaded)});
+  std::vector<uint8_t> buffer(4096);
+  std::error_code ec;
+  bool ok = espp::receive_decompressed(*data, decompressor, buffer, ec);
+  data.reset();
+  client.response();
+  ok = ok && downloaded == corpus;
+
+  // upload
+  data = client.open_data_connection();
+  client.command("STOR upload.txt");
+  espp::LzCompressor compressor({.block_size = 4096, .write = espp::make_socket_writer(*data)});
+  ok = ok && compressor.write(corpus) && compressor.finish();
+  data.reset();
+  client.response();
+  std::this_thread::sleep_for(50ms);
+  std::ifstream file(root / "upload.txt", std::ios::binary);
+  std::vector<uint8_t> uploaded((std::istreambuf_iterator<char>(file)),
+                                std::istreambuf_iterator<char>());
+  ok = ok && uploaded == corpus;
+  client.command("QUIT");
+  server.stop();
+  std::filesystem::remove_all(root);
+  logger.info("FTP MODE L: {} byte file, {} compressed bytes transferred, {}", corpus.size(),
+              compressor.get_bytes_out(), ok ? "ok" : "FAILED");
+  return ok;
+}
+
+int main() {
+  espp::Logger logger({.tag = "Compression Test", .level = espp::Logger::Verbosity::INFO});
+
+  logger.info("Starting compression test");
+
+  static constexpr size_t corpus_size = 1 << 20;
+  std::array corpora = {
+      std::pair{"telemetry", make_telemetry_corpus(corpus_size)},
+      std::pair{"logs", make_log_corpus(corpus_size)},
+      std::pair{"random", make_random_corpus(corpus_size)},
+  };
+  for (const auto &[name, corpus] : corpora) {
+    if (!benchmark(logger, name, corpus, 4 * 1024, true) ||
+        !benchmark(logger, name, corpus, 4 * 1024, false) ||
+        !benchmark(logger, name, corpus, 64 * 1024, true)) {
+      return 1;
+    }
+  }
+
+  if (!test_streaming(logger) || !test_ftp(logger)) {
+    return 1;
+  }
+
+  logger.info("Compression test complete");
+
+  return 0;
+}
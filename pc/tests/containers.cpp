@@ -0,0 +1,163 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+
+#include "alloc_counter.hpp"
+#include "ads7138.hpp"
+#include "flat_map.hpp"
+#include "flat_set.hpp"
+#include "logger.hpp"
+#include "small_vector.hpp"
+#include "static_vector.hpp"
+
+using namespace std::chrono_literals;
+
+// Register-level model of an ADS7138 which only answers block reads (e.g. of
+// the RECENT_CHx registers) with a fixed pattern.
+struct SimulatedAds7138 {
+  uint8_t registers[256]{};
+  uint8_t read_address{0};
+
+  bool write(uint8_t, const uint8_t *data, size_t length) {
+    // opcode, register address, [data...]
+    if (length >= 2) {
+      read_address = data[1];
+    }
+    return true;
+  }
+
+  bool read(uint8_t, uint8_t *data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+      data[i] = registers[(read_address + i) % 256];
+    }
+    return true;
+  }
+};
+
+int main() {
+  espp::Logger logger({.tag = "Containers Test", .level = espp::Logger::Verbosity::INFO});
+
+  logger.info("Starting containers test");
+
+  // basic behavior of the containers
+  {
+    espp::StaticVector<int, 4> sv{1, 2, 3};
+    sv.insert(sv.begin(), 0);
+    bool ok = sv.size() == 4 && sv.full() && sv.front() == 0 && sv.back() == 3;
+    ok = ok && !sv.try_push_back(4);
+    sv.erase(sv.begin() + 1);
+    ok = ok && sv == espp::StaticVector<int, 4>{0, 2, 3};
+    std::span<const int> view = sv;
+    ok = ok && view.size() == 3 && view[1] == 2;
+    if (!ok) {
+      logger.error("StaticVector failed");
+      return 1;
+    }
+  }
+  {
+    num_allocations = 0;
+    espp::SmallVector<std::string, 2> v;
+    v.push_back("a");
+    v.push_back("b");
+    bool ok = v.is_inline() && num_allocations == 0;
+    v.push_back(v[0]); // grows (and allocates) while referring to itself
+    ok = ok && !v.is_inline() && v.size() == 3 && v[2] == "a";
+    auto moved = std::move(v);
+    ok = ok && v.empty() && v.is_inline() && moved.size() == 3 && moved[1] == "b";
+    if (!ok) {
+      logger.error("SmallVector failed");
+      return 1;
+    }
+  }
+  {
+    espp::FlatMap<int, std::unique_ptr<int>, 3> map;
+    map.try_emplace(3, std::make_unique<int>(30));
+    map.try_emplace(1, std::make_unique<int>(10));
+    map[2] = std::make_unique<int>(20);
+    bool ok = map.full() && map.try_emplace(4).first == map.end();
+    int expected_key = 1;
+    for (const auto &[key, value] : map) {
+      ok = ok && key == expected_key && *value == key * 10;
+      expected_key++;
+    }
+    ok = ok && map.erase(2) == 1 && !map.contains(2) && map.size() == 2;
+    espp::FlatSet<int, 4> set{3, 1, 3, 2};
+    ok = ok && set.size() == 3 && *set.begin() == 1 && set.contains(3) && !set.contains(4);
+    if (!ok) {
+      logger.error("FlatMap / FlatSet failed");
+      return 1;
+    }
+  }
+  logger.info("Container checks passed");
+
+  // steady-state driver loop: read all analog inputs of an ADS7138 over and
+  // over, using the allocating and non-allocating APIs
+  SimulatedAds7138 device;
+  for (int i = 0; i < 256; i++) {
+    device.registers[i] = i;
+  }
+  espp::Ads7138 ads({
+      .analog_inputs = {espp::Ads7138::Channel::CH1, espp::Ads7138::Channel::CH3,
+                        espp::Ads7138::Channel::CH5, espp::Ads7138::Channel::CH7},
+      .write = [&device](uint8_t address, const uint8_t *data,
+                         size_t length) { return device.write(address, data, length); },
+      .read = [&device](uint8_t address, uint8_t *data,
+                        size_t length) { return device.read(address, data, length); },
+      .auto_init = false,
+      .log_level = espp::Logger::Verbosity::WARN,
+  });
+
+  static constexpr size_t num_iterations = 1'000'000;
+  float total_mv = 0;
+  auto benchmark = [&](std::string_view name, auto &&fn) -> size_t {
+    std::error_code ec;
+    num_allocations = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < num_iterations && !ec; i++) {
+      fn(ec);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    size_t allocations = num_allocations;
+    float elapsed_s = std::chrono::duration<float>(end - start).count();
+    if (ec) {
+      logger.error("{}: error: {}", name, ec.message());
+    }
+    logger.info("{}: {:6.1f} ns / call, {:.1f} allocations / call, {:10.0f} allocations / s",
+                name, elapsed_s * 1e9f / num_iterations, (float)allocations / num_iterations,
+                allocations / elapsed_s);
+    return allocations;
+  };
+
+  benchmark("get_all_mv(ec)           ", [&](std::error_code &ec) {
+    auto values = ads.get_all_mv(ec);
+    total_mv += values[0];
+  });
+  auto span_allocations = benchmark("get_all_mv(span, ec)     ", [&](std::error_code &ec) {
+    float buffer[espp::Ads7138::NUM_CHANNELS];
+    auto values = ads.get_all_mv(buffer, ec);
+    total_mv += values[0];
+  });
+  benchmark("get_all_mv_map(ec)       ", [&](std::error_code &ec) {
+    auto values = ads.get_all_mv_map(ec);
+    total_mv += values[espp::Ads7138::Channel::CH1];
+  });
+  auto map_allocations = benchmark("get_all_mv_map(map, ec)  ", [&](std::error_code &ec) {
+    espp::Ads7138::ChannelMap<float> values;
+    ads.get_all_mv_map(values, ec);
+    total_mv += values[espp::Ads7138::Channel::CH1];
+  });
+  logger.info("(total {} mV)", total_mv);
+
+  if (span_allocations != 0 || map_allocations != 0) {
+    logger.error("Non-allocating APIs allocated: span = {}, map = {}", span_allocations,
+                 map_allocations);
+    return 1;
+  }
+
+  logger.info("Containers test complete");
+
+  return 0;
+}
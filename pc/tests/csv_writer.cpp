@@ -0,0 +1,236 @@
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if __has_include("csv2/writer.hpp")
+#include "csv.hpp"
+#define HAS_CSV2 1
+#endif
+#include "csv_writer.hpp"
+#include "logger.hpp"
+
+using namespace std::chrono_literals;
+
+struct Sample {
+  uint32_t timestamp_ms;
+  float ax, ay, az;
+  float temperature;
+  int32_t position;
+  uint16_t adc;
+  bool enabled;
+};
+
+std::vector<Sample> make_samples(size_t num_samples) {
+  std::mt19937 gen(1);
+  std::normal_distribution<float> noise(0.0f, 1.0f);
+  std::vector<Sample> samples(num_samples);
+  for (size_t i = 0; i < num_samples; i++) {
+    samples[i] = {uint32_t(i * 10),    noise(gen),          noise(gen),
+                  9.81f + noise(gen),  25.0f + noise(gen),  int32_t(i * 37 - 100000),
+                  uint16_t(gen() % 4096), i % 2 == 0};
+  }
+  return samples;
+}
+
+// the csv2 path: format every value to a std::string, then write the row
+// through an std::ostream
+template <class Writer> void write_csv2(Writer &writer, const std::vector<Sample> &samples) {
+  std::vector<std::string> row(8);
+  for (const auto &s : samples) {
+    row[0] = std::to_string(s.timestamp_ms);
+    row[1] = std::to_string(s.ax);
+    row[2] = std::to_string(s.ay);
+    row[3] = std::to_string(s.az);
+    row[4] = std::to_string(s.temperature);
+    row[5] = std::to_string(s.position);
+    row[6] = std::to_string(s.adc);
+    row[7] = s.enabled ? "true" : "false";
+    writer.write_row(row);
+  }
+}
+
+#ifndef HAS_CSV2
+// same as csv2::Writer<csv2::delimiter<','>>::write_row
+struct OstreamRowWriter {
+  std::ostream &stream;
+  void write_row(const std::vector<std::string> &row) {
+    for (size_t i = 0; i + 1 < row.size(); i++) {
+      stream << row[i] << ",";
+    }
+    stream << row.back() << "\n";
+  }
+};
+#endif
+
+int main() {
+  espp::Logger logger({.tag = "CSV Writer Test", .level = espp::Logger::Verbosity::INFO});
+
+  logger.info("Starting CSV writer test");
+
+  // formatting and quoting
+  {
+    std::string output;
+    {
+      espp::CsvWriter writer({.write = [&output](std::string_view data) {
+        output += data;
+        return true;
+      }});
+      writer.write_row("plain", "a,b", "say \"hi\"", "two\nlines", 'c', true, -42, uint8_t(7));
+      writer.write_row(0.1f, -2.5, 1e30f, 1.0 / 3.0);
+      writer.write_field(1);
+      writer.write_field(std::string("x"));
+      writer.end_row();
+    }
+    std::string expected = "plain,\"a,b\",\"say \"\"hi\"\"\",\"two\nlines\",c,true,-42,7\n"
+                           "0.1,-2.5,1e+30,0.3333333333333333\n"
+                           "1,x\n";
+    if (output != expected) {
+      logger.error("Unexpected output:\n{}", output);
+      return 1;
+    }
+
+    output.clear();
+    {
+      espp::TypedCsvWriter<uint32_t, float, std::string_view> writer(
+          {"time", "value", "name"}, {.write = [&output](std::string_view data) {
+                                        output += data;
+                                        return true;
+                                      },
+                                      .delimiter = ';',
+                                      .float_precision = 3});
+      writer.write_row(10, 1.23456f, "a;b");
+      writer.write_row(20, -1e25f, "c,d");
+    }
+    expected = "time;value;name\n10;1.235;\"a;b\"\n20;-9999999562023526247432192.000;c,d\n";
+    if (output != expected) {
+      logger.error("Unexpected typed output:\n{}", output);
+      return 1;
+    }
+    logger.info("Formatting and quoting correct");
+  }
+
+  // floating point values round trip exactly, across many buffer boundaries
+  {
+    std::mt19937 gen(2);
+    std::vector<double> values(100'000);
+    for (auto &value : values) {
+      value = std::ldexp(double(gen()) / gen.max() - 0.5, int(gen() % 200) - 100);
+    }
+    std::string output;
+    espp::CsvWriter writer({.write =
+                                [&output](std::string_view data) {
+                                  output += data;
+                                  return true;
+                                },
+                            .buffer_size = 256});
+    for (size_t i = 0; i < values.size(); i += 4) {
+      writer.write_row(values[i], values[i + 1], values[i + 2], values[i + 3]);
+    }
+    writer.flush();
+    const char *p = output.data();
+    const char *end = output.data() + output.size();
+    for (auto value : values) {
+      double parsed;
+      auto result = std::from_chars(p, end, parsed);
+      if (result.ec != std::errc() || parsed != value) {
+        logger.error("Value {} did not round trip", value);
+        return 1;
+      }
+      p = result.ptr + 1;
+    }
+    logger.info("{} doubles round trip exactly", values.size());
+  }
+
+  // background flush produces the same output, with a slow write callback
+  {
+    auto samples = make_samples(20'000);
+    auto write_all = [&](bool background, bool slow) {
+      std::string output;
+      espp::CsvWriter writer({.write =
+                                  [&output, slow](std::string_view data) {
+                                    if (slow) {
+                                      std::this_thread::sleep_for(1ms);
+                                    }
+                                    output += data;
+                                    return true;
+                                  },
+                              .buffer_size = 4096,
+                              .background_flush = background});
+      for (const auto &s : samples) {
+        writer.write_row(s.timestamp_ms, s.ax, s.ay, s.az, s.temperature, s.position, s.adc,
+                         s.enabled);
+      }
+      writer.flush();
+      return output;
+    };
+    auto expected = write_all(false, false);
+    if (write_all(true, true) != expected || write_all(true, false) != expected) {
+      logger.error("Background flush output differs");
+      return 1;
+    }
+    logger.info("Background flush output matches");
+
+    // a failing write callback is reported
+    espp::CsvWriter failing({.write = [](std::string_view) { return false; },
+                             .buffer_size = 128,
+                             .background_flush = true,
+                             .log_level = espp::Logger::Verbosity::NONE});
+    bool ok = true;
+    for (int i = 0; i < 100 && ok; i++) {
+      ok = failing.write_row(i, "some text to fill the buffer");
+    }
+    if (ok || failing.flush()) {
+      logger.error("Write failure not reported");
+      return 1;
+    }
+  }
+
+  // throughput
+  {
+    static constexpr size_t num_rows = 200'000;
+    auto samples = make_samples(num_rows);
+    std::ostringstream stream;
+    auto start = std::chrono::high_resolution_clock::now();
+#ifdef HAS_CSV2
+    csv2::Writer<csv2::delimiter<','>, std::ostringstream> csv2_writer(stream);
+    write_csv2(csv2_writer, samples);
+    std::string_view baseline_name = "csv2::Writer";
+#else
+    OstreamRowWriter ostream_writer{stream};
+    write_csv2(ostream_writer, samples);
+    std::string_view baseline_name = "std::to_string + std::ostream (csv2 path)";
+#endif
+    auto end = std::chrono::high_resolution_clock::now();
+    float baseline_s = std::chrono::duration<float>(end - start).count();
+
+    size_t bytes = 0;
+    start = std::chrono::high_resolution_clock::now();
+    {
+      espp::CsvWriter writer({.write = [&bytes](std::string_view data) {
+        bytes += data.size();
+        return true;
+      }});
+      for (const auto &s : samples) {
+        writer.write_row(s.timestamp_ms, s.ax, s.ay, s.az, s.temperature, s.position, s.adc,
+                         s.enabled);
+      }
+    }
+    end = std::chrono::high_resolution_clock::now();
+    float typed_s = std::chrono::duration<float>(end - start).count();
+
+    logger.info("{}: {:.2f} M rows / s ({} bytes)", baseline_name, num_rows / baseline_s / 1e6f,
+                stream.str().size());
+    logger.info("espp::CsvWriter: {:.2f} M rows / s ({} bytes, shortest round-trip floats), "
+                "{:.1f}x",
+                num_rows / typed_s / 1e6f, bytes, baseline_s / typed_s);
+  }
+
+  logger.info("CSV writer test complete");
+
+  return 0;
+}
@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "event_manager.hpp"
+
+using namespace std::chrono_literals;
+
+static constexpr size_t num_subscribers = 8;
+static constexpr uint32_t num_messages = 1000;
+static constexpr auto publish_period = 500us;
+static constexpr auto slow_callback_time = 2ms;
+static constexpr size_t ring_size = 256;
+
+// what a subscriber received
+struct Received {
+  std::atomic<uint32_t> count{0};
+  std::atomic<uint32_t> last{0};
+  std::atomic<bool> in_order{true};
+  std::atomic<int64_t> max_latency_us{0};
+};
+
+int64_t now_us() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+struct Result {
+  float fast_done_s;      // time until the fast subscribers got all messages
+  float slow_done_s;      // time until the slow subscriber was done
+  int64_t max_latency_us; // of the fast subscribers
+};
+
+// publish numbered, timestamped messages on the topic, with subscriber 0
+// being slow, and wait until all the subscribers are done
+Result run(espp::Logger &logger, const std::string &topic, bool use_rings) {
+  auto &em = espp::EventManager::get();
+  std::vector<Received> received(num_subscribers);
+  for (size_t i = 0; i < num_subscribers; i++) {
+    auto callback = [&, i](const std::vector<uint8_t> &data) {
+      uint32_t sequence;
+      int64_t timestamp;
+      std::memcpy(&sequence, data.data(), sizeof(sequence));
+      std::memcpy(&timestamp, data.data() + sizeof(sequence), sizeof(timestamp));
+      auto &r = received[i];
+      if (r.count > 0 && sequence <= r.last) {
+        r.in_order = false;
+      }
+      r.last = sequence;
+      r.count++;
+      int64_t latency_us = now_us() - timestamp;
+      if (latency_us > r.max_latency_us) {
+        r.max_latency_us = latency_us;
+      }
+      if (i == 0) {
+        std::this_thread::sleep_for(slow_callback_time);
+      }
+    };
+    auto component = fmt::format("subscriber {}", i);
+    if (use_rings) {
+      em.add_subscriber(topic, component, callback, {.ring_size = ring_size});
+    } else {
+      em.add_subscriber(topic, component, callback);
+    }
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<uint8_t> data(64);
+  for (uint32_t i = 0; i < num_messages; i++) {
+    std::this_thread::sleep_until(start + i * publish_period);
+    int64_t timestamp = now_us();
+    std::memcpy(data.data(), &i, sizeof(i));
+    std::memcpy(data.data() + sizeof(i), &timestamp, sizeof(timestamp));
+    em.publish(topic, data);
+  }
+
+  auto last_received = [&](size_t i) {
+    return received[i].count > 0 && received[i].last == num_messages - 1;
+  };
+  Result result{};
+  auto deadline = start + 30s;
+  while (std::chrono::steady_clock::now() < deadline) {
+    bool fast_done = true;
+    for (size_t i = 1; i < num_subscribers; i++) {
+      fast_done = fast_done && last_received(i);
+    }
+    auto elapsed = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+    if (fast_done && result.fast_done_s == 0) {
+      result.fast_done_s = elapsed;
+    }
+    if (last_received(0)) {
+      result.slow_done_s = elapsed;
+      if (fast_done) {
+        break;
+      }
+    }
+    std::this_thread::sleep_for(1ms);
+  }
+
+  for (size_t i = 1; i < num_subscribers; i++) {
+    result.max_latency_us = std::max<int64_t>(result.max_latency_us, received[i].max_latency_us);
+  }
+  bool ok = result.fast_done_s > 0 && result.slow_done_s > 0;
+  for (size_t i = 0; i < num_subscribers; i++) {
+    ok = ok && received[i].in_order;
+    // the fast subscribers must get every message
+    ok = ok && (i == 0 || received[i].count == num_messages);
+  }
+  if (use_rings) {
+    auto slow_stats = em.get_subscriber_stats(topic, "subscriber 0");
+    auto fast_stats = em.get_subscriber_stats(topic, "subscriber 1");
+    if (!slow_stats || !fast_stats) {
+      logger.error("Missing subscriber stats");
+      ok = false;
+    } else {
+      logger.info("Slow subscriber: {}", *slow_stats);
+      logger.info("Fast subscriber: {}", *fast_stats);
+      // the slow subscriber falls behind and skips messages, the others don't
+      ok = ok && slow_stats->num_delivered == received[0].count;
+      ok = ok && slow_stats->num_delivered + slow_stats->num_overflowed == num_messages;
+      ok = ok && slow_stats->num_overflowed > 0 && slow_stats->max_lag == ring_size;
+      ok = ok && fast_stats->num_overflowed == 0 && fast_stats->lag == 0;
+    }
+  } else {
+    ok = ok && received[0].count == num_messages;
+  }
+  for (size_t i = 0; i < num_subscribers; i++) {
+    em.remove_subscriber(topic, fmt::format("subscriber {}", i));
+  }
+  if (!ok) {
+    logger.error("{}: unexpected delivery", topic);
+    for (size_t i = 0; i < num_subscribers; i++) {
+      logger.error("  subscriber {}: {} messages, last {}, in order: {}", i,
+                   received[i].count.load(), received[i].last.load(),
+                   received[i].in_order.load());
+    }
+    result.fast_done_s = -1;
+  }
+  return result;
+}
+
+int main() {
+  espp::Logger logger({.tag = "Event Manager Test", .level = espp::Logger::Verbosity::INFO});
+
+  logger.info("Starting event manager test");
+  espp::EventManager::get().set_log_level(espp::Logger::Verbosity::WARN);
+
+  // benchmark: 8 subscribers, one of which takes 2 ms per message, with a
+  // message every 0.5 ms
+  float publish_time = std::chrono::duration<float>(publish_period * num_messages).count();
+  auto shared = run(logger, "shared", false);
+  auto rings = run(logger, "rings", true);
+  if (shared.fast_done_s < 0 || rings.fast_done_s < 0) {
+    return 1;
+  }
+  logger.info("{} messages published over {:.2f} s, to {} subscribers (1 slow)", num_messages,
+              publish_time, num_subscribers);
+  logger.info("Shared task: fast subscribers done after {:.2f} s ({:.0f} msg/s), max latency "
+              "{:.1f} ms, slow subscriber done after {:.2f} s",
+              shared.fast_done_s, num_messages / shared.fast_done_s,
+              shared.max_latency_us / 1e3f, shared.slow_done_s);
+  logger.info("Rings:       fast subscribers done after {:.2f} s ({:.0f} msg/s), max latency "
+              "{:.1f} ms, slow subscriber done after {:.2f} s",
+              rings.fast_done_s, num_messages / rings.fast_done_s, rings.max_latency_us / 1e3f,
+              rings.slow_done_s);
+  // with rings, the fast subscribers keep up with the publisher
+  if (rings.fast_done_s > publish_time * 1.5f || rings.fast_done_s >= shared.fast_done_s) {
+    logger.error("The slow subscriber should not delay the others");
+    return 1;
+  }
+
+  // a subscriber of each kind on the same topic, and removing them
+  {
+    auto &em = espp::EventManager::get();
+    std::atomic<int> num_shared{0};
+    std::atomic<int> num_ring{0};
+    em.add_subscriber("mixed", "shared", [&](const auto &) { num_shared++; });
+    em.add_subscriber("mixed", "ring", [&](const auto &) { num_ring++; }, {.ring_size = 4});
+    if (em.add_subscriber("mixed", "ring", [&](const auto &) {},
+                          espp::EventManager::SubscriberConfig{}) ||
+        em.get_subscriber_stats("mixed", "shared")) {
+      logger.error("Duplicate subscriber added, or stats for a shared subscriber");
+      return 1;
+    }
+    em.publish("mixed", {1, 2, 3});
+    auto deadline = std::chrono::steady_clock::now() + 1s;
+    while ((num_shared == 0 || num_ring == 0) && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(1ms);
+    }
+    // the shared subscriber still gets messages without the ring subscriber
+    bool removed = em.remove_subscriber("mixed", "ring");
+    bool published = em.publish("mixed", {4});
+    while (num_shared < 2 && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(1ms);
+    }
+    removed = removed && em.remove_subscriber("mixed", "shared");
+    if (num_shared != 2 || num_ring != 1 || !removed || !published ||
+        em.publish("mixed", {5})) {
+      logger.error("Mixed subscribers: got {} / {} messages", num_shared.load(), num_ring.load());
+      return 1;
+    }
+  }
+
+  logger.info("Event manager test complete");
+
+  return 0;
+}
@@ -0,0 +1,215 @@
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "async_file.hpp"
+#include "file_io.hpp"
+#include "logger.hpp"
+
+using namespace std::chrono_literals;
+
+static constexpr size_t block_size = 4096;
+
+// stands in for the other half of a transfer (e.g. a socket send), which
+// blocks the task while the file I/O can proceed
+void process_block([[maybe_unused]] std::span<const uint8_t> block,
+                   std::chrono::microseconds duration) {
+  std::this_thread::sleep_for(duration);
+}
+
+// like the flash on an ESP, without the kernel's read-ahead and write cache:
+// open for reading without read-ahead, after dropping the file from the page
+// cache, or for writing through to the disk
+int open_uncached(const std::filesystem::path &path, bool write) {
+  if (write) {
+    return open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DSYNC, 0644);
+  }
+  int fd = open(path.c_str(), O_RDONLY);
+  fdatasync(fd);
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  posix_fadvise(fd, 0, 0, POSIX_FADV_RANDOM);
+  return fd;
+}
+
+float seconds_since(std::chrono::high_resolution_clock::time_point start) {
+  return std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+std::string_view backend_name(espp::FileIoService::Backend backend) {
+  return backend == espp::FileIoService::Backend::WORKER ? "WORKER   " : "POSIX_AIO";
+}
+
+int main() {
+  espp::Logger logger({.tag = "File IO Test", .level = espp::Logger::Verbosity::INFO});
+
+  logger.info("Starting file I/O test");
+
+  auto directory = std::filesystem::temp_directory_path() / "espp_file_io_test";
+  std::filesystem::create_directories(directory);
+  auto path = directory / "data.bin";
+
+  std::vector<uint8_t> data(8 * 1024 * 1024 + 123);
+  std::mt19937 gen(1);
+  for (auto &byte : data) {
+    byte = uint8_t(gen());
+  }
+
+  for (auto backend :
+       {espp::FileIoService::Backend::WORKER, espp::FileIoService::Backend::POSIX_AIO}) {
+    espp::FileIoService service({.backend = backend});
+    std::error_code ec;
+
+    // write-behind then read-ahead round trip, in odd sized pieces
+    {
+      espp::AsyncFileWriter writer(service, {.block_size = block_size, .num_blocks = 4});
+      if (!writer.open(path, ec)) {
+        logger.error("Failed to open {}: {}", path.string(), ec.message());
+        return 1;
+      }
+      for (size_t offset = 0; offset < data.size();) {
+        size_t n = std::min<size_t>(gen() % 10000, data.size() - offset);
+        if (!writer.write(std::span(data).subspan(offset, n), ec)) {
+          logger.error("Write failed: {}", ec.message());
+          return 1;
+        }
+        offset += n;
+      }
+      auto sync_result = writer.sync().get();
+      if (sync_result.ec || !writer.close(ec) || std::filesystem::file_size(path) != data.size()) {
+        logger.error("Sync / close failed");
+        return 1;
+      }
+    }
+    {
+      espp::AsyncFileReader reader(service, {.block_size = block_size, .num_blocks = 4});
+      if (!reader.open(path, 0, ec)) {
+        logger.error("Failed to open {}: {}", path.string(), ec.message());
+        return 1;
+      }
+      std::vector<uint8_t> read_back;
+      while (true) {
+        auto block = reader.read_next(ec);
+        if (block.empty()) {
+          break;
+        }
+        read_back.insert(read_back.end(), block.begin(), block.end());
+      }
+      if (ec || read_back != data) {
+        logger.error("Read back {} of {} bytes, data differs", read_back.size(), data.size());
+        return 1;
+      }
+    }
+
+    // a reused writer starts the new file without the previous file's blocks
+    {
+      auto reuse_path = directory / "reuse.bin";
+      espp::AsyncFileWriter writer(service, {.block_size = 4, .num_blocks = 2});
+      auto as_bytes = [](std::string_view s) {
+        return std::span(reinterpret_cast<const uint8_t *>(s.data()), s.size());
+      };
+      bool ok = writer.open(reuse_path, ec) && writer.write(as_bytes("AAAA"), ec) &&
+                writer.close(ec) && writer.open(reuse_path, ec) &&
+                writer.write(as_bytes("xy"), ec) && writer.get_size() == 2 && writer.close(ec);
+      std::vector<uint8_t> contents(16);
+      int fd = open(reuse_path.c_str(), O_RDONLY);
+      ssize_t n = ::read(fd, contents.data(), contents.size());
+      close(fd);
+      if (!ok || n != 2 || contents[0] != 'x' || contents[1] != 'y') {
+        logger.error("Reused writer wrote {} bytes, expected \"xy\"", n);
+        return 1;
+      }
+    }
+
+    // callbacks, errors and many concurrent requests
+    {
+      int fd = open(path.c_str(), O_RDONLY);
+      std::atomic<size_t> total{0};
+      std::atomic<int> num_done{0};
+      std::vector<std::vector<uint8_t>> buffers(64, std::vector<uint8_t>(1000));
+      for (size_t i = 0; i < buffers.size(); i++) {
+        service.read(fd, i * 1000, buffers[i], [&](const espp::FileIoResult &result) {
+          total += result.bytes;
+          num_done++;
+        });
+      }
+      auto bad = service.read(-1, 0, buffers[0]).get();
+      close(fd);
+      bool ok = num_done == 64 && total == 64'000 && bad.ec == std::errc::bad_file_descriptor;
+      for (size_t i = 0; ok && i < buffers.size(); i++) {
+        ok = std::equal(buffers[i].begin(), buffers[i].end(), data.begin() + i * 1000);
+      }
+      if (!ok) {
+        logger.error("Concurrent reads failed");
+        return 1;
+      }
+    }
+
+    // throughput: overlapped vs synchronous, with the task blocked for 50 us
+    // (+ timer slack) per 4 KiB block, e.g. in a socket send
+    static constexpr auto work = 50us;
+    static constexpr float mib = 1024.0f * 1024.0f;
+    float sync_read_s, async_read_s, sync_write_s, async_write_s;
+    {
+      std::vector<uint8_t> buffer(block_size);
+      int fd = open_uncached(path, false);
+      auto start = std::chrono::high_resolution_clock::now();
+      ssize_t n;
+      while ((n = read(fd, buffer.data(), buffer.size())) > 0) {
+        process_block(std::span(buffer).first(n), work);
+      }
+      close(fd);
+      sync_read_s = seconds_since(start);
+
+      espp::AsyncFileReader reader(service, {.block_size = block_size, .num_blocks = 4});
+      fd = open_uncached(path, false);
+      start = std::chrono::high_resolution_clock::now();
+      reader.open(fd, 0);
+      for (auto block = reader.read_next(ec); !block.empty(); block = reader.read_next(ec)) {
+        process_block(block, work);
+      }
+      reader.close();
+      async_read_s = seconds_since(start);
+    }
+    {
+      auto start = std::chrono::high_resolution_clock::now();
+      int fd = open_uncached(path, true);
+      for (size_t offset = 0; offset < data.size(); offset += block_size) {
+        auto block = std::span(data).subspan(offset, std::min(block_size, data.size() - offset));
+        process_block(block, work);
+        (void)!::write(fd, block.data(), block.size());
+      }
+      fsync(fd);
+      close(fd);
+      sync_write_s = seconds_since(start);
+
+      start = std::chrono::high_resolution_clock::now();
+      espp::AsyncFileWriter writer(service, {.block_size = block_size, .num_blocks = 4});
+      writer.open(open_uncached(path, true));
+      for (size_t offset = 0; offset < data.size(); offset += block_size) {
+        auto block = std::span(data).subspan(offset, std::min(block_size, data.size() - offset));
+        process_block(block, work);
+        writer.write(block, ec);
+      }
+      writer.sync().get();
+      writer.close(ec);
+      async_write_s = seconds_since(start);
+    }
+    float size_mib = data.size() / mib;
+    logger.info("{}: read {:6.1f} MiB/s sync, {:6.1f} MiB/s read-ahead | write {:6.1f} MiB/s "
+                "sync, {:6.1f} MiB/s write-behind",
+                backend_name(service.get_backend()), size_mib / sync_read_s,
+                size_mib / async_read_s, size_mib / sync_write_s, size_mib / async_write_s);
+  }
+
+  std::filesystem::remove_all(directory);
+
+  logger.info("File I/O test complete");
+
+  return 0;
+}
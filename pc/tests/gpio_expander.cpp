@@ -0,0 +1,547 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "kts1622.hpp"
+#include "logger.hpp"
+#include "mcp23x17.hpp"
+
+using namespace std::chrono_literals;
+using Clock = std::chrono::steady_clock;
+
+// I2C bus traffic of a simulated device
+struct BusStats {
+  size_t num_transactions{0};
+  size_t num_bytes{0}; // including the address bytes
+
+  // time the bytes take on a 400 kHz bus (9 clocks per byte)
+  float bus_time_s() const { return num_bytes * 9 / 400'000.0f; }
+};
+
+// Active low INT line: the handler runs in its own thread for each falling
+// edge, like an espp::Interrupt callback
+class InterruptLine {
+public:
+  ~InterruptLine() { stop(); }
+
+  void start(std::function<void()> handler) {
+    handler_ = handler;
+    thread_ = std::thread([this] { run(); });
+  }
+
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      done_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+  void set_active(bool active) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (active && !active_) {
+        num_edges_++;
+      }
+      active_ = active;
+    }
+    cv_.notify_all();
+  }
+
+protected:
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      cv_.wait(lock, [this] { return done_ || num_edges_ > 0; });
+      if (done_) {
+        return;
+      }
+      num_edges_--;
+      lock.unlock();
+      handler_();
+      lock.lock();
+    }
+  }
+
+  std::function<void()> handler_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool active_{false};
+  size_t num_edges_{0};
+  bool done_{false};
+  std::thread thread_;
+};
+
+// Model of the MCP23017 registers (BANK = 0, sequential operation) used for
+// reading inputs and interrupt on change from the previous value: INTF and
+// INTCAP capture the first change of a port, and are cleared by reading its
+// INTCAP or GPIO register. The INT pins are mirrored.
+class SimulatedMcp23017 {
+public:
+  explicit SimulatedMcp23017(InterruptLine &line)
+      : line_(line) {}
+
+  bool write(uint8_t, const uint8_t *data, size_t length) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    count(length + 1);
+    for (size_t i = 1; i < length; i++) {
+      registers_[(data[0] + i - 1) % NUM_REGISTERS] = data[i];
+    }
+    return true;
+  }
+
+  bool read_register(uint8_t, uint8_t reg, uint8_t *data, size_t length) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    count(length + 3);
+    for (size_t i = 0; i < length; i++) {
+      uint8_t r = (reg + i) % NUM_REGISTERS;
+      if (r == GPIOA || r == GPIOB) {
+        data[i] = inputs_ >> (8 * (r - GPIOA));
+      } else {
+        data[i] = registers_[r];
+      }
+      if (r == INTCAPA || r == INTCAPB || r == GPIOA || r == GPIOB) {
+        registers_[INTFA + (r % 2)] = 0;
+      }
+    }
+    update_int();
+    return true;
+  }
+
+  void set_inputs(uint16_t inputs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint16_t changed = inputs ^ inputs_;
+    inputs_ = inputs;
+    for (int port = 0; port < 2; port++) {
+      uint8_t port_changed = (changed >> (8 * port)) & registers_[GPINTENA + port];
+      if (port_changed && registers_[INTFA + port] == 0) {
+        registers_[INTFA + port] = port_changed;
+        registers_[INTCAPA + port] = inputs >> (8 * port);
+      }
+    }
+    update_int();
+  }
+
+  uint8_t get_register(uint8_t reg) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return registers_[reg];
+  }
+
+  BusStats get_bus_stats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+  }
+
+protected:
+  static constexpr size_t NUM_REGISTERS = 0x16;
+  static constexpr uint8_t GPINTENA = 0x04;
+  static constexpr uint8_t INTFA = 0x0E;
+  static constexpr uint8_t INTCAPA = 0x10;
+  static constexpr uint8_t INTCAPB = 0x11;
+  static constexpr uint8_t GPIOA = 0x12;
+  static constexpr uint8_t GPIOB = 0x13;
+
+  void count(size_t num_bytes) {
+    stats_.num_transactions++;
+    stats_.num_bytes += num_bytes;
+  }
+
+  void update_int() { line_.set_active(registers_[INTFA] || registers_[INTFA + 1]); }
+
+  InterruptLine &line_;
+  std::mutex mutex_;
+  uint8_t registers_[NUM_REGISTERS]{0xFF, 0xFF};
+  uint16_t inputs_{0xFFFF};
+  BusStats stats_;
+};
+
+// Model of the KTS1622 input, input latch, and interrupt registers: a change
+// of an unmasked input interrupts, and a latched input holds the state which
+// caused the interrupt until its port is read. Reading a port clears its
+// interrupt, which is raised again if the inputs no longer match what was
+// read.
+class SimulatedKts1622 {
+public:
+  explicit SimulatedKts1622(InterruptLine &line)
+      : line_(line) {}
+
+  bool write(uint8_t, const uint8_t *data, size_t length) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    count(length + 1);
+    for (size_t i = 1; i < length; i++) {
+      uint8_t r = data[0] + i - 1;
+      if (r == INPUT_LATCH0 || r == INPUT_LATCH1) {
+        latch_[r - INPUT_LATCH0] = data[i];
+      } else if (r == INT_MASK0 || r == INT_MASK1) {
+        mask_[r - INT_MASK0] = data[i];
+      } else if (r >= INT_EDGE0A && r <= INT_EDGE1B) {
+        edge_[r - INT_EDGE0A] = data[i];
+      }
+    }
+    return true;
+  }
+
+  bool write_then_read(uint8_t, const uint8_t *write_data, size_t write_length, uint8_t *data,
+                       size_t length) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    count(write_length + length + 2);
+    for (size_t i = 0; i < length; i++) {
+      uint8_t r = write_data[0] + i;
+      if (r != INPORT0 && r != INPORT1) {
+        data[i] = get_config_register(r);
+        continue;
+      }
+      int port = r - INPORT0;
+      uint8_t inputs = inputs_ >> (8 * port);
+      data[i] = pending_[port] ? (captured_[port] & latch_[port]) | (inputs & ~latch_[port])
+                               : inputs;
+      last_read_[port] = data[i];
+      pending_[port] = false;
+      // the inputs changed since they were captured
+      check(port, inputs);
+    }
+    update_int();
+    return true;
+  }
+
+  void set_inputs(uint16_t inputs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    inputs_ = inputs;
+    for (int port = 0; port < 2; port++) {
+      check(port, inputs >> (8 * port));
+    }
+    update_int();
+  }
+
+  uint8_t get_register(uint8_t reg) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return get_config_register(reg);
+  }
+
+  BusStats get_bus_stats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+  }
+
+protected:
+  static constexpr uint8_t INPORT0 = 0x00;
+  static constexpr uint8_t INPORT1 = 0x01;
+  static constexpr uint8_t INPUT_LATCH0 = 0x44;
+  static constexpr uint8_t INPUT_LATCH1 = 0x45;
+  static constexpr uint8_t INT_MASK0 = 0x4A;
+  static constexpr uint8_t INT_MASK1 = 0x4B;
+  static constexpr uint8_t INT_EDGE0A = 0x50;
+  static constexpr uint8_t INT_EDGE1B = 0x53;
+
+  // the modelled latch, mask, and edge registers (others read as 0)
+  uint8_t get_config_register(uint8_t r) const {
+    if (r == INPUT_LATCH0 || r == INPUT_LATCH1) {
+      return latch_[r - INPUT_LATCH0];
+    }
+    if (r == INT_MASK0 || r == INT_MASK1) {
+      return mask_[r - INT_MASK0];
+    }
+    if (r >= INT_EDGE0A && r <= INT_EDGE1B) {
+      return edge_[r - INT_EDGE0A];
+    }
+    return 0;
+  }
+
+  void count(size_t num_bytes) {
+    stats_.num_transactions++;
+    stats_.num_bytes += num_bytes;
+  }
+
+  void check(int port, uint8_t inputs) {
+    if (!pending_[port] && ((inputs ^ last_read_[port]) & ~mask_[port])) {
+      pending_[port] = true;
+      captured_[port] = inputs;
+    }
+  }
+
+  void update_int() { line_.set_active(pending_[0] || pending_[1]); }
+
+  InterruptLine &line_;
+  std::mutex mutex_;
+  uint16_t inputs_{0xFFFF};
+  uint8_t latch_[2]{0, 0};
+  uint8_t mask_[2]{0xFF, 0xFF};
+  uint8_t edge_[4]{0, 0, 0, 0};
+  uint8_t last_read_[2]{0xFF, 0xFF};
+  uint8_t captured_[2]{0xFF, 0xFF};
+  bool pending_[2]{false, false};
+  BusStats stats_;
+};
+
+// press and release a button (active low) a number of times, with the contact
+// bouncing for a millisecond or two on each edge
+static constexpr uint16_t button = 1 << 9;
+static constexpr int num_presses = 5;
+static constexpr int num_bounces = 5;
+// changes of the inputs while pressing the buttons
+static constexpr int num_input_changes = 2 * num_presses * (2 * num_bounces + 1);
+
+void press_buttons(const std::function<void(uint16_t)> &set_inputs) {
+  uint16_t inputs = 0xFFFF;
+  for (int i = 0; i < 2 * num_presses; i++) {
+    for (int bounce = 0; bounce < num_bounces; bounce++) {
+      set_inputs(inputs ^ button);
+      std::this_thread::sleep_for(200us);
+      set_inputs(inputs);
+      std::this_thread::sleep_for(100us);
+    }
+    inputs ^= button;
+    set_inputs(inputs);
+    std::this_thread::sleep_for(200ms);
+  }
+}
+
+struct Result {
+  BusStats bus;
+  float elapsed_s;
+
+  float transactions_per_second() const { return bus.num_transactions / elapsed_s; }
+  float utilization_percent() const { return 100.0f * bus.bus_time_s() / elapsed_s; }
+};
+
+// poll the pins at 1 kHz while the buttons are pressed
+template <typename Expander, typename Simulator>
+Result poll(Expander &expander, Simulator &sim, uint16_t &num_changes) {
+  std::atomic<bool> done{false};
+  auto start_stats = sim.get_bus_stats();
+  auto start = Clock::now();
+  std::thread buttons([&] {
+    press_buttons([&](uint16_t inputs) { sim.set_inputs(inputs); });
+    done = true;
+  });
+  std::error_code ec;
+  uint16_t previous = 0xFFFF;
+  num_changes = 0;
+  auto next = start;
+  while (!done) {
+    uint16_t pins = expander.get_pins(ec);
+    num_changes += pins != previous;
+    previous = pins;
+    next += 1ms;
+    std::this_thread::sleep_until(next);
+  }
+  buttons.join();
+  auto stats = sim.get_bus_stats();
+  return {{stats.num_transactions - start_stats.num_transactions,
+           stats.num_bytes - start_stats.num_bytes},
+          std::chrono::duration<float>(Clock::now() - start).count()};
+}
+
+// detect the changes with the INT pin while the buttons are pressed
+template <typename Expander, typename Simulator>
+bool detect_changes(espp::Logger &logger, Expander &expander, Simulator &sim, Result &result) {
+  std::mutex events_mutex;
+  std::vector<espp::PinChangeDetector::Event> events;
+  std::error_code ec;
+  expander.enable_change_detection(
+      {.mask = button,
+       .callback =
+           [&](const auto &event) {
+             std::lock_guard<std::mutex> lock(events_mutex);
+             events.push_back(event);
+           }},
+      ec);
+  if (ec) {
+    logger.error("enable_change_detection failed: {}", ec.message());
+    return false;
+  }
+  auto start_stats = sim.get_bus_stats();
+  auto start = Clock::now();
+  press_buttons([&](uint16_t inputs) { sim.set_inputs(inputs); });
+  auto stats = sim.get_bus_stats();
+  result = {{stats.num_transactions - start_stats.num_transactions,
+             stats.num_bytes - start_stats.num_bytes},
+            std::chrono::duration<float>(Clock::now() - start).count()};
+
+  // get_pins() is served from the last read
+  uint16_t pins = expander.get_pins(ec);
+  if (ec || pins != 0xFFFF || sim.get_bus_stats().num_transactions != stats.num_transactions) {
+    logger.error("get_pins() returned {:#06x} and accessed the bus", pins);
+    return false;
+  }
+
+  expander.disable_change_detection(ec);
+  // a debounced press and release for each press, without the bounces
+  std::lock_guard<std::mutex> lock(events_mutex);
+  bool ok = events.size() == 2 * num_presses;
+  for (size_t i = 0; ok && i < events.size(); i++) {
+    bool pressed = i % 2 == 0;
+    ok = events[i].changed == button && (events[i].pins == (pressed ? 0xFFFF ^ button : 0xFFFF));
+  }
+  if (!ok) {
+    logger.error("Got {} events, expected {}:", events.size(), 2 * num_presses);
+    for (const auto &event : events) {
+      logger.error("  pins {:#06x}, changed {:#06x}", event.pins, event.changed);
+    }
+    return false;
+  }
+  return true;
+}
+
+// enable and disable change detection while the inputs change, so that
+// handle_interrupt() runs concurrently with them
+template <typename Expander, typename Simulator>
+bool toggle_change_detection(espp::Logger &logger, Expander &expander, Simulator &sim) {
+  std::atomic<bool> done{false};
+  std::thread inputs([&] {
+    uint16_t pins = 0xFFFF;
+    while (!done) {
+      pins ^= button;
+      sim.set_inputs(pins);
+      std::this_thread::sleep_for(100us);
+    }
+    sim.set_inputs(0xFFFF);
+  });
+  std::error_code ec;
+  for (int i = 0; i < 100 && !ec; i++) {
+    expander.enable_change_detection({.mask = button}, ec);
+    if (!ec) {
+      expander.get_pins(ec);
+    }
+    if (!ec) {
+      expander.disable_change_detection(ec);
+    }
+  }
+  done = true;
+  inputs.join();
+  if (ec) {
+    logger.error("Toggling change detection failed: {}", ec.message());
+    return false;
+  }
+  return true;
+}
+
+int main() {
+  espp::Logger logger({.tag = "GPIO Expander Test", .level = espp::Logger::Verbosity::INFO});
+
+  logger.info("Starting GPIO expander change detection test");
+
+  auto report = [&](std::string_view name, const Result &result) {
+    logger.info("  {:<28} {:7.1f} transactions/s, {:6.3f}% bus utilization", name,
+                result.transactions_per_second(), result.utilization_percent());
+  };
+
+  // the interrupt line is stopped before the expander is destroyed, so its
+  // handler never outlives the expander
+  InterruptLine mcp_line;
+  SimulatedMcp23017 mcp_sim(mcp_line);
+  espp::Mcp23x17 mcp23x17({
+      .port_0_direction_mask = 0xFF,
+      .port_1_direction_mask = 0xFF,
+      .write = [&](uint8_t addr, const uint8_t *data,
+                   size_t len) { return mcp_sim.write(addr, data, len); },
+      .read_register = [&](uint8_t addr, uint8_t reg, uint8_t *data,
+                           size_t len) { return mcp_sim.read_register(addr, reg, data, len); },
+  });
+  mcp_line.start([&] {
+    std::error_code ec;
+    mcp23x17.handle_interrupt(ec);
+  });
+
+  InterruptLine kts_line;
+  SimulatedKts1622 kts_sim(kts_line);
+  espp::Kts1622 kts1622({
+      .write = [&](uint8_t addr, const uint8_t *data,
+                   size_t len) { return kts_sim.write(addr, data, len); },
+      .write_then_read =
+          [&](uint8_t addr, const uint8_t *write_data, size_t write_length, uint8_t *data,
+              size_t length) {
+            return kts_sim.write_then_read(addr, write_data, write_length, data, length);
+          },
+  });
+  kts_line.start([&] {
+    std::error_code ec;
+    kts1622.handle_interrupt(ec);
+  });
+
+  // handle_interrupt() needs change detection
+  std::error_code ec;
+  mcp23x17.handle_interrupt(ec);
+  if (ec != std::errc::operation_not_permitted) {
+    logger.error("handle_interrupt() should fail without change detection");
+    return 1;
+  }
+
+  uint16_t num_changes = 0;
+  Result mcp_polled = poll(mcp23x17, mcp_sim, num_changes);
+  Result mcp_detected{};
+  if (num_changes < 2 * num_presses || !detect_changes(logger, mcp23x17, mcp_sim, mcp_detected)) {
+    logger.error("Mcp23x17 change detection failed");
+    return 1;
+  }
+  Result kts_polled = poll(kts1622, kts_sim, num_changes);
+  Result kts_detected{};
+  if (num_changes < 2 * num_presses || !detect_changes(logger, kts1622, kts_sim, kts_detected)) {
+    logger.error("Kts1622 change detection failed");
+    return 1;
+  }
+  if (!toggle_change_detection(logger, mcp23x17, mcp_sim) ||
+      !toggle_change_detection(logger, kts1622, kts_sim)) {
+    return 1;
+  }
+  mcp_line.stop();
+  kts_line.stop();
+
+  // disabling change detection restores the interrupt configuration
+  mcp23x17.set_interrupt_on_change(espp::Mcp23x17::Port::PORT1, 0xA5, ec);
+  mcp23x17.enable_change_detection({.mask = button}, ec);
+  mcp23x17.disable_change_detection(ec);
+  // GPINTENA, GPINTENB, IOCON
+  if (ec || mcp_sim.get_register(0x04) != 0x00 || mcp_sim.get_register(0x05) != 0xA5 ||
+      mcp_sim.get_register(0x0A) != 0x00) {
+    logger.error("Mcp23x17 interrupt config not restored: GPINTEN {:#04x} {:#04x}, IOCON {:#04x}",
+                 mcp_sim.get_register(0x04), mcp_sim.get_register(0x05),
+                 mcp_sim.get_register(0x0A));
+    return 1;
+  }
+  kts1622.set_input_latch(espp::Kts1622::Port::PORT1, 0x0F, ec);
+  kts1622.enable_interrupt(espp::Kts1622::Port::PORT1, 0x5A, ec);
+  // pins 0 and 4, so both INT_EDGE1A and INT_EDGE1B are 0x01
+  kts1622.configure_interrupt(espp::Kts1622::Port::PORT1, 0x11, espp::Kts1622::InterruptType::RISING,
+                              ec);
+  kts1622.enable_change_detection({.mask = button}, ec);
+  kts1622.disable_change_detection(ec);
+  // INPUT_LATCH0/1, INT_MASK0/1, INT_EDGE1A/1B
+  if (ec || kts_sim.get_register(0x44) != 0x00 || kts_sim.get_register(0x45) != 0x0F ||
+      kts_sim.get_register(0x4A) != 0xFF || kts_sim.get_register(0x4B) != 0x5A ||
+      kts_sim.get_register(0x52) != 0x01 || kts_sim.get_register(0x53) != 0x01) {
+    logger.error("Kts1622 interrupt config not restored: INPUT_LATCH {:#04x} {:#04x}, INT_MASK "
+                 "{:#04x} {:#04x}, INT_EDGE1A {:#04x}, INT_EDGE1B {:#04x}",
+                 kts_sim.get_register(0x44), kts_sim.get_register(0x45),
+                 kts_sim.get_register(0x4A), kts_sim.get_register(0x4B),
+                 kts_sim.get_register(0x52), kts_sim.get_register(0x53));
+    return 1;
+  }
+
+  logger.info("{} bouncy button presses, 400 kHz I2C:", num_presses);
+  report("Mcp23x17 polled at 1 kHz", mcp_polled);
+  report("Mcp23x17 change detection", mcp_detected);
+  report("Kts1622 polled at 1 kHz", kts_polled);
+  report("Kts1622 change detection", kts_detected);
+
+  // each change of the inputs costs at most one burst read, instead of
+  // polling all the time
+  if (mcp_detected.bus.num_transactions > num_input_changes ||
+      kts_detected.bus.num_transactions > num_input_changes ||
+      mcp_detected.utilization_percent() > mcp_polled.utilization_percent() / 10 ||
+      kts_detected.utilization_percent() > kts_polled.utilization_percent() / 10) {
+    logger.error("Change detection should use a fraction of the bus traffic of polling");
+    return 1;
+  }
+
+  logger.info("GPIO expander change detection test complete");
+
+  return 0;
+}
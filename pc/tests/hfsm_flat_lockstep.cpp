@@ -0,0 +1,125 @@
+#include <array>
+#include <random>
+#include <utility>
+
+#include "logger.hpp"
+
+// pc/CMakeLists.txt builds each test from a single file, so the class based
+// backend of the Complex example is compiled into this test
+#include "../../components/state_machine/example/main/Complex_generated_flat_states.hpp"
+#include "../../components/state_machine/example/main/Complex_generated_states.cpp"
+
+using namespace espp::state_machine;
+
+// Runs the class based (Complex) and the flat table (ComplexFlat) backends of
+// the Complex example HFSM in lockstep on random events, with random guard
+// values, and checks that they agree on every step. This keeps the hand
+// maintained tables of Complex_generated_flat_states.hpp from drifting away
+// from Complex_generated_states.cpp.
+
+static constexpr size_t num_events = 20000;
+
+// the active leaf of the class based HFSM, as a state of the flat HFSM
+ComplexFlat::State get_active_leaf(Complex::Root &root) {
+  if (root.has_stopped()) {
+    return ComplexFlat::State::END_STATE;
+  }
+  const std::array<std::pair<StateBase *, ComplexFlat::State>, 11> leaves = {{
+      {&root.COMPLEX_OBJ__STATE_1_OBJ, ComplexFlat::State::STATE_1},
+      {&root.COMPLEX_OBJ__STATE_2_OBJ, ComplexFlat::State::STATE_2},
+      {&root.COMPLEX_OBJ__STATE_2_OBJ__CHILDSTATE_OBJ, ComplexFlat::State::STATE_2__CHILDSTATE},
+      {&root.COMPLEX_OBJ__STATE_2_OBJ__CHILDSTATE2_OBJ, ComplexFlat::State::STATE_2__CHILDSTATE2},
+      {&root.COMPLEX_OBJ__STATE_2_OBJ__CHILDSTATE3_OBJ, ComplexFlat::State::STATE_2__CHILDSTATE3},
+      {&root.COMPLEX_OBJ__STATE_2_OBJ__CHILDSTATE3_OBJ__GRAND_OBJ,
+       ComplexFlat::State::STATE_2__CHILDSTATE3__GRAND},
+      {&root.COMPLEX_OBJ__STATE_2_OBJ__CHILDSTATE3_OBJ__GRAND2_OBJ,
+       ComplexFlat::State::STATE_2__CHILDSTATE3__GRAND2},
+      {&root.COMPLEX_OBJ__STATE3_OBJ, ComplexFlat::State::STATE3},
+      {&root.COMPLEX_OBJ__STATE3_OBJ__CHILDSTATE_OBJ, ComplexFlat::State::STATE3__CHILDSTATE},
+      {&root.COMPLEX_OBJ__STATE3_OBJ__CHILDSTATE2_OBJ, ComplexFlat::State::STATE3__CHILDSTATE2},
+      {&root.COMPLEX_OBJ__STATE3_OBJ__CHILDSTATE3_OBJ, ComplexFlat::State::STATE3__CHILDSTATE3},
+  }};
+  auto leaf = root.getActiveLeaf();
+  for (const auto &[state, flat_state] : leaves) {
+    if (state == leaf) {
+      return flat_state;
+    }
+  }
+  return ComplexFlat::State::ROOT;
+}
+
+int main() {
+  espp::Logger logger({.tag = "HFSM Lockstep Test", .level = espp::Logger::Verbosity::INFO});
+
+  logger.info("Starting flat / class HFSM lockstep test");
+
+  Complex::Root complex_root;
+  ComplexFlat::Root flat_root;
+  complex_root.initialize();
+  flat_root.initialize();
+
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<int> event_dist(0, 4);
+  std::uniform_int_distribution<int> number_dist(30, 70);
+  std::bernoulli_distribution coin(0.5);
+  // ENDEVENT only ends the HFSM from a few states, but make it rarer so that
+  // the runs between restarts are long
+  std::bernoulli_distribution end_dist(0.1);
+
+  size_t num_handled = 0;
+  size_t num_restarts = 0;
+  for (size_t i = 0; i < num_events; i++) {
+    // randomize the guards, identically for both HFSMs
+    bool guards[7];
+    for (auto &guard : guards) {
+      guard = coin(gen);
+    }
+    int some_number = number_dist(gen);
+    complex_root.goToEnd = flat_root.goToEnd = guards[0];
+    complex_root.goToChoice = flat_root.goToChoice = guards[1];
+    complex_root.goToHistory = flat_root.goToHistory = guards[2];
+    complex_root.nextState = flat_root.nextState = guards[3];
+    complex_root.killedState = flat_root.killedState = guards[4];
+    complex_root.someGuard = flat_root.someGuard = guards[5];
+    complex_root.someTest = flat_root.someTest = guards[6];
+    complex_root.someNumber = flat_root.someNumber = some_number;
+
+    int event_index = event_dist(gen);
+    if (event_index == 0 && !end_dist(gen)) {
+      event_index = 1 + event_dist(gen) % 4;
+    }
+    auto type = static_cast<Complex::EventType>(event_index);
+    Complex::GeneratedEventBase event(type);
+    bool complex_handled = complex_root.handleEvent(&event);
+    bool flat_handled = flat_root.handle_event(static_cast<ComplexFlat::EventType>(event_index));
+    num_handled += complex_handled;
+
+    auto complex_leaf = get_active_leaf(complex_root);
+    auto flat_leaf = flat_root.get_active_leaf();
+    if (complex_handled != flat_handled || complex_leaf != flat_leaf ||
+        complex_root.has_stopped() != flat_root.has_stopped() ||
+        complex_root.someNumber != flat_root.someNumber ||
+        complex_root.someValue != flat_root.someValue) {
+      logger.error("Event {} ({}): class HFSM handled {} -> state {}, flat HFSM handled {} -> "
+                   "state {}",
+                   i, event.to_string(), complex_handled, (int)complex_leaf, flat_handled,
+                   (int)flat_leaf);
+      return 1;
+    }
+
+    if (complex_root.has_stopped()) {
+      complex_root.restart();
+      flat_root.restart();
+      num_restarts++;
+    } else if (i % 16 == 0) {
+      complex_root.tick();
+      flat_root.tick();
+    }
+  }
+
+  logger.info("{} events ({} handled, {} restarts): both backends agree", num_events, num_handled,
+              num_restarts);
+  logger.info("Flat / class HFSM lockstep test complete");
+
+  return 0;
+}
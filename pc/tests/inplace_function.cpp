@@ -0,0 +1,112 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <new>
+
+#include "alloc_counter.hpp"
+#include "base_peripheral.hpp"
+#include "inplace_function.hpp"
+#include "logger.hpp"
+
+using namespace std::chrono_literals;
+
+// Register-level model of an I2C device with 256 8-bit registers
+struct SimulatedBus {
+  uint8_t registers[256]{};
+  size_t num_transactions{0};
+
+  bool read_register(uint8_t address, uint8_t reg, uint8_t *data, size_t length) {
+    num_transactions++;
+    for (size_t i = 0; i < length; i++) {
+      data[i] = registers[(reg + i) % 256] ^ address;
+    }
+    return true;
+  }
+};
+
+// Minimal peripheral which exposes BasePeripheral::read_u8_from_register
+class SimulatedDevice : public espp::BasePeripheral<> {
+public:
+  explicit SimulatedDevice(const Config &config)
+      : BasePeripheral(config, "SimulatedDevice") {}
+
+  uint8_t read(uint8_t reg, std::error_code &ec) { return read_u8_from_register(reg, ec); }
+};
+
+int main() {
+  espp::Logger logger({.tag = "InplaceFunction Test", .level = espp::Logger::Verbosity::INFO});
+
+  logger.info("Starting InplaceFunction test");
+
+  SimulatedBus bus;
+  for (int i = 0; i < 256; i++) {
+    bus.registers[i] = i;
+  }
+  // a typical bus callback: binds a member function and captures a little
+  // state, which is larger than std::function's small buffer
+  uint8_t xor_mask = 0x5a;
+  size_t bytes_read = 0;
+  auto read_register = [&bus, &xor_mask, &bytes_read](uint8_t address, uint8_t reg,
+                                                      uint8_t *data, size_t length) {
+    bytes_read += length;
+    return bus.read_register(address ^ xor_mask, reg, data, length);
+  };
+
+  static constexpr size_t num_iterations = 10'000'000;
+  auto benchmark = [&](std::string_view name, auto &&fn) {
+    num_allocations = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t checksum = 0;
+    for (size_t i = 0; i < num_iterations; i++) {
+      checksum += fn(i);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    float elapsed_ns = std::chrono::duration<float, std::nano>(end - start).count();
+    logger.info("{}: {:5.1f} ns / op, {} allocations (checksum {})", name,
+                elapsed_ns / num_iterations, num_allocations.load(), checksum);
+  };
+
+  // construction / copy, e.g. when configs are passed around
+  using std_fn = std::function<bool(uint8_t, uint8_t, uint8_t *, size_t)>;
+  using inplace_fn = espp::InplaceFunction<bool(uint8_t, uint8_t, uint8_t *, size_t)>;
+  benchmark("std::function construct + copy  ", [&](size_t) {
+    std_fn fn = read_register;
+    std_fn copy = fn;
+    return (size_t)(bool)copy;
+  });
+  benchmark("InplaceFunction construct + copy", [&](size_t) {
+    inplace_fn fn = read_register;
+    inplace_fn copy = fn;
+    return (size_t)(bool)copy;
+  });
+
+  // call overhead
+  std_fn std_read_register = read_register;
+  inplace_fn inplace_read_register = read_register;
+  uint8_t data;
+  benchmark("std::function call              ", [&](size_t i) {
+    std_read_register(0x10, i, &data, 1);
+    return data;
+  });
+  benchmark("InplaceFunction call            ", [&](size_t i) {
+    inplace_read_register(0x10, i, &data, 1);
+    return data;
+  });
+
+  // full BasePeripheral::read_u8_from_register path (mutex + callback)
+  SimulatedDevice device({.address = 0x10, .read_register = read_register});
+  benchmark("BasePeripheral::read_register   ", [&](size_t i) {
+    std::error_code ec;
+    return device.read(i, ec);
+  });
+
+  if (bytes_read != 3 * num_iterations) {
+    logger.error("Unexpected number of bytes read: {}", bytes_read);
+    return 1;
+  }
+
+  logger.info("InplaceFunction test complete");
+
+  return 0;
+}
@@ -0,0 +1,309 @@
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "input_event_queue.hpp"
+#include "logger.hpp"
+#include "qwiicnes.hpp"
+#include "t_keyboard.hpp"
+
+using namespace std::chrono_literals;
+using Clock = std::chrono::steady_clock;
+
+// Model of the T-Keyboard firmware: it holds the last key pressed, which is
+// cleared by reading it.
+class SimulatedTKeyboard {
+public:
+  bool read(uint8_t, uint8_t *data, size_t length) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    num_transactions_++;
+    for (size_t i = 0; i < length; i++) {
+      data[i] = key_;
+      key_ = 0;
+    }
+    return true;
+  }
+
+  void press(uint8_t key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    key_ = key;
+  }
+
+  size_t get_num_transactions() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return num_transactions_;
+  }
+
+protected:
+  std::mutex mutex_;
+  uint8_t key_{0};
+  size_t num_transactions_{0};
+};
+
+// Model of the Qwiic NES registers: the current state of the buttons,
+// followed by the accumulator of the buttons pressed since it was last read.
+class SimulatedQwiicNes {
+public:
+  bool write(uint8_t, const uint8_t *, size_t) { return true; }
+
+  bool read_register(uint8_t, uint8_t reg, uint8_t *data, size_t length) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    num_transactions_++;
+    for (size_t i = 0; i < length; i++) {
+      if (reg + i == 0) {
+        data[i] = current_;
+      } else if (reg + i == 1) {
+        data[i] = accumulator_;
+        accumulator_ = 0;
+      } else {
+        data[i] = 0;
+      }
+    }
+    return true;
+  }
+
+  void set_button(int button, bool pressed) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint8_t bit = 1 << button;
+    if (pressed) {
+      current_ |= bit;
+      accumulator_ |= bit;
+    } else {
+      current_ &= ~bit;
+    }
+  }
+
+  size_t get_num_transactions() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return num_transactions_;
+  }
+
+protected:
+  std::mutex mutex_;
+  uint8_t current_{0};
+  uint8_t accumulator_{0};
+  size_t num_transactions_{0};
+};
+
+// an input of the simulated user
+struct Step {
+  std::chrono::milliseconds time;
+  uint16_t code;
+  bool pressed;
+};
+
+// checks that the events are the expected presses (and releases) of each code
+// in order, with increasing timestamps
+bool check_events(espp::Logger &logger, const char *name,
+                  const std::vector<espp::InputEvent> &events, const std::vector<Step> &steps,
+                  bool releases) {
+  for (size_t i = 1; i < events.size(); i++) {
+    if (events[i].timestamp < events[i - 1].timestamp) {
+      logger.error("{}: event {} is older than the previous event", name, i);
+      return false;
+    }
+  }
+  // events read in the same poll are in the order of their codes, so compare
+  // the events of each code
+  for (uint16_t code = 0; code < 256; code++) {
+    std::vector<bool> expected;
+    std::vector<bool> actual;
+    for (const auto &step : steps) {
+      if (step.code == code && (releases || step.pressed)) {
+        expected.push_back(step.pressed);
+      }
+    }
+    for (const auto &event : events) {
+      if (event.code == code) {
+        actual.push_back(event.pressed);
+      }
+    }
+    if (expected != actual) {
+      logger.error("{}: {} events for code {}, expected {}", name, actual.size(), code,
+                   expected.size());
+      return false;
+    }
+  }
+  return true;
+}
+
+int main() {
+  espp::Logger logger({.tag = "Input Events Test", .level = espp::Logger::Verbosity::INFO});
+
+  logger.info("Starting input events test");
+
+  // the queue drops events once it is full, and keeps their order
+  {
+    espp::InputEventQueue<4> queue;
+    for (uint16_t i = 0; i < 5; i++) {
+      queue.push({.code = i, .pressed = true, .timestamp = Clock::now()});
+    }
+    espp::InputEvent event;
+    bool ok = queue.size() == 4 && queue.get_num_dropped() == 1;
+    for (uint16_t i = 0; i < 4; i++) {
+      ok = ok && queue.pop(event) && event.code == i;
+    }
+    if (!ok || queue.pop(event) || !queue.empty()) {
+      logger.error("Unexpected queue behavior");
+      return 1;
+    }
+  }
+
+  // two bursts of input separated by a long idle period, as when typing or
+  // playing: a key every 60 ms, and a button pressed every 70 ms, either
+  // tapped (released before the next poll) or held, with several buttons
+  // held at once
+  static constexpr int num_bursts = 2;
+  static constexpr int num_inputs = 10;
+  static constexpr auto burst_period = 4000ms;
+  std::vector<Step> keys;
+  std::vector<Step> buttons;
+  for (int burst = 0; burst < num_bursts; burst++) {
+    auto start = burst * burst_period;
+    for (int i = 0; i < num_inputs; i++) {
+      keys.push_back({start + i * 60ms, uint16_t('a' + i), true});
+      uint16_t button = i % 8;
+      auto hold = i % 2 ? 150ms : 3ms;
+      buttons.push_back({start + i * 70ms, button, true});
+      buttons.push_back({start + i * 70ms + hold, button, false});
+    }
+  }
+  std::sort(buttons.begin(), buttons.end(),
+            [](const auto &a, const auto &b) { return a.time < b.time; });
+
+  SimulatedTKeyboard keyboard_sim;
+  espp::TKeyboard keyboard({
+      .write = [](uint8_t, const uint8_t *, size_t) { return true; },
+      .read = [&](uint8_t addr, uint8_t *data,
+                  size_t len) { return keyboard_sim.read(addr, data, len); },
+      .idle_polling_interval = 30ms,
+      .auto_start = false,
+      .log_level = espp::Logger::Verbosity::WARN,
+  });
+  SimulatedQwiicNes nes_sim;
+  espp::QwiicNes nes({
+      .write = [&](uint8_t addr, const uint8_t *data,
+                   size_t len) { return nes_sim.write(addr, data, len); },
+      .read_register = [&](uint8_t addr, uint8_t reg, uint8_t *data,
+                           size_t len) { return nes_sim.read_register(addr, reg, data, len); },
+      .idle_polling_interval = 50ms,
+      .log_level = espp::Logger::Verbosity::WARN,
+  });
+
+  auto start = Clock::now();
+  keyboard.start();
+  nes.start();
+  std::thread user([&] {
+    size_t k = 0;
+    size_t b = 0;
+    while (k < keys.size() || b < buttons.size()) {
+      bool next_is_key =
+          b == buttons.size() || (k < keys.size() && keys[k].time <= buttons[b].time);
+      const auto &step = next_is_key ? keys[k++] : buttons[b++];
+      std::this_thread::sleep_until(start + step.time);
+      if (next_is_key) {
+        keyboard_sim.press(step.code);
+      } else {
+        nes_sim.set_button(step.code, step.pressed);
+      }
+    }
+  });
+
+  // handle the events as they come, from another task
+  std::vector<espp::InputEvent> key_events;
+  std::vector<espp::InputEvent> button_events;
+  auto end = start + num_bursts * burst_period;
+  while (Clock::now() < end) {
+    espp::InputEvent event;
+    while (keyboard.pop_event(event)) {
+      key_events.push_back(event);
+    }
+    while (nes.pop_event(event)) {
+      button_events.push_back(event);
+    }
+    std::this_thread::sleep_for(20ms);
+  }
+  user.join();
+  keyboard.stop();
+  nes.stop();
+  float elapsed = std::chrono::duration<float>(Clock::now() - start).count();
+  espp::InputEvent event;
+  while (keyboard.pop_event(event)) {
+    key_events.push_back(event);
+  }
+  while (nes.pop_event(event)) {
+    button_events.push_back(event);
+  }
+
+  // no input is lost
+  if (!check_events(logger, "TKeyboard", key_events, keys, false) ||
+      !check_events(logger, "QwiicNes", button_events, buttons, true)) {
+    return 1;
+  }
+  if (keyboard.get_num_dropped_events() || nes.get_num_dropped_events()) {
+    logger.error("Events were dropped");
+    return 1;
+  }
+
+  // a button which is held at two updates, but was released and pressed
+  // again in between, is reported as a release and a press
+  {
+    SimulatedQwiicNes sim;
+    espp::QwiicNes controller({
+        .write = [&](uint8_t addr, const uint8_t *data,
+                     size_t len) { return sim.write(addr, data, len); },
+        .read_register = [&](uint8_t addr, uint8_t reg, uint8_t *data,
+                             size_t len) { return sim.read_register(addr, reg, data, len); },
+        .log_level = espp::Logger::Verbosity::WARN,
+    });
+    static constexpr int a = (int)espp::QwiicNes::Button::A;
+    std::error_code ec;
+    std::vector<bool> presses;
+    auto update = [&]() {
+      controller.update(ec);
+      espp::InputEvent event;
+      while (controller.pop_event(event)) {
+        presses.push_back(event.pressed);
+      }
+    };
+    sim.set_button(a, true);
+    update();
+    sim.set_button(a, false);
+    sim.set_button(a, true);
+    update();
+    // held, without a new press
+    update();
+    sim.set_button(a, false);
+    sim.set_button(a, true);
+    sim.set_button(a, false);
+    update();
+    std::vector<bool> expected = {true, false, true, false, true, false};
+    if (ec || presses != expected) {
+      logger.error("QwiicNes re-press: got {} events, expected press, release, press, release, "
+                   "press, release",
+                   presses.size());
+      return 1;
+    }
+  }
+
+  // polling every 10 ms takes 100 transactions per second for the keyboard,
+  // and 200 for the controller when reading both its current state and its
+  // accumulator (read_current_state() and update())
+  float keyboard_rate = keyboard_sim.get_num_transactions() / elapsed;
+  float nes_rate = nes_sim.get_num_transactions() / elapsed;
+  logger.info("{} key presses, {} button events in {:.1f} s:", key_events.size(),
+              button_events.size(), elapsed);
+  logger.info("  TKeyboard: {:5.1f} transactions/s (vs 100.0 polling every 10 ms)",
+              keyboard_rate);
+  logger.info("  QwiicNes:  {:5.1f} transactions/s (vs 200.0 polling every 10 ms)", nes_rate);
+  if (keyboard_rate > 60.0f || nes_rate > 60.0f) {
+    logger.error("The devices should be polled slowly while idle");
+    return 1;
+  }
+
+  logger.info("Input events test complete");
+
+  return 0;
+}
@@ -0,0 +1,197 @@
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "extended_kalman_filter.hpp"
+#include "kalman_filter.hpp"
+#include "logger.hpp"
+#include "square_root_kalman_filter.hpp"
+#include "unscented_kalman_filter.hpp"
+
+// Constant velocity model in D dimensions: the state is [position (D),
+// velocity (D)] and the position is measured.
+template <size_t D> struct ConstantVelocityModel {
+  static constexpr size_t N = 2 * D;
+  static constexpr size_t M = D;
+  static constexpr float dt = 0.01f;
+  static constexpr float acceleration_noise = 1.0f;
+  static constexpr float measurement_noise = 0.1f;
+
+  using Config = typename espp::KalmanFilter<N, M>::Config;
+
+  static espp::Matrix<N, N> F() {
+    auto F = espp::Matrix<N, N>::identity();
+    for (size_t i = 0; i < D; i++) {
+      F(i, D + i) = dt;
+    }
+    return F;
+  }
+
+  static espp::Matrix<M, N> H() {
+    espp::Matrix<M, N> H;
+    for (size_t i = 0; i < D; i++) {
+      H(i, i) = 1.0f;
+    }
+    return H;
+  }
+
+  static Config config() {
+    // discretized white noise acceleration (rank deficient)
+    espp::Matrix<N, N> Q;
+    float q = acceleration_noise * acceleration_noise;
+    for (size_t i = 0; i < D; i++) {
+      Q(i, i) = q * dt * dt * dt * dt / 4.0f;
+      Q(i, D + i) = q * dt * dt * dt / 2.0f;
+      Q(D + i, i) = q * dt * dt * dt / 2.0f;
+      Q(D + i, D + i) = q * dt * dt;
+    }
+    return {
+        .F = F(),
+        .H = H(),
+        .Q = Q,
+        .R = espp::Matrix<M, M>::identity() * (measurement_noise * measurement_noise),
+        .P = espp::Matrix<N, N>::identity() * 10.0f,
+    };
+  }
+
+  // simulate a trajectory and its noisy measurements
+  static void simulate(size_t num_steps, std::vector<espp::Vector<N>> &truth,
+                       std::vector<espp::Vector<M>> &measurements) {
+    std::mt19937 gen(1234);
+    std::normal_distribution<float> acceleration(0.0f, acceleration_noise);
+    std::normal_distribution<float> noise(0.0f, measurement_noise);
+    espp::Vector<N> x;
+    for (size_t i = 0; i < D; i++) {
+      x[D + i] = 1.0f;
+    }
+    for (size_t step = 0; step < num_steps; step++) {
+      for (size_t i = 0; i < D; i++) {
+        float a = acceleration(gen);
+        x[i] += x[D + i] * dt + 0.5f * a * dt * dt;
+        x[D + i] += a * dt;
+      }
+      espp::Vector<M> z;
+      for (size_t i = 0; i < D; i++) {
+        z[i] = x[i] + noise(gen);
+      }
+      truth.push_back(x);
+      measurements.push_back(z);
+    }
+  }
+};
+
+template <size_t R, size_t C>
+float max_abs_difference(const espp::Matrix<R, C> &a, const espp::Matrix<R, C> &b) {
+  float max_diff = 0;
+  for (size_t i = 0; i < R * C; i++) {
+    max_diff = std::max(max_diff, std::abs(a.data[i] - b.data[i]));
+  }
+  return max_diff;
+}
+
+template <size_t D> bool test_model(espp::Logger &logger) {
+  using Model = ConstantVelocityModel<D>;
+  static constexpr size_t N = Model::N;
+  static constexpr size_t M = Model::M;
+  static constexpr size_t num_steps = 2000;
+  std::vector<espp::Vector<N>> truth;
+  std::vector<espp::Vector<M>> measurements;
+  Model::simulate(num_steps, truth, measurements);
+
+  auto config = Model::config();
+  espp::KalmanFilter<N, M> kf(config);
+  espp::SquareRootKalmanFilter<N, M> srkf(config);
+  espp::ExtendedKalmanFilter<N, M> ekf({.Q = config.Q, .R = config.R, .P = config.P});
+  espp::UnscentedKalmanFilter<N, M> ukf({.Q = config.Q, .R = config.R, .P = config.P});
+  auto F = Model::F();
+  auto H = Model::H();
+  auto f = [&F](const espp::Vector<N> &x) { return F * x; };
+  auto f_jacobian = [&F](const espp::Vector<N> &) { return F; };
+  auto h = [&H](const espp::Vector<N> &x) { return H * x; };
+  auto h_jacobian = [&H](const espp::Vector<N> &) { return H; };
+
+  // accuracy: all filters estimate the same linear model, so they should
+  // agree, and track the true state better than the raw measurements
+  float squared_error = 0;
+  float squared_measurement_error = 0;
+  bool ok = true;
+  for (size_t step = 0; step < num_steps; step++) {
+    kf.predict();
+    srkf.predict();
+    ekf.predict(f, f_jacobian);
+    ok = ok && ukf.predict(f);
+    ok = ok && kf.update(measurements[step]);
+    ok = ok && srkf.update(measurements[step]);
+    ok = ok && ekf.update(measurements[step], h, h_jacobian);
+    ok = ok && ukf.update(measurements[step], h);
+    if (step >= num_steps / 2) {
+      for (size_t i = 0; i < D; i++) {
+        float error = kf.get_state()[i] - truth[step][i];
+        float measurement_error = measurements[step][i] - truth[step][i];
+        squared_error += error * error;
+        squared_measurement_error += measurement_error * measurement_error;
+      }
+    }
+  }
+  float rms_error = std::sqrt(squared_error / (D * num_steps / 2));
+  float rms_measurement_error = std::sqrt(squared_measurement_error / (D * num_steps / 2));
+  float srkf_diff = max_abs_difference(kf.get_state(), srkf.get_state());
+  float ekf_diff = max_abs_difference(kf.get_state(), ekf.get_state());
+  float ukf_diff = max_abs_difference(kf.get_state(), ukf.get_state());
+  float srkf_cov_diff = max_abs_difference(kf.get_covariance(), srkf.get_covariance());
+  logger.info("{:2}-state: position rms error {:.4f} (measurements {:.4f}), max |x - x_kf|: "
+              "srkf {:.2e}, ekf {:.2e}, ukf {:.2e}, max |P - P_kf|: srkf {:.2e}",
+              N, rms_error, rms_measurement_error, srkf_diff, ekf_diff, ukf_diff, srkf_cov_diff);
+  ok = ok && rms_error < rms_measurement_error;
+  ok = ok && srkf_diff < 1e-3f && ekf_diff < 1e-3f && ukf_diff < 1e-3f && srkf_cov_diff < 1e-4f;
+  if (!ok) {
+    logger.error("{}-state filters disagree or diverged", N);
+    return false;
+  }
+
+  // throughput of one predict + update cycle
+  static constexpr size_t num_iterations = 200'000;
+  auto benchmark = [&](std::string_view name, auto &&step_fn) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < num_iterations; i++) {
+      step_fn(measurements[i % num_steps]);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    float elapsed_s = std::chrono::duration<float>(end - start).count();
+    logger.info("{:2}-state {}: {:9.0f} predict+update / s ({:6.0f} ns)", N, name,
+                num_iterations / elapsed_s, elapsed_s * 1e9f / num_iterations);
+  };
+  benchmark("KalmanFilter          ", [&](const auto &z) {
+    kf.predict();
+    kf.update(z);
+  });
+  benchmark("SquareRootKalmanFilter", [&](const auto &z) {
+    srkf.predict();
+    srkf.update(z);
+  });
+  benchmark("ExtendedKalmanFilter  ", [&](const auto &z) {
+    ekf.predict(f, f_jacobian);
+    ekf.update(z, h, h_jacobian);
+  });
+  benchmark("UnscentedKalmanFilter ", [&](const auto &z) {
+    ukf.predict(f);
+    ukf.update(z, h);
+  });
+  logger.info("{:2}-state final estimate: {}", N, kf.get_state());
+  return true;
+}
+
+int main() {
+  espp::Logger logger({.tag = "Kalman Filter Test", .level = espp::Logger::Verbosity::INFO});
+
+  logger.info("Starting Kalman filter test");
+
+  if (!test_model<1>(logger) || !test_model<3>(logger) || !test_model<6>(logger)) {
+    return 1;
+  }
+
+  logger.info("Kalman filter test complete");
+
+  return 0;
+}
@@ -0,0 +1,192 @@
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <malloc.h>
+
+#include "event_manager.hpp"
+#include "latest_value.hpp"
+
+using namespace std::chrono_literals;
+
+static constexpr size_t state_size = 64;
+static constexpr uint32_t burst_size = 5000;
+static constexpr auto callback_time = 1ms;
+
+// a state whose bytes all depend on its counter, so that torn reads show
+std::vector<uint8_t> make_state(uint32_t counter) {
+  std::vector<uint8_t> state(state_size, uint8_t(counter * 31));
+  std::memcpy(state.data(), &counter, sizeof(counter));
+  return state;
+}
+
+bool is_consistent(const std::vector<uint8_t> &state, uint32_t &counter) {
+  if (state.size() != state_size) {
+    return false;
+  }
+  std::memcpy(&counter, state.data(), sizeof(counter));
+  for (size_t i = sizeof(counter); i < state.size(); i++) {
+    if (state[i] != uint8_t(counter * 31)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t heap_in_use() { return mallinfo2().uordblks; }
+
+struct TopicResult {
+  float publish_rate;    // publishes per second during the burst
+  size_t num_deliveries; // callbacks for the burst
+  float delivery_time_s; // until the subscriber got the last value
+  size_t backlog_heap;   // heap in use at the end of the burst, above the start
+};
+
+// publish a burst of states on the topic, which has a subscriber taking 1 ms
+// per callback
+TopicResult run_burst(const std::string &topic) {
+  auto &em = espp::EventManager::get();
+  std::atomic<size_t> num_deliveries{0};
+  std::atomic<uint32_t> last_counter{0};
+  std::atomic<bool> consistent{true};
+  em.add_subscriber(topic, "subscriber", [&](const std::vector<uint8_t> &data) {
+    uint32_t counter = 0;
+    consistent = consistent && is_consistent(data, counter);
+    last_counter = counter;
+    num_deliveries++;
+    std::this_thread::sleep_for(callback_time);
+  });
+  // let the subscriber task start waiting
+  std::this_thread::sleep_for(10ms);
+
+  std::vector<std::vector<uint8_t>> states;
+  for (uint32_t i = 1; i <= burst_size; i++) {
+    states.push_back(make_state(i));
+  }
+  size_t heap_start = heap_in_use();
+  auto start = std::chrono::steady_clock::now();
+  for (const auto &state : states) {
+    em.publish(topic, state);
+  }
+  auto end = std::chrono::steady_clock::now();
+  TopicResult result{};
+  result.backlog_heap = heap_in_use() - std::min(heap_in_use(), heap_start);
+  result.publish_rate = burst_size / std::chrono::duration<float>(end - start).count();
+  auto deadline = end + 30s;
+  while (last_counter != burst_size && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(1ms);
+  }
+  result.delivery_time_s =
+      std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+  result.num_deliveries = num_deliveries;
+  em.remove_subscriber(topic, "subscriber");
+  if (!consistent || last_counter != burst_size) {
+    result.num_deliveries = 0;
+  }
+  return result;
+}
+
+int main() {
+  espp::Logger logger({.tag = "Latest Value Test", .level = espp::Logger::Verbosity::INFO});
+
+  logger.info("Starting latest value test");
+
+  // LatestValue: one writer and two readers polling as fast as they can,
+  // checking that no read sees a partially written value
+  {
+    espp::LatestValue value(state_size);
+    std::atomic<bool> done{false};
+    std::atomic<size_t> num_writes{0};
+    std::atomic<size_t> num_reads{0};
+    std::atomic<size_t> num_torn{0};
+    std::thread writer([&] {
+      std::vector<std::vector<uint8_t>> states;
+      for (uint32_t i = 0; i < 256; i++) {
+        states.push_back(make_state(i + 1));
+      }
+      size_t i = 0;
+      while (!done) {
+        value.write(states[i++ % states.size()]);
+      }
+      num_writes = i;
+    });
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 2; r++) {
+      readers.emplace_back([&] {
+        std::vector<uint8_t> state;
+        state.reserve(state_size);
+        size_t n = 0;
+        uint32_t counter = 0;
+        while (!done) {
+          if (value.read(state) > 0 && !is_consistent(state, counter)) {
+            num_torn++;
+          }
+          n++;
+        }
+        num_reads += n;
+      });
+    }
+    std::this_thread::sleep_for(500ms);
+    done = true;
+    writer.join();
+    for (auto &reader : readers) {
+      reader.join();
+    }
+    logger.info("LatestValue: {:.1f} M writes/s, {:.1f} M reads/s (2 readers), {} torn reads",
+                num_writes / 0.5f / 1e6f, num_reads / 0.5f / 1e6f, num_torn.load());
+    std::vector<uint8_t> too_large(state_size + 1);
+    if (num_torn > 0 || num_writes == 0 || num_reads == 0 || value.write(too_large)) {
+      logger.error("LatestValue failed");
+      return 1;
+    }
+  }
+
+  // EventManager: a burst of 5000 publishes to a subscriber taking 1 ms per
+  // callback, on a queued topic and on a latest-value topic
+  {
+    auto &em = espp::EventManager::get();
+    em.set_log_level(espp::Logger::Verbosity::WARN);
+    em.add_latest_value_topic("latest", state_size);
+    auto queued = run_burst("queued");
+    auto latest = run_burst("latest");
+    logger.info("Queued topic:       {:.0f} k publishes/s, {} callbacks, last value delivered "
+                "after {:.2f} s, backlog {} kB",
+                queued.publish_rate / 1e3f, queued.num_deliveries, queued.delivery_time_s,
+                queued.backlog_heap / 1024);
+    logger.info("Latest-value topic: {:.0f} k publishes/s, {} callbacks, last value delivered "
+                "after {:.2f} s, backlog {} kB",
+                latest.publish_rate / 1e3f, latest.num_deliveries, latest.delivery_time_s,
+                latest.backlog_heap / 1024);
+    if (queued.num_deliveries != burst_size || latest.num_deliveries == 0 ||
+        latest.num_deliveries > burst_size / 10 ||
+        latest.delivery_time_s >= queued.delivery_time_s) {
+      logger.error("The latest-value topic should coalesce the burst");
+      return 1;
+    }
+
+    // the latest value can be polled without subscribing, and is kept
+    // without subscribers
+    auto value = em.get_latest_value("latest");
+    std::vector<uint8_t> state;
+    uint32_t version = 0;
+    uint32_t counter = 0;
+    if (!value || !value->read_if_newer(state, version) || !is_consistent(state, counter) ||
+        counter != burst_size || value->read_if_newer(state, version)) {
+      logger.error("Polling the latest value failed");
+      return 1;
+    }
+    if (!em.publish("latest", make_state(1)) || !value->read_if_newer(state, version) ||
+        em.publish("latest", std::vector<uint8_t>(state_size + 1)) ||
+        em.get_latest_value("queued") || !em.remove_latest_value_topic("latest") ||
+        em.publish("latest", make_state(2))) {
+      logger.error("Latest-value topic failed");
+      return 1;
+    }
+  }
+
+  logger.info("Latest value test complete");
+
+  return 0;
+}
@@ -0,0 +1,182 @@
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "led_sequencer.hpp"
+#include "led_waveform_recorder.hpp"
+#include "logger.hpp"
+
+using namespace std::chrono_literals;
+using Clock = std::chrono::steady_clock;
+
+// 13 bit duty resolution, as the default of espp::Led
+static constexpr uint32_t max_raw_duty = (1 << 13) - 1;
+static constexpr float max_error = 0.5f;
+
+// breathing, from off to the peak brightness and back
+espp::LedSequencer::Timeline breathing(uint32_t period_ms, float peak) {
+  return {.keyframes = {{0, 0.0f}, {period_ms / 2, peak}, {period_ms, 0.0f}}};
+}
+
+// the largest difference (raw duty) between the fades and the curve of a
+// breathing timeline, evaluated every ms over one period
+float compiled_error(const espp::LedSequencer::Timeline &timeline) {
+  auto fades = espp::LedSequencer::compile(timeline, max_raw_duty, max_error);
+  const auto &keyframes = timeline.keyframes;
+  float error = 0;
+  uint32_t t = 0;
+  uint32_t duty = fades[0].raw_duty;
+  for (size_t i = 1; i < fades.size(); i++) {
+    const auto &fade = fades[i];
+    for (uint32_t dt = 0; dt < fade.fade_time_ms; dt++) {
+      float linear = duty + (float(fade.raw_duty) - float(duty)) * dt / fade.fade_time_ms;
+      // brightness of the keyframes at t + dt
+      uint32_t time = t + dt;
+      size_t k = 1;
+      while (k < keyframes.size() - 1 && keyframes[k].time_ms <= time) {
+        k++;
+      }
+      const auto &from = keyframes[k - 1];
+      const auto &to = keyframes[k];
+      float brightness = from.brightness + (to.brightness - from.brightness) *
+                                               (time - from.time_ms) / (to.time_ms - from.time_ms);
+      float curve = espp::LedSequencer::to_raw_duty(timeline, brightness, max_raw_duty);
+      error = std::max(error, std::fabs(curve - linear));
+    }
+    t += fade.fade_time_ms;
+    duty = fade.raw_duty;
+  }
+  return error;
+}
+
+int main() {
+  espp::Logger logger({.tag = "LedSequencer Test", .level = espp::Logger::Verbosity::INFO});
+
+  logger.info("Starting LedSequencer test");
+
+  // the curves
+  espp::LedSequencer::Timeline linear{.curve = espp::LedSequencer::Curve::LINEAR};
+  espp::LedSequencer::Timeline gamma{.curve = espp::LedSequencer::Curve::GAMMA};
+  espp::LedSequencer::Timeline cie{.curve = espp::LedSequencer::Curve::CIE1931};
+  auto raw = [](const auto &timeline, float brightness) {
+    return espp::LedSequencer::to_raw_duty(timeline, brightness, max_raw_duty);
+  };
+  if (raw(linear, 50) != 4096 ||
+      raw(gamma, 50) != std::lround(std::pow(0.5f, 2.2f) * max_raw_duty) || raw(cie, 0) != 0 ||
+      raw(cie, 100) != max_raw_duty || raw(cie, 50) < 1400 || raw(cie, 50) > 1600 ||
+      raw(gamma, 150) != max_raw_duty) {
+    logger.error("Unexpected curves");
+    return 1;
+  }
+
+  // the compiled fades follow the curves
+  for (auto curve : {espp::LedSequencer::Curve::LINEAR, espp::LedSequencer::Curve::GAMMA,
+                     espp::LedSequencer::Curve::CIE1931}) {
+    auto timeline = breathing(3000, 100.0f);
+    timeline.curve = curve;
+    auto fades = espp::LedSequencer::compile(timeline, max_raw_duty, max_error);
+    float error = compiled_error(timeline) * 100.0f / max_raw_duty;
+    logger.info("Curve {}: {} fades per period, max error {:.2f}%", (int)curve, fades.size() - 1,
+                error);
+    // (plus rounding of the duty)
+    if (error > max_error + 0.05f ||
+        (curve == espp::LedSequencer::Curve::LINEAR && fades.size() != 3)) {
+      logger.error("The fades do not follow the curve");
+      return 1;
+    }
+  }
+
+  // 6 breathing channels with different peak brightness
+  static constexpr size_t num_channels = 6;
+  static constexpr uint32_t period_ms = 3000;
+  static constexpr int num_periods = 2;
+  espp::LedSequencer *sequencer_ptr = nullptr;
+  espp::LedWaveformRecorder *recorder_ptr = nullptr;
+  espp::LedSequencer sequencer({
+      .num_channels = num_channels,
+      .max_raw_duty = max_raw_duty,
+      .start_fade = [&recorder_ptr](size_t channel, uint32_t raw_duty,
+                                    uint32_t fade_time_ms) {
+        recorder_ptr->start_fade(channel, raw_duty, fade_time_ms);
+      },
+      .max_error = max_error,
+  });
+  sequencer_ptr = &sequencer;
+  // the recorder is destroyed first, so its fade end callback never outlives
+  // the sequencer
+  espp::LedWaveformRecorder recorder({
+      .num_channels = num_channels,
+      .on_fade_end = [&sequencer_ptr](size_t channel) { sequencer_ptr->fade_ended(channel); },
+  });
+  recorder_ptr = &recorder;
+
+  std::vector<espp::LedSequencer::Timeline> timelines;
+  for (size_t i = 0; i < num_channels; i++) {
+    timelines.push_back(breathing(period_ms, 100.0f - 10.0f * i));
+  }
+  auto start = Clock::now();
+  sequencer.play(timelines);
+  std::this_thread::sleep_for(num_periods * std::chrono::milliseconds(period_ms));
+  float elapsed = std::chrono::duration<float>(Clock::now() - start).count();
+  size_t num_wakeups = sequencer.get_num_wakeups();
+  size_t num_fades = sequencer.get_num_fades();
+  sequencer.stop();
+
+  // each channel played its fades in order, and looped without going through
+  // the fade to the first keyframe again
+  for (size_t i = 0; i < num_channels; i++) {
+    auto expected = espp::LedSequencer::compile(timelines[i], max_raw_duty, max_error);
+    auto fades = recorder.get_fades(i);
+    if (fades.size() <= expected.size()) {
+      logger.error("Channel {} played only {} fades", i, fades.size());
+      return 1;
+    }
+    for (size_t j = 0; j < fades.size(); j++) {
+      size_t k = j < expected.size() ? j : 1 + (j - 1) % (expected.size() - 1);
+      if (fades[j].raw_duty != expected[k].raw_duty ||
+          fades[j].duration.count() != expected[k].fade_time_ms) {
+        logger.error("Channel {} fade {} is to {} in {} ms", i, j, fades[j].raw_duty,
+                     fades[j].duration.count());
+        return 1;
+      }
+    }
+    // the waveform reaches the peak (between two samples) and goes back to
+    // off
+    auto samples = recorder.sample(i, start, 1ms, period_ms);
+    auto peak = raw(timelines[i], timelines[i].keyframes[1].brightness);
+    auto max = *std::max_element(samples.begin(), samples.end());
+    if (max > peak || max < peak * 0.99f || samples.back() > peak / 10) {
+      logger.error("Channel {} peaks at {}, expected {}", i, max, peak);
+      return 1;
+    }
+  }
+
+  // driving the same effect from a task per channel which updates its duty
+  // cycle every 10 ms (as in the breathing led example) takes 100 wakeups per
+  // second per channel
+  float wakeups_per_second = num_wakeups / elapsed;
+  float fades_per_second = num_fades / elapsed;
+  logger.info("{} breathing channels, {} ms period:", num_channels, period_ms);
+  logger.info("  LedSequencer: {:5.1f} wakeups/s, {:5.1f} fades/s", wakeups_per_second,
+              fades_per_second);
+  logger.info("  task per channel at 100 Hz: {:5.1f} wakeups/s", num_channels * 100.0f);
+  if (num_wakeups == 0 || num_wakeups > num_fades || wakeups_per_second > num_channels * 20.0f) {
+    logger.error("The sequencer should only wake up at the fade boundaries");
+    return 1;
+  }
+
+  // a timeline which does not repeat ends
+  auto once = breathing(100, 100.0f);
+  once.repeat = false;
+  sequencer.play({once});
+  std::this_thread::sleep_for(300ms);
+  if (sequencer.is_playing(0) || recorder.get_raw_duty(0, Clock::now()) != 0) {
+    logger.error("A timeline which does not repeat should end");
+    return 1;
+  }
+
+  logger.info("LedSequencer test complete");
+
+  return 0;
+}
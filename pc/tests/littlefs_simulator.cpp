@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "logger.hpp"
+#include "nor_flash_simulator.hpp"
+
+#if defined(ESPP_LITTLEFS)
+#include "littlefs_simulator.hpp"
+
+struct Workload {
+  size_t bytes_written{0};
+  espp::NorFlashSimulator::Stats stats;
+};
+
+// append fixed size records to a log file, committing every sync_every records
+Workload append_log(espp::LittleFsSimulator &fs, size_t record_size, size_t num_records,
+                    size_t sync_every, std::error_code &ec) {
+  auto before = fs.get_flash().get_stats();
+  auto file = fs.open("log.bin", LFS_O_WRONLY | LFS_O_CREAT | LFS_O_APPEND, ec);
+  std::vector<uint8_t> record(record_size);
+  for (size_t i = 0; i < num_records && !ec; i++) {
+    std::fill(record.begin(), record.end(), uint8_t(i));
+    file.write(record, ec);
+    if ((i + 1) % sync_every == 0) {
+      file.sync(ec);
+    }
+  }
+  file.close(ec);
+  return {record_size * num_records, fs.get_flash().get_stats() - before};
+}
+
+// rewrite a small settings file atomically (write a copy, then rename it)
+Workload rewrite_settings(espp::LittleFsSimulator &fs, size_t size, size_t num_rewrites,
+                          std::error_code &ec) {
+  auto before = fs.get_flash().get_stats();
+  std::vector<uint8_t> settings(size);
+  for (size_t i = 0; i < num_rewrites && !ec; i++) {
+    std::fill(settings.begin(), settings.end(), uint8_t(i));
+    auto file = fs.open("settings.tmp", LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC, ec);
+    file.write(settings, ec);
+    file.close(ec);
+    fs.rename("settings.tmp", "settings.bin", ec);
+  }
+  return {size * num_rewrites, fs.get_flash().get_stats() - before};
+}
+
+void log_workload(espp::Logger &logger, std::string_view name, const Workload &workload) {
+  float write_amplification = float(workload.stats.bytes_programmed) / workload.bytes_written;
+  float seconds = workload.stats.busy_time.count() / 1e6f;
+  logger.info("{}: write amplification {:.2f}, {} erases, {:.1f} KiB/s simulated, {}", name,
+              write_amplification, workload.stats.erases,
+              workload.bytes_written / 1024.0f / seconds, workload.stats);
+}
+#endif
+
+int main() {
+  espp::Logger logger({.tag = "LittleFS Simulator Test", .level = espp::Logger::Verbosity::INFO});
+
+  logger.info("Starting LittleFS simulator test");
+
+  // NOR flash semantics and accounting
+  {
+    espp::NorFlashSimulator flash({.block_size = 4096, .block_count = 4, .page_size = 256});
+    std::vector<uint8_t> data(300, 0x0F);
+    std::vector<uint8_t> read(300);
+    if (!flash.read(1, 0, read) || read != std::vector<uint8_t>(300, 0xFF)) {
+      logger.error("Flash is not erased initially");
+      return 1;
+    }
+    // 300 bytes at offset 200 touch 2 pages
+    flash.program(1, 200, data);
+    std::vector<uint8_t> set_bits(300, 0xF0);
+    flash.program(1, 200, set_bits);
+    flash.read(1, 200, read);
+    if (read != std::vector<uint8_t>(300, 0x00) || flash.get_num_bad_programs() != 300) {
+      logger.error("Programming must only clear bits");
+      return 1;
+    }
+    flash.erase(1);
+    flash.read(1, 200, read);
+    auto stats = flash.get_stats();
+    if (read != std::vector<uint8_t>(300, 0xFF) || stats.reads != 3 || stats.programs != 2 ||
+        stats.erases != 1 || stats.bytes_programmed != 600 || flash.get_erase_count(1) != 1 ||
+        flash.get_max_erase_count() != 1) {
+      logger.error("Wrong contents or stats after erase: {}", stats);
+      return 1;
+    }
+    // 3 reads of 300 bytes, 2 programs of 2 pages and 1 erase
+    auto expected = std::chrono::microseconds(3 * (1 + 15) + 2 * 2 * 700 + 45'000);
+    if (stats.busy_time != expected) {
+      logger.error("Busy time {} us, expected {} us", stats.busy_time.count(), expected.count());
+      return 1;
+    }
+    if (flash.read(4, 0, read) || flash.program(0, 4000, data)) {
+      logger.error("Out of range access not rejected");
+      return 1;
+    }
+
+    // power cut: the second program is torn, and nothing works until power on
+    flash.schedule_power_cut(1);
+    bool first = flash.program(2, 0, data);
+    bool second = flash.program(2, 512, data);
+    if (!first || second || flash.is_powered() || flash.read(2, 0, read) || flash.erase(3)) {
+      logger.error("Power cut not simulated");
+      return 1;
+    }
+    flash.power_on();
+    flash.read(2, 512, read);
+    size_t programmed = std::count(read.begin(), read.end(), 0x0F);
+    bool prefix = std::all_of(read.begin(), read.begin() + programmed,
+                              [](uint8_t b) { return b == 0x0F; });
+    if (!prefix || programmed == data.size()) {
+      logger.error("Torn program should program a prefix, programmed {}", programmed);
+      return 1;
+    }
+    logger.info("Flash model: {}", flash.get_stats());
+  }
+
+#if defined(ESPP_LITTLEFS)
+  // access patterns, on the default (esp_littlefs) configuration
+  {
+    espp::LittleFsSimulator fs({});
+    std::error_code ec;
+    fs.format(ec);
+    fs.mount(ec);
+    log_workload(logger, "Log, sync every record", append_log(fs, 64, 1000, 1, ec));
+    fs.remove("log.bin", ec);
+    log_workload(logger, "Log, sync every 64 records", append_log(fs, 64, 1000, 64, ec));
+    log_workload(logger, "Settings rewrite", rewrite_settings(fs, 256, 1000, ec));
+    logger.info("Wear: max {} erases per block, {} / {} bytes used", fs.get_flash()
+                .get_max_erase_count(), fs.get_used_space(), fs.get_total_space());
+    if (ec || fs.get_flash().get_num_bad_programs() != 0) {
+      logger.error("Access patterns failed: {}", ec.message());
+      return 1;
+    }
+  }
+
+  // cache size sweep for the log pattern
+  for (size_t cache_size : {128, 256, 512, 1024, 4096}) {
+    espp::LittleFsSimulator fs({.cache_size = cache_size});
+    std::error_code ec;
+    fs.format(ec);
+    fs.mount(ec);
+    auto workload = append_log(fs, 64, 1000, 16, ec);
+    if (ec) {
+      logger.error("Log with cache size {} failed: {}", cache_size, ec.message());
+      return 1;
+    }
+    log_workload(logger, fmt::format("Cache size {:4}", cache_size), workload);
+  }
+
+  // power cuts: after remounting, the log holds every synced record and only
+  // whole records
+  {
+    static constexpr size_t record_size = 32;
+    espp::LittleFsSimulator fs({.flash = {.block_count = 64, .seed = 5}});
+    std::error_code ec;
+    fs.format(ec);
+    std::mt19937 gen(7);
+    size_t synced = 0;
+    static constexpr int num_power_cuts = 50;
+    for (int cut = 0; cut < num_power_cuts; cut++) {
+      ec.clear();
+      if (!fs.mount(ec)) {
+        logger.error("Mount after power cut {} failed: {}", cut, ec.message());
+        return 1;
+      }
+      {
+        auto file = fs.open("log.bin", LFS_O_RDONLY, ec);
+        size_t size = file.is_open() ? file.size(ec) : 0;
+        std::vector<uint8_t> contents(size);
+        file.read(contents, ec);
+        bool valid = size % record_size == 0 && size >= synced * record_size;
+        for (size_t i = 0; valid && i < size; i++) {
+          valid = contents[i] == uint8_t(i / record_size);
+        }
+        if (!valid) {
+          logger.error("Log corrupted by power cut {}: {} bytes, {} records synced", cut, size,
+                       synced);
+          return 1;
+        }
+        synced = size / record_size;
+        ec.clear();
+      }
+      fs.get_flash().schedule_power_cut(std::uniform_int_distribution<size_t>(1, 100)(gen));
+      {
+        auto file = fs.open("log.bin", LFS_O_WRONLY | LFS_O_CREAT | LFS_O_APPEND, ec);
+        std::vector<uint8_t> record(record_size);
+        for (size_t i = synced; !ec; i++) {
+          std::fill(record.begin(), record.end(), uint8_t(i));
+          if (file.write(record, ec) && file.sync(ec)) {
+            synced = i + 1;
+          }
+        }
+      }
+      fs.unmount(ec);
+      fs.get_flash().cancel_power_cut();
+      fs.get_flash().power_on();
+    }
+    logger.info("Log survived {} power cuts, {} records", num_power_cuts, synced);
+  }
+#else
+  logger.warn("Built with ESPP_LITTLEFS=OFF, skipping the LittleFS workloads");
+#endif
+
+  logger.info("LittleFS simulator test complete");
+
+  return 0;
+}
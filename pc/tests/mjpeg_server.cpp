@@ -0,0 +1,268 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "mjpeg_server.hpp"
+#include "rtsp_server.hpp"
+#include "tcp_socket.hpp"
+
+using namespace std::chrono_literals;
+
+static constexpr int port = 18080;
+static constexpr size_t frame_size = 48 * 1024;
+static constexpr int frame_rate = 30;
+static constexpr auto stream_duration = 3s;
+static constexpr int client_counts[] = {1, 2, 4, 8, 16, 32};
+
+// results of one client, sent from the client process to the server process
+struct ClientResult {
+  uint32_t num_frames;
+  uint32_t num_bad_frames;
+  float median_latency_ms;
+  float max_latency_ms;
+};
+
+int64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// a JPEG frame whose scan data starts with the time it was sent
+espp::JpegFrame make_frame(const std::string &header) {
+  std::vector<char> data(header.begin(), header.end());
+  data.resize(frame_size);
+  for (size_t i = header.size(); i < data.size(); i++) {
+    data[i] = char(i * 7);
+  }
+  int64_t timestamp = now_ns();
+  std::memcpy(data.data() + header.size(), &timestamp, sizeof(timestamp));
+  return espp::JpegFrame(data.data(), data.size());
+}
+
+// connect, request the stream and read frames until the server closes the
+// connection, measuring the latency from send_frame() to the full frame
+ClientResult run_client(size_t header_size, const std::string &path = "/stream") {
+  ClientResult result{};
+  espp::TcpSocket socket({.log_level = espp::Logger::Verbosity::ERROR});
+  auto deadline = std::chrono::steady_clock::now() + 10s;
+  while (!socket.connect({.ip_address = "127.0.0.1", .port = port})) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return result;
+    }
+    std::this_thread::sleep_for(10ms);
+    socket.reinit();
+  }
+  socket.transmit(fmt::format("GET {} HTTP/1.1\r\nHost: localhost\r\n\r\n", path));
+  // wait for frames until the server closes the connection
+  socket.set_receive_timeout(30s);
+  std::vector<float> latencies_ms;
+  std::string buffer;
+  std::vector<uint8_t> chunk(64 * 1024);
+  bool header_done = false;
+  while (true) {
+    // parse all complete parts in the buffer
+    while (true) {
+      auto end = buffer.find("\r\n\r\n");
+      if (end == std::string::npos) {
+        break;
+      }
+      if (!header_done) {
+        header_done = true;
+        buffer.erase(0, end + 4);
+        continue;
+      }
+      auto length_pos = buffer.find("Content-Length: ");
+      size_t length = std::stoul(buffer.substr(length_pos + 16));
+      size_t part_size = end + 4 + length + 2;
+      if (buffer.size() < part_size) {
+        break;
+      }
+      int64_t timestamp;
+      std::memcpy(&timestamp, buffer.data() + end + 4 + header_size, sizeof(timestamp));
+      latencies_ms.push_back((now_ns() - timestamp) / 1e6f);
+      bool valid = length == frame_size && buffer[end + 4 + length - 1] == char((length - 1) * 7);
+      result.num_bad_frames += valid ? 0 : 1;
+      buffer.erase(0, part_size);
+    }
+    size_t num_bytes = socket.receive(chunk.data(), chunk.size());
+    if (num_bytes == 0) {
+      break;
+    }
+    buffer.append(reinterpret_cast<const char *>(chunk.data()), num_bytes);
+  }
+  result.num_frames = latencies_ms.size();
+  if (!latencies_ms.empty()) {
+    std::sort(latencies_ms.begin(), latencies_ms.end());
+    result.median_latency_ms = latencies_ms[latencies_ms.size() / 2];
+    result.max_latency_ms = latencies_ms.back();
+  }
+  return result;
+}
+
+float cpu_seconds() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6f;
+}
+
+int main() {
+  espp::Logger logger({.tag = "MJPEG Server Test", .level = espp::Logger::Verbosity::INFO});
+
+  logger.info("Starting MJPEG server test");
+
+  std::string q_table(64, 1);
+  std::string header(espp::JpegHeader(640, 480, q_table, q_table).get_data());
+
+  // the clients run in a separate process, so that the CPU time of the server
+  // process is only the server's
+  int pipe_fds[2];
+  if (pipe(pipe_fds) != 0) {
+    logger.error("Failed to create pipe");
+    return 1;
+  }
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(pipe_fds[0]);
+    for (int num_clients : client_counts) {
+      std::vector<ClientResult> results(num_clients);
+      std::vector<std::thread> threads;
+      for (int i = 0; i < num_clients; i++) {
+        threads.emplace_back([&, i] { results[i] = run_client(header.size()); });
+      }
+      for (auto &thread : threads) {
+        thread.join();
+      }
+      ssize_t size = results.size() * sizeof(ClientResult);
+      if (write(pipe_fds[1], results.data(), size) != size) {
+        _exit(1);
+      }
+    }
+    _exit(0);
+  }
+  close(pipe_fds[1]);
+
+  // benchmark: frames from an RtspServer, to 1 - 32 clients on loopback
+  for (int num_clients : client_counts) {
+    espp::MjpegServer mjpeg_server({.port = port, .path = "/stream", .max_num_clients = 32});
+    espp::RtspServer rtsp_server({.server_address = "127.0.0.1", .port = 18554, .path = "/s"});
+    rtsp_server.set_mjpeg_server(&mjpeg_server);
+    mjpeg_server.start();
+    auto deadline = std::chrono::steady_clock::now() + 10s;
+    while (mjpeg_server.get_num_clients() < size_t(num_clients) &&
+           std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(10ms);
+    }
+    // wait for the clients' requests to be handled
+    std::this_thread::sleep_for(100ms);
+
+    int num_frames = std::chrono::duration_cast<std::chrono::seconds>(stream_duration).count() *
+                     frame_rate;
+    float cpu_start = cpu_seconds();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_frames; i++) {
+      std::this_thread::sleep_until(start + i * 1000ms / frame_rate);
+      rtsp_server.send_frame(make_frame(header));
+    }
+    // let the clients receive the last frame
+    std::this_thread::sleep_for(100ms);
+    float cpu = cpu_seconds() - cpu_start;
+    float elapsed = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+    auto stats = mjpeg_server.get_stats();
+    mjpeg_server.stop();
+
+    std::vector<ClientResult> results(num_clients);
+    ssize_t size = results.size() * sizeof(ClientResult);
+    if (read(pipe_fds[0], results.data(), size) != size) {
+      logger.error("Failed to read the client results");
+      return 1;
+    }
+    std::vector<float> medians;
+    float max_latency_ms = 0;
+    size_t min_frames = num_frames;
+    for (const auto &result : results) {
+      if (result.num_bad_frames > 0) {
+        logger.error("{} clients: a client received {} corrupted frames", num_clients,
+                     result.num_bad_frames);
+        return 1;
+      }
+      medians.push_back(result.median_latency_ms);
+      max_latency_ms = std::max(max_latency_ms, result.max_latency_ms);
+      min_frames = std::min<size_t>(min_frames, result.num_frames);
+    }
+    std::sort(medians.begin(), medians.end());
+    logger.info("{:2} clients: latency median {:.2f} ms, max {:.2f} ms, frames >= {} / {}, "
+                "{} dropped, server CPU {:.1f}% ({:.1f} us / frame / client)",
+                num_clients, medians[medians.size() / 2], max_latency_ms, min_frames, num_frames,
+                stats.frames_dropped, cpu / elapsed * 100.0f,
+                cpu * 1e6f / (num_frames * num_clients));
+    if (min_frames < size_t(num_frames) * 9 / 10) {
+      logger.error("Clients on loopback should receive almost all frames");
+      return 1;
+    }
+  }
+  int status = 0;
+  waitpid(pid, &status, 0);
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    logger.error("Client process failed");
+    return 1;
+  }
+
+  // drop-if-behind: a client which stops reading neither delays nor blocks
+  // the others, and is disconnected once it stalls
+  {
+    espp::MjpegServer server({.port = port, .path = "/stream", .send_timeout = 500ms});
+    server.start();
+    // a client which connects and requests the stream, but never reads
+    espp::TcpSocket stalled({.log_level = espp::Logger::Verbosity::ERROR});
+    stalled.connect({.ip_address = "127.0.0.1", .port = port});
+    stalled.transmit(std::string_view("GET /stream HTTP/1.1\r\n\r\n"));
+    // a client which requests a wrong path
+    espp::TcpSocket wrong_path({.log_level = espp::Logger::Verbosity::ERROR});
+    wrong_path.connect({.ip_address = "127.0.0.1", .port = port});
+    wrong_path.transmit(std::string_view("GET /other HTTP/1.1\r\n\r\n"));
+    std::vector<uint8_t> response;
+    wrong_path.receive(response, 1024);
+    if (std::string_view((const char *)response.data(), response.size()).find("404") ==
+        std::string_view::npos) {
+      logger.error("Wrong path should get a 404 response");
+      return 1;
+    }
+    ClientResult result;
+    std::thread reader([&] { result = run_client(header.size()); });
+    while (server.get_num_clients() < 2) {
+      std::this_thread::sleep_for(10ms);
+    }
+    std::this_thread::sleep_for(100ms);
+    static constexpr int num_frames = 300;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_frames; i++) {
+      std::this_thread::sleep_until(start + i * 10ms);
+      server.send_frame(make_frame(header));
+    }
+    std::this_thread::sleep_for(100ms);
+    size_t num_clients = server.get_num_clients();
+    server.stop();
+    reader.join();
+    logger.info("Stalled client: reader got {} / {} frames (max latency {:.2f} ms), {} "
+                "clients left",
+                result.num_frames, num_frames, result.max_latency_ms, num_clients);
+    if (result.num_frames < num_frames * 9 / 10 || num_clients != 1) {
+      logger.error("The stalled client should be dropped without affecting the reader");
+      return 1;
+    }
+  }
+
+  logger.info("MJPEG server test complete");
+
+  return 0;
+}
@@ -0,0 +1,132 @@
+#include <chrono>
+#include <vector>
+
+#include "logger.hpp"
+#include "rtp_jpeg_packet.hpp"
+#include "rtp_jpeg_packet_view.hpp"
+#include "rtp_packet_view.hpp"
+
+using namespace std::chrono_literals;
+
+int main() {
+  espp::Logger logger({.tag = "RTP Packet Test", .level = espp::Logger::Verbosity::INFO});
+
+  logger.info("Starting RTP packet test");
+
+  // build a first (with quantization tables) and a middle packet of a frame
+  std::string q0(64, 0x10);
+  std::string q1(64, 0x20);
+  std::string scan(1400, 0x55);
+  espp::RtpJpegPacket first(0, 0, 128, 320, 240, q0, q1, scan);
+  first.set_payload_type(26);
+  first.set_sequence_number(1234);
+  first.set_timestamp(90000);
+  first.set_ssrc(0xdeadbeef);
+  first.serialize();
+  espp::RtpJpegPacket middle(0, 1400, 0, 96, 320, 240, scan);
+  middle.set_payload_type(26);
+  middle.set_sequence_number(1235);
+  middle.set_marker(true);
+  middle.set_ssrc(0xdeadbeef);
+  middle.serialize();
+
+  // make sure the view parses the same values as the owning packet
+  for (auto *packet : {&first, &middle}) {
+    espp::RtpJpegPacket parsed(packet->get_data());
+    espp::RtpJpegPacketView view(packet->get_data());
+    bool matches = view.is_valid() &&
+                   view.get_sequence_number() == (uint16_t)parsed.get_sequence_number() &&
+                   view.get_ssrc() == (uint32_t)parsed.get_ssrc() &&
+                   view.get_marker() == parsed.get_marker() &&
+                   view.get_offset() == parsed.get_offset() && view.get_q() == parsed.get_q() &&
+                   view.get_width() == parsed.get_width() &&
+                   view.get_height() == parsed.get_height() &&
+                   view.get_num_q_tables() == parsed.get_num_q_tables() &&
+                   view.get_q_table(0) == parsed.get_q_table(0) &&
+                   view.get_jpeg_data() == parsed.get_jpeg_data();
+    if (!matches) {
+      logger.error("RtpJpegPacketView does not match RtpJpegPacket!");
+      return 1;
+    }
+  }
+  logger.info("RtpJpegPacketView matches RtpJpegPacket");
+
+  // truncated packets must be rejected rather than read out of bounds
+  auto data = first.get_data();
+  for (size_t size : {0, 11, 12, 19, 20, 23, 150}) {
+    espp::RtpJpegPacketView view(data.substr(0, size));
+    if (view.is_valid()) {
+      logger.error("Truncated packet of size {} was considered valid!", size);
+      return 1;
+    }
+  }
+
+  // relay the packet in place with a new ssrc and sequence number
+  std::vector<uint8_t> relayed(data.begin(), data.end());
+  espp::RtpRelay relay({.ssrc = 0x12345678, .initial_sequence_number = 10});
+  bool relayed_ok = relay.relay(relayed);
+  espp::RtpPacketView relayed_view(std::span<const uint8_t>{relayed});
+  logger.info("Relayed packet: ssrc 0x{:08x}, sequence number {}", relayed_view.get_ssrc(),
+              relayed_view.get_sequence_number());
+  // only the sequence number (bytes 2-3) and the ssrc (bytes 8-11) change
+  auto same_except_rewritten = [](std::string_view original, const std::vector<uint8_t> &packet) {
+    if (original.size() != packet.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < packet.size(); i++) {
+      bool rewritten = (i >= 2 && i < 4) || (i >= 8 && i < 12);
+      if (!rewritten && (uint8_t)original[i] != packet[i]) {
+        return false;
+      }
+    }
+    return true;
+  };
+  if (!relayed_ok || relayed_view.get_ssrc() != 0x12345678 ||
+      relayed_view.get_sequence_number() != 10 || !same_except_rewritten(data, relayed)) {
+    logger.error("Relayed packet has ssrc 0x{:08x} and sequence number {}, expected 0x12345678 "
+                 "and 10, with the rest of the packet unchanged",
+                 relayed_view.get_ssrc(), relayed_view.get_sequence_number());
+    return 1;
+  }
+  // the following packets keep their spacing in sequence numbers
+  auto middle_data = middle.get_data();
+  std::vector<uint8_t> relayed_middle(middle_data.begin(), middle_data.end());
+  relayed_ok = relay.relay(relayed_middle);
+  espp::RtpPacketView relayed_middle_view(std::span<const uint8_t>{relayed_middle});
+  if (!relayed_ok || relayed_middle_view.get_ssrc() != 0x12345678 ||
+      relayed_middle_view.get_sequence_number() != 11 ||
+      !same_except_rewritten(middle_data, relayed_middle)) {
+    logger.error("Second relayed packet has ssrc 0x{:08x} and sequence number {}, expected "
+                 "0x12345678 and 11",
+                 relayed_middle_view.get_ssrc(), relayed_middle_view.get_sequence_number());
+    return 1;
+  }
+
+  // now benchmark parsing with the owning packet vs the view
+  static constexpr size_t num_iterations = 1'000'000;
+  auto benchmark = [&](std::string_view name, auto &&parse) {
+    size_t checksum = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < num_iterations; i++) {
+      checksum += parse(i % 2 ? first.get_data() : middle.get_data());
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    float elapsed = std::chrono::duration<float>(end - start).count();
+    logger.info("{}: {:.0f} packets/s (checksum {})", name, num_iterations / elapsed, checksum);
+  };
+  benchmark("RtpJpegPacket    ", [](std::string_view packet_data) -> size_t {
+    espp::RtpJpegPacket packet(packet_data);
+    return packet.get_sequence_number() + packet.get_offset() + packet.get_jpeg_data().size();
+  });
+  benchmark("RtpJpegPacketView", [](std::string_view packet_data) -> size_t {
+    espp::RtpJpegPacketView packet(packet_data);
+    return packet.get_sequence_number() + packet.get_offset() + packet.get_jpeg_data().size();
+  });
+  benchmark("RtpRelay         ", [&](std::string_view) -> size_t {
+    return relay.relay(relayed);
+  });
+
+  logger.info("RTP packet test complete");
+
+  return 0;
+}
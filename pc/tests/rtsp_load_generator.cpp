@@ -0,0 +1,183 @@
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "rtsp_load_generator.hpp"
+#include "rtsp_server.hpp"
+
+using namespace std::chrono_literals;
+
+// Load / soak test for RTSP servers.
+//
+// Usage: rtsp_load_generator [--server <ip>] [--port <port>] [--path <path>]
+//                            [--profile <clients>:<ramp s>:<hold s>,...]
+//                            [--server-pid <pid>] [--json <file>]
+//
+// Without --server, runs a self test against an RtspServer in a child process.
+
+static constexpr int self_test_port = 18555;
+static constexpr int self_test_frame_rate = 30;
+// limits for every playing client in the self test
+static constexpr float max_packet_loss_percent = 1.0f;
+static constexpr float max_median_latency_ms = 50.0f;
+static constexpr float max_latency_ms = 250.0f;
+
+std::vector<espp::RtspLoadGenerator::Stage> parse_profile(const std::string &profile) {
+  std::vector<espp::RtspLoadGenerator::Stage> stages;
+  size_t start = 0;
+  while (start < profile.size()) {
+    size_t end = profile.find(',', start);
+    if (end == std::string::npos) {
+      end = profile.size();
+    }
+    size_t num_clients = 0;
+    float ramp = 0, hold = 0;
+    if (sscanf(profile.substr(start, end - start).c_str(), "%zu:%f:%f", &num_clients, &ramp,
+               &hold) != 3) {
+      return {};
+    }
+    stages.push_back({num_clients, std::chrono::duration<float>(ramp),
+                      std::chrono::duration<float>(hold)});
+    start = end + 1;
+  }
+  return stages;
+}
+
+// stream frames at a fixed rate until killed
+[[noreturn]] void run_server() {
+  espp::RtspServer server({.server_address = "127.0.0.1",
+                           .port = self_test_port,
+                           .path = "/mjpeg/1",
+                           .log_level = espp::Logger::Verbosity::ERROR});
+  server.start();
+  std::string q_table(64, 1);
+  std::string header(espp::JpegHeader(320, 240, q_table, q_table).get_data());
+  std::vector<char> data(header.begin(), header.end());
+  // enough scan data for a few RTP packets per frame
+  data.resize(header.size() + 8 * 1024);
+  for (size_t i = header.size(); i < data.size(); i++) {
+    data[i] = char(i * 7);
+  }
+  espp::JpegFrame frame(data.data(), data.size());
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0;; i++) {
+    std::this_thread::sleep_until(start + i * 1000ms / self_test_frame_rate);
+    server.send_frame(frame);
+  }
+}
+
+int main(int argc, char **argv) {
+  espp::Logger logger({.tag = "RTSP Load Generator", .level = espp::Logger::Verbosity::INFO});
+
+  //! [rtsp load generator example]
+  espp::RtspLoadGenerator::Config config{
+      .server_address = "127.0.0.1",
+      .rtsp_port = self_test_port,
+      .path = "/mjpeg/1",
+      // ramp up to 4 clients, then to 12
+      .profile = {{.num_clients = 4, .ramp_time = 1s, .hold_time = 2s},
+                  {.num_clients = 12, .ramp_time = 2s, .hold_time = 2s}},
+      .sample_period = 500ms,
+      .log_level = espp::Logger::Verbosity::INFO,
+  };
+  //! [rtsp load generator example]
+  std::string json_file;
+  bool self_test = true;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string arg = argv[i];
+    std::string value = argv[i + 1];
+    if (arg == "--server") {
+      config.server_address = value;
+      self_test = false;
+    } else if (arg == "--port") {
+      config.rtsp_port = std::stoi(value);
+    } else if (arg == "--path") {
+      config.path = value;
+    } else if (arg == "--profile") {
+      config.profile = parse_profile(value);
+    } else if (arg == "--server-pid") {
+      config.server_pid = std::stoi(value);
+    } else if (arg == "--json") {
+      json_file = value;
+    } else {
+      logger.error("Unknown argument '{}'", arg);
+      return 1;
+    }
+  }
+  if (config.profile.empty()) {
+    logger.error("Invalid profile, expected <clients>:<ramp s>:<hold s>,...");
+    return 1;
+  }
+
+  pid_t server_pid = -1;
+  if (self_test) {
+    logger.info("Starting RTSP load generator self test");
+    server_pid = fork();
+    if (server_pid == 0) {
+      // do not outlive the test if it fails
+      prctl(PR_SET_PDEATHSIG, SIGKILL);
+      run_server();
+    }
+    config.server_pid = server_pid;
+    // let the server start listening
+    std::this_thread::sleep_for(200ms);
+  }
+
+  //! [rtsp load generator example]
+  espp::RtspLoadGenerator generator(config);
+  auto results = generator.run();
+  fmt::print("{}", results.to_json());
+  //! [rtsp load generator example]
+
+  if (!json_file.empty()) {
+    std::ofstream(json_file) << results.to_json();
+  }
+  if (!self_test) {
+    return 0;
+  }
+  kill(server_pid, SIGKILL);
+  waitpid(server_pid, nullptr, 0);
+
+  // every playing client must get (almost) all frames, without corruption,
+  // loss or excessive latency
+  size_t num_connected = 0;
+  for (const auto &client : results.clients) {
+    if (!client.connected) {
+      continue;
+    }
+    num_connected++;
+    float loss_percent =
+        client.num_packets ? 100.0f * client.num_packets_lost / client.num_packets : 100.0f;
+    if (client.num_invalid_frames > 0 || client.frame_rate < self_test_frame_rate * 0.8f ||
+        loss_percent > max_packet_loss_percent ||
+        client.median_latency_ms > max_median_latency_ms ||
+        client.max_latency_ms > max_latency_ms) {
+      logger.error("Client {} got {} frames ({:.1f} fps), {} invalid, {:.1f}% packets lost, "
+                   "latency {:.1f} ms median / {:.1f} ms max",
+                   client.id, client.num_frames, client.frame_rate, client.num_invalid_frames,
+                   loss_percent, client.median_latency_ms, client.max_latency_ms);
+      return 1;
+    }
+  }
+  if (results.clients.size() != 12 || num_connected == 0) {
+    logger.error("Expected 12 clients with at least one playing, got {} of {}", num_connected,
+                 results.clients.size());
+    return 1;
+  }
+  if (results.samples.empty() || results.samples.back().server_cpu_percent < 0) {
+    logger.error("Expected samples with the server's CPU use");
+    return 1;
+  }
+
+  logger.info("RTSP load generator self test complete");
+
+  return 0;
+}
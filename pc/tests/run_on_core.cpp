@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <chrono>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "task.hpp"
+
+using namespace std::chrono_literals;
+
+int main() {
+  espp::Logger logger({.tag = "Run On Core Test", .level = espp::Logger::Verbosity::INFO});
+
+  logger.info("Starting run on core test");
+
+  // functions returning a value, returning void, and running non-blocking
+  // use the second core if there is one
+  int core_id = std::min(1, (int)std::thread::hardware_concurrency() - 1);
+  auto value = espp::Task::run_on_core([]() { return 42; }, core_id);
+  bool void_ran = false;
+  int void_core = -1;
+  espp::Task::run_on_core(
+      [&]() {
+        void_ran = true;
+        void_core = sched_getcpu();
+      },
+      core_id);
+  auto ran_on_core = espp::Task::run_on_core([]() { return sched_getcpu(); }, core_id);
+  auto future = espp::Task::run_on_core_non_blocking(
+      []() { return fmt::format("hello from core {}", sched_getcpu()); }, 0);
+  // nested calls from within the worker run directly instead of deadlocking
+  auto nested = espp::Task::run_on_core(
+      [&]() { return espp::Task::run_on_core([]() { return 7; }, core_id); }, core_id);
+  auto string_value = future.get();
+  logger.info("run_on_core returned {}, void function ran: {}, non-blocking returned '{}', "
+              "nested returned {}",
+              value, void_ran, string_value, nested);
+  if (value != 42 || !void_ran || string_value != "hello from core 0" || nested != 7) {
+    logger.error("Unexpected result from run_on_core!");
+    return 1;
+  }
+  if (ran_on_core != core_id || void_core != core_id) {
+    logger.error("run_on_core ran on core {} / {}, expected core {}", ran_on_core, void_core,
+                 core_id);
+    return 1;
+  }
+
+  // a call which needs a larger stack replaces the worker, which first
+  // finishes the jobs already queued on it, and a later call with a smaller
+  // stack keeps the larger worker
+  auto stack_size = []() {
+    pthread_attr_t attr;
+    pthread_getattr_np(pthread_self(), &attr);
+    size_t size = 0;
+    pthread_attr_getstacksize(&attr, &size);
+    pthread_attr_destroy(&attr);
+    return size;
+  };
+  static constexpr size_t large_stack_size = 32 * 1024 * 1024;
+  auto queued = espp::Task::run_on_core_non_blocking(
+      []() {
+        std::this_thread::sleep_for(50ms);
+        return 1;
+      },
+      core_id);
+  auto large_stack = espp::Task::run_on_core(stack_size, core_id, large_stack_size);
+  auto default_stack = espp::Task::run_on_core(stack_size, core_id);
+  // nested calls run directly, even if they ask for a larger stack
+  auto nested_large = espp::Task::run_on_core(
+      [&]() { return espp::Task::run_on_core([]() { return 8; }, core_id, 2 * large_stack_size); },
+      core_id);
+  bool queued_ran = queued.wait_for(0s) == std::future_status::ready && queued.get() == 1;
+  logger.info("Worker stack: {} bytes after requesting {}, then {} bytes; queued job ran: {}",
+              large_stack, large_stack_size, default_stack, queued_ran);
+  if (large_stack < large_stack_size || default_stack < large_stack_size || !queued_ran ||
+      nested_large != 8) {
+    logger.error("Worker was not replaced with a larger stack");
+    return 1;
+  }
+
+  // now benchmark the persistent worker against creating a task per call
+  // (which is what run_on_core used to do)
+  static constexpr size_t num_calls = 2000;
+  static constexpr size_t expected_sum = num_calls * (num_calls - 1) / 2;
+  bool sums_match = true;
+  auto benchmark = [&](std::string_view name, auto &&run) {
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t sum = 0;
+    for (size_t i = 0; i < num_calls; i++) {
+      sum += run(i);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    float elapsed_us = std::chrono::duration<float, std::micro>(end - start).count();
+    logger.info("{}: {:.2f} us / call (sum {})", name, elapsed_us / num_calls, sum);
+    sums_match = sums_match && sum == expected_sum;
+  };
+  benchmark("task per call    ", [&](size_t i) -> size_t {
+    std::mutex m;
+    std::condition_variable cv;
+    bool done = false;
+    size_t result = 0;
+    auto task = espp::Task::make_unique(espp::Task::Config{
+        .name = "run_on_core_task",
+        .callback = [&](auto &, auto &) -> bool {
+          result = i;
+          std::lock_guard<std::mutex> lock(m);
+          done = true;
+          cv.notify_all();
+          return true;
+        },
+        .stack_size_bytes = 2048,
+        .priority = 5,
+        .core_id = core_id,
+    });
+    task->start();
+    std::unique_lock<std::mutex> lock(m);
+    cv.wait(lock, [&] { return done; });
+    return result;
+  });
+  benchmark("persistent worker", [&](size_t i) -> size_t {
+    return espp::Task::run_on_core([i]() { return i; }, core_id);
+  });
+  if (!sums_match) {
+    logger.error("Expected every call to return its value (sum {})", expected_sum);
+    return 1;
+  }
+
+  logger.info("Run on core test complete");
+
+  return 0;
+}
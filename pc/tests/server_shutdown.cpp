@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <future>
+#include <vector>
+
+#include "ftp_server.hpp"
+#include "rtsp_server.hpp"
+#include "tcp_socket.hpp"
+
+using namespace std::chrono_literals;
+
+// stop() must not wait for the blocked socket operations to time out
+static constexpr auto max_stop_time = 100ms;
+// if stop() hangs, the test fails instead of hanging too
+static constexpr auto stop_watchdog_time = 5s;
+
+// Repeatedly starts a server, connects a client which never sends a request
+// (so the server's accept task and the session's task are both blocked on a
+// socket), and then stops the server, checking how long stop() takes.
+template <typename Server>
+bool run_cycles(espp::Logger &logger, std::string_view name, Server &server, int port) {
+  static constexpr int num_cycles = 10;
+  std::vector<float> stop_times_ms;
+  for (int i = 0; i < num_cycles; i++) {
+    if (!server.start()) {
+      logger.error("{}: failed to start on cycle {}", name, i);
+      return false;
+    }
+    espp::TcpSocket client({.log_level = espp::Logger::Verbosity::WARN});
+    if (!client.connect({.ip_address = "127.0.0.1", .port = (size_t)port})) {
+      logger.error("{}: client failed to connect on cycle {}", name, i);
+      return false;
+    }
+    // give the server time to accept the connection and block again
+    std::this_thread::sleep_for(50ms);
+    auto start = std::chrono::steady_clock::now();
+    auto stopped = std::async(std::launch::async, [&server] { server.stop(); });
+    if (stopped.wait_for(stop_watchdog_time) != std::future_status::ready) {
+      logger.error("{}: stop() did not return within {} on cycle {}", name, stop_watchdog_time, i);
+      // the future would wait for stop() when destroyed
+      std::_Exit(1);
+    }
+    auto end = std::chrono::steady_clock::now();
+    stop_times_ms.push_back(std::chrono::duration<float, std::milli>(end - start).count());
+  }
+  std::sort(stop_times_ms.begin(), stop_times_ms.end());
+  logger.info("{}: {} start/stop cycles, stop latency (ms) median = {:.2f}, max = {:.2f}", name,
+              num_cycles, stop_times_ms[num_cycles / 2], stop_times_ms.back());
+  if (stop_times_ms.back() > std::chrono::duration<float, std::milli>(max_stop_time).count()) {
+    logger.error("{}: stop() took {:.2f} ms, more than {}", name, stop_times_ms.back(),
+                 max_stop_time);
+    return false;
+  }
+  return true;
+}
+
+int main() {
+  espp::Logger logger({.tag = "Server Shutdown Test", .level = espp::Logger::Verbosity::INFO});
+
+  logger.info("Starting server shutdown test");
+
+  {
+    static constexpr int port = 18554;
+    espp::RtspServer server({.server_address = "127.0.0.1", .port = port, .path = "mjpeg/1"});
+    if (!run_cycles(logger, "RtspServer", server, port)) {
+      return 1;
+    }
+  }
+
+  {
+    static constexpr int port = 18021;
+    espp::FtpServer server("127.0.0.1", port, std::filesystem::temp_directory_path());
+    if (!run_cycles(logger, "FtpServer", server, port)) {
+      return 1;
+    }
+  }
+
+  logger.info("Server shutdown test complete");
+
+  return 0;
+}
@@ -0,0 +1,142 @@
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <numbers>
+#include <random>
+#include <vector>
+
+#include "fft.hpp"
+#include "logger.hpp"
+#include "spectrum.hpp"
+
+// compare the FFT against a direct DFT
+bool test_fft(espp::Logger &logger, size_t size) {
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  std::vector<float> input(size);
+  for (auto &x : input) {
+    x = dist(gen);
+  }
+  espp::RealFft fft(size);
+  std::vector<std::complex<float>> output(fft.get_num_bins());
+  fft.forward(input, output);
+  double max_error = 0;
+  for (size_t k = 0; k < fft.get_num_bins(); k++) {
+    std::complex<double> expected = 0;
+    for (size_t n = 0; n < size; n++) {
+      double angle = -2.0 * std::numbers::pi * double(k * n % size) / double(size);
+      expected += double(input[n]) * std::complex<double>(std::cos(angle), std::sin(angle));
+    }
+    max_error = std::max(max_error, std::abs(expected - std::complex<double>(output[k])));
+  }
+  logger.info("{:5}-point FFT: max error vs DFT {:.2e}", size, max_error);
+  return max_error < 1e-4 * size;
+}
+
+// a tone plus white noise: check the peak, the tone power and the noise floor
+bool test_spectrum(espp::Logger &logger, espp::Spectrum::Window window) {
+  static constexpr float sample_rate_hz = 8000.0f;
+  static constexpr float tone_hz = 1234.5f;
+  static constexpr float tone_amplitude = 0.5f;
+  static constexpr float noise_stddev = 0.05f;
+  size_t num_spectra = 0;
+  espp::Spectrum spectrum({
+      .fft_size = 1024,
+      .sample_rate_hz = sample_rate_hz,
+      .window = window,
+      .num_averages = 16,
+      .callback = [&num_spectra](std::span<const float>) { num_spectra++; },
+  });
+  std::mt19937 gen(7);
+  std::normal_distribution<float> noise(0.0f, noise_stddev);
+  // feed in odd-sized blocks, like an ADC stream would
+  std::vector<float> block(100);
+  size_t sample = 0;
+  size_t returned_spectra = 0;
+  while (num_spectra < 2) {
+    for (auto &x : block) {
+      x = tone_amplitude * std::sin(2.0f * std::numbers::pi_v<float> * tone_hz * sample++ /
+                                    sample_rate_hz) +
+          noise(gen);
+    }
+    returned_spectra += spectrum.feed(block);
+  }
+  auto peak = spectrum.find_peak();
+  float tone_power = spectrum.get_band_power(tone_hz - 50.0f, tone_hz + 50.0f);
+  float expected_tone_power = tone_amplitude * tone_amplitude / 2.0f;
+  float noise_power = spectrum.get_band_power(0, 1000) + spectrum.get_band_power(1500);
+  float expected_noise_power = noise_stddev * noise_stddev * (1.0f - 600.0f / 4000.0f);
+  std::array<espp::Spectrum::Peak, 3> peaks;
+  size_t num_peaks = spectrum.find_peaks(peaks);
+  logger.info("window {}: peak {}, tone power {:.4f} (expected {:.4f}), noise power {:.5f} "
+              "(expected {:.5f})",
+              int(window), peak, tone_power, expected_tone_power, noise_power,
+              expected_noise_power);
+  bool ok = returned_spectra == num_spectra && num_peaks > 0 && peaks[0].psd == peak.psd;
+  ok = ok && std::abs(peak.frequency_hz - tone_hz) < spectrum.get_frequency_resolution() / 4;
+  ok = ok && std::abs(tone_power / expected_tone_power - 1.0f) < 0.05f;
+  ok = ok && std::abs(noise_power / expected_noise_power - 1.0f) < 0.25f;
+  if (!ok) {
+    logger.error("window {}: spectrum is wrong", int(window));
+  }
+  return ok;
+}
+
+void benchmark(espp::Logger &logger, size_t size) {
+  std::vector<float> input(size);
+  std::mt19937 gen(1);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  for (auto &x : input) {
+    x = dist(gen);
+  }
+  espp::RealFft fft(size);
+  std::vector<std::complex<float>> output(fft.get_num_bins());
+  size_t num_iterations = std::max<size_t>(20'000'000 / size, 100);
+  auto start = std::chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < num_iterations; i++) {
+    input[i % size] += 1e-6f;
+    fft.forward(input, output);
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  float fft_us = std::chrono::duration<float, std::micro>(end - start).count() / num_iterations;
+
+  // streaming throughput with 50% overlap (two frames per fft_size samples)
+  espp::Spectrum spectrum({.fft_size = size, .num_averages = 8});
+  size_t num_samples = num_iterations * size / 2;
+  start = std::chrono::high_resolution_clock::now();
+  for (size_t fed = 0; fed < num_samples; fed += size) {
+    spectrum.feed(input);
+  }
+  end = std::chrono::high_resolution_clock::now();
+  float seconds = std::chrono::duration<float>(end - start).count();
+  logger.info("{:5}-point real FFT: {:8.2f} us, spectrum throughput {:6.1f} Msamples/s", size,
+              fft_us, num_samples / seconds / 1e6f);
+}
+
+int main() {
+  espp::Logger logger({.tag = "Spectrum Test", .level = espp::Logger::Verbosity::INFO});
+
+  logger.info("Starting spectrum test");
+
+  for (size_t size : {4, 8, 64, 1024, 4096}) {
+    if (!test_fft(logger, size)) {
+      logger.error("{}-point FFT is wrong", size);
+      return 1;
+    }
+  }
+  using Window = espp::Spectrum::Window;
+  // (the tone is between bins, so the rectangular window leaks too much)
+  for (auto window : {Window::HANN, Window::HAMMING, Window::BLACKMAN, Window::BLACKMAN_HARRIS,
+                      Window::FLAT_TOP}) {
+    if (!test_spectrum(logger, window)) {
+      return 1;
+    }
+  }
+  for (size_t size = 1024; size <= 16384; size *= 2) {
+    benchmark(logger, size);
+  }
+
+  logger.info("Spectrum test complete");
+
+  return 0;
+}
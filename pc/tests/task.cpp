@@ -1,30 +1,47 @@
+#include "clock.hpp"
 #include "task.hpp"
 
 using namespace std::chrono_literals;
 
 int main() {
 
-  static auto start = std::chrono::steady_clock::now();
+  // run the test in simulated time so that it is deterministic and runs much
+  // faster than real time
+  espp::Clock::set_simulated(true);
+  espp::Clock::Participant participant;
+
+  static auto start = espp::Clock::now();
   static auto elapsed = []() -> float {
-    return std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+    return std::chrono::duration<float>(espp::Clock::now() - start).count();
   };
 
   espp::Logger logger({.tag = "Task Test", .level = espp::Logger::Verbosity::INFO});
 
   logger.info("Starting task test");
 
-  espp::Task task({.name = "Task", .callback = [&](auto &m, auto &cv) -> bool {
-                     auto now = std::chrono::steady_clock::now();
-                     logger.info("[{:.3f}] Hello from the task!", elapsed());
-                     std::this_thread::sleep_until(now + 1s);
-                     // don't want to stop the task
-                     return false;
-                   }});
-  task.start();
-
-  std::this_thread::sleep_for(10s);
+  std::atomic<int> iterations{0};
+  {
+    espp::Task task({.name = "Task", .callback = [&](auto &m, auto &cv) -> bool {
+                       auto now = espp::Clock::now();
+                       logger.info("[{:.3f}] Hello from the task!", elapsed());
+                       iterations++;
+                       std::unique_lock<std::mutex> lock(m);
+                       espp::Clock::wait_until(cv, lock, now + 1s);
+                       // don't want to stop the task
+                       return false;
+                     }});
+    task.start();
+
+    espp::Clock::sleep_for(10s);
+  }
 
   logger.info("Stopping task test");
 
+  // the task runs at t = 0, 1, ..., 9 s
+  if (iterations != 10) {
+    logger.error("Expected 10 iterations, got {}", iterations.load());
+    return 1;
+  }
+
   return 0;
 }
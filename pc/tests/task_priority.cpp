@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "task.hpp"
+
+using namespace std::chrono_literals;
+
+// The thread attributes a Task's thread actually ran with
+struct ThreadInfo {
+  size_t stack_size{0};
+  std::string name;
+  cpu_set_t affinity{};
+  int policy{-1};
+};
+
+// Start a task with the given config and return the attributes of its thread
+std::optional<ThreadInfo> get_thread_info(const espp::Task::BaseConfig &task_config) {
+  ThreadInfo info;
+  espp::Task task({.callback =
+                       [&info]() -> bool {
+                         auto self = pthread_self();
+                         pthread_attr_t attr;
+                         if (pthread_getattr_np(self, &attr) == 0) {
+                           pthread_attr_getstacksize(&attr, &info.stack_size);
+                           pthread_attr_destroy(&attr);
+                         }
+                         char name[16] = {0};
+                         pthread_getname_np(self, name, sizeof(name));
+                         info.name = name;
+                         pthread_getaffinity_np(self, sizeof(info.affinity), &info.affinity);
+                         sched_param param{};
+                         pthread_getschedparam(self, &info.policy, &param);
+                         return true;
+                       },
+                   .task_config = task_config});
+  if (!task.start()) {
+    return {};
+  }
+  while (task.is_started()) {
+    std::this_thread::sleep_for(1ms);
+  }
+  return info;
+}
+
+// Checks that the stack size, name, and core affinity of the Task::BaseConfig
+// are applied to the thread. Then measures the wakeup latency of a periodic
+// task while every core is kept busy by CPU-bound background tasks, first with
+// the default task configuration and then with the task pinned to a core and
+// given a high priority.
+int main() {
+  espp::Logger logger({.tag = "Task Priority Test", .level = espp::Logger::Verbosity::INFO});
+
+  logger.info("Starting task priority test");
+
+  static constexpr auto period = 1ms;
+  static constexpr auto test_duration = 2s;
+  int num_cores = std::max(1u, std::thread::hardware_concurrency());
+
+  cpu_set_t process_affinity;
+  sched_getaffinity(0, sizeof(process_affinity), &process_affinity);
+
+  // stack sizes larger than the host's default, name and core affinity are
+  // applied
+  pthread_attr_t default_attr;
+  pthread_attr_init(&default_attr);
+  size_t default_stack_size = 0;
+  pthread_attr_getstacksize(&default_attr, &default_stack_size);
+  pthread_attr_destroy(&default_attr);
+  size_t stack_size = default_stack_size * 2;
+  auto info = get_thread_info(
+      {.name = "thread attributes task", .stack_size_bytes = stack_size, .core_id = 0});
+  if (!info || info->stack_size < stack_size || info->name != "thread attribut" ||
+      CPU_COUNT(&info->affinity) != 1 || !CPU_ISSET(0, &info->affinity)) {
+    logger.error("Thread attributes were not applied");
+    return 1;
+  }
+  logger.info("Applied stack size {} B, name '{}', pinned to core 0", info->stack_size,
+              info->name);
+
+  // smaller (ESP sized) stacks get the host's default stack size
+  info = get_thread_info({.name = "default stack"});
+  if (!info || info->stack_size < default_stack_size) {
+    logger.error("Task with the default stack size got {} B, expected at least {} B",
+                 info ? info->stack_size : 0, default_stack_size);
+    return 1;
+  }
+  logger.info("Default stack size {} B", info->stack_size);
+
+  // a core which does not exist is ignored rather than failing to start
+  info = get_thread_info({.name = "missing core", .core_id = num_cores + 1});
+  if (!info || !CPU_EQUAL(&info->affinity, &process_affinity)) {
+    logger.error("Task with core_id {} should run unpinned", num_cores + 1);
+    return 1;
+  }
+
+  // real-time scheduling is opt-in
+  info = get_thread_info({.name = "priority", .priority = 50});
+  if (!info || info->policy != SCHED_OTHER) {
+    logger.error("Task should not use real-time scheduling unless enabled");
+    return 1;
+  }
+
+  // start CPU-bound background load on every core
+  std::vector<std::unique_ptr<espp::Task>> load_tasks;
+  for (int i = 0; i < num_cores * 2; i++) {
+    load_tasks.push_back(espp::Task::make_unique(
+        {.callback =
+             []() -> bool {
+               volatile float x = 1.0f;
+               for (int j = 0; j < 100'000; j++) {
+                 x = x * 1.000001f + 0.5f;
+               }
+               return false;
+             },
+         .task_config = {.name = fmt::format("load {}", i)}}));
+    load_tasks.back()->start();
+  }
+
+  auto measure_latency = [&](const espp::Task::BaseConfig &task_config) {
+    std::vector<float> latencies_us;
+    latencies_us.reserve(test_duration / period);
+    auto next_wakeup = std::chrono::steady_clock::now() + period;
+    espp::Task task({.callback =
+                         [&](auto &m, auto &cv) -> bool {
+                           {
+                             std::unique_lock<std::mutex> lock(m);
+                             if (cv.wait_until(lock, next_wakeup) == std::cv_status::no_timeout) {
+                               return true;
+                             }
+                           }
+                           auto now = std::chrono::steady_clock::now();
+                           latencies_us.push_back(
+                               std::chrono::duration<float, std::micro>(now - next_wakeup)
+                                   .count());
+                           next_wakeup += period;
+                           return latencies_us.size() >= latencies_us.capacity();
+                         },
+                     .task_config = task_config,
+                     .log_level = espp::Logger::Verbosity::INFO});
+    task.start();
+    while (task.is_started()) {
+      std::this_thread::sleep_for(100ms);
+    }
+    std::sort(latencies_us.begin(), latencies_us.end());
+    auto percentile = [&](float p) {
+      return latencies_us[std::min(latencies_us.size() - 1, size_t(p * latencies_us.size()))];
+    };
+    logger.info("{}: wakeup latency (us) p50 = {:.1f}, p99 = {:.1f}, max = {:.1f}",
+                task_config.name, percentile(0.50f), percentile(0.99f), latencies_us.back());
+  };
+
+  measure_latency({.name = "default"});
+  espp::Task::set_realtime_scheduling(true);
+  measure_latency({.name = "pinned priority", .priority = 50, .core_id = 0});
+
+  espp::Task::set_realtime_scheduling(false);
+  load_tasks.clear();
+
+  logger.info("Task priority test complete");
+
+  return 0;
+}
@@ -0,0 +1,191 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "alloc_counter.hpp"
+#include "task.hpp"
+#include "task_snapshot.hpp"
+
+using namespace std::chrono_literals;
+
+// what TaskMonitor::get_latest_info_vector() provides
+struct TaskInfo {
+  std::string name;
+  uint32_t cpu_percent;
+  uint32_t high_water_mark;
+  uint32_t priority;
+  int core_id;
+};
+
+// the string based way of getting the same information: list the threads,
+// read their stat files into strings, split them into fields, and format the
+// result like TaskMonitor::get_latest_info_string()
+std::string get_info_string() {
+  std::vector<TaskInfo> task_info;
+  for (const auto &entry : std::filesystem::directory_iterator("/proc/self/task")) {
+    std::ifstream file(entry.path() / "stat");
+    std::string stat;
+    std::getline(file, stat);
+    auto name_start = stat.find('(');
+    auto name_end = stat.rfind(')');
+    if (name_start == std::string::npos || name_end == std::string::npos) {
+      continue;
+    }
+    std::istringstream fields(stat.substr(name_end + 2));
+    std::vector<std::string> values;
+    std::string value;
+    while (fields >> value) {
+      values.push_back(value);
+    }
+    if (values.size() < 38) {
+      continue;
+    }
+    // values[0] is field 3 (the state)
+    uint64_t run_time = std::stoull(values[11]) + std::stoull(values[12]);
+    task_info.push_back({stat.substr(name_start + 1, name_end - name_start - 1),
+                         uint32_t(run_time), 0, uint32_t(std::stoul(values[37])),
+                         std::stoi(values[36])});
+  }
+  std::string info = "";
+  for (const auto &t : task_info) {
+    info += fmt::format("{},{},{},{},{};", t.name, t.cpu_percent, t.high_water_mark, t.priority,
+                        t.core_id);
+  }
+  return info;
+}
+
+const espp::TaskStats *find(const espp::TaskSnapshot<> &snapshot, std::string_view name) {
+  for (const auto &t : snapshot) {
+    if (name == t.name) {
+      return &t;
+    }
+  }
+  return nullptr;
+}
+
+int main() {
+  espp::Logger logger({.tag = "TaskSnapshot Test", .level = espp::Logger::Verbosity::INFO});
+
+  logger.info("Starting TaskSnapshot test");
+
+  static espp::TaskSnapshot<> snapshot;
+
+  // a task busy for half of the time, and one which is mostly sleeping
+  auto busy = espp::Task::make_unique(espp::Task::AdvancedConfig{
+      .callback = [](auto &, auto &) {
+        auto end = std::chrono::steady_clock::now() + 5ms;
+        while (std::chrono::steady_clock::now() < end) {
+        }
+        std::this_thread::sleep_for(5ms);
+        return false;
+      },
+      .task_config = {.name = "busy"},
+  });
+  auto idle = espp::Task::make_unique(espp::Task::AdvancedConfig{
+      .callback = [](auto &, auto &) {
+        std::this_thread::sleep_for(10ms);
+        return false;
+      },
+      .task_config = {.name = "idle"},
+  });
+  busy->start();
+  idle->start();
+  std::this_thread::sleep_for(100ms);
+  snapshot.update();
+  std::this_thread::sleep_for(1s);
+  size_t allocations_before = num_allocations;
+  bool updated = snapshot.update();
+  size_t update_allocations = num_allocations - allocations_before;
+  busy.reset();
+  idle.reset();
+
+  for (const auto &t : snapshot) {
+    logger.info("{:>8} {:16} {:5.1f}% run time {} ms, core {}", t.id, t.name, t.cpu_percent,
+                t.run_time_us / 1000, t.core_id);
+  }
+  auto *busy_stats = find(snapshot, "busy");
+  auto *idle_stats = find(snapshot, "idle");
+  float interval_s = std::chrono::duration<float>(snapshot.get_interval()).count();
+  if (!updated || update_allocations != 0 || !busy_stats || !idle_stats || interval_s < 0.9f ||
+      busy_stats->cpu_percent < 30.0f || busy_stats->cpu_percent > 70.0f ||
+      idle_stats->cpu_percent > 5.0f) {
+    logger.error("Unexpected snapshot: {} tasks over {:.2f} s, {} allocations", snapshot.size(),
+                 interval_s, update_allocations);
+    return 1;
+  }
+
+  // a snapshot which can not hold all the threads fails, and is empty
+  {
+    espp::TaskSnapshot<1> small;
+    std::thread other([] { std::this_thread::sleep_for(100ms); });
+    bool small_updated = small.update();
+    other.join();
+    if (small_updated || small.size() != 0) {
+      logger.error("A snapshot with too many tasks should fail");
+      return 1;
+    }
+  }
+
+  // benchmark: the cost of a snapshot vs the string based path, with 16
+  // threads
+  {
+    std::atomic<bool> done{false};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 15; i++) {
+      threads.emplace_back([&done] {
+        while (!done) {
+          std::this_thread::sleep_for(10ms);
+        }
+      });
+    }
+    static constexpr int num_iterations = 2000;
+    auto start = std::chrono::steady_clock::now();
+    allocations_before = num_allocations;
+    for (int i = 0; i < num_iterations; i++) {
+      snapshot.update();
+    }
+    float snapshot_us =
+        std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count() /
+        num_iterations;
+    float snapshot_allocations = float(num_allocations - allocations_before) / num_iterations;
+    size_t snapshot_size = snapshot.size();
+
+    size_t info_size = 0;
+    start = std::chrono::steady_clock::now();
+    allocations_before = num_allocations;
+    for (int i = 0; i < num_iterations; i++) {
+      info_size += get_info_string().size();
+    }
+    float string_us =
+        std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count() /
+        num_iterations;
+    float string_allocations = float(num_allocations - allocations_before) / num_iterations;
+    done = true;
+    for (auto &thread : threads) {
+      thread.join();
+    }
+
+    logger.info("Snapshot of {} threads:", snapshot_size);
+    logger.info("  TaskSnapshot::update(): {:6.1f} us, {:5.1f} allocations", snapshot_us,
+                snapshot_allocations);
+    logger.info("  string based:           {:6.1f} us, {:5.1f} allocations", string_us,
+                string_allocations);
+    if (snapshot_size < 16 || info_size == 0 || snapshot_allocations > 0 ||
+        snapshot_us >= string_us) {
+      logger.error("TaskSnapshot should be cheaper than the string based path");
+      return 1;
+    }
+  }
+
+  logger.info("TaskSnapshot test complete");
+
+  return 0;
+}
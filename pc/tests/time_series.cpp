@@ -0,0 +1,240 @@
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "logger.hpp"
+#include "time_series.hpp"
+
+// 100 Hz telemetry sample, like a sensor task would log / stream
+struct Telemetry {
+  uint32_t timestamp_ms;
+  float temperature;
+  float pressure;
+  double latitude;
+  int16_t accel_x;
+  int16_t accel_y;
+  int16_t accel_z;
+  uint16_t adc;
+  uint8_t status;
+  bool charging;
+};
+
+enum class Mode : uint8_t { IDLE, RUNNING, FAULT };
+
+struct EdgeCase {
+  int64_t i64;
+  uint64_t u64;
+  int8_t i8;
+  Mode mode;
+  float f;
+  double d;
+};
+
+std::vector<Telemetry> make_telemetry(size_t num_samples) {
+  std::mt19937 gen(1);
+  std::normal_distribution<float> noise(0.0f, 1.0f);
+  std::vector<Telemetry> samples(num_samples);
+  for (size_t i = 0; i < num_samples; i++) {
+    auto &s = samples[i];
+    // 100 Hz, with a little jitter
+    s.timestamp_ms = uint32_t(i * 10 + (i % 7 == 0 ? 1 : 0));
+    // quantized sensor readings, which change slowly
+    s.temperature = 25.0f + std::round(std::sin(i / 500.0f) * 16.0f) * 0.0625f;
+    s.pressure = 1013.25f + std::round(noise(gen) * 4) * 0.25f;
+    s.latitude = 47.6062 + (i / 10) * 1e-6;
+    s.accel_x = int16_t(noise(gen) * 8);
+    s.accel_y = int16_t(noise(gen) * 8);
+    s.accel_z = int16_t(1000 + noise(gen) * 8);
+    s.adc = uint16_t(2048 + 1000 * std::sin(i / 100.0f) + noise(gen) * 2);
+    s.status = i < num_samples / 2 ? 1 : 3;
+    s.charging = i % 1000 < 500;
+  }
+  return samples;
+}
+
+template <class T> bool bitwise_equal(const std::vector<T> &a, const std::vector<T> &b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); i++) {
+    using espp::detail::field_to_bits;
+    bool equal = true;
+    auto fa = espp::detail::tie_fields(const_cast<T &>(a[i]));
+    auto fb = espp::detail::tie_fields(const_cast<T &>(b[i]));
+    std::apply(
+        [&](const auto &...x) {
+          std::apply(
+              [&](const auto &...y) {
+                ((equal = equal && field_to_bits(x) == field_to_bits(y)), ...);
+              },
+              fb);
+        },
+        fa);
+    if (!equal) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int main() {
+  espp::Logger logger({.tag = "Time Series Test", .level = espp::Logger::Verbosity::INFO});
+
+  logger.info("Starting time series test");
+
+  // telemetry: size, speed and exact round trip
+  {
+    static constexpr size_t num_samples = 6000; // one minute at 100 Hz
+    auto samples = make_telemetry(num_samples);
+    espp::TimeSeriesEncoder<Telemetry> encoder;
+    espp::TimeSeriesDecoder<Telemetry> decoder;
+    std::vector<uint8_t> encoded;
+    std::vector<Telemetry> decoded;
+    std::error_code ec;
+
+    static constexpr int num_iterations = 50;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < num_iterations; i++) {
+      encoded.clear();
+      encoder.encode(samples, encoded);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    float encode_ns = std::chrono::duration<float, std::nano>(end - start).count() /
+                      (num_iterations * num_samples);
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < num_iterations; i++) {
+      decoder.decode(encoded, decoded, ec);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    float decode_ns = std::chrono::duration<float, std::nano>(end - start).count() /
+                      (num_iterations * num_samples);
+
+    if (ec || !bitwise_equal(samples, decoded)) {
+      logger.error("Telemetry round trip failed: {}", ec.message());
+      return 1;
+    }
+    // size of the fields, without padding
+    size_t fixed_size = 4 + 4 + 4 + 8 + 2 + 2 + 2 + 2 + 1 + 1;
+    float bytes_per_sample = float(encoded.size()) / num_samples;
+    logger.info("Telemetry: {:.2f} bytes / sample (fixed width {} bytes, {:.1f}x), encode "
+                "{:.1f} ns / sample, decode {:.1f} ns / sample",
+                bytes_per_sample, fixed_size, fixed_size / bytes_per_sample, encode_ns, decode_ns);
+    std::string codecs;
+    for (auto codec : encoder.get_selected_codecs()) {
+      codecs += fmt::format("{} ", codec);
+    }
+    logger.info("Selected codecs: {}", codecs);
+    if (bytes_per_sample > fixed_size / 3.0f) {
+      logger.error("Telemetry should compress at least 3x");
+      return 1;
+    }
+  }
+
+  // every codec round trips every field type, including extreme values
+  {
+    std::mt19937_64 gen(2);
+    std::vector<EdgeCase> samples;
+    for (int i = 0; i < 300; i++) {
+      EdgeCase s{};
+      if (i % 3 == 0) {
+        s = {std::numeric_limits<int64_t>::min(), std::numeric_limits<uint64_t>::max(),
+             std::numeric_limits<int8_t>::min(), Mode::FAULT, -0.0f,
+             std::numeric_limits<double>::quiet_NaN()};
+      } else if (i % 3 == 1) {
+        s = {std::numeric_limits<int64_t>::max(), 0, std::numeric_limits<int8_t>::max(), Mode::IDLE,
+             std::numeric_limits<float>::infinity(), std::numeric_limits<double>::denorm_min()};
+      } else {
+        uint64_t r = gen();
+        s = {int64_t(r), r, int8_t(r), Mode(r % 3), std::bit_cast<float>(uint32_t(r)),
+             std::bit_cast<double>(r)};
+      }
+      samples.push_back(s);
+    }
+    espp::TimeSeriesDecoder<EdgeCase> decoder;
+    for (uint8_t c = 0; c <= uint8_t(espp::TimeSeriesCodec::XOR); c++) {
+      auto codec = espp::TimeSeriesCodec(c);
+      for (size_t n : {size_t(0), size_t(1), size_t(2), size_t(31), size_t(33), samples.size()}) {
+        std::vector<EdgeCase> input(samples.begin(), samples.begin() + n);
+        espp::TimeSeriesEncoder<EdgeCase> encoder({codec, codec, codec, codec, codec, codec});
+        std::vector<uint8_t> encoded;
+        std::vector<EdgeCase> decoded;
+        std::error_code ec;
+        encoder.encode(input, encoded);
+        if (!decoder.decode(encoded, decoded, ec) || !bitwise_equal(input, decoded)) {
+          logger.error("Round trip of {} samples with codec {} failed: {}", n, codec,
+                       ec.message());
+          return 1;
+        }
+      }
+    }
+    logger.info("Edge cases round trip with every codec");
+  }
+
+  // constant columns are bit-packed with a width of 0, i.e. 1 byte per 32
+  // samples, and still decode
+  {
+    struct Constant {
+      uint8_t a;
+      uint16_t b;
+    };
+    std::vector<Constant> samples(10000, Constant{7, 1234});
+    espp::TimeSeriesEncoder<Constant> encoder;
+    espp::TimeSeriesDecoder<Constant> decoder;
+    std::vector<uint8_t> encoded;
+    std::vector<Constant> decoded;
+    std::error_code ec;
+    encoder.encode(samples, encoded);
+    if (!decoder.decode(encoded, decoded, ec) || !bitwise_equal(samples, decoded)) {
+      logger.error("Round trip of {} constant samples ({} bytes) failed: {}", samples.size(),
+                   encoded.size(), ec.message());
+      return 1;
+    }
+    logger.info("{} constant samples round trip in {} bytes", samples.size(), encoded.size());
+  }
+
+  // schema mismatch and corruption are detected
+  {
+    auto samples = make_telemetry(1000);
+    espp::TimeSeriesEncoder<Telemetry> encoder;
+    std::vector<uint8_t> encoded;
+    encoder.encode(samples, encoded);
+    std::error_code ec;
+    std::vector<EdgeCase> wrong_type;
+    espp::TimeSeriesDecoder<EdgeCase> edge_decoder;
+    if (edge_decoder.decode(encoded, wrong_type, ec) || ec != std::errc::invalid_argument) {
+      logger.error("Schema mismatch not detected");
+      return 1;
+    }
+    espp::TimeSeriesDecoder<Telemetry> decoder;
+    std::vector<Telemetry> decoded;
+    for (size_t size = 0; size < encoded.size(); size += 7) {
+      ec.clear();
+      std::span<const uint8_t> truncated(encoded.data(), size);
+      if (decoder.decode(truncated, decoded, ec)) {
+        logger.error("Truncation to {} bytes not detected", size);
+        return 1;
+      }
+    }
+    // flipping bits must never crash, and mostly fails or changes the data
+    std::mt19937 gen(3);
+    int num_detected = 0;
+    static constexpr int num_trials = 2000;
+    for (int i = 0; i < num_trials; i++) {
+      auto corrupted = encoded;
+      corrupted[gen() % corrupted.size()] ^= uint8_t(1 << (gen() % 8));
+      ec.clear();
+      if (!decoder.decode(corrupted, decoded, ec) || !bitwise_equal(samples, decoded)) {
+        num_detected++;
+      }
+    }
+    logger.info("Corruption: {} / {} single bit flips changed or failed the decode", num_detected,
+                num_trials);
+  }
+
+  logger.info("Time series test complete");
+
+  return 0;
+}
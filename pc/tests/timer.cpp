@@ -1,32 +1,54 @@
+#include "clock.hpp"
 #include "timer.hpp"
 
 using namespace std::chrono_literals;
 
 int main() {
 
-  static auto start = std::chrono::system_clock::now();
+  // run the test in simulated time so that it is deterministic and runs much
+  // faster than real time
+  espp::Clock::set_simulated(true);
+  // the main thread participates in the simulation, so time only advances
+  // while both it and the timer are waiting
+  espp::Clock::Participant participant;
+
+  static auto start = espp::Clock::now();
   static auto elapsed = []() -> float {
-    return std::chrono::duration<float>(std::chrono::system_clock::now() - start).count();
+    return std::chrono::duration<float>(espp::Clock::now() - start).count();
   };
 
   espp::Logger logger({.tag = "Timer Test", .level = espp::Logger::Verbosity::INFO});
 
   logger.info("Starting timer test");
 
-  espp::Timer timer({.name = "Timer",
-                     .period = 0.100s,
-                     .delay = 0.0s,
-                     .callback = [&]() -> bool {
-                       static int iterations = 0;
-                       logger.info("[{:.3f}] timer fired {}", elapsed(), iterations++);
-                       // don't want to stop the timer
-                       return false;
-                     },
-                     .log_level = espp::Logger::Verbosity::DEBUG});
-
-  std::this_thread::sleep_for(10s);
-
-  logger.info("Stopping timer test");
+  std::atomic<int> iterations{0};
+  auto real_start = std::chrono::steady_clock::now();
+  {
+    espp::Timer timer({.name = "Timer",
+                       .period = 0.100s,
+                       .delay = 0.0s,
+                       .callback = [&]() -> bool {
+                         logger.info("[{:.3f}] timer fired {}", elapsed(), iterations++);
+                         // don't want to stop the timer
+                         return false;
+                       },
+                       .log_level = espp::Logger::Verbosity::DEBUG});
+
+    espp::Clock::sleep_for(10s);
+  }
+  auto real_elapsed =
+      std::chrono::duration<float>(std::chrono::steady_clock::now() - real_start).count();
+
+  logger.info("Stopping timer test, {} iterations in {:.3f} s simulated / {:.3f} s real",
+              iterations.load(), elapsed(), real_elapsed);
+
+  // the timer fires at t = 0, 0.1, ..., 9.9 s. The main thread started waiting
+  // for t = 10 s before the timer did, so it is woken (and stops the timer)
+  // first.
+  if (iterations != 100) {
+    logger.error("Expected 100 iterations, got {}", iterations.load());
+    return 1;
+  }
 
   return 0;
 }